@@ -0,0 +1,142 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Stress test of SmartMeter238Snapshot on ESP32: one task publishes samples whose fields all come from one
+// counter, several tasks read snapshots as fast as they can and check that every field of a copy comes from the
+// same sample. Prints the throughput, the read retries and the torn copies (must be 0). No meter is needed.
+
+#include <Arduino.h>
+
+#include <SmartMeter238.h>           //import SmartMeter238 library
+#include <SmartMeter238Snapshot.h>   //import SmartMeter238 snapshots
+
+#define READER_TASKS 3
+
+//-----------------------------------------------------------------------
+
+HardwareSerial &debug = Serial;
+
+//-----------------------------------------------------------------------
+
+SmartMeter238Snapshot snapshot;
+
+// Data storage, only used by the publish task
+SmartMeter238::smartMeterData smData;
+
+volatile uint32_t writeCount = 0;
+volatile uint32_t readCount[READER_TASKS];
+volatile uint32_t tornCount = 0;
+volatile uint32_t outOfOrderCount = 0;
+
+void fill(SmartMeter238::smartMeterData *data, uint32_t value) {
+    float v = value & 0xFFFFFF;   // exact in a float
+
+    data->measurementData.time = value;
+    data->measurementData.data.current = v;
+    data->measurementData.data.voltage = v;
+    data->measurementData.data.activePower = v;
+    data->measurementData.data.lapseOfTimeTotalEnergy = v;
+    data->limitAndPurchaseData.data.energyPurchaseBalance = v;
+}
+
+bool consistent(SmartMeter238::smartMeterData *data) {
+    float v = data->measurementData.time & 0xFFFFFF;
+
+    return data->measurementData.data.current == v && data->measurementData.data.voltage == v && data->measurementData.data.activePower == v &&
+           data->measurementData.data.lapseOfTimeTotalEnergy == v && data->limitAndPurchaseData.data.energyPurchaseBalance == v;
+}
+
+void publishTask(void *parameter) {
+    while (true) {
+        fill(&smData, writeCount + 1);
+        snapshot.publish(&smData);
+
+        writeCount++;
+
+        if ((writeCount % 1000) == 0) {
+            vTaskDelay(1);
+        }
+    }
+}
+
+void readerTask(void *parameter) {
+    uint8_t id = (uint32_t)parameter;
+
+    SmartMeter238::smartMeterData readData;
+    uint32_t lastVersion = 0;
+
+    while (true) {
+        uint32_t version = snapshot.read(&readData);
+
+        if (version > 0 && !consistent(&readData)) {
+            tornCount++;
+        }
+
+        if (version < lastVersion) {
+            outOfOrderCount++;
+        }
+
+        lastVersion = version;
+
+        readCount[id]++;
+    }
+}
+
+void setup() {
+    debug.begin(115200);   // Start Serial Debug
+
+    xTaskCreatePinnedToCore(publishTask, "publish", 4096, nullptr, 2, nullptr, 1);
+
+    for (uint32_t i = 0; i < READER_TASKS; i++) {
+        xTaskCreatePinnedToCore(readerTask, "reader", 4096, (void *)i, 1, nullptr, i % 2);
+    }
+}
+
+void loop() {
+    static uint32_t lastWrites = 0;
+    static uint32_t lastReads = 0;
+
+    delay(10000);
+
+    uint32_t reads = 0;
+
+    for (uint8_t i = 0; i < READER_TASKS; i++) {
+        reads += readCount[i];
+    }
+
+    debug.print("writes/s:\t");      debug.println((writeCount - lastWrites) / 10.0);
+    debug.print("reads/s:\t");       debug.println((reads - lastReads) / 10.0);
+    debug.print("retries:\t");       debug.println(snapshot.getRetryCount(true));
+    debug.print("torn:\t\t");        debug.println(tornCount);
+    debug.print("out of order:\t");  debug.println(outOfOrderCount);
+    debug.print("version:\t");       debug.println(snapshot.getVersion());
+    debug.println();
+
+    lastWrites = writeCount;
+    lastReads = reads;
+}
@@ -0,0 +1,238 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Emulator of a DDS238-4 (or DTS238-7 with threePhase) on the Tuya protocol, used in place of the UART. The
+// three phase frame uses the same unverified offsets as SmartMeter238ModelDTS238_7.
+// The request is echoed at once and the answer is released after answerDelay, one byte every byteTime.
+
+#ifndef FakeMeter_h
+#define FakeMeter_h
+
+#include "Arduino.h"
+
+#include <deque>
+#include <vector>
+
+class FakeMeter : public Stream {
+   public:
+    unsigned long answerDelay = 20000;   // micros from the request to the answer
+    unsigned long byteTime = 0;          // micros between answer bytes, 0 all at once
+
+    // Measurement, raw units of the frame
+    uint32_t current = 5123;   // mA
+    uint16_t voltage = 2301;   // dV
+    uint16_t frequency = 5002;   // cHz
+    uint8_t activePowerInt = 1;
+    uint16_t activePowerFrac = 2345;
+    uint8_t reactivePowerInt = 0;
+    uint16_t reactivePowerFrac = 1234;
+    uint16_t powerFactor = 987;
+    uint32_t totalEnergy = 12345;   // cKWh
+    uint32_t importEnergy = 12000;
+    uint32_t exportEnergy = 345;
+    bool threePhase = false;   // phase n: current * (n + 1), voltage + 10 * n
+
+    // Power cut and limits
+    bool powerOn = true;
+    uint16_t delayMinutes = 0;
+    uint32_t purchaseBalance = 10000;   // cKWh
+    uint8_t purchaseStatus = 1;
+
+    uint32_t requestCount = 0;
+
+    std::vector<uint8_t> measurementFrame() {
+        std::vector<uint8_t> frame = this->header(0x43, 0x0B);
+
+        this->put(frame, 5, this->current, 3);
+        this->put(frame, 14, this->voltage, 2);
+        frame[20] = this->reactivePowerInt;
+        this->put(frame, 21, this->reactivePowerFrac, 2);
+        frame[32] = this->activePowerInt;
+        this->put(frame, 33, this->activePowerFrac, 2);
+        this->put(frame, 44, this->powerFactor, 2);
+
+        if (this->threePhase) {
+            for (uint8_t i = 0; i < 3; i++) {
+                this->put(frame, 5 + 3 * i, this->current * (i + 1), 3);
+                this->put(frame, 14 + 2 * i, this->voltage + 10 * i, 2);
+                frame[23 + 3 * i] = 0;
+                this->put(frame, 24 + 3 * i, 100 * (i + 1), 2);
+                frame[35 + 3 * i] = i;
+                this->put(frame, 36 + 3 * i, 1000 * (i + 1), 2);
+                this->put(frame, 46 + 2 * i, 900 + i, 2);
+            }
+        }
+
+        this->put(frame, 52, this->frequency, 2);
+        this->put(frame, 54, this->totalEnergy, 4);
+        this->put(frame, 58, this->importEnergy, 4);
+        this->put(frame, 62, this->exportEnergy, 4);
+
+        return this->close(frame);
+    }
+
+    std::vector<uint8_t> powerCutFrame() {
+        std::vector<uint8_t> frame = this->header(0x15, 0x01);
+
+        frame[6] = this->powerOn;
+        this->put(frame, 16, this->delayMinutes, 2);
+
+        return this->close(frame);
+    }
+
+    std::vector<uint8_t> limitsFrame() {
+        std::vector<uint8_t> frame = this->header(0x19, 0x08);
+
+        this->put(frame, 5, 270, 2);
+        this->put(frame, 7, 175, 2);
+        this->put(frame, 9, 5000, 2);
+        this->put(frame, 15, this->purchaseBalance, 4);
+        frame[23] = this->purchaseStatus;
+
+        return this->close(frame);
+    }
+
+    size_t write(uint8_t byte) override {
+        this->request.push_back(byte);
+
+        if (this->request[0] != 0x48) {
+            this->request.clear();
+        } else if (this->request.size() >= 2 && this->request.size() == this->request[1]) {
+            this->answer();
+            this->request.clear();
+        }
+
+        return 1;
+    }
+    using Print::write;
+
+    int available() override {
+        uint64_t now = micros64();
+        int n = 0;
+
+        for (const smByte &b : this->output) {
+            if (b.due > now) {
+                break;
+            }
+
+            n++;
+        }
+
+        return n;
+    }
+    int read() override {
+        if (this->available() == 0) {
+            return -1;
+        }
+
+        uint8_t byte = this->output.front().value;
+
+        this->output.pop_front();
+
+        return byte;
+    }
+    int peek() override { return (this->available() > 0) ? this->output.front().value : -1; }
+
+   private:
+    typedef struct {
+        uint64_t due;
+        uint8_t value;
+    } smByte;
+
+    std::vector<uint8_t> request;
+    std::deque<smByte> output;
+
+    std::vector<uint8_t> header(uint8_t size, uint8_t type) {
+        std::vector<uint8_t> frame(size, 0);
+
+        frame[0] = 0x48;
+        frame[1] = size;
+        frame[2] = 0x01;
+        frame[3] = 0x01;
+        frame[4] = type;
+
+        return frame;
+    }
+
+    void put(std::vector<uint8_t> &frame, uint8_t offset, uint32_t value, uint8_t size) {
+        for (uint8_t i = 0; i < size; i++) {
+            frame[offset + i] = value >> (8 * (size - 1 - i));
+        }
+    }
+
+    std::vector<uint8_t> close(std::vector<uint8_t> &frame) {
+        uint8_t sum = 0;
+
+        for (size_t i = 0; i + 1 < frame.size(); i++) {
+            sum += frame[i];
+        }
+
+        frame.back() = sum;
+
+        return frame;
+    }
+
+    void push(const std::vector<uint8_t> &frame, uint64_t due, unsigned long gap) {
+        for (uint8_t b : frame) {
+            this->output.push_back({due, b});
+            due += gap;
+        }
+    }
+
+    void answer() {
+        uint64_t now = micros64();
+        uint8_t cmd = this->request[1];
+        uint8_t type = this->request[4];
+
+        this->requestCount++;
+        this->push(this->request, now, 0);   // echo
+
+        now += this->answerDelay;
+
+        if (cmd == 0x06 && type == 0x0A) {
+            this->push(this->measurementFrame(), now, this->byteTime);
+        } else if (cmd == 0x06 && type == 0x00) {
+            this->push(this->powerCutFrame(), now, this->byteTime);
+        } else if (cmd == 0x06 && type == 0x02) {
+            this->push(this->limitsFrame(), now, this->byteTime);
+        } else if (cmd == 0x07) {
+            this->powerOn = this->request[5];
+            this->push(this->powerCutFrame(), now, this->byteTime);
+        } else if (cmd == 0x09) {
+            this->delayMinutes = (this->request[5] << 8) | this->request[6];
+            this->push(this->powerCutFrame(), now, this->byteTime);
+        } else if (cmd == 0x0C || cmd == 0x0F) {
+            this->push(this->limitsFrame(), now, this->byteTime);
+        } else if (cmd == 0x12) {
+            this->totalEnergy = this->importEnergy = this->exportEnergy = 0;
+            this->push(this->measurementFrame(), now, this->byteTime);
+        }
+    }
+};
+
+#endif   // FakeMeter_h
@@ -0,0 +1,54 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Checks of the host tests, a failed check is printed and counted, main() returns smTestResult()
+
+#ifndef SmartMeter238Test_h
+#define SmartMeter238Test_h
+
+#include "Arduino.h"
+
+static uint32_t smTestFailures = 0;
+
+#define SM_CHECK(condition)                                                  \
+    do {                                                                     \
+        if (!(condition)) {                                                  \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            smTestFailures++;                                                \
+        }                                                                    \
+    } while (0)
+
+#define SM_CHECK_NEAR(value, expected, tolerance) SM_CHECK(fabs((double)(value) - (double)(expected)) <= (tolerance))
+
+inline int smTestResult(const char *name) {
+    printf("%s: %s\n", name, (smTestFailures == 0) ? "OK" : "FAILED");
+
+    return (smTestFailures == 0) ? 0 : 1;
+}
+
+#endif   // SmartMeter238Test_h
@@ -0,0 +1,131 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Archive compression and speed on a synthetic 1 Hz trace of 10 days: voltage random walk, load steps, timestamp
+// jitter of +-1 ms, energy counters integrated from the power. There is no real trace in the tree, the ratio of a
+// real meter depends on how often its values change.
+
+#include "SmartMeter238.h"
+#include "SmartMeter238Archive.h"
+
+#include <chrono>
+#include <random>
+#include <vector>
+
+#define SAMPLES 864000
+#define BLOCK_SIZE 4096
+
+static double seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main() {
+    std::mt19937 random(238);
+    std::vector<SmartMeter238Archive::smSample> samples(SAMPLES);
+    HardwareSerial serial;
+    SmartMeter238 sm(serial);   // without SM_ENABLE_LAZY_DECODE the data is taken as it is
+    SmartMeter238::smartMeterData data;
+
+    double voltage = 230;
+    double current = 0.5;
+    double energy = 1234.56;
+    uint64_t timestamp = 1700000000000000ULL;
+
+    for (SmartMeter238Archive::smSample &sample : samples) {
+        timestamp += 1000000 + (random() % 2001) - 1000;
+        voltage += ((int)(random() % 7) - 3) * 0.1;
+        voltage = (voltage < 215 || voltage > 245) ? 230 : voltage;
+        current = (random() % 600 == 0) ? (random() % 3000) * 0.01 : current;
+
+        double power = voltage * current / 1000 * 0.95;
+
+        energy += power / 3600;
+
+        data.measurementData.timestamp = timestamp;
+        data.measurementData.data.voltage = voltage;
+        data.measurementData.data.current = current * (1 + ((int)(random() % 3) - 1) * 0.002);
+        data.measurementData.data.frequency = 50 + ((int)(random() % 5) - 2) * 0.01;
+        data.measurementData.data.activePower = power;
+        data.measurementData.data.reactivePower = power * 0.1;
+        data.measurementData.data.powerFactor = 0.95;
+        data.measurementData.data.lapseOfTimeTotalEnergy = energy;
+        data.measurementData.data.lapseOfTimeImportEnergy = energy;
+        data.measurementData.data.lapseOfTimeExportEnergy = 0;
+
+        SmartMeter238Archive::toSample(sm, &data, &sample);
+    }
+
+    uint8_t buffer[BLOCK_SIZE];
+    std::vector<std::vector<uint8_t>> blocks;
+    SmartMeter238ArchiveEncoder encoder(buffer, sizeof(buffer));
+    size_t total = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (SmartMeter238Archive::smSample &sample : samples) {
+        if (!encoder.append(&sample)) {
+            blocks.emplace_back(buffer, buffer + encoder.getSize());
+            total += encoder.getSize();
+
+            encoder.reset();
+            encoder.append(&sample);
+        }
+    }
+
+    blocks.emplace_back(buffer, buffer + encoder.getSize());
+    total += encoder.getSize();
+
+    double encodeTime = seconds(start);
+
+    size_t decoded = 0;
+    size_t errors = 0;
+
+    start = std::chrono::steady_clock::now();
+
+    for (std::vector<uint8_t> &block : blocks) {
+        SmartMeter238ArchiveDecoder decoder(block.data(), block.size());
+        SmartMeter238Archive::smSample sample;
+
+        while (decoder.next(&sample)) {
+            SmartMeter238Archive::smSample &expected = samples[decoded++];
+
+            if (sample.timestamp / SM_ARCHIVE_TIME_RESOLUTION != expected.timestamp / SM_ARCHIVE_TIME_RESOLUTION || memcmp(sample.values, expected.values, sizeof(sample.values)) != 0) {
+                errors++;
+            }
+        }
+    }
+
+    double decodeTime = seconds(start);
+    double raw = (double)SAMPLES * sizeof(data.measurementData);
+
+    printf("samples %u in %zu blocks of %u bytes, decoded %zu, errors %zu\n", SAMPLES, blocks.size(), BLOCK_SIZE, decoded, errors);
+    printf("%.2f bytes/sample, measurementData %zu bytes, ratio %.1f\n", (double)total / SAMPLES, sizeof(data.measurementData), raw / total);
+    printf("encode %.1f Msamples/s (%.0f MB/s of measurementData), decode %.1f Msamples/s (%.0f MB/s)\n", SAMPLES / encodeTime / 1e6, raw / encodeTime / 1e6, SAMPLES / decodeTime / 1e6, raw / decodeTime / 1e6);
+
+    return (decoded == SAMPLES && errors == 0) ? 0 : 1;
+}
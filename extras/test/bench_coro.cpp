@@ -0,0 +1,142 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Cost of a coroutine switch per transaction: the same measurement reads of the emulator (no answer delay) run as
+// SM_CORO_FRAME_COUNT coroutines awaiting in a loop, then as callbacks that submit the next read, both scheduled
+// by worker.loop() on this thread. The difference per request is what the suspend and resume add.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238Coro.h"
+
+#define READS 5000   // per task
+
+static SmartMeter238Task reader(SmartMeter238Async &smAsync, uint32_t *done) {
+    for (uint32_t i = 0; i < READS; i++) {
+        if ((co_await smAsync.measurement()).success) {
+            (*done)++;
+        }
+    }
+}
+
+typedef struct {
+    SmartMeter238Worker *worker;
+    uint32_t done;
+} smChain;
+
+static void next(const SmartMeter238Worker::smResult &result, void *context) {
+    smChain *chain = static_cast<smChain *>(context);
+
+    if (result.success) {
+        chain->done++;
+    }
+
+    if (chain->done < READS) {
+        SmartMeter238Worker::smRequest request;
+
+        request.callback = next;
+        request.context = chain;
+
+        chain->worker->submit(request);
+    }
+}
+
+static bool allDone(uint32_t *done) {
+    for (uint8_t i = 0; i < SM_CORO_FRAME_COUNT; i++) {
+        if (done[i] < READS) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238::smartMeterData data;
+    SmartMeter238Worker worker(sm, &data);
+    SmartMeter238Async smAsync(worker);
+
+    meter.answerDelay = 0;
+
+    // Coroutines
+    uint32_t done[SM_CORO_FRAME_COUNT] = {};
+    uint32_t transactions = worker.getTransactionCount();
+    uint64_t start = micros64();
+
+    for (uint8_t i = 0; i < SM_CORO_FRAME_COUNT; i++) {
+        reader(smAsync, &done[i]);
+    }
+
+    while (!allDone(done)) {
+        worker.loop();
+    }
+
+    uint64_t coroMicros = micros64() - start;
+    uint32_t coroTransactions = worker.getTransactionCount() - transactions;
+
+    // Callbacks
+    smChain chains[SM_CORO_FRAME_COUNT];
+    uint32_t chainDone[SM_CORO_FRAME_COUNT];
+
+    transactions = worker.getTransactionCount();
+    start = micros64();
+
+    for (uint8_t i = 0; i < SM_CORO_FRAME_COUNT; i++) {
+        SmartMeter238Worker::smResult result = {};
+
+        chains[i].worker = &worker;
+        chains[i].done = 0;
+
+        result.success = false;
+        next(result, &chains[i]);
+    }
+
+    do {
+        worker.loop();
+
+        for (uint8_t i = 0; i < SM_CORO_FRAME_COUNT; i++) {
+            chainDone[i] = chains[i].done;
+        }
+    } while (!allDone(chainDone));
+
+    uint64_t callbackMicros = micros64() - start;
+    uint32_t callbackTransactions = worker.getTransactionCount() - transactions;
+
+    uint32_t requests = SM_CORO_FRAME_COUNT * READS;
+    bool ok = (SmartMeter238CoroPool::getFailCount() == 0);
+
+    printf("%u tasks x %u reads\n", SM_CORO_FRAME_COUNT, READS);
+    printf("coroutines: %.2f us per request, %u transactions\n", (double)coroMicros / requests, coroTransactions);
+    printf("callbacks:  %.2f us per request, %u transactions\n", (double)callbackMicros / requests, callbackTransactions);
+    printf("switch overhead: %.3f us per request\n", ((double)coroMicros - (double)callbackMicros) / requests);
+    printf("%s\n", ok ? "OK" : "FAILED");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,306 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Scan and downsampling speed of the history.
+//
+// Scan: 10^8 samples per kernel, ten passes over a ring of 10^7 (one of 10^8 would need 5.6 GB), against the same
+// samples kept as an array of records with a plain loop, as the measurements were stored before the columns.
+// Downsampling: a day at 1 Hz in a ring that has wrapped, reduced with downsample() (LTTB) and envelope() to
+// several point counts. The voltage has a slow wave, noise and a spike every 20000 samples, which both
+// reductions have to keep.
+
+#include "SmartMeter238.h"
+#include "SmartMeter238History.h"
+
+#include <chrono>
+#include <vector>
+
+#define SAMPLES 86400
+#define REPEAT 50
+
+#define SCAN_SAMPLES 10000000
+#define SCAN_PASSES 10
+
+typedef struct {
+    uint64_t timestamp;
+    float values[SmartMeter238::SM_FIELD_COUNT];
+} smRecord;
+
+static double elapsed(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void report(const char *kernel, double records, double columns, bool same) {
+    double samples = (double)SCAN_SAMPLES * SCAN_PASSES;
+
+    printf("%-10s records %7.1f ms (%6.0f Msamples/s), columns %7.1f ms (%6.0f Msamples/s), x%.1f%s\n", kernel, records * 1e3, samples / records / 1e6, columns * 1e3, samples / columns / 1e6, records / columns, same ? "" : "  DIFFERENT");
+}
+
+static bool scan() {
+    SmartMeter238History history(SCAN_SAMPLES);
+    std::vector<smRecord> records(SCAN_SAMPLES);
+    SmartMeter238::smartMeterData data;
+
+    if (!history.isReady()) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < SCAN_SAMPLES; i++) {
+        data.measurementData.timestamp = (uint64_t)i * 1000000;
+        data.measurementData.data.voltage = 230 + ((i * 7919) % 97) * 0.02;
+        data.measurementData.data.activePower = ((i * 104729) % 3001) * 0.001;
+
+        history.append(&data);
+
+        records[i].timestamp = data.measurementData.timestamp;
+
+        for (uint8_t f = 0; f < SmartMeter238::SM_FIELD_COUNT; f++) {
+            records[i].values[f] = history.getValue((SmartMeter238::smMeasurementField)f, i);
+        }
+    }
+
+    const uint8_t voltage = SmartMeter238::SM_FIELD_VOLTAGE;
+    const uint8_t power = SmartMeter238::SM_FIELD_ACTIVEPOWER;
+    bool ok = true;
+
+    printf("%u samples per kernel\n", SCAN_SAMPLES * SCAN_PASSES);
+
+    // sum
+    double recordSum = 0;
+    double columnSum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (int p = 0; p < SCAN_PASSES; p++) {
+        for (uint32_t i = 0; i < SCAN_SAMPLES; i++) {
+            recordSum += records[i].values[voltage];
+        }
+    }
+
+    double recordTime = elapsed(start);
+
+    start = std::chrono::steady_clock::now();
+
+    for (int p = 0; p < SCAN_PASSES; p++) {
+        columnSum += history.sum(SmartMeter238::SM_FIELD_VOLTAGE, 0, SCAN_SAMPLES);
+    }
+
+    double columnTime = elapsed(start);
+
+    ok &= fabs(recordSum - columnSum) < 1e-6 * recordSum;
+    report("sum", recordTime, columnTime, fabs(recordSum - columnSum) < 1e-6 * recordSum);
+
+    // min/max
+    float recordMin = records[0].values[voltage];
+    float recordMax = recordMin;
+    float columnMin = 0;
+    float columnMax = 0;
+
+    start = std::chrono::steady_clock::now();
+
+    for (int p = 0; p < SCAN_PASSES; p++) {
+        for (uint32_t i = 0; i < SCAN_SAMPLES; i++) {
+            float value = records[i].values[voltage];
+
+            recordMin = value < recordMin ? value : recordMin;
+            recordMax = value > recordMax ? value : recordMax;
+        }
+    }
+
+    recordTime = elapsed(start);
+
+    start = std::chrono::steady_clock::now();
+
+    for (int p = 0; p < SCAN_PASSES; p++) {
+        history.minMax(SmartMeter238::SM_FIELD_VOLTAGE, 0, SCAN_SAMPLES, &columnMin, &columnMax);
+    }
+
+    columnTime = elapsed(start);
+
+    ok &= (recordMin == columnMin && recordMax == columnMax);
+    report("min/max", recordTime, columnTime, recordMin == columnMin && recordMax == columnMax);
+
+    // mean
+    float recordMean = 0;
+    float columnMean = 0;
+
+    start = std::chrono::steady_clock::now();
+
+    for (int p = 0; p < SCAN_PASSES; p++) {
+        double total = 0;
+
+        for (uint32_t i = 0; i < SCAN_SAMPLES; i++) {
+            total += records[i].values[power];
+        }
+
+        recordMean = total / SCAN_SAMPLES;
+    }
+
+    recordTime = elapsed(start);
+
+    start = std::chrono::steady_clock::now();
+
+    for (int p = 0; p < SCAN_PASSES; p++) {
+        columnMean = history.mean(SmartMeter238::SM_FIELD_ACTIVEPOWER, 0, SCAN_SAMPLES);
+    }
+
+    columnTime = elapsed(start);
+
+    ok &= fabs(recordMean - columnMean) < 1e-4;
+    report("mean", recordTime, columnTime, fabs(recordMean - columnMean) < 1e-4);
+
+    // threshold
+    uint32_t recordCount = 0;
+    uint32_t columnCount = 0;
+
+    start = std::chrono::steady_clock::now();
+
+    for (int p = 0; p < SCAN_PASSES; p++) {
+        for (uint32_t i = 0; i < SCAN_SAMPLES; i++) {
+            recordCount += (records[i].values[voltage] > 231.0f) ? 1 : 0;
+        }
+    }
+
+    recordTime = elapsed(start);
+
+    start = std::chrono::steady_clock::now();
+
+    for (int p = 0; p < SCAN_PASSES; p++) {
+        columnCount += history.countAbove(SmartMeter238::SM_FIELD_VOLTAGE, 0, SCAN_SAMPLES, 231.0f);
+    }
+
+    columnTime = elapsed(start);
+
+    ok &= (recordCount == columnCount);
+    report("threshold", recordTime, columnTime, recordCount == columnCount);
+
+    // energy
+    double recordEnergy = 0;
+    double columnEnergy = 0;
+
+    start = std::chrono::steady_clock::now();
+
+    for (int p = 0; p < SCAN_PASSES; p++) {
+        double total = 0;
+
+        for (uint32_t i = 1; i < SCAN_SAMPLES; i++) {
+            total += (records[i - 1].values[power] + records[i].values[power]) * 0.5 * (records[i].timestamp - records[i - 1].timestamp);
+        }
+
+        recordEnergy += total / 3600000000.0;
+    }
+
+    recordTime = elapsed(start);
+
+    start = std::chrono::steady_clock::now();
+
+    for (int p = 0; p < SCAN_PASSES; p++) {
+        columnEnergy += history.energy(0, SCAN_SAMPLES);
+    }
+
+    columnTime = elapsed(start);
+
+    ok &= fabs(recordEnergy - columnEnergy) < 1e-6 * recordEnergy;
+    report("energy", recordTime, columnTime, fabs(recordEnergy - columnEnergy) < 1e-6 * recordEnergy);
+
+    return ok;
+}
+
+static bool downsampling() {
+    SmartMeter238History history(SAMPLES);
+    SmartMeter238::smartMeterData data;
+    bool ok = history.isReady();
+
+    for (uint32_t i = 0; i < SAMPLES + 12345; i++) {
+        data.measurementData.timestamp = (uint64_t)i * 1000000;
+        data.measurementData.data.voltage = 230 + 5 * sin(i * 0.001) + ((i * 7919) % 97) * 0.02 + ((i % 20000 == 0) ? 30 : 0);
+
+        history.append(&data);
+    }
+
+    uint32_t from;
+    uint32_t count;
+
+    history.getRange(0, UINT64_MAX, &from, &count);
+
+    std::vector<SmartMeter238History::smPoint> points(2000);
+    std::vector<SmartMeter238History::smEnvelope> buckets(2000);
+
+    printf("%u samples\n", count);
+
+    for (uint32_t maxPoints : {2000u, 1000u, 500u, 100u}) {
+        uint32_t n = 0;
+        uint32_t m = 0;
+
+        auto start = std::chrono::steady_clock::now();
+
+        for (int r = 0; r < REPEAT; r++) {
+            n = history.downsample(SmartMeter238::SM_FIELD_VOLTAGE, from, count, points.data(), maxPoints);
+        }
+
+        double lttb = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / REPEAT;
+
+        start = std::chrono::steady_clock::now();
+
+        for (int r = 0; r < REPEAT; r++) {
+            m = history.envelope(SmartMeter238::SM_FIELD_VOLTAGE, from, count, buckets.data(), maxPoints);
+        }
+
+        double envelope = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() / REPEAT;
+
+        float pointMax = 0;
+        float bucketMax = 0;
+
+        for (uint32_t i = 0; i < n; i++) {
+            pointMax = max(pointMax, points[i].value);
+            ok &= (i == 0 || points[i].time > points[i - 1].time);
+        }
+
+        for (uint32_t i = 0; i < m; i++) {
+            bucketMax = max(bucketMax, buckets[i].max);
+        }
+
+        ok &= (n == maxPoints && m == maxPoints && pointMax > 250 && bucketMax > 250);
+
+        printf("%5u points: downsample %.3f ms (%.0f Msamples/s), envelope %.3f ms (%.0f Msamples/s)\n", maxPoints, lttb * 1e3, count / lttb / 1e6, envelope * 1e3, count / envelope / 1e6);
+    }
+
+    printf("%s\n", ok ? "spikes kept, times increasing" : "FAILED");
+
+    return ok;
+}
+
+int main() {
+    bool ok = scan();
+
+    printf("%s\n", ok ? "same results" : "FAILED");
+
+    ok &= downsampling();
+
+    return ok ? 0 : 1;
+}
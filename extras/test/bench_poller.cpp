@@ -0,0 +1,103 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Poller with 16 emulated meters read every 100 ms for 3 s, meter 3 never answers and meter 5 reads the limits.
+// Every live meter has to keep its interval, the dead one only fails; loop() time is the CPU the poller takes.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238Poller.h"
+
+#include <memory>
+#include <vector>
+
+#define METERS 16
+#define INTERVAL 100    // millis
+#define DURATION 3000   // millis
+#define DEAD_METER 3
+
+int main() {
+    std::vector<std::unique_ptr<FakeMeter>> meters;
+    std::vector<std::unique_ptr<SmartMeter238>> engines;
+    std::vector<SmartMeter238::smartMeterData> data(METERS);
+    SmartMeter238Poller poller;
+
+    for (uint8_t i = 0; i < METERS; i++) {
+        meters.emplace_back(new FakeMeter());
+        meters.back()->current = 1000 * i;
+        meters.back()->answerDelay = (i == DEAD_METER) ? 100000000 : 20000;
+
+        engines.emplace_back(new SmartMeter238(*meters.back()));
+        poller.addMeter(*engines.back(), &data[i], INTERVAL);
+    }
+
+    poller.setCommand(5, SmartMeter238::SM_CMD_RESP_LIMITANDPURCHASEDATA);
+
+    unsigned long start = millis();
+    unsigned long loops = 0;
+    uint64_t loopMicros = 0;
+
+    while ((millis() - start) < DURATION) {
+        uint64_t loopStart = micros64();
+
+        poller.loop();
+
+        loopMicros += micros64() - loopStart;
+        loops++;
+    }
+
+    bool ok = true;
+    uint32_t minReads = UINT32_MAX;
+    uint32_t maxLatency = 0;
+
+    for (uint8_t i = 0; i < METERS; i++) {
+        SmartMeter238Poller::smMeterStats stats;
+
+        poller.getStats(i, &stats);
+
+        if (i == DEAD_METER) {
+            ok &= (stats.readCount == 0 && stats.failedCount > 0);
+
+            continue;
+        }
+
+        minReads = min(minReads, stats.readCount);
+        maxLatency = max(maxLatency, stats.latency);
+
+        ok &= (stats.failedCount == 0 && stats.missedCount == 0);
+        ok &= (i == 5) ? data[i].limitAndPurchaseData.data.energyPurchaseBalance == 100 : fabs(data[i].measurementData.data.current - i) < 0.001;
+    }
+
+    ok &= (minReads >= DURATION / INTERVAL - 1);
+
+    printf("%u meters, %u live reads each at least (%u expected), last latency max %u us\n", METERS, minReads, DURATION / INTERVAL, maxLatency);
+    printf("%lu loop() calls, %.2f us per call over all meters\n", loops, (double)loopMicros / loops);
+    printf("%s\n", ok ? "OK" : "FAILED");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,295 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Gateway on ptys: meters emulated behind pseudo terminals by a second thread, read through SmartMeter238Tty by
+// one poller in an epoll loop that sleeps until a stream has bytes or getNextDue(). The data of every meter is
+// taken from SmartMeter238PollerSocket at the end. The CPU time of the gateway thread gives the CPU per meter at
+// the interval and the meters one core could poll. Built with SM_POLLER_MAX_METERS=128.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238Poller.h"
+#include "SmartMeter238PollerSocket.h"
+#include "SmartMeter238Tty.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define INTERVAL 200     // millis
+#define DURATION 4000    // millis
+#define SOCKET_PATH "/tmp/SmartMeter238-bench.sock"
+
+// Meters on the master side of the ptys, answered by one thread
+class PtyMeters {
+   public:
+    std::vector<std::string> paths;
+
+    PtyMeters(uint8_t count) {
+        for (uint8_t i = 0; i < count; i++) {
+            int master = posix_openpt(O_RDWR | O_NOCTTY);
+
+            grantpt(master);
+            unlockpt(master);
+            fcntl(master, F_SETFL, O_NONBLOCK);
+
+            this->masters.push_back(master);
+            this->paths.push_back(ptsname(master));
+            this->meters.emplace_back(new FakeMeter());
+            this->meters.back()->current = 1000 * i;
+        }
+    }
+    ~PtyMeters() {
+        this->stop();
+
+        for (int master : this->masters) {
+            close(master);
+        }
+    }
+
+    void start() {
+        this->running = true;
+        this->thread = std::thread([this] { this->run(); });
+    }
+    void stop() {
+        this->running = false;
+
+        if (this->thread.joinable()) {
+            this->thread.join();
+        }
+    }
+
+   private:
+    std::vector<int> masters;
+    std::vector<std::unique_ptr<FakeMeter>> meters;
+    std::atomic<bool> running{false};
+    std::thread thread;
+
+    void run() {
+        std::vector<pollfd> fds(this->masters.size());
+        uint8_t buffer[256];
+
+        for (size_t i = 0; i < fds.size(); i++) {
+            fds[i] = {this->masters[i], POLLIN, 0};
+        }
+
+        while (this->running) {
+            poll(fds.data(), fds.size(), 1);
+
+            for (size_t i = 0; i < fds.size(); i++) {
+                FakeMeter &meter = *this->meters[i];
+
+                if (fds[i].revents & POLLIN) {
+                    ssize_t n = read(this->masters[i], buffer, sizeof(buffer));
+
+                    for (ssize_t j = 0; j < n; j++) {
+                        meter.write(buffer[j]);
+                    }
+                }
+
+                // Answers released by the emulator timing, in one write
+                size_t n = 0;
+
+                while (meter.available() > 0 && n < sizeof(buffer)) {
+                    buffer[n++] = meter.read();
+                }
+
+                if (n > 0) {
+                    write(this->masters[i], buffer, n);
+                }
+            }
+        }
+    }
+};
+
+static uint64_t threadCpuMicros() {
+    timespec now;
+
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+
+    return (uint64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+}
+
+static std::string querySocket() {
+    sockaddr_un address = {};
+    std::string answer;
+    char buffer[4096];
+    ssize_t n;
+
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, SOCKET_PATH);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+    if (connect(fd, (sockaddr *)&address, sizeof(address)) == 0) {
+        while ((n = read(fd, buffer, sizeof(buffer))) > 0) {
+            answer.append(buffer, n);
+        }
+    }
+
+    close(fd);
+
+    return answer;
+}
+
+static bool run(uint8_t count) {
+    PtyMeters emulated(count);
+    std::vector<std::unique_ptr<SmartMeter238Tty>> ttys;
+    std::vector<std::unique_ptr<SmartMeter238>> engines;
+    std::vector<SmartMeter238::smartMeterData> data(count);
+    SmartMeter238Poller poller;
+    SmartMeter238PollerSocket server(poller);
+    bool ok = true;
+
+    int epoll = epoll_create1(0);
+    epoll_event event = {};
+
+    for (uint8_t i = 0; i < count; i++) {
+        ttys.emplace_back(new SmartMeter238Tty());
+        ok &= ttys.back()->open(emulated.paths[i].c_str());
+
+        engines.emplace_back(new SmartMeter238(*ttys.back()));
+        ok &= (poller.addMeter(*engines.back(), &data[i], INTERVAL) == i);
+
+        event.events = EPOLLIN;
+        event.data.u32 = i;
+        epoll_ctl(epoll, EPOLL_CTL_ADD, ttys.back()->getFd(), &event);
+    }
+
+    ok &= server.begin(SOCKET_PATH);
+
+    event.events = EPOLLIN;
+    event.data.u32 = 0xFFFF;
+    epoll_ctl(epoll, EPOLL_CTL_ADD, server.getFd(), &event);
+
+    emulated.start();
+
+    // Whole intervals only, a read started at the end is not counted
+    std::vector<epoll_event> events(count + 1);
+    unsigned long start = millis();
+    uint64_t cpuStart = threadCpuMicros();
+    unsigned long wakeups = 0;
+
+    while ((millis() - start) < DURATION) {
+        unsigned long left = DURATION - (millis() - start);
+        unsigned long due = min(poller.getNextDue(), left);
+
+        int n = epoll_wait(epoll, events.data(), events.size(), due);
+
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.u32 == 0xFFFF) {
+                server.loop();
+            }
+        }
+
+        poller.loop();
+        wakeups++;
+    }
+
+    uint64_t cpu = threadCpuMicros() - cpuStart;
+    uint32_t windowReads = 0;
+
+    for (uint8_t i = 0; i < count; i++) {
+        SmartMeter238Poller::smMeterStats stats;
+
+        poller.getStats(i, &stats);
+        windowReads += stats.readCount;
+    }
+
+    // The data is taken through the socket from another thread, while the loop goes on
+    std::string answer;
+    std::thread client([&answer] { answer = querySocket(); });
+
+    for (unsigned long end = millis(); (millis() - end) < 300;) {
+        epoll_wait(epoll, events.data(), events.size(), 5);
+        server.loop();
+        poller.loop();
+    }
+
+    client.join();
+    emulated.stop();
+    close(epoll);
+
+    uint32_t reads = 0;
+    uint32_t failed = 0;
+    uint32_t missed = 0;
+    uint32_t maxLatency = 0;
+
+    for (uint8_t i = 0; i < count; i++) {
+        SmartMeter238Poller::smMeterStats stats;
+        char expected[48];
+
+        poller.getStats(i, &stats);
+
+        reads += stats.readCount;
+        failed += stats.failedCount;
+        missed += stats.missedCount;
+        maxLatency = max(maxLatency, stats.latency);
+
+        snprintf(expected, sizeof(expected), "{\"meter\":%u,", i);
+        ok &= (answer.find(expected) != std::string::npos);
+
+        snprintf(expected, sizeof(expected), "\"current\":%.3f,", (float)i);
+        ok &= (answer.find(expected) != std::string::npos);
+        ok &= (stats.readCount >= DURATION / INTERVAL);
+    }
+
+    ok &= (answer.find("\"state\":\"failed\"") == std::string::npos && answer.find("\"data\":null") == std::string::npos);
+    ok &= (failed == 0 && missed == 0 && answer.size() > 2 && answer[0] == '[' && answer.compare(answer.size() - 2, 2, "]\n") == 0);
+
+    double seconds = DURATION / 1000.0;
+    double cpuPerMeter = cpu / seconds / count;   // micros of CPU each second
+
+    printf("%3u meters every %u ms: %u reads (%u in the timed %u ms), %u failed, %u missed, latency max %u us, %lu wakeups\n", count, INTERVAL, reads, windowReads, DURATION, failed, missed, maxLatency, wakeups);
+    printf("    gateway CPU %.1f%%, %.1f us per read, %.3f%% of a core per meter, %.0f meters per core at this interval\n", cpu / seconds / 1e4, (double)cpu / windowReads, cpuPerMeter / 1e4, 1e6 / cpuPerMeter);
+    printf("    socket answer %zu bytes\n", answer.size());
+
+    return ok;
+}
+
+int main() {
+    bool ok = true;
+
+    for (uint8_t count : {16, 64, 128}) {
+        ok &= run(count);
+    }
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Snapshot under contention: one thread publishes as fast as it can samples whose fields are all derived from one
+// counter, reader threads copy snapshots for 2 s. A copy with fields from two samples is torn; there must be none,
+// and the versions seen by each reader must only grow. Reports the writes and reads per second and the retries.
+
+#include "SmartMeter238.h"
+#include "SmartMeter238Snapshot.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define READERS 4
+#define DURATION 2000   // millis
+
+// Fields at the start, the middle and the end of the structure, so a copy cut anywhere is caught
+static void fill(SmartMeter238::smartMeterData *data, uint32_t value) {
+    float v = value & 0xFFFFFF;   // exact in a float
+
+    data->powerCompanyData.data.periodKWh = v;
+
+    data->measurementData.time = value;
+    data->measurementData.timestamp = value;
+    data->measurementData.data.current = v;
+    data->measurementData.data.voltage = v;
+    data->measurementData.data.frequency = v;
+    data->measurementData.data.reactivePower = v;
+    data->measurementData.data.activePower = v;
+    data->measurementData.data.powerFactor = v;
+    data->measurementData.data.lapseOfTimeTotalEnergy = v;
+    data->measurementData.data.lapseOfTimeImportEnergy = v;
+    data->measurementData.data.lapseOfTimeExportEnergy = v;
+    data->measurementData.data.lapseOfTimePriceEnergy = v;
+
+    data->limitAndPurchaseData.time = value;
+    data->limitAndPurchaseData.data.energyPurchaseBalance = v;
+}
+
+static bool consistent(SmartMeter238::smartMeterData *data) {
+    uint32_t value = data->measurementData.time;
+    float v = value & 0xFFFFFF;
+
+    return data->powerCompanyData.data.periodKWh == v && data->measurementData.timestamp == value && data->measurementData.data.current == v &&
+           data->measurementData.data.voltage == v && data->measurementData.data.frequency == v && data->measurementData.data.reactivePower == v &&
+           data->measurementData.data.activePower == v && data->measurementData.data.powerFactor == v && data->measurementData.data.lapseOfTimeTotalEnergy == v &&
+           data->measurementData.data.lapseOfTimeImportEnergy == v && data->measurementData.data.lapseOfTimeExportEnergy == v &&
+           data->measurementData.data.lapseOfTimePriceEnergy == v && data->limitAndPurchaseData.time == value && data->limitAndPurchaseData.data.energyPurchaseBalance == v;
+}
+
+int main() {
+    SmartMeter238Snapshot snapshot;
+    SmartMeter238::smartMeterData data;
+    std::atomic<bool> stop(false);
+    std::atomic<uint64_t> reads(0);
+    std::atomic<uint32_t> torn(0);
+    std::atomic<uint32_t> backwards(0);
+    std::vector<std::thread> readers;
+
+    fill(&data, 1);
+    snapshot.publish(&data);
+
+    for (uint8_t i = 0; i < READERS; i++) {
+        readers.emplace_back([&]() {
+            SmartMeter238::smartMeterData copy;
+            uint32_t lastVersion = 0;
+            uint64_t count = 0;
+
+            while (!stop.load(std::memory_order_relaxed)) {
+                uint32_t version = snapshot.read(&copy);
+
+                if (!consistent(&copy)) {
+                    torn++;
+                }
+
+                if (version < lastVersion) {
+                    backwards++;
+                }
+
+                lastVersion = version;
+                count++;
+            }
+
+            reads += count;
+        });
+    }
+
+    uint32_t writes = 0;
+    unsigned long start = millis();
+
+    while ((millis() - start) < DURATION) {
+        fill(&data, writes + 2);
+        snapshot.publish(&data);
+        writes++;
+    }
+
+    stop = true;
+
+    for (std::thread &reader : readers) {
+        reader.join();
+    }
+
+    bool ok = (torn == 0 && backwards == 0 && reads > 0);
+
+    printf("%u readers, %zu bytes per sample\n", READERS, sizeof(data));
+    printf("%.2f M writes/s, %.2f M reads/s, %u retries, %u torn, %u out of order\n", writes / (DURATION * 1000.0), reads / (DURATION * 1000.0), snapshot.getRetryCount(),
+           torn.load(), backwards.load());
+    printf("%s\n", ok ? "OK" : "FAILED");
+
+    return ok ? 0 : 1;
+}
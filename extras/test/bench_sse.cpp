@@ -0,0 +1,203 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Event server fan-out over loopback: 8, 32 and 64 streams read by client threads while 1000 measurements per
+// second are published for 2 s, plus one client that asks for the stream and never reads. Every reading client
+// has to receive every event and the one not reading has to be closed; loop() time is the CPU the fan-out takes.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238EventServer.h"
+
+#include <arpa/inet.h>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define PORT 18080
+#define RATE 1000       // events per second
+#define DURATION 2000   // millis
+
+#define REQUEST "GET /events HTTP/1.1\r\nAccept: text/event-stream\r\n\r\n"
+
+static int dial(uint16_t port, int receiveBuffer) {
+    sockaddr_in address = {};
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (receiveBuffer > 0) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer));
+    }
+
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    if (connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+
+        return -1;
+    }
+
+    send(fd, REQUEST, strlen(REQUEST), 0);
+
+    return fd;
+}
+
+// Events of one stream, until the server closes it or the run ends
+static void readEvents(int fd, std::atomic<bool> *stop, std::atomic<uint32_t> *events) {
+    timeval timeout = {0, 100000};
+    std::string pending;
+    char buffer[4096];
+
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    while (!*stop) {
+        int n = recv(fd, buffer, sizeof(buffer), 0);
+
+        if (n == 0) {
+            break;
+        }
+
+        if (n < 0) {
+            continue;
+        }
+
+        pending.append(buffer, n);
+
+        size_t end;
+
+        while ((end = pending.find("\n\n")) != std::string::npos) {
+            if (pending.compare(0, 4, "id: ") == 0 || pending.find("\r\n\r\nid: ") != std::string::npos) {
+                (*events)++;
+            }
+
+            pending.erase(0, end + 2);
+        }
+    }
+
+    close(fd);
+}
+
+static bool fanOut(SmartMeter238 &sm, SmartMeter238::smartMeterData *data, uint8_t clients) {
+    uint16_t port = PORT + clients;
+    WiFiServer wifiServer(port);
+    SmartMeter238EventServer server(wifiServer);
+    std::atomic<bool> stop(false);
+    std::vector<std::atomic<uint32_t>> events(clients);
+    std::vector<std::thread> readers;
+
+    server.begin();
+
+    for (uint8_t i = 0; i < clients; i++) {
+        readers.emplace_back(readEvents, dial(port, 0), &stop, &events[i]);
+    }
+
+    int stalled = dial(port, 4096);
+
+    // Every stream accepted before the first event
+    unsigned long start = millis();
+
+    while (server.getStreamCount() < clients + 1 && (millis() - start) < 1000) {
+        server.loop();
+    }
+
+    server.clearCounters();
+
+    uint32_t published = 0;
+    unsigned long loops = 0;
+    uint64_t loopMicros = 0;
+    unsigned long next = micros();
+
+    start = millis();
+
+    while ((millis() - start) < DURATION) {
+        uint64_t loopStart = micros64();
+
+        if ((long)(micros() - next) >= 0) {
+            next += 1000000 / RATE;
+            data->measurementData.data.voltage = 220 + published % 20;
+
+            server.publish(sm, data);
+            published++;
+        }
+
+        server.loop();
+
+        loopMicros += micros64() - loopStart;
+        loops++;
+    }
+
+    // Last events on their way
+    start = millis();
+
+    while ((millis() - start) < 200) {
+        server.loop();
+    }
+
+    stop = true;
+
+    for (std::thread &reader : readers) {
+        reader.join();
+    }
+
+    close(stalled);
+
+    uint32_t minEvents = UINT32_MAX;
+
+    for (std::atomic<uint32_t> &count : events) {
+        minEvents = min(minEvents, count.load());
+    }
+
+    bool ok = (minEvents == published && server.getDroppedCount() == 1);
+
+    printf("%3u clients: %u events, %.1f%% received by the slowest, %u skipped, %u dropped, %.2f us per loop() call\n", clients, published, 100.0 * minEvents / published,
+           server.getSkippedCount(), server.getDroppedCount(), (double)loopMicros / loops);
+
+    return ok;
+}
+
+int main() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238::smartMeterData data;
+
+    meter.answerDelay = 1000;
+    sm.getMeasurementData(&data, true);
+
+    bool ok = true;
+
+    ok &= fanOut(sm, &data, 8);
+    ok &= fanOut(sm, &data, 32);
+    ok &= fanOut(sm, &data, 64);
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+
+    return ok ? 0 : 1;
+}
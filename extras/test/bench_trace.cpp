@@ -0,0 +1,179 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Trace to disk and back: a session of measurement reads of the emulator is captured to a file, then replayed as
+// fast as possible through the engine, and its answer frames decoded straight by the codec. Reports frames per
+// second of both, the replay must have no mismatch and give the captured values.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238Codec.h"
+#include "SmartMeter238Trace.h"
+
+#include <vector>
+
+#define READS 1000
+#define DECODE_ROUNDS 2000
+#define TRACE_PATH "/tmp/SmartMeter238-bench.trace"
+
+// Answer frames of the trace: the last bytes received before each frame sent
+static void extractAnswers(SmartMeter238TraceFile &file, uint8_t answerSize, std::vector<uint8_t> *answers) {
+    std::vector<uint8_t> received;
+    bool sending = false;
+
+    file.read();   // magic
+    file.read();
+    file.read();
+    file.read();
+
+    while (true) {
+        uint32_t value = 0;
+        uint8_t shift = 0;
+        int c;
+
+        do {
+            c = file.read();
+            value |= (uint32_t)(c & 0x7F) << shift;
+            shift += 7;
+        } while (c >= 0 && (c & 0x80));
+
+        int byte = file.read();
+
+        if (c < 0 || byte < 0 || (value & 1) == SM_TRACE_TX) {
+            if (!sending && received.size() >= answerSize) {
+                answers->insert(answers->end(), received.end() - answerSize, received.end());
+            }
+
+            if (c < 0 || byte < 0) {
+                return;
+            }
+
+            received.clear();
+            sending = true;
+        } else {
+            received.push_back(byte);
+            sending = false;
+        }
+    }
+}
+
+int main() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238Trace trace;
+    SmartMeter238TraceFile file;
+    SmartMeter238::smartMeterData data;
+
+    meter.answerDelay = 500;
+
+    if (!file.open(TRACE_PATH, true)) {
+        printf("cannot open %s\n", TRACE_PATH);
+
+        return 1;
+    }
+
+    trace.begin(file);
+    sm.setTrace(&trace);
+
+    unsigned long start = millis();
+
+    for (uint16_t i = 0; i < READS; i++) {
+        meter.current = 1000 + i;
+        sm.getMeasurementData(&data, true);
+    }
+
+    unsigned long captureMillis = millis() - start;
+
+    trace.end();
+    file.close();
+
+    // Through the engine, as fast as the replay releases the answers
+    SmartMeter238TraceFile replayFile;
+    SmartMeter238::smartMeterData replayData;
+
+    replayFile.open(TRACE_PATH, false);
+
+    SmartMeter238Replay replay(replayFile, false);
+    SmartMeter238 smReplay(replay);
+    uint32_t replayed = 0;
+    bool ok = replay.begin();
+
+    start = millis();
+
+    while (!replay.finished()) {
+        if (smReplay.getMeasurementData(&replayData, true)) {
+            ok &= fabs(replayData.measurementData.data.current - (1000 + replayed) * 0.001) < 0.0001;
+            replayed++;
+        }
+    }
+
+    unsigned long replayMillis = millis() - start;
+
+    ok &= (replayed == READS && replay.getTxMismatchCount() == 0 && replay.getDroppedCount() == 0);
+
+    // Codec only, the answers of the trace again and again
+    SmartMeter238TuyaCodec codec;
+    std::vector<uint8_t> answers;
+    uint8_t answerSize = codec.getAnswerSize(SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA);
+
+    replayFile.open(TRACE_PATH, false);
+    extractAnswers(replayFile, answerSize, &answers);
+
+    uint32_t frames = answers.size() / answerSize;
+    uint32_t decoded = 0;
+    double check = 0;
+
+    ok &= (frames == READS);
+
+    uint64_t decodeStart = micros64();
+
+    for (uint32_t round = 0; round < DECODE_ROUNDS; round++) {
+        for (uint32_t n = 0; n < frames; n++) {
+            uint8_t *answer = &answers[n * answerSize];
+
+            if (codec.checkAnswer(SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA, answer, answerSize) == SmartMeter238::SM_ERR_NO_ERROR) {
+                codec.decodeAnswer(SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA, answer, &data);
+                check += data.measurementData.data.current;
+                decoded++;
+            }
+        }
+    }
+
+    uint64_t decodeMicros = micros64() - decodeStart;
+
+    ok &= (decoded == frames * DECODE_ROUNDS && check > 0);
+
+    printf("capture: %u reads in %lu ms, %u trace bytes, %u lost\n", READS, captureMillis, trace.getByteCount(), trace.getLostCount());
+    printf("engine replay: %u frames in %lu ms, %.0f frames/s\n", replayed, replayMillis, replayed * 1000.0 / max(replayMillis, 1UL));
+    printf("codec decode: %u frames in %.1f ms, %.2f Mframes/s\n", decoded, decodeMicros / 1000.0, decoded / (double)decodeMicros);
+    printf("%s\n", ok ? "OK" : "FAILED");
+
+    remove(TRACE_PATH);
+
+    return ok ? 0 : 1;
+}
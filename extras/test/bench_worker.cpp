@@ -0,0 +1,131 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Worker under contention: the worker runs in its thread (begin()) and 1, 4 and 16 producer threads submit
+// requests to the emulator for 2 s, each waiting for its completion before the next. Every 10th request of a
+// producer reads the limits and every 50th is a control request. Reports the submit to complete latency and how
+// many requests each transaction answered; every request has to complete and the statistics have to add up.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238Worker.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define DURATION 2000   // millis
+
+static bool contention(uint8_t producers) {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238::smartMeterData data;
+    SmartMeter238Worker worker(sm, &data);
+    std::atomic<bool> stop(false);
+    std::atomic<uint32_t> failed(0);
+    std::atomic<uint32_t> retries(0);
+    std::vector<std::vector<uint32_t>> latencies(producers);
+    std::vector<std::thread> threads;
+
+    meter.answerDelay = 1000;
+
+    worker.begin();
+
+    for (uint8_t p = 0; p < producers; p++) {
+        threads.emplace_back([&, p]() {
+            SmartMeter238Worker::smCompletion completion;
+            uint32_t n = 0;
+
+            while (!stop) {
+                SmartMeter238Worker::smRequest request;
+
+                request.type = SmartMeter238Worker::SM_REQ_GET_MEASUREMENTDATA;
+                request.completion = &completion;
+
+                if ((n % 50) == 49) {
+                    request.type = SmartMeter238Worker::SM_REQ_SET_POWERCUT;
+                    request.flag = false;
+                } else if ((n % 10) == 9) {
+                    request.type = SmartMeter238Worker::SM_REQ_GET_LIMITANDPURCHASEDATA;
+                }
+
+                if (!worker.submit(request)) {
+                    retries++;
+                    yield();
+
+                    continue;
+                }
+
+                if (!worker.wait(&completion, 2000) || !completion.result.success) {
+                    failed++;
+                }
+
+                latencies[p].push_back(completion.result.latency);
+                n++;
+            }
+        });
+    }
+
+    delay(DURATION);
+
+    stop = true;
+
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+
+    std::vector<uint32_t> all;
+
+    for (std::vector<uint32_t> &l : latencies) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+
+    std::sort(all.begin(), all.end());
+
+    uint32_t completed = worker.getCompletedCount();
+    uint32_t transactions = worker.getTransactionCount();
+    bool ok = (failed == 0 && !all.empty() && completed == all.size() && transactions <= completed && worker.getMaxLatency() == all.back());
+
+    printf("%2u producers: %6zu requests, %5.1f per transaction, latency avg %5u us p50 %5u p99 %6u max %6u, %u queue full retries\n", producers, all.size(),
+           (double)completed / max(transactions, 1U), worker.getAverageLatency(), all[all.size() / 2], all[all.size() * 99 / 100], all.back(), retries.load());
+
+    return ok;
+}
+
+int main() {
+    bool ok = true;
+
+    ok &= contention(1);
+    ok &= contention(4);
+    ok &= contention(16);
+
+    printf("%s\n", ok ? "OK" : "FAILED");
+
+    return ok ? 0 : 1;
+}
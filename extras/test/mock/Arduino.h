@@ -0,0 +1,163 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Minimal Arduino core for the host tests, only what the library uses
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <ctype.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define F(x) (reinterpret_cast<const __FlashStringHelper *>(x))
+#define HEX 16
+#define DEC 10
+#define SERIAL_8N1 0x06
+
+#define pgm_read_byte(x) (*(const uint8_t *)(x))
+#define pgm_read_byte_near(x) (*(const uint8_t *)(x))
+#define pgm_read_word(x) (*(const uint16_t *)(x))
+#define strlen_P strlen
+#define memcpy_P memcpy
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+class __FlashStringHelper;
+
+unsigned long millis();
+unsigned long micros();
+uint64_t micros64();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+inline size_t strlcpy(char *dst, const char *src, size_t size) {
+    size_t length = strlen(src);
+
+    if (size > 0) {
+        size_t copy = (length >= size) ? size - 1 : length;
+
+        memcpy(dst, src, copy);
+        dst[copy] = 0;
+    }
+
+    return length;
+}
+
+class Print {
+   public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t byte) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size) {
+        size_t n = 0;
+
+        while (size--) {
+            n += this->write(*buffer++);
+        }
+
+        return n;
+    }
+    size_t write(const char *str) { return this->write((const uint8_t *)str, strlen(str)); }
+    size_t write(const char *buffer, size_t size) { return this->write((const uint8_t *)buffer, size); }
+
+    virtual int availableForWrite() { return 0; }
+    virtual void flush() {}
+
+    // Debug output is not checked by the tests, numbers are dropped
+    size_t print(const __FlashStringHelper *str) { return this->write((const char *)str); }
+    size_t print(const char *str) { return this->write(str); }
+    size_t print(char c) { return this->write((uint8_t)c); }
+    size_t print(int, int = DEC) { return 0; }
+    size_t print(unsigned int, int = DEC) { return 0; }
+    size_t print(long, int = DEC) { return 0; }
+    size_t print(unsigned long, int = DEC) { return 0; }
+    size_t print(unsigned char, int = DEC) { return 0; }
+    size_t print(double, int = 2) { return 0; }
+    size_t println() { return this->write("\r\n"); }
+    template <typename T>
+    size_t println(T value) { return this->print(value) + this->println(); }
+    template <typename T>
+    size_t println(T value, int format) { return this->print(value, format) + this->println(); }
+};
+
+class Stream : public Print {
+   public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+
+    size_t readBytes(uint8_t *buffer, size_t size) {
+        size_t n = 0;
+
+        while (n < size && this->available() > 0) {
+            buffer[n++] = this->read();
+        }
+
+        return n;
+    }
+    void setTimeout(unsigned long) {}
+};
+
+class HardwareSerial : public Stream {
+   public:
+    void begin(unsigned long, uint8_t = SERIAL_8N1) {}
+
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    size_t write(uint8_t) override { return 1; }
+    using Print::write;
+};
+
+class Client : public Stream {
+   public:
+    virtual int connect(const char *host, uint16_t port) = 0;
+    virtual uint8_t connected() = 0;
+    virtual void stop() = 0;
+    virtual int read(uint8_t *buffer, size_t size) = 0;
+    using Stream::read;
+    virtual operator bool() = 0;
+};
+
+#endif   // Arduino_h
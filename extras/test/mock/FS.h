@@ -0,0 +1,98 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// File system of the host tests, files live under SM_TEST_FS_ROOT
+
+#ifndef FS_h
+#define FS_h
+
+#include "Arduino.h"
+
+#include <string>
+
+#ifndef SM_TEST_FS_ROOT
+#define SM_TEST_FS_ROOT "/tmp"
+#endif
+
+namespace fs {
+
+class File {
+   public:
+    File() {}
+    File(FILE *file) : file(file) {}
+
+    operator bool() const { return this->file != nullptr; }
+
+    size_t size() {
+        long position = ftell(this->file);
+
+        fseek(this->file, 0, SEEK_END);
+        long size = ftell(this->file);
+        fseek(this->file, position, SEEK_SET);
+
+        return size;
+    }
+    bool seek(uint32_t position) { return fseek(this->file, position, SEEK_SET) == 0; }
+    size_t read(uint8_t *buffer, size_t size) { return fread(buffer, 1, size, this->file); }
+    size_t write(const uint8_t *buffer, size_t size) { return fwrite(buffer, 1, size, this->file); }
+    void close() {
+        if (this->file != nullptr) {
+            fclose(this->file);
+        }
+
+        this->file = nullptr;
+    }
+
+   private:
+    FILE *file = nullptr;
+};
+
+class FS {
+   public:
+    File open(const char *path, const char *mode) {
+        std::string fileMode = (strcmp(mode, "r+") == 0) ? "r+b" : std::string(mode) + "b";
+
+        return File(fopen((std::string(SM_TEST_FS_ROOT) + path).c_str(), fileMode.c_str()));
+    }
+    bool exists(const char *path) {
+        FILE *file = fopen((std::string(SM_TEST_FS_ROOT) + path).c_str(), "rb");
+
+        if (file != nullptr) {
+            fclose(file);
+        }
+
+        return file != nullptr;
+    }
+    bool remove(const char *path) { return ::remove((std::string(SM_TEST_FS_ROOT) + path).c_str()) == 0; }
+};
+
+}   // namespace fs
+
+using fs::File;
+
+#endif   // FS_h
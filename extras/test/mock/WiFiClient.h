@@ -0,0 +1,161 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// WiFiClient over a non blocking loopback socket, copies share the socket like on the ESP cores
+
+#ifndef WiFiClient_h
+#define WiFiClient_h
+
+#include "Arduino.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/sockios.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <memory>
+
+class WiFiClient : public Client {
+   public:
+    WiFiClient() {}
+    explicit WiFiClient(int fd) : socket(std::make_shared<Socket>(fd)) {}
+
+    // Loopback only, the host name is ignored
+    int connect(const char *, uint16_t port) override {
+        sockaddr_in address = {};
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        if (::connect(fd, (sockaddr *)&address, sizeof(address)) != 0) {
+            ::close(fd);
+
+            return 0;
+        }
+
+        fcntl(fd, F_SETFL, O_NONBLOCK);
+        this->socket = std::make_shared<Socket>(fd);
+
+        return 1;
+    }
+    uint8_t connected() override {
+        char c;
+
+        if (!this->isOpen()) {
+            return 0;
+        }
+
+        int n = recv(this->socket->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+
+        return (n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))) ? 1 : 0;
+    }
+    void stop() override {
+        if (this->isOpen()) {
+            ::close(this->socket->fd);
+            this->socket->fd = -1;
+        }
+    }
+    operator bool() override { return this->isOpen(); }
+
+    int available() override {
+        int n = 0;
+
+        if (this->isOpen()) {
+            ioctl(this->socket->fd, FIONREAD, &n);
+        }
+
+        return n;
+    }
+    int read() override {
+        uint8_t c;
+
+        return (this->read(&c, 1) == 1) ? c : -1;
+    }
+    int read(uint8_t *buffer, size_t size) override { return this->isOpen() ? recv(this->socket->fd, buffer, size, MSG_DONTWAIT) : -1; }
+    int peek() override {
+        uint8_t c;
+
+        return (this->isOpen() && recv(this->socket->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 1) ? c : -1;
+    }
+
+    size_t write(uint8_t c) override { return this->write(&c, 1); }
+    size_t write(const uint8_t *buffer, size_t size) override {
+        ssize_t n = this->isOpen() ? send(this->socket->fd, buffer, size, MSG_DONTWAIT | MSG_NOSIGNAL) : -1;
+
+        return (n < 0) ? 0 : n;
+    }
+    using Print::write;
+
+    // Free space of the send buffer, as lwIP reports it
+    int availableForWrite() override {
+        int size = 0;
+        int queued = 0;
+        socklen_t length = sizeof(size);
+
+        if (!this->isOpen()) {
+            return 0;
+        }
+
+        getsockopt(this->socket->fd, SOL_SOCKET, SO_SNDBUF, &size, &length);
+        ioctl(this->socket->fd, SIOCOUTQ, &queued);
+
+        return max(size / 2 - queued, 0);
+    }
+
+    void setNoDelay(bool noDelay) {
+        int value = noDelay;
+
+        if (this->isOpen()) {
+            setsockopt(this->socket->fd, IPPROTO_TCP, TCP_NODELAY, &value, sizeof(value));
+        }
+    }
+
+   private:
+    struct Socket {
+        int fd;
+
+        Socket(int fd) : fd(fd) {}
+        ~Socket() {
+            if (this->fd >= 0) {
+                ::close(this->fd);
+            }
+        }
+    };
+
+    std::shared_ptr<Socket> socket;
+
+    bool isOpen() { return this->socket && this->socket->fd >= 0; }
+};
+
+#endif   // WiFiClient_h
@@ -0,0 +1,83 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// WiFiServer listening on the loopback interface
+
+#ifndef WiFiServer_h
+#define WiFiServer_h
+
+#include "WiFiClient.h"
+
+// Send buffer of the accepted connections, the kernel doubles it. A few KiB like lwIP, so a client that does not
+// read fills it in a few events instead of megabytes
+#ifndef SM_TEST_SEND_BUFFER
+#define SM_TEST_SEND_BUFFER 8192
+#endif
+
+class WiFiServer {
+   public:
+    WiFiServer(uint16_t port) : port(port) {}
+    ~WiFiServer() { this->close(); }
+
+    void begin() {
+        sockaddr_in address = {};
+        int value = 1;
+        int sendBuffer = SM_TEST_SEND_BUFFER;
+
+        address.sin_family = AF_INET;
+        address.sin_port = htons(this->port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+        this->fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+        setsockopt(this->fd, SOL_SOCKET, SO_REUSEADDR, &value, sizeof(value));
+        setsockopt(this->fd, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+        bind(this->fd, (sockaddr *)&address, sizeof(address));
+        listen(this->fd, 256);
+        fcntl(this->fd, F_SETFL, O_NONBLOCK);
+    }
+
+    WiFiClient available() {
+        int client = accept4(this->fd, nullptr, nullptr, SOCK_NONBLOCK);
+
+        return (client >= 0) ? WiFiClient(client) : WiFiClient();
+    }
+
+    void close() {
+        if (this->fd >= 0) {
+            ::close(this->fd);
+            this->fd = -1;
+        }
+    }
+
+   private:
+    uint16_t port;
+    int fd = -1;
+};
+
+#endif   // WiFiServer_h
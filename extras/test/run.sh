@@ -0,0 +1,76 @@
+#!/bin/sh
+# Host tests and benchmarks of the library, built against the Arduino core of mock/ with the system g++.
+#
+#   extras/test/run.sh                 every test
+#   extras/test/run.sh <name> ...      the given tests or benchmarks (bench_*) with the flags of their first entry
+#
+# Each entry of the lists is a source and the flags of its build, a test can be built for several models.
+
+set -e
+
+TEST_DIR=$(cd "$(dirname "$0")" && pwd)
+SRC_DIR="$TEST_DIR/../../src"
+BUILD_DIR=${BUILD_DIR:-/tmp/SmartMeter238-test}
+CXX=${CXX:-g++}
+
+TESTS="
+test_tariff
+test_worker_abort -DSM_ENABLE_TRACE
+test_decode
+test_decode -DSM_METER_MODEL=SM_METER_MODEL_DTS238_7
+test_decode -DSM_ENABLE_LAZY_DECODE
+test_decode -DSM_METER_MODEL=SM_METER_MODEL_DTS238_7 -DSM_ENABLE_LAZY_DECODE
+test_archive
+test_archive -DSM_ENABLE_LAZY_DECODE
+test_netserial
+test_coro
+test_history
+test_history -mavx
+test_history -DSM_HISTORY_NO_SIMD
+test_loadsteps
+test_protection
+test_forecast
+test_hexscript -DSM_ENABLE_RAW_TEST_MSG
+test_uplink -DESP8266
+"
+
+# Only run by name
+BENCHES="
+bench_history -mavx
+bench_coro
+bench_pty -DSM_POLLER_MAX_METERS=128
+bench_worker
+bench_snapshot
+bench_trace -DSM_ENABLE_TRACE -DSM_TRACE_FAST_GAP_MICROS=0
+bench_sse -DESP8266 -DSM_EVENT_MAX_CLIENTS=72
+"
+
+mkdir -p "$BUILD_DIR"
+
+run() {
+    name=$1
+    shift
+
+    echo "== $name $*"
+
+    "$CXX" -std=gnu++20 -O2 -pthread -I"$TEST_DIR/mock" -I"$TEST_DIR" -I"$SRC_DIR" "$@" \
+        "$TEST_DIR/$name.cpp" "$SRC_DIR"/*.cpp "$TEST_DIR/mock/Arduino.cpp" -o "$BUILD_DIR/$name" || return 1
+
+    "$BUILD_DIR/$name"
+}
+
+failed=0
+
+if [ $# -eq 0 ]; then
+    echo "$TESTS" | while read -r name flags; do
+        [ -n "$name" ] || continue
+        run "$name" $flags || exit 1
+    done || failed=1
+else
+    for name in "$@"; do
+        flags=$(echo "$TESTS$BENCHES" | awk -v n="$name" '$1 == n { $1 = ""; print; exit }')
+        run "$name" $flags || failed=1
+    done
+fi
+
+exit $failed
@@ -0,0 +1,216 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Archive blocks round trip: every sample appended is decoded with the same values and the timestamp to
+// SM_ARCHIVE_TIME_RESOLUTION, also when a sample does not fit in the end of a block.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238Archive.h"
+#include "SmartMeter238Test.h"
+
+#include <random>
+#include <vector>
+
+#define BLOCK_SIZE 1024
+
+static bool sameSample(SmartMeter238Archive::smSample *a, SmartMeter238Archive::smSample *b) {
+    return (a->timestamp / SM_ARCHIVE_TIME_RESOLUTION) == (b->timestamp / SM_ARCHIVE_TIME_RESOLUTION) && memcmp(a->values, b->values, sizeof(a->values)) == 0;
+}
+
+// Random walk with jumps to the limits of int32 and timestamps with jitter and gaps, split in blocks
+static void testRoundTrip() {
+    std::mt19937 random(238);
+    std::vector<SmartMeter238Archive::smSample> samples(20000);
+    SmartMeter238Archive::smSample sample = {};
+
+    sample.timestamp = 1700000000000000ULL;
+
+    for (SmartMeter238Archive::smSample &s : samples) {
+        sample.timestamp += (random() % 50 == 0) ? (random() % 100000000) : 1000000 + (random() % 2001) - 1000;
+
+        for (uint8_t i = 0; i < SM_ARCHIVE_FIELDS; i++) {
+            uint32_t r = random() % 100;
+
+            if (r == 0) {
+                sample.values[i] = (random() % 2) ? INT32_MAX : INT32_MIN;
+            } else if (r < 30) {
+                sample.values[i] += (int32_t)(random() % 201) - 100;
+            } else if (r < 32) {
+                sample.values[i] = (int32_t)random();
+            }
+        }
+
+        s = sample;
+    }
+
+    uint8_t buffer[BLOCK_SIZE];
+    std::vector<std::vector<uint8_t>> blocks;
+    std::vector<size_t> firstIndex;
+    SmartMeter238ArchiveEncoder encoder(buffer, sizeof(buffer));
+
+    for (size_t n = 0; n < samples.size(); n++) {
+        if (encoder.getCount() == 0) {
+            firstIndex.push_back(n);
+        }
+
+        if (!encoder.append(&samples[n])) {
+            blocks.emplace_back(buffer, buffer + encoder.getSize());
+            encoder.reset();
+
+            firstIndex.push_back(n);
+            SM_CHECK(encoder.append(&samples[n]));
+        }
+    }
+
+    blocks.emplace_back(buffer, buffer + encoder.getSize());
+
+    SM_CHECK(blocks.size() > 1);
+
+    // Blocks decoded alone, in reverse order
+    size_t decoded = 0;
+
+    for (size_t b = blocks.size(); b-- > 0;) {
+        SmartMeter238ArchiveDecoder decoder(blocks[b].data(), blocks[b].size());
+        SmartMeter238Archive::smSample out;
+        uint64_t firstTime;
+        uint16_t count;
+
+        SM_CHECK(decoder.isValid());
+        SM_CHECK(SmartMeter238Archive::getBlockInfo(blocks[b].data(), blocks[b].size(), &firstTime, &count));
+        SM_CHECK(count == decoder.getCount());
+        SM_CHECK(firstTime / SM_ARCHIVE_TIME_RESOLUTION == samples[firstIndex[b]].timestamp / SM_ARCHIVE_TIME_RESOLUTION);
+
+        for (uint16_t i = 0; decoder.next(&out); i++) {
+            SM_CHECK(sameSample(&out, &samples[firstIndex[b] + i]));
+            decoded++;
+        }
+
+        // Decoded again after rewind()
+        decoder.rewind();
+
+        SM_CHECK(decoder.next(&out) && sameSample(&out, &samples[firstIndex[b]]));
+    }
+
+    SM_CHECK(decoded == samples.size());
+}
+
+// Samples that take the 64 bit code alternate with unchanged ones in a small block: an append that does not fit
+// must leave the block as it was, the next smaller sample goes in the same bits
+static void testFullBlock() {
+    uint8_t buffer[SM_ARCHIVE_HEADER_SIZE + 40];
+    std::vector<SmartMeter238Archive::smSample> appended;
+    SmartMeter238ArchiveEncoder encoder(buffer, sizeof(buffer));
+    SmartMeter238Archive::smSample sample = {};
+
+    sample.timestamp = 1000000;
+
+    SM_CHECK(encoder.append(&sample));
+    appended.push_back(sample);
+
+    for (int k = 0; k < 200; k++) {
+        SmartMeter238Archive::smSample steady = appended.back();
+        SmartMeter238Archive::smSample jump;
+
+        steady.timestamp += 1000000;
+        jump = steady;
+
+        for (uint8_t i = 0; i < SM_ARCHIVE_FIELDS; i++) {
+            jump.values[i] = (k % 2) ? INT32_MIN + i * k : INT32_MAX - i * k;
+        }
+
+        if (encoder.append(&jump)) {
+            appended.push_back(jump);
+        } else if (encoder.append(&steady)) {
+            appended.push_back(steady);
+        } else {
+            break;
+        }
+    }
+
+    SmartMeter238ArchiveDecoder decoder(buffer, encoder.getSize());
+    SmartMeter238Archive::smSample out;
+    size_t n = 0;
+
+    SM_CHECK(appended.size() > 10);
+    SM_CHECK(decoder.getCount() == appended.size());
+
+    while (decoder.next(&out)) {
+        SM_CHECK(n < appended.size() && sameSample(&out, &appended[n]));
+        n++;
+    }
+
+    SM_CHECK(n == appended.size());
+}
+
+// Measurements of the emulator archived and restored
+static void testEngine() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238::smartMeterData data;
+    SmartMeter238::smartMeterData restored;
+    uint8_t buffer[BLOCK_SIZE];
+    SmartMeter238ArchiveEncoder encoder(buffer, sizeof(buffer));
+
+    meter.answerDelay = 1000;
+
+    for (uint16_t i = 0; i < 5; i++) {
+        meter.current = 5000 + i * 37;
+        meter.exportEnergy = 345 + i;
+
+        SM_CHECK(sm.getMeasurementData(&data, true));
+        SM_CHECK(encoder.append(sm, &data));
+    }
+
+    SmartMeter238ArchiveDecoder decoder(buffer, encoder.getSize());
+    SmartMeter238Archive::smSample out;
+    uint16_t n = 0;
+
+    while (decoder.next(&out)) {
+        n++;
+    }
+
+    SmartMeter238Archive::toData(&out, &restored);
+
+    SM_CHECK(n == 5);
+    SM_CHECK(restored.measurementData.timestamp / SM_ARCHIVE_TIME_RESOLUTION == data.measurementData.timestamp / SM_ARCHIVE_TIME_RESOLUTION);
+    SM_CHECK_NEAR(restored.measurementData.data.current, 5.148, 0.0001);
+    SM_CHECK_NEAR(restored.measurementData.data.voltage, 230.1, 0.001);
+    SM_CHECK_NEAR(restored.measurementData.data.frequency, 50.02, 0.001);
+    SM_CHECK_NEAR(restored.measurementData.data.activePower, 1.2345, 0.0001);
+    SM_CHECK_NEAR(restored.measurementData.data.powerFactor, 0.987, 0.0001);
+    SM_CHECK_NEAR(restored.measurementData.data.lapseOfTimeExportEnergy, 3.49, 0.001);
+}
+
+int main() {
+    testRoundTrip();
+    testFullBlock();
+    testEngine();
+
+    return smTestResult("test_archive");
+}
@@ -0,0 +1,157 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Coroutines over the worker, with the sketch loop calling worker.loop() as the scheduler: every frame of the pool
+// runs a task at once and one more does not start, the frames are free again when the tasks end, a full queue
+// resumes at once with SM_ERR_QUEUE_FULL, and the awaited operations run in order against the emulator.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238Coro.h"
+#include "SmartMeter238Test.h"
+
+#define READS 20
+
+static SmartMeter238Task reader(SmartMeter238Async &smAsync, uint32_t *done) {
+    for (uint8_t i = 0; i < READS; i++) {
+        SmartMeter238Worker::smResult result = co_await smAsync.measurement();
+
+        if (result.success) {
+            (*done)++;
+        }
+    }
+}
+
+static SmartMeter238Task cutAndRead(SmartMeter238Async &smAsync, SmartMeter238::smartMeterData *data, bool *ok) {
+    SmartMeter238Worker::smResult cut = co_await smAsync.setPowerCut(true);
+    SmartMeter238Worker::smResult read = co_await smAsync.powerCut();
+
+    *ok = cut.success && read.success && data->powerCutData.data.powerCut;
+}
+
+static SmartMeter238Task one(SmartMeter238Async &smAsync, SmartMeter238Worker::smResult *result, bool *done) {
+    *result = co_await smAsync.measurement();
+    *done = true;
+}
+
+static void testPool() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238::smartMeterData data;
+    SmartMeter238Worker worker(sm, &data);
+    SmartMeter238Async smAsync(worker);
+    uint32_t done[SM_CORO_FRAME_COUNT + 1] = {};
+
+    meter.answerDelay = 500;
+
+    for (uint8_t round = 0; round < 2; round++) {
+        uint32_t fails = SmartMeter238CoroPool::getFailCount();
+
+        for (uint8_t i = 0; i < SM_CORO_FRAME_COUNT; i++) {
+            done[i] = 0;
+
+            SM_CHECK(reader(smAsync, &done[i]).isRunning());
+        }
+
+        // No frame left
+        SM_CHECK(!reader(smAsync, &done[SM_CORO_FRAME_COUNT]).isRunning());
+        SM_CHECK(SmartMeter238CoroPool::getFailCount() == fails + 1);
+
+        unsigned long start = millis();
+        bool all = false;
+
+        while (!all && (millis() - start) < 5000) {
+            worker.loop();
+
+            all = true;
+
+            for (uint8_t i = 0; i < SM_CORO_FRAME_COUNT; i++) {
+                all &= (done[i] == READS);
+            }
+        }
+
+        SM_CHECK(all);
+        SM_CHECK(done[SM_CORO_FRAME_COUNT] == 0);
+    }
+
+    // Same reads of the tasks share a transaction
+    SM_CHECK(worker.getTransactionCount() < worker.getCompletedCount());
+}
+
+static void testQueueFull() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238::smartMeterData data;
+    SmartMeter238Worker worker(sm, &data);
+    SmartMeter238Async smAsync(worker);
+    SmartMeter238Worker::smCompletion completions[SM_WORKER_QUEUE_SIZE];
+    SmartMeter238Worker::smResult result;
+    bool done = false;
+
+    meter.answerDelay = 500;
+
+    for (uint8_t i = 0; i < SM_WORKER_QUEUE_SIZE; i++) {
+        SM_CHECK(worker.submit(SmartMeter238Worker::SM_REQ_GET_MEASUREMENTDATA, &completions[i]));
+    }
+
+    one(smAsync, &result, &done);
+
+    SM_CHECK(done);   // not suspended
+    SM_CHECK(!result.success && result.errCode == SmartMeter238::SM_ERR_QUEUE_FULL);
+
+    while (worker.loop()) {
+    }
+}
+
+static void testOrder() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238::smartMeterData data;
+    SmartMeter238Worker worker(sm, &data);
+    SmartMeter238Async smAsync(worker);
+    bool ok = false;
+
+    meter.answerDelay = 500;
+
+    SM_CHECK(cutAndRead(smAsync, &data, &ok).isRunning());
+
+    for (uint8_t i = 0; i < 10 && !ok; i++) {
+        worker.loop();
+    }
+
+    SM_CHECK(ok);
+    SM_CHECK(!meter.powerOn);
+}
+
+int main() {
+    testPool();
+    testQueueFull();
+    testOrder();
+
+    return smTestResult("test_coro");
+}
@@ -0,0 +1,201 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Decoding of fixed answer frames with the meter model of the build (SM_METER_MODEL). The measurement frame has
+// every phase slot filled: DDS238-4 has to read phase A and the totals only, DTS238-7 each phase. The DTS238-7
+// offsets are assumed, there is no capture of a real meter to check them against. run.sh builds it for both
+// models and with SM_ENABLE_LAZY_DECODE.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238Codec.h"
+#include "SmartMeter238Test.h"
+
+// Phase A/B/C current 5.123/10.246/15.369 A, voltage 230.1/231.1/232.1 V, reactive power total 0.1234 kvar and
+// phases 0.01/0.02/0.03, active power total 1.2345 kW and phases 0.1/0.2/0.3, power factor total 0.987 and
+// phases 0.900/0.901/0.902, 50.02 Hz, energy total 123.45, import 120.00 and export 3.45 kWh
+static uint8_t measurementFrame[SM_FRAMESIZE_MSG_RESP_MEASUREMENTDATA] = {
+    0x48, 0x43, 0x01, 0x01, 0x0B,
+    0x00, 0x14, 0x03, 0x00, 0x28, 0x06, 0x00, 0x3C, 0x09,
+    0x08, 0xFD, 0x09, 0x07, 0x09, 0x11,
+    0x00, 0x04, 0xD2, 0x00, 0x00, 0x64, 0x00, 0x00, 0xC8, 0x00, 0x01, 0x2C,
+    0x01, 0x09, 0x29, 0x00, 0x03, 0xE8, 0x00, 0x07, 0xD0, 0x00, 0x0B, 0xB8,
+    0x03, 0xDB, 0x03, 0x84, 0x03, 0x85, 0x03, 0x86,
+    0x13, 0x8A,
+    0x00, 0x00, 0x30, 0x39, 0x00, 0x00, 0x2E, 0xE0, 0x00, 0x00, 0x01, 0x59,
+    0x1C};
+
+// Power cut by over voltage, 30 minutes delay set to cut
+static uint8_t powerCutFrame[SM_FRAMESIZE_MSG_RESP_POWERCUT] = {
+    0x48, 0x15, 0x01, 0x01, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1E, 0x01, 0x00,
+    0x80};
+
+// Voltage 270/175 V, 50.00 A, purchase 200.00, balance 100.00, alarm 10.00 kWh, purchase off
+static uint8_t limitsFrame[SM_FRAMESIZE_MSG_RESP_LIMITANDPURCHASEDATA] = {
+    0x48, 0x19, 0x01, 0x01, 0x08,
+    0x01, 0x0E, 0x00, 0xAF, 0x13, 0x88,
+    0x00, 0x00, 0x4E, 0x20, 0x00, 0x00, 0x27, 0x10, 0x00, 0x00, 0x03, 0xE8,
+    0x00,
+    0x54};
+
+static void checkMeasurement(SmartMeter238::smartMeterData *data) {
+#if SM_METER_PHASES == 3
+    SM_CHECK_NEAR(data->measurementData.data.current, 5.123 + 10.246 + 15.369, 0.001);
+    SM_CHECK_NEAR(data->measurementData.data.voltage, 231.1, 0.01);
+
+    for (uint8_t i = 0; i < 3; i++) {
+        SM_CHECK_NEAR(data->measurementData.data.phase[i].current, 5.123 * (i + 1), 0.001);
+        SM_CHECK_NEAR(data->measurementData.data.phase[i].voltage, 230.1 + i, 0.01);
+        SM_CHECK_NEAR(data->measurementData.data.phase[i].reactivePower, 0.01 * (i + 1), 0.0001);
+        SM_CHECK_NEAR(data->measurementData.data.phase[i].activePower, 0.1 * (i + 1), 0.0001);
+        SM_CHECK_NEAR(data->measurementData.data.phase[i].powerFactor, 0.9 + 0.001 * i, 0.0001);
+    }
+#else
+    SM_CHECK_NEAR(data->measurementData.data.current, 5.123, 0.0001);
+    SM_CHECK_NEAR(data->measurementData.data.voltage, 230.1, 0.001);
+#endif
+
+    SM_CHECK_NEAR(data->measurementData.data.frequency, 50.02, 0.001);
+    SM_CHECK_NEAR(data->measurementData.data.reactivePower, 0.1234, 0.00001);
+    SM_CHECK_NEAR(data->measurementData.data.activePower, 1.2345, 0.00001);
+    SM_CHECK_NEAR(data->measurementData.data.powerFactor, 0.987, 0.0001);
+    SM_CHECK_NEAR(data->measurementData.data.lapseOfTimeTotalEnergy, 123.45, 0.001);
+    SM_CHECK_NEAR(data->measurementData.data.lapseOfTimeImportEnergy, 120.00, 0.001);
+    SM_CHECK_NEAR(data->measurementData.data.lapseOfTimeExportEnergy, 3.45, 0.001);
+}
+
+static void testMeasurementFrame() {
+    SmartMeter238TuyaCodec codec;
+    SmartMeter238::smartMeterData data;
+
+    SM_CHECK(codec.getAnswerSize(SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA) == sizeof(measurementFrame));
+    SM_CHECK(codec.checkAnswer(SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA, measurementFrame, sizeof(measurementFrame)) == SmartMeter238::SM_ERR_NO_ERROR);
+
+    codec.decodeAnswer(SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA, measurementFrame, &data);
+
+    checkMeasurement(&data);
+
+    // A field decoded alone has the value of the whole frame, the sums of the phases are only in decodeAnswer()
+    float value;
+
+    SM_CHECK(codec.decodeField(SmartMeter238::SM_FIELD_FREQUENCY, measurementFrame, &value) && value == data.measurementData.data.frequency);
+    SM_CHECK(codec.decodeField(SmartMeter238::SM_FIELD_REACTIVEPOWER, measurementFrame, &value) && value == data.measurementData.data.reactivePower);
+    SM_CHECK(codec.decodeField(SmartMeter238::SM_FIELD_ACTIVEPOWER, measurementFrame, &value) && value == data.measurementData.data.activePower);
+    SM_CHECK(codec.decodeField(SmartMeter238::SM_FIELD_POWERFACTOR, measurementFrame, &value) && value == data.measurementData.data.powerFactor);
+    SM_CHECK(codec.decodeField(SmartMeter238::SM_FIELD_TOTALENERGY, measurementFrame, &value) && value == data.measurementData.data.lapseOfTimeTotalEnergy);
+    SM_CHECK(codec.decodeField(SmartMeter238::SM_FIELD_IMPORTENERGY, measurementFrame, &value) && value == data.measurementData.data.lapseOfTimeImportEnergy);
+    SM_CHECK(codec.decodeField(SmartMeter238::SM_FIELD_EXPORTENERGY, measurementFrame, &value) && value == data.measurementData.data.lapseOfTimeExportEnergy);
+
+#if SM_METER_PHASES == 1
+    SM_CHECK(codec.decodeField(SmartMeter238::SM_FIELD_CURRENT, measurementFrame, &value) && value == data.measurementData.data.current);
+    SM_CHECK(codec.decodeField(SmartMeter238::SM_FIELD_VOLTAGE, measurementFrame, &value) && value == data.measurementData.data.voltage);
+#else
+    SM_CHECK(!codec.decodeField(SmartMeter238::SM_FIELD_CURRENT, measurementFrame, &value));
+    SM_CHECK(!codec.decodeField(SmartMeter238::SM_FIELD_VOLTAGE, measurementFrame, &value));
+#endif
+
+    // Any changed byte breaks the checksum
+    uint8_t corrupted[sizeof(measurementFrame)];
+
+    memcpy(corrupted, measurementFrame, sizeof(corrupted));
+    corrupted[15]++;
+
+    SM_CHECK(codec.checkAnswer(SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA, corrupted, sizeof(corrupted)) != SmartMeter238::SM_ERR_NO_ERROR);
+}
+
+static void testPowerCutFrame() {
+    SmartMeter238TuyaCodec codec;
+    SmartMeter238::smartMeterData data;
+
+    SM_CHECK(codec.checkAnswer(SmartMeter238::SM_CMD_RESP_POWERCUT, powerCutFrame, sizeof(powerCutFrame)) == SmartMeter238::SM_ERR_NO_ERROR);
+
+    codec.decodeAnswer(SmartMeter238::SM_CMD_RESP_POWERCUT, powerCutFrame, &data);
+
+    SM_CHECK(data.powerCutData.data.powerCut);
+    SM_CHECK(strcmp(data.powerCutData.data.powerCutDetails, SM_STR_POWERCUT_DETAILS_OVER_VOLTAGE) == 0);
+    SM_CHECK(data.powerCutData.data.delay == 30);
+    SM_CHECK(data.powerCutData.data.delaySetPowerCut);
+}
+
+static void testLimitsFrame() {
+    SmartMeter238TuyaCodec codec;
+    SmartMeter238::smartMeterData data;
+
+    SM_CHECK(codec.checkAnswer(SmartMeter238::SM_CMD_RESP_LIMITANDPURCHASEDATA, limitsFrame, sizeof(limitsFrame)) == SmartMeter238::SM_ERR_NO_ERROR);
+
+    codec.decodeAnswer(SmartMeter238::SM_CMD_RESP_LIMITANDPURCHASEDATA, limitsFrame, &data);
+
+    SM_CHECK(data.limitAndPurchaseData.data.maxVoltageLimit == 270);
+    SM_CHECK(data.limitAndPurchaseData.data.minVoltageLimit == 175);
+    SM_CHECK_NEAR(data.limitAndPurchaseData.data.maxCurrentLimit, 50.00, 0.001);
+    SM_CHECK_NEAR(data.limitAndPurchaseData.data.energyPurchase, 200.00, 0.001);
+    SM_CHECK_NEAR(data.limitAndPurchaseData.data.energyPurchaseBalance, 100.00, 0.001);
+    SM_CHECK_NEAR(data.limitAndPurchaseData.data.energyPurchaseAlarm, 10.00, 0.001);
+    SM_CHECK(!data.limitAndPurchaseData.data.energyPurchaseStatus);   // byte 23, not a byte of the purchase
+}
+
+// The same values from the emulator through the engine, lazily decoded fields included
+static void testEngine() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238::smartMeterData data;
+
+    meter.threePhase = (SM_METER_PHASES == 3);
+    meter.activePowerInt = 1;
+    meter.activePowerFrac = 2345;
+
+    SM_CHECK(sm.getMeasurementData(&data, true));
+
+    sm.decodeMeasurementFields(&data);
+
+#if SM_METER_PHASES == 3
+    SM_CHECK_NEAR(data.measurementData.data.phase[2].current, 15.369, 0.001);
+    SM_CHECK_NEAR(data.measurementData.data.phase[2].voltage, 232.1, 0.01);
+    SM_CHECK_NEAR(sm.getMeasurementField(&data, SmartMeter238::SM_FIELD_CURRENT), 5.123 + 10.246 + 15.369, 0.001);
+#else
+    SM_CHECK_NEAR(sm.getMeasurementField(&data, SmartMeter238::SM_FIELD_CURRENT), 5.123, 0.0001);
+#endif
+
+    SM_CHECK_NEAR(sm.getMeasurementField(&data, SmartMeter238::SM_FIELD_ACTIVEPOWER), 1.2345, 0.00001);
+    SM_CHECK_NEAR(sm.getMeasurementField(&data, SmartMeter238::SM_FIELD_FREQUENCY), 50.02, 0.001);
+    SM_CHECK_NEAR(sm.getMeasurementField(&data, SmartMeter238::SM_FIELD_EXPORTENERGY), 3.45, 0.001);
+    SM_CHECK_NEAR(data.measurementData.data.lapseOfTimeTotalEnergy, 123.45, 0.001);
+
+    SM_CHECK(sm.getLimitAndPurchaseData(&data, true));
+    SM_CHECK(data.limitAndPurchaseData.data.energyPurchaseStatus);
+}
+
+int main() {
+    testMeasurementFrame();
+    testPowerCutFrame();
+    testLimitsFrame();
+    testEngine();
+
+    return smTestResult("test_decode");
+}
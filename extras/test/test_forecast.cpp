@@ -0,0 +1,110 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Purchase forecast on a synthetic load: 0.5 kW with 2 kW from 18 to 22 h (18 kWh a day), one measurement a
+// minute for two days with the hours taken from the meter clock. The time to depletion then follows the profile
+// from the read of the balance, and a balance of more than SM_FORECAST_MAX_DAYS is reported as no depletion.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238Clock.h"
+#include "SmartMeter238Forecast.h"
+#include "SmartMeter238Test.h"
+
+#define MONDAY 1704067200ULL   // 2024-01-01 00:00 UTC
+#define MINUTE 60000000ULL     // micros
+#define HOUR (60 * MINUTE)
+
+static uint64_t origin;   // timestamp of monday 00:00
+
+static void measure(SmartMeter238 &sm, SmartMeter238Forecast &forecast, uint64_t time) {
+    SmartMeter238::smartMeterData data = {};
+    uint8_t hour = (time / HOUR) % 24;
+
+    data.measurementData.timestamp = origin + time;
+    data.measurementData.data.activePower = (hour >= 18 && hour < 22) ? 2.0 : 0.5;
+
+    forecast.update(sm, SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA, &data);
+}
+
+static void readBalance(SmartMeter238 &sm, SmartMeter238Forecast &forecast, uint64_t time, float balance) {
+    SmartMeter238::smartMeterData data = {};
+
+    data.limitAndPurchaseData.timestamp = origin + time;
+    data.limitAndPurchaseData.data.energyPurchaseStatus = true;
+    data.limitAndPurchaseData.data.energyPurchaseBalance = balance;
+
+    forecast.update(sm, SmartMeter238::SM_CMD_RESP_LIMITANDPURCHASEDATA, &data);
+}
+
+int main() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238Forecast forecast;
+
+    // Wall clock at monday 00:00 a day after boot
+    origin = sm.getClock()->now() + 24 * HOUR;
+    sm.getClock()->setEpoch(MONDAY * 1000000 - 24 * HOUR);
+
+    uint64_t time = 0;
+
+    for (; time <= 2 * 24 * HOUR + 12 * HOUR; time += MINUTE) {
+        measure(sm, forecast, time);
+    }
+
+    time -= MINUTE;   // wednesday 12:00
+
+    // 6 h at 0.5, 4 h at 2 and 8 h at 0.5
+    readBalance(sm, forecast, time, 15);
+    SM_CHECK_NEAR(forecast.getHoursToDepletion(), 18, 0.05);
+
+    // Two more days
+    readBalance(sm, forecast, time, 15 + 2 * 18);
+    SM_CHECK_NEAR(forecast.getHoursToDepletion(), 18 + 48, 0.05);
+
+    // Within the current hour
+    readBalance(sm, forecast, time, 0.25);
+    SM_CHECK_NEAR(forecast.getHoursToDepletion(), 0.5, 0.01);
+
+    // From 19:30 the evening load goes first: 2.5 h at 2 kW, then 0.5 kW
+    time += 7 * HOUR + 30 * MINUTE;
+    measure(sm, forecast, time);
+
+    readBalance(sm, forecast, time, 6);
+    SM_CHECK_NEAR(forecast.getHoursToDepletion(), 2.5 + 2, 0.05);
+
+    // Lasts more than SM_FORECAST_MAX_DAYS, the days do not fit in 32 bits either
+    readBalance(sm, forecast, time, 18.0f * (SM_FORECAST_MAX_DAYS + 1));
+    SM_CHECK(forecast.getHoursToDepletion() < 0);
+
+    readBalance(sm, forecast, time, 1e12);
+    SM_CHECK(forecast.getHoursToDepletion() < 0);
+    SM_CHECK(forecast.getBalanceInterval() == SM_FORECAST_DEFAULT_MAX_INTERVAL);
+
+    return smTestResult("test_forecast");
+}
@@ -0,0 +1,168 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Hex scripts against the meter emulator: answers checked exactly, with "??" mask bytes and with a "*" tail,
+// failures by value and by length, a request the meter does not answer (TIMEOUT) and lines refused before
+// anything is sent (BADLINE), a trailing ':' among them.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238Test.h"
+
+#include <string>
+#include <vector>
+
+class StringPrint : public Print {
+   public:
+    std::string text;
+
+    size_t write(uint8_t byte) override {
+        this->text += (char)byte;
+
+        return 1;
+    }
+    using Print::write;
+};
+
+static std::vector<std::string> split(const std::string &text) {
+    std::vector<std::string> lines;
+    size_t start = 0;
+
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+
+        end = (end == std::string::npos) ? text.size() : end;
+
+        std::string line = text.substr(start, end - start);
+
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+
+        lines.push_back(line);
+        start = end + 1;
+    }
+
+    return lines;
+}
+
+// "   3 FAIL        45 48:15:..." -> status and answer
+static void checkLine(const std::string &line, uint16_t frame, const char *status, const char *answerStart) {
+    char expected[16];
+
+    snprintf(expected, sizeof(expected), "%4u %-7s", frame, status);
+
+    SM_CHECK(line.compare(0, strlen(expected), expected) == 0);
+    SM_CHECK(line.size() >= 20 && line.compare(20, strlen(answerStart), answerStart) == 0);
+
+    if (line.compare(0, strlen(expected), expected) != 0) {
+        printf("  line %u: \"%s\"\n", frame, line.c_str());
+    }
+}
+
+static void testScript() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    StringPrint output;
+
+    meter.purchaseBalance = 0x01020304;
+
+    const char *script =
+        "# measurement, power cut and limits\n"
+        "48:06:02:01:0A:00 48:43:01:01:0B:* 500\n"
+        "48:06:02:01:00:00 48:15:01:01:01:??:01:*\n"
+        "48:06:02:01:00:00 48:15:01:01:01:??:00:*\n"
+        "48:06:02:01:02:00 48:19:01:01:08:01:0E:00:AF:13:88:??:??:??:??:01:02:03:04:??:??:??:??:01:??\n"
+        "48:06:02:01:02:00 48:19:01:01:08\n"
+        "\n"
+        "48:06:02:01:0A:00 -\n"
+        "48:06:02:01:55:00 - 50   # not answered\n"
+        "48:06:02:01:0A: 48:43:*\n"
+        "48:06:02:01:0A:00 48:43:\n"
+        "48:06:02:01:0A:00 48:4G:*\n";
+
+    SM_CHECK(!sm.runHexScript(script, output));
+
+    std::vector<std::string> lines = split(output.text);
+
+    SM_CHECK(lines.size() == 11);
+
+    if (lines.size() != 11) {
+        printf("%s", output.text.c_str());
+
+        return;
+    }
+
+    checkLine(lines[0], 1, "PASS", "48:43:01:01:0B:");
+    checkLine(lines[1], 2, "PASS", "48:15:01:01:01:00:01:");
+    checkLine(lines[2], 3, "FAIL", "48:15:01:01:01:00:01:");   // mask byte right, value byte wrong
+    checkLine(lines[3], 4, "PASS", "48:19:01:01:08:01:0E:00:AF:13:88:");
+    checkLine(lines[4], 5, "FAIL", "48:19:01:01:08:");   // longer than expected without '*'
+    checkLine(lines[5], 6, "PASS", "48:43:");
+    checkLine(lines[6], 7, "TIMEOUT", "");
+    checkLine(lines[7], 8, "BADLINE", "");   // trailing ':' in the request
+    checkLine(lines[8], 9, "BADLINE", "");   // and in the expected answer
+    checkLine(lines[9], 10, "BADLINE", "");
+
+    SM_CHECK(lines[10] == "4/10 passed");
+
+    // The TIMEOUT line waited its own timeout, not the default one
+    unsigned long elapsed = strtoul(lines[6].c_str() + 13, nullptr, 10);
+
+    SM_CHECK(elapsed >= 50 && elapsed < sm.getResponseTimeout());
+
+    // Nothing is sent for a refused line
+    SM_CHECK(meter.requestCount == 7);
+
+    // A whole passing script
+    output.text.clear();
+
+    SM_CHECK(sm.runHexScript("48:06:02:01:0A:00 48:43:01:01:0B:*\n48:06:02:01:00:00 48:15:??:*", output));
+    SM_CHECK(output.text.find("2/2 passed") != std::string::npos);
+}
+
+static void testSendHexMessage() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+
+    SM_CHECK(sm.sendHexMessage("48:06:02:01:00:00"));
+    SM_CHECK(strncmp(sm.getIncomingHexMessage(), "48:15:01:01:01:", 15) == 0);
+
+    SM_CHECK(!sm.sendHexMessage("48:06:02:01:00:"));
+    SM_CHECK(sm.getErrCode() == SmartMeter238::SM_ERR_WRONG_MSG);
+    SM_CHECK(!sm.sendHexMessage("48:06:02:01:00:0"));
+    SM_CHECK(!sm.sendHexMessage("48::06"));
+    SM_CHECK(meter.requestCount == 1);
+}
+
+int main() {
+    testScript();
+    testSendHexMessage();
+
+    return smTestResult("test_hexscript");
+}
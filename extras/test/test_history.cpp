@@ -0,0 +1,135 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// History kernels against a plain loop over the same samples: sum, mean, min/max, threshold counts and energy on
+// every range length around the vector widths, in a ring that has wrapped. Built with the SSE2, AVX and portable
+// kernels, the results have to be the same.
+
+#include "SmartMeter238.h"
+#include "SmartMeter238History.h"
+#include "SmartMeter238Test.h"
+
+#include <vector>
+
+#define CAPACITY 1000
+#define APPENDS 1357
+
+static std::vector<float> power;       // every appended value, the history keeps the last CAPACITY
+static std::vector<uint64_t> times;
+
+static void fill(SmartMeter238History &history) {
+    SmartMeter238::smartMeterData data;
+    uint32_t seed = 12345;
+
+    for (uint32_t i = 0; i < APPENDS; i++) {
+        seed = seed * 1103515245 + 12345;
+
+        // Few distinct values so the thresholds are hit by equal ones
+        float value = ((int32_t)((seed >> 8) % 101) - 50) * 2.5f;
+
+        data.measurementData.timestamp = (uint64_t)i * 1000000 + (seed % 1000);
+        data.measurementData.data.activePower = value;
+
+        history.append(&data);
+
+        power.push_back(value);
+        times.push_back(data.measurementData.timestamp);
+    }
+}
+
+static void checkRange(SmartMeter238History &history, uint32_t from, uint32_t count) {
+    uint32_t first = APPENDS - CAPACITY + from;
+
+    double sum = 0;
+    float min = power[first];
+    float max = power[first];
+    uint32_t above = 0;
+    uint32_t below = 0;
+    double energy = 0;
+
+    for (uint32_t i = first; i < first + count; i++) {
+        sum += power[i];
+        min = power[i] < min ? power[i] : min;
+        max = power[i] > max ? power[i] : max;
+        above += (power[i] > 12.5f) ? 1 : 0;
+        below += (power[i] < -100.0f) ? 1 : 0;
+
+        if (i > first) {
+            energy += (power[i - 1] + power[i]) * 0.5 * (times[i] - times[i - 1]);
+        }
+    }
+
+    float kernelMin = 0;
+    float kernelMax = 0;
+
+    SM_CHECK_NEAR(history.sum(SmartMeter238::SM_FIELD_ACTIVEPOWER, from, count), sum, 1e-6);
+    SM_CHECK_NEAR(history.mean(SmartMeter238::SM_FIELD_ACTIVEPOWER, from, count), sum / count, 1e-3);
+    SM_CHECK(history.minMax(SmartMeter238::SM_FIELD_ACTIVEPOWER, from, count, &kernelMin, &kernelMax));
+    SM_CHECK(kernelMin == min && kernelMax == max);
+    SM_CHECK(history.countAbove(SmartMeter238::SM_FIELD_ACTIVEPOWER, from, count, 12.5f) == above);
+    SM_CHECK(history.countBelow(SmartMeter238::SM_FIELD_ACTIVEPOWER, from, count, -100.0f) == below);
+    SM_CHECK_NEAR(history.energy(from, count), energy / 3600000000.0, 1e-9);
+}
+
+int main() {
+    SmartMeter238History history(CAPACITY);
+
+    SM_CHECK(history.isReady());
+
+    fill(history);
+
+    SM_CHECK(history.getCount() == CAPACITY);
+
+    // Every length up to a few vectors, from an aligned and an unaligned start, before and across the wrap
+    const uint32_t starts[] = {0, 1, 3, 640, 643, 990};
+
+    for (uint32_t from : starts) {
+        for (uint32_t count = 1; count <= 40 && from + count <= CAPACITY; count++) {
+            checkRange(history, from, count);
+        }
+    }
+
+    checkRange(history, 0, CAPACITY);
+    checkRange(history, 5, CAPACITY - 7);
+
+    // Past the end the count is cut, an empty range gives nothing
+    float min = 0;
+    float max = 0;
+
+    SM_CHECK(history.sum(SmartMeter238::SM_FIELD_ACTIVEPOWER, CAPACITY, 10) == 0);
+    SM_CHECK(!history.minMax(SmartMeter238::SM_FIELD_ACTIVEPOWER, 10, 0, &min, &max));
+    SM_CHECK(history.countAbove(SmartMeter238::SM_FIELD_ACTIVEPOWER, CAPACITY - 4, 100, -1e9f) == 4);
+
+#if defined(__AVX__) && !defined(SM_HISTORY_NO_SIMD)
+    return smTestResult("test_history (avx)");
+#elif defined(__SSE2__) && !defined(SM_HISTORY_NO_SIMD)
+    return smTestResult("test_history (sse2)");
+#else
+    return smTestResult("test_history (portable)");
+#endif
+}
@@ -0,0 +1,179 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Load steps: a load switched on and off in the emulator is detected through the engine with the duration and
+// energy of the answer timestamps. Fed directly, a run longer than 2^32 micros keeps its duration, and with the
+// table full of running loads a new step is dropped instead of taking the place of one of them.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238LoadSteps.h"
+#include "SmartMeter238Test.h"
+
+#include <vector>
+
+#define HOUR 3600000000ULL   // micros
+
+static std::vector<SmartMeter238LoadSteps::smLoadEvent> events;
+
+static void onLoad(const SmartMeter238LoadSteps::smLoadEvent &event, void *context) {
+    events.push_back(event);
+}
+
+static void feed(SmartMeter238LoadSteps &loadSteps, float activePower, uint64_t timestamp) {
+    SmartMeter238::smartMeterData data;
+
+    data.measurementData.timestamp = timestamp;
+    data.measurementData.data.activePower = activePower;
+    data.measurementData.data.reactivePower = activePower * 0.1f;
+    data.measurementData.data.current = activePower * 4.3f;
+
+    loadSteps.update(&data);
+}
+
+static void testEngine() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238LoadSteps loadSteps;
+    SmartMeter238::smartMeterData data;
+
+    events.clear();
+    loadSteps.setCallback(onLoad);
+    sm.addObserver(&loadSteps);
+
+    meter.answerDelay = 1000;
+
+    // 0.1 kW, 2.1 kW for a while, 0.1 kW again
+    const uint8_t levels[] = {0, 0, 0, 2, 2, 2, 2, 2, 2, 0, 0, 0};
+    uint64_t timestamps[sizeof(levels)];
+
+    for (uint8_t i = 0; i < sizeof(levels); i++) {
+        meter.activePowerInt = levels[i];
+        meter.activePowerFrac = 1000;   // + 0.1 kW
+        meter.reactivePowerInt = 0;
+        meter.reactivePowerFrac = levels[i] * 1000;
+
+        SM_CHECK(sm.getMeasurementData(&data, true));
+
+        timestamps[i] = data.measurementData.timestamp;
+
+        delay(5);
+    }
+
+    SM_CHECK(events.size() == 2);
+
+    if (events.size() == 2) {
+        // Confirmed by the second measurement at the new level (debounce 2)
+        SM_CHECK(events[0].type == SmartMeter238LoadSteps::SM_LOAD_ON);
+        SM_CHECK(events[0].time == timestamps[4]);
+        SM_CHECK_NEAR(events[0].deltaActivePower, 2.0, 0.001);
+
+        SM_CHECK(events[1].type == SmartMeter238LoadSteps::SM_LOAD_OFF);
+        SM_CHECK(events[1].signature == events[0].signature);
+        SM_CHECK(events[1].time == timestamps[10]);
+        SM_CHECK(events[1].duration == timestamps[10] - timestamps[4]);
+        SM_CHECK_NEAR(events[1].energy, 2.0 * (timestamps[10] - timestamps[4]) / HOUR, 1e-6);
+    }
+}
+
+static void testLongRun() {
+    SmartMeter238LoadSteps loadSteps;
+    uint64_t start = 5 * HOUR;   // past 2^32 micros (71 minutes)
+
+    events.clear();
+    loadSteps.setCallback(onLoad);
+
+    feed(loadSteps, 0.1, start);
+    feed(loadSteps, 1.5, start + 1000000);
+    feed(loadSteps, 1.5, start + 2000000);
+    feed(loadSteps, 0.1, start + 2000000 + 3 * HOUR);
+    feed(loadSteps, 0.1, start + 3000000 + 3 * HOUR);
+
+    SM_CHECK(events.size() == 2);
+
+    if (events.size() == 2) {
+        SM_CHECK(events[0].time == start + 2000000);
+        SM_CHECK(events[1].duration == 3 * HOUR + 1000000);
+        SM_CHECK_NEAR(events[1].energy, 1.4 * (3 * HOUR + 1000000) / HOUR, 1e-3);
+    }
+}
+
+static void testTableFull() {
+    SmartMeter238LoadSteps loadSteps;
+    SmartMeter238LoadSteps::smSignature signature;
+    uint64_t time = 0;
+    float power = 0.1;
+
+    events.clear();
+    loadSteps.setCallback(onLoad);
+
+    feed(loadSteps, power, time);
+
+    // Every signature learned and running: 1, 2, ... kW on top of each other
+    for (uint8_t i = 0; i < SM_LOAD_MAX_SIGNATURES; i++) {
+        power += i + 1;
+        feed(loadSteps, power, time += 1000000);
+        feed(loadSteps, power, time += 1000000);
+    }
+
+    SM_CHECK(loadSteps.getSignatureCount() == SM_LOAD_MAX_SIGNATURES);
+    SM_CHECK(events.size() == SM_LOAD_MAX_SIGNATURES);
+
+    // One more load: no room, no event, the running ones are kept
+    feed(loadSteps, power + 20, time += 1000000);
+    feed(loadSteps, power + 20, time += 1000000);
+
+    SM_CHECK(events.size() == SM_LOAD_MAX_SIGNATURES);
+
+    for (uint8_t i = 0; i < SM_LOAD_MAX_SIGNATURES; i++) {
+        SM_CHECK(loadSteps.getSignature(i, &signature) && signature.on);
+        SM_CHECK_NEAR(signature.activePower, i + 1, 0.001);
+    }
+
+    // It goes off, nothing matches the 20 kW drop. Then the first load goes off and still has its signature.
+    feed(loadSteps, power, time += 1000000);
+    feed(loadSteps, power, time += 1000000);
+    feed(loadSteps, power - 1, time += 1000000);
+    feed(loadSteps, power - 1, time += 1000000);
+
+    SM_CHECK(events.size() == SM_LOAD_MAX_SIGNATURES + 1);
+
+    if (events.size() == SM_LOAD_MAX_SIGNATURES + 1) {
+        SM_CHECK(events.back().type == SmartMeter238LoadSteps::SM_LOAD_OFF);
+        SM_CHECK(events.back().signature == 0);
+        SM_CHECK(events.back().duration == time - 2000000);
+    }
+}
+
+int main() {
+    testEngine();
+    testLongRun();
+    testTableFull();
+
+    return smTestResult("test_loadsteps");
+}
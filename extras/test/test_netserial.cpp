@@ -0,0 +1,267 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Meter behind a serial server: a loopback TCP server thread passes the bytes to the emulator, raw or as a telnet
+// RFC2217 port server that sends its own commands and escapes IAC. The emulator answers with 0xFF bytes in the
+// data. Every frame has to leave in one write, and after a reconnect the port settings are sent again.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238NetSerial.h"
+#include "SmartMeter238Test.h"
+
+#include <WiFiServer.h>
+
+#include <atomic>
+#include <thread>
+
+#define PORT 23823
+#define READS 100
+
+#define IAC 255
+#define SB 250
+#define SE 240
+
+class CountingClient : public WiFiClient {
+   public:
+    uint32_t frameWrites = 0;   // writes that are not telnet commands
+
+    size_t write(const uint8_t *buffer, size_t size) override {
+        if (size > 0 && buffer[0] != IAC) {
+            this->frameWrites++;
+        }
+
+        return WiFiClient::write(buffer, size);
+    }
+    using WiFiClient::write;
+};
+
+// Serial server with the meter on its port, one connection at a time until stopped
+class SerialServer {
+   public:
+    std::atomic<bool> stop;
+    std::atomic<uint32_t> connections;
+    std::atomic<uint32_t> portSettings;   // RFC2217 subnegotiations received
+    std::atomic<uint32_t> baud;
+
+    SerialServer(bool telnet) : stop(false), connections(0), portSettings(0), baud(0), telnet(telnet), server(PORT) {
+        this->meter.answerDelay = 2000;
+        this->meter.current = 0xFF00FF;   // 0xFF bytes to escape
+        this->meter.voltage = 0xFFFF;
+
+        this->server.begin();
+        this->task = std::thread([this]() { this->run(); });
+    }
+    ~SerialServer() {
+        this->stop = true;
+        this->task.join();
+    }
+
+   private:
+    bool telnet;
+    WiFiServer server;
+    FakeMeter meter;
+    std::thread task;
+
+    uint8_t state = 0;
+    uint8_t subnegotiation[16];
+    uint8_t subnegotiationSize = 0;
+
+    void run() {
+        while (!this->stop) {
+            WiFiClient client = this->server.available();
+
+            if (!client) {
+                delay(1);
+
+                continue;
+            }
+
+            this->connections++;
+            this->state = 0;
+
+            client.setNoDelay(true);
+
+            if (this->telnet) {
+                uint8_t hello[] = {IAC, 253, 0, IAC, 251, 1, IAC, 251, 3};   // DO BINARY, WILL ECHO, WILL SGA
+
+                client.write(hello, sizeof(hello));
+            }
+
+            while (!this->stop && client.connected()) {
+                int c;
+
+                while ((c = client.read()) >= 0) {
+                    this->receive(c);
+                }
+
+                uint8_t buffer[64];
+                size_t size = 0;
+
+                while (this->meter.available() > 0 && size < sizeof(buffer) - 1) {
+                    buffer[size] = this->meter.read();
+
+                    if (this->telnet && buffer[size] == IAC) {
+                        buffer[++size] = IAC;
+                    }
+
+                    size++;
+                }
+
+                if (size > 0) {
+                    client.write(buffer, size);
+                }
+
+                yield();
+            }
+
+            client.stop();
+        }
+    }
+
+    void receive(uint8_t b) {
+        if (!this->telnet) {
+            this->meter.write(b);
+
+            return;
+        }
+
+        switch (this->state) {
+            case 0:   // data
+                if (b == IAC) {
+                    this->state = 1;
+                } else {
+                    this->meter.write(b);
+                }
+                break;
+            case 1:   // command
+                if (b == IAC) {
+                    this->meter.write(b);
+                    this->state = 0;
+                } else if (b == SB) {
+                    this->subnegotiationSize = 0;
+                    this->state = 3;
+                } else {
+                    this->state = (b > SB) ? 2 : 0;
+                }
+                break;
+            case 2:   // option
+                this->state = 0;
+                break;
+            case 3:   // subnegotiation
+                if (b == IAC) {
+                    this->state = 4;
+                } else if (this->subnegotiationSize < sizeof(this->subnegotiation)) {
+                    this->subnegotiation[this->subnegotiationSize++] = b;
+                }
+                break;
+            case 4:
+                if (b == SE) {
+                    this->endSubnegotiation();
+                    this->state = 0;
+                } else {
+                    if (this->subnegotiationSize < sizeof(this->subnegotiation)) {
+                        this->subnegotiation[this->subnegotiationSize++] = b;
+                    }
+                    this->state = 3;
+                }
+                break;
+        }
+    }
+
+    void endSubnegotiation() {
+        this->portSettings++;
+
+        // COM-PORT-OPTION SET-BAUDRATE
+        if (this->subnegotiationSize == 6 && this->subnegotiation[0] == 44 && this->subnegotiation[1] == 1) {
+            this->baud = ((uint32_t)this->subnegotiation[2] << 24) | (this->subnegotiation[3] << 16) | (this->subnegotiation[4] << 8) | this->subnegotiation[5];
+        }
+    }
+};
+
+// NetSerial sets no delay itself only on the ESP cores
+static bool connect(CountingClient &client) {
+    if (!client.connect("127.0.0.1", PORT)) {
+        return false;
+    }
+
+    client.setNoDelay(true);
+
+    return true;
+}
+
+static void checkReads(SmartMeter238 &sm, CountingClient &client) {
+    SmartMeter238::smartMeterData data;
+    uint32_t ok = 0;
+    uint32_t writes = client.frameWrites;
+
+    for (uint16_t i = 0; i < READS; i++) {
+        ok += sm.getMeasurementData(&data, true);
+    }
+
+    SM_CHECK(ok == READS);
+    SM_CHECK(client.frameWrites - writes == READS);   // one segment per request
+    SM_CHECK_NEAR(data.measurementData.data.current, 0xFF00FF * 0.001, 0.01);
+    SM_CHECK_NEAR(data.measurementData.data.voltage, 0xFFFF * 0.1, 0.01);
+}
+
+static void testMode(SmartMeter238NetSerial::smNetMode mode) {
+    bool telnet = (mode == SmartMeter238NetSerial::SM_NET_TELNET);
+    SerialServer server(telnet);
+    CountingClient client;
+    SmartMeter238NetSerial netSerial(client, mode);
+    SmartMeter238 sm(netSerial);
+    SmartMeter238::smartMeterData data;
+
+    SM_CHECK(connect(client));
+
+    checkReads(sm, client);
+
+    SM_CHECK(server.portSettings == (telnet ? 4u : 0u));
+    SM_CHECK(server.baud == (telnet ? SM_UART_BAUD : 0));
+
+    // Connection lost: the read fails, the sketch reconnects and the settings go out again
+    client.stop();
+
+    SM_CHECK(!sm.getMeasurementData(&data, true));
+    SM_CHECK(connect(client));
+
+    checkReads(sm, client);
+
+    SM_CHECK(server.connections == 2);
+    SM_CHECK(server.portSettings == (telnet ? 8u : 0u));
+
+    client.stop();
+}
+
+int main() {
+    testMode(SmartMeter238NetSerial::SM_NET_RAW);
+    testMode(SmartMeter238NetSerial::SM_NET_TELNET);
+
+    return smTestResult("test_netserial");
+}
@@ -0,0 +1,147 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Protection without a worker: the observer only holds the cut, nothing is sent while the measurement answer is
+// dispatched, and loop() sends it once the meter has no read in flight. rearm() drops a cut not sent yet.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238Protection.h"
+#include "SmartMeter238Test.h"
+
+#include <vector>
+
+// Added after the protection: records the dispatch order and the requests seen by the meter meanwhile
+class Recorder : public SmartMeter238Observer {
+   public:
+    FakeMeter *meter;
+    std::vector<SmartMeter238::smCommandReceive> commands;
+    std::vector<uint32_t> requests;
+
+    void onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) override {
+        this->commands.push_back(cmd);
+        this->requests.push_back(this->meter->requestCount);
+    }
+};
+
+static std::vector<SmartMeter238Protection::smTripEvent> trips;
+
+static void onTrip(const SmartMeter238Protection::smTripEvent &event, void *context) {
+    trips.push_back(event);
+}
+
+static void testHeldTrip() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238Protection protection;
+    SmartMeter238::smartMeterData data;
+    SmartMeter238Protection::smTripEvent event;
+    Recorder recorder;
+
+    trips.clear();
+    recorder.meter = &meter;
+    meter.answerDelay = 1000;
+
+    // The emulator answers 1.2345 kW: fires on the first measurement
+    SM_CHECK(protection.addRule(SmartMeter238::SM_FIELD_ACTIVEPOWER, SmartMeter238Protection::SM_RULE_ABOVE, 1.0, 0.1, 0) == 0);
+    protection.setTripCallback(onTrip);
+
+    sm.addObserver(&protection);
+    sm.addObserver(&recorder);
+
+    SM_CHECK(!protection.loop());
+
+    SM_CHECK(sm.getMeasurementData(&data, true));
+
+    // Tripped and logged, but no request left from the observer and the dispatch ended with the measurement
+    SM_CHECK(protection.isTripped());
+    SM_CHECK(meter.requestCount == 1);
+    SM_CHECK(meter.powerOn);
+    SM_CHECK(trips.empty());
+    SM_CHECK(recorder.commands.size() == 1 && recorder.commands[0] == SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA);
+    SM_CHECK(protection.getEventCount() == 1);
+    SM_CHECK(protection.getEvent(0, &event) && event.trip == 0);
+
+    // A read in flight keeps the cut held
+    SM_CHECK(sm.startRead(SmartMeter238::SM_CMD_RESP_LIMITANDPURCHASEDATA, &data));
+    SM_CHECK(!protection.loop());
+    SM_CHECK(meter.requestCount == 2);
+
+    while (sm.pollRead() == SmartMeter238::SM_TRANSACTION_BUSY) {
+        delay(1);
+    }
+
+    SM_CHECK(protection.loop());
+    SM_CHECK(!protection.loop());
+
+    SM_CHECK(meter.requestCount == 3);
+    SM_CHECK(!meter.powerOn);
+    SM_CHECK(recorder.commands.size() == 3 && recorder.commands[2] == SmartMeter238::SM_CMD_RESP_POWERCUT);
+    SM_CHECK(trips.size() == 1);
+    SM_CHECK(protection.getEvent(0, &event) && event.success);
+    SM_CHECK(event.trip > event.detection);
+    SM_CHECK(protection.getLastTripLatency() == (uint32_t)(event.trip - event.detection));
+
+    // Latched: more measurements over the rule do not cut again
+    SM_CHECK(sm.getMeasurementData(&data, true));
+    SM_CHECK(!protection.loop());
+    SM_CHECK(meter.requestCount == 4);
+    SM_CHECK(protection.getEventCount() == 1);
+}
+
+static void testRearmDrops() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238Protection protection;
+    SmartMeter238::smartMeterData data;
+
+    trips.clear();
+    meter.answerDelay = 1000;
+
+    protection.addRule(SmartMeter238::SM_FIELD_ACTIVEPOWER, SmartMeter238Protection::SM_RULE_ABOVE, 1.0, 0.1, 0);
+    protection.setTripCallback(onTrip);
+    sm.addObserver(&protection);
+
+    SM_CHECK(sm.getMeasurementData(&data, true));
+    SM_CHECK(protection.isTripped());
+
+    protection.rearm();
+
+    SM_CHECK(!protection.isTripped());
+    SM_CHECK(!protection.loop());
+    SM_CHECK(meter.requestCount == 1);
+    SM_CHECK(meter.powerOn);
+    SM_CHECK(trips.empty());
+}
+
+int main() {
+    testHeldTrip();
+    testRearmDrops();
+
+    return smTestResult("test_protection");
+}
@@ -0,0 +1,143 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Tariff bands and tiers: a band that wraps midnight, bands on weekdays only, times off the slot grid and empty
+// bands refused without touching the table, and the energy of one measurement split at the tier limits.
+
+#include "SmartMeter238.h"
+#include "SmartMeter238Tariff.h"
+#include "SmartMeter238Test.h"
+
+#define MONDAY 1704067200UL   // 2024-01-01 00:00 UTC
+#define HOUR 3600UL
+#define DAY 86400UL
+
+static void testBands() {
+    SmartMeter238Tariff tariff;
+
+    SM_CHECK(tariff.setBand(1, SM_TARIFF_WORKDAYS, 17 * 60, 21 * 60));
+    SM_CHECK(tariff.setBand(2, SM_TARIFF_ALL_DAYS, 22 * 60, 6 * 60));
+
+    SM_CHECK(tariff.getBand(MONDAY + 17 * HOUR) == 1);
+    SM_CHECK(tariff.getBand(MONDAY + 17 * HOUR - 1) == 0);
+    SM_CHECK(tariff.getBand(MONDAY + 21 * HOUR - 1) == 1);
+    SM_CHECK(tariff.getBand(MONDAY + 21 * HOUR) == 0);
+    SM_CHECK(tariff.getBand(MONDAY - DAY + 18 * HOUR) == 0);   // sunday
+
+    // Wraps midnight
+    SM_CHECK(tariff.getBand(MONDAY + 22 * HOUR) == 2);
+    SM_CHECK(tariff.getBand(MONDAY + 23 * HOUR + 1800) == 2);
+    SM_CHECK(tariff.getBand(MONDAY + 5 * HOUR + 1800) == 2);
+    SM_CHECK(tariff.getBand(MONDAY + 6 * HOUR) == 0);
+    SM_CHECK(tariff.getBand(MONDAY + 12 * HOUR) == 0);
+
+    // Shorter than a slot, off the grid or empty: refused, the table is not changed
+    SM_CHECK(!tariff.setBand(3, SM_TARIFF_ALL_DAYS, 17 * 60, 17 * 60 + 10));
+    SM_CHECK(!tariff.setBand(3, SM_TARIFF_ALL_DAYS, 17 * 60 + 5, 18 * 60));
+    SM_CHECK(!tariff.setBand(3, SM_TARIFF_ALL_DAYS, 10 * 60, 10 * 60));
+    SM_CHECK(!tariff.setBand(3, SM_TARIFF_ALL_DAYS, 0, 1441));
+    SM_CHECK(tariff.getBand(MONDAY + 12 * HOUR) == 0);
+    SM_CHECK(tariff.getBand(MONDAY + 17 * HOUR) == 1);
+
+    // The whole day is asked as 0 to 1440
+    SM_CHECK(tariff.setBand(3, 1 << 6, 0, 1440));
+    SM_CHECK(tariff.getBand(MONDAY + 5 * DAY + 12 * HOUR) == 3);   // saturday
+    SM_CHECK(tariff.getBand(MONDAY + 5 * DAY + 23 * HOUR) == 3);
+    SM_CHECK(tariff.getBand(MONDAY + 4 * DAY + 12 * HOUR) == 0);
+}
+
+static void testTiers() {
+    SmartMeter238Tariff tariff;
+    SmartMeter238::smartMeterData data;
+
+    SM_CHECK(tariff.setBandPrice(0, 0.10));
+    SM_CHECK(tariff.setTier(0, 200, 0));
+    SM_CHECK(tariff.setTier(1, 500, 0.05));
+    SM_CHECK(tariff.setTier(2, INFINITY, 0.12));
+    SM_CHECK(!tariff.setTier(2, 400, 0.12));   // limits grow
+    SM_CHECK(!tariff.setTier(4, 900, 0.12));   // in order
+
+    SM_CHECK(tariff.getTier(199.9) == 0);
+    SM_CHECK(tariff.getTier(200) == 1);
+    SM_CHECK(tariff.getTier(500) == 2);
+    SM_CHECK(tariff.getTier(1e9) == 2);
+
+    data.measurementData.data.lapseOfTimeTotalEnergy = 1000;
+    tariff.accumulate(&data, MONDAY + 12 * HOUR);   // first sample, not attributed
+
+    SM_CHECK(data.powerCompanyData.data.periodKWh == 0);
+
+    // Up to the first limit exactly, then across the other two limits at once
+    data.measurementData.data.lapseOfTimeTotalEnergy = 1200;
+    tariff.accumulate(&data, MONDAY + 13 * HOUR);
+
+    SM_CHECK_NEAR(data.powerCompanyData.data.bandCost[0], 200 * 0.10, 0.001);
+    SM_CHECK(data.powerCompanyData.data.activeTier == 1);
+
+    data.measurementData.data.lapseOfTimeTotalEnergy = 1600;
+    tariff.accumulate(&data, MONDAY + 14 * HOUR);
+
+    SM_CHECK_NEAR(data.powerCompanyData.data.bandCost[0], 200 * 0.10 + 300 * 0.15 + 100 * 0.22, 0.001);
+    SM_CHECK_NEAR(data.powerCompanyData.data.bandKWh[0], 600, 0.001);
+    SM_CHECK_NEAR(data.powerCompanyData.data.periodKWh, 600, 0.001);
+    SM_CHECK(data.powerCompanyData.data.activeTier == 2);
+}
+
+// clear() puts back the billing day and the UTC offset too
+static void testClear() {
+    SmartMeter238Tariff tariff;
+    SmartMeter238::smartMeterData data;
+
+    tariff.setUtcOffset(HOUR);
+    SM_CHECK(tariff.setBillingDay(15));
+
+    tariff.clear();
+
+    SM_CHECK(tariff.setBand(1, SM_TARIFF_ALL_DAYS, 0, 60));
+    SM_CHECK(tariff.getBand(MONDAY + 1800) == 1);
+    SM_CHECK(tariff.getBand(MONDAY + HOUR + 1800) == 0);
+
+    data.measurementData.data.lapseOfTimeTotalEnergy = 0;
+    tariff.accumulate(&data, MONDAY + 9 * DAY);
+
+    data.measurementData.data.lapseOfTimeTotalEnergy = 100;
+    tariff.accumulate(&data, MONDAY + 9 * DAY + HOUR);
+
+    data.measurementData.data.lapseOfTimeTotalEnergy = 150;
+    tariff.accumulate(&data, MONDAY + 19 * DAY);   // same period with the billing day on the 1st
+
+    SM_CHECK_NEAR(data.powerCompanyData.data.periodKWh, 150, 0.001);
+}
+
+int main() {
+    testBands();
+    testTiers();
+    testClear();
+
+    return smTestResult("test_tariff");
+}
@@ -0,0 +1,235 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Uplink store and forward to a loopback socket: records leave in packets of the batch size or after the maximum
+// delay, with the link down they go to the file spill (mock FS under SM_TEST_FS_ROOT), which a new spill object
+// finds again, and after the reconnect every record arrives once and in order, the spill before RAM.
+
+#include "FS.h"
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238Test.h"
+#include "SmartMeter238Uplink.h"
+#include "WiFiServer.h"
+
+#include <vector>
+
+#define PORT 23824
+#define SPILL_PATH "/SmartMeter238-uplink-test.spill"
+#define RECORD_SIZE (sizeof(uint64_t) + SmartMeter238::SM_FIELD_COUNT * sizeof(float))
+
+typedef struct {
+    uint8_t records;
+    uint32_t sequence;
+    std::vector<uint64_t> timestamps;
+} smReceivedPacket;
+
+static fs::FS testFs;
+static std::vector<uint8_t> received;
+static uint64_t nextTimestamp = 1;
+
+static void push(SmartMeter238 &sm, SmartMeter238Uplink &uplink, uint32_t records) {
+    SmartMeter238::smartMeterData data = {};
+
+    for (uint32_t i = 0; i < records; i++) {
+        data.measurementData.timestamp = nextTimestamp;
+        data.measurementData.data.activePower = nextTimestamp * 0.5f;
+        nextTimestamp++;
+
+        uplink.push(sm, &data);
+        uplink.loop();
+    }
+}
+
+static void drain(WiFiClient &peer) {
+    uint8_t buffer[512];
+    int n;
+
+    while ((n = peer.read(buffer, sizeof(buffer))) > 0) {
+        received.insert(received.end(), buffer, buffer + n);
+    }
+}
+
+// Packets received so far, a cut packet at the end is left for later
+static std::vector<smReceivedPacket> parse() {
+    std::vector<smReceivedPacket> packets;
+    size_t pos = 0;
+
+    while (pos + SM_UPLINK_PACKET_HEADER <= received.size()) {
+        smReceivedPacket packet;
+
+        SM_CHECK(received[pos] == 'S' && received[pos + 1] == 'U' && received[pos + 2] == SM_UPLINK_PACKET_VERSION);
+
+        packet.records = received[pos + 3];
+        memcpy(&packet.sequence, &received[pos + 4], sizeof(packet.sequence));
+
+        size_t size = SM_UPLINK_PACKET_HEADER + packet.records * RECORD_SIZE;
+
+        if (pos + size > received.size()) {
+            break;
+        }
+
+        for (uint8_t i = 0; i < packet.records; i++) {
+            const uint8_t *record = &received[pos + SM_UPLINK_PACKET_HEADER + i * RECORD_SIZE];
+            uint64_t timestamp;
+            float power;
+
+            memcpy(&timestamp, record, sizeof(timestamp));
+            memcpy(&power, record + sizeof(timestamp) + SmartMeter238::SM_FIELD_ACTIVEPOWER * sizeof(float), sizeof(power));
+
+            SM_CHECK(power == timestamp * 0.5f);
+
+            packet.timestamps.push_back(timestamp);
+        }
+
+        packets.push_back(packet);
+        pos += size;
+    }
+
+    return packets;
+}
+
+int main() {
+    FakeMeter meter;   // not read, the records are pushed
+    SmartMeter238 sm(meter);
+
+    WiFiServer server(PORT);
+    WiFiClient client;
+    WiFiClient peer;
+
+    testFs.remove(SPILL_PATH);
+
+    SmartMeter238ClientSink sink(client);
+    SmartMeter238FileSpill spill(testFs, SPILL_PATH, 64 * 1024);
+    SmartMeter238Uplink uplink(&sink, &spill);
+
+    SM_CHECK(spill.begin());
+
+    server.begin();
+
+    SM_CHECK(client.connect("127.0.0.1", PORT));
+
+    delay(10);
+    peer = server.available();
+    SM_CHECK(peer);
+
+    // Batching: four records make a packet, one record waits for the maximum delay
+    uplink.setMaxBatch(4);
+    uplink.setMaxDelay(50);
+
+    push(sm, uplink, 3);
+    SM_CHECK(uplink.getSentCount() == 0 && uplink.getQueuedCount() == 3);
+
+    push(sm, uplink, 1);
+    SM_CHECK(uplink.getSentCount() == 1 && uplink.getQueuedCount() == 0);
+
+    push(sm, uplink, 1);
+    SM_CHECK(!uplink.loop());
+
+    delay(60);
+
+    SM_CHECK(uplink.loop());
+    SM_CHECK(uplink.getSentCount() == 2);
+
+    delay(10);
+    drain(peer);
+
+    std::vector<smReceivedPacket> packets = parse();
+
+    SM_CHECK(packets.size() == 2);
+
+    if (packets.size() == 2) {
+        SM_CHECK(packets[0].records == 4 && packets[0].sequence == 0 && packets[0].timestamps.front() == 1);
+        SM_CHECK(packets[1].records == 1 && packets[1].sequence == 1 && packets[1].timestamps.front() == 5);
+    }
+
+    // Link down: RAM up to the high watermark, then whole packets to the spill, nothing dropped
+    peer.stop();
+    delay(10);
+
+    push(sm, uplink, 60);
+
+    SM_CHECK(!sink.isReady());
+    SM_CHECK(uplink.getSpilledCount() > 0);
+    SM_CHECK(uplink.getQueuedCount() < SM_UPLINK_HIGH_WATERMARK);
+    SM_CHECK(uplink.getDroppedCount() == 0);
+    SM_CHECK(uplink.getPressure() == SmartMeter238Uplink::SM_UPLINK_BACKLOG);
+
+    // The file keeps the packets for a spill opened after a restart
+    SmartMeter238FileSpill reopened(testFs, SPILL_PATH, 64 * 1024);
+
+    SM_CHECK(reopened.begin());
+    SM_CHECK(reopened.getCount() == spill.getCount());
+
+    // Reconnect: spill first, then RAM, until everything is out
+    SM_CHECK(client.connect("127.0.0.1", PORT));
+
+    delay(10);
+    peer = server.available();
+    SM_CHECK(peer);
+
+    received.clear();
+
+    for (int i = 0; i < 1000 && (uplink.getQueuedCount() > 0 || uplink.getSpilledCount() > 0); i++) {
+        uplink.loop();
+        drain(peer);
+        delay(1);
+    }
+
+    delay(60);
+    uplink.loop();
+    delay(10);
+    drain(peer);
+
+    SM_CHECK(uplink.getQueuedCount() == 0 && uplink.getSpilledCount() == 0);
+    SM_CHECK(uplink.getPressure() == SmartMeter238Uplink::SM_UPLINK_NORMAL);
+    SM_CHECK(!testFs.exists(SPILL_PATH));
+
+    packets = parse();
+
+    uint64_t expected = 6;
+    uint32_t sequence = 2;
+
+    for (const smReceivedPacket &packet : packets) {
+        SM_CHECK(packet.sequence == sequence);
+        sequence++;
+
+        for (uint64_t timestamp : packet.timestamps) {
+            SM_CHECK(timestamp == expected);
+            expected++;
+        }
+    }
+
+    SM_CHECK(expected == nextTimestamp);
+
+    if (expected != nextTimestamp) {
+        printf("  received up to %llu of %llu\n", (unsigned long long)expected - 1, (unsigned long long)nextTimestamp - 1);
+    }
+
+    return smTestResult("test_uplink");
+}
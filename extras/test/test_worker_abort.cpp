@@ -0,0 +1,194 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González Zárate
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// A control request preempting a routine read. The read is aborted at a frame boundary, the power cut goes out
+// while the meter still sends the rest of the aborted answer, and those bytes are skipped by count
+// (discardCount) so the power cut answer and the next read are decoded in sync. The session is recorded with the
+// trace and played back in real time, the replay has to see the same frames.
+
+#include "FakeMeter.h"
+#include "SmartMeter238.h"
+#include "SmartMeter238Test.h"
+#include "SmartMeter238Trace.h"
+#include "SmartMeter238Worker.h"
+
+#include <atomic>
+#include <thread>
+
+#define ABORT_AFTER 30       // millis after the request for the worker, the limits answer arrives from 20 to 45 ms
+#define ABORT_AT_BYTE 17     // bytes read when the read is aborted: the echo (6) and 11 of the answer
+
+// Transport that lets SmartMeter238 read up to a limit, so the live run and the replay abort at the same byte
+class LimitedStream : public Stream {
+   public:
+    uint32_t readCount = 0;
+    uint32_t limit = 0xFFFFFFFF;
+
+    LimitedStream(Stream &stream) : stream(stream) {}
+
+    size_t write(uint8_t byte) override { return this->stream.write(byte); }
+    using Print::write;
+
+    int available() override { return min((uint32_t)this->stream.available(), this->limit - this->readCount); }
+    int read() override {
+        if (this->available() == 0) {
+            return -1;
+        }
+
+        this->readCount++;
+
+        return this->stream.read();
+    }
+    int peek() override { return (this->available() > 0) ? this->stream.peek() : -1; }
+
+   private:
+    Stream &stream;
+};
+
+static void abortThenControl(LimitedStream &link, SmartMeter238 &sm, SmartMeter238::smartMeterData *data) {
+    link.limit = ABORT_AT_BYTE;
+
+    SM_CHECK(sm.startRead(SmartMeter238::SM_CMD_RESP_LIMITANDPURCHASEDATA, data));
+
+    while (link.readCount < ABORT_AT_BYTE) {
+        SM_CHECK(sm.pollRead() == SmartMeter238::SM_TRANSACTION_BUSY);
+        yield();
+    }
+
+    link.limit = 0xFFFFFFFF;
+
+    uint8_t owed = sm.abortRead();
+
+    SM_CHECK(owed == SM_FRAMESIZE_MSG_RESP_LIMITANDPURCHASEDATA - (ABORT_AT_BYTE - SM_FRAMESIZE_MSG_GET_LIMITANDPURCHASEDATA));
+    SM_CHECK(sm.getErrCode() == SmartMeter238::SM_ERR_ABORTED);
+    SM_CHECK(!sm.isReadBusy());
+
+    // The echo of the power cut comes after the rest of the aborted answer
+    SM_CHECK(sm.setPowerCutData(true, data));
+    SM_CHECK(data->powerCutData.data.powerCut);
+
+    SM_CHECK(sm.getMeasurementData(data, true));
+    SM_CHECK_NEAR(data->measurementData.data.voltage, 230.1, 0.01);
+    SM_CHECK_NEAR(data->measurementData.data.lapseOfTimeTotalEnergy, 123.45, 0.001);
+
+    SM_CHECK(sm.getLimitAndPurchaseData(data, true));
+    SM_CHECK_NEAR(data->limitAndPurchaseData.data.energyPurchaseBalance, 100, 0.001);
+}
+
+static void testTraceAndReplay() {
+    static uint8_t traceArray[4096];
+
+    FakeMeter meter;
+    LimitedStream link(meter);
+    SmartMeter238TraceBuffer traceBuffer(traceArray, sizeof(traceArray));
+    SmartMeter238Trace trace;
+    SmartMeter238 sm(link);
+    SmartMeter238::smartMeterData data;
+
+    meter.byteTime = 1000;
+
+    trace.begin(traceBuffer);
+    sm.setTrace(&trace);
+
+    abortThenControl(link, sm, &data);
+
+    SM_CHECK(!meter.powerOn);
+    SM_CHECK(meter.requestCount == 4);
+    SM_CHECK(trace.getLostCount() == 0);
+
+    traceBuffer.rewind();
+
+    SmartMeter238Replay replay(traceBuffer, true);
+    LimitedStream replayLink(replay);
+    SmartMeter238 smReplay(replayLink);
+    SmartMeter238::smartMeterData replayData;
+
+    SM_CHECK(replay.begin());
+
+    abortThenControl(replayLink, smReplay, &replayData);
+
+    SM_CHECK(replay.getTxMismatchCount() == 0);
+    SM_CHECK(replay.getDroppedCount() == 0);
+    SM_CHECK(replay.finished());
+}
+
+static void testWorker() {
+    FakeMeter meter;
+    SmartMeter238 sm(meter);
+    SmartMeter238::smartMeterData data;
+    SmartMeter238Worker worker(sm, &data);
+    std::atomic<bool> stop(false);
+
+    meter.byteTime = 1000;
+
+    std::thread task([&]() {
+        while (!stop) {
+            if (!worker.loop()) {
+                yield();
+            }
+        }
+    });
+
+    SmartMeter238Worker::smCompletion read;
+    SmartMeter238Worker::smCompletion control;
+    SmartMeter238Worker::smCompletion next;
+
+    SM_CHECK(worker.submit(SmartMeter238Worker::SM_REQ_GET_LIMITANDPURCHASEDATA, &read));
+    delay(ABORT_AFTER);
+
+    SmartMeter238Worker::smRequest request;
+
+    request.type = SmartMeter238Worker::SM_REQ_SET_POWERCUT;
+    request.flag = true;
+    request.callback = nullptr;
+    request.completion = &control;
+
+    SM_CHECK(worker.submit(request));
+    SM_CHECK(worker.submit(SmartMeter238Worker::SM_REQ_GET_MEASUREMENTDATA, &next));
+
+    while (!read.done || !control.done || !next.done) {
+        yield();
+    }
+
+    stop = true;
+    task.join();
+
+    SM_CHECK(!read.result.success && read.result.errCode == SmartMeter238::SM_ERR_ABORTED);
+    SM_CHECK(control.result.success);
+    SM_CHECK(next.result.success);
+    SM_CHECK(!meter.powerOn);
+    SM_CHECK(worker.getAbortedCount() == 1);
+    SM_CHECK_NEAR(data.measurementData.data.voltage, 230.1, 0.01);
+}
+
+int main() {
+    testTraceAndReplay();
+    testWorker();
+
+    return smTestResult("test_worker_abort");
+}
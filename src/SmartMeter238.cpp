@@ -28,166 +28,135 @@ SOFTWARE.
 
 //------------------------------------------------------------------------------
 #include "SmartMeter238.h"
+#include "SmartMeter238Clock.h"
+#include "SmartMeter238Codec.h"
+#include "SmartMeter238Tariff.h"
+
+#ifdef SM_ENABLE_TRACE
+#include "SmartMeter238Trace.h"
+#endif
+
+#include <time.h>
 //------------------------------------------------------------------------------
 
+static SmartMeter238TuyaCodec smTuyaCodec;   // stateless, shared by every meter that uses the default protocol
+static SmartMeter238Clock smDefaultClock;
+
 #ifdef SM_ENABLE_DEBUG
 
 #ifdef SM_USE_REMOTE_DEBUG
-SmartMeter238::SmartMeter238(HardwareSerial &serial, RemoteDebug &debug) : smSerial(serial), smDebug(debug) {}
+SmartMeter238::SmartMeter238(HardwareSerial &serial, RemoteDebug &debug) : smSerial(serial), smHardwareSerial(&serial), smDebug(debug), smCodec(&smTuyaCodec), smClock(&smDefaultClock) {}
+SmartMeter238::SmartMeter238(Stream &stream, RemoteDebug &debug) : smSerial(stream), smDebug(debug), smCodec(&smTuyaCodec), smClock(&smDefaultClock) {}
 #else
-SmartMeter238::SmartMeter238(HardwareSerial &serial, HardwareSerial &debug) : smSerial(serial), smDebug(debug) {}
+SmartMeter238::SmartMeter238(HardwareSerial &serial, HardwareSerial &debug) : smSerial(serial), smHardwareSerial(&serial), smDebug(debug), smCodec(&smTuyaCodec), smClock(&smDefaultClock) {}
+SmartMeter238::SmartMeter238(Stream &stream, HardwareSerial &debug) : smSerial(stream), smDebug(debug), smCodec(&smTuyaCodec), smClock(&smDefaultClock) {}
 #endif   // SM_USE_REMOTE_DEBUG
 
 #else    // SM_ENABLE_DEBUG
-SmartMeter238::SmartMeter238(HardwareSerial &serial) : smSerial(serial) {}
+SmartMeter238::SmartMeter238(HardwareSerial &serial) : smSerial(serial), smHardwareSerial(&serial), smCodec(&smTuyaCodec), smClock(&smDefaultClock) {}
+SmartMeter238::SmartMeter238(Stream &stream) : smSerial(stream), smCodec(&smTuyaCodec), smClock(&smDefaultClock) {}
 #endif   // SM_ENABLE_DEBUG
 
 SmartMeter238::~SmartMeter238() {}
 
 void SmartMeter238::begin(void) {
-    this->smSerial.begin(SM_UART_BAUD, SM_UART_CONFIG);
+    // Other streams (replay, network) are already open
+    if (this->smHardwareSerial != nullptr) {
+        this->smHardwareSerial->begin(SM_UART_BAUD, SM_UART_CONFIG);
+    }
 }
 
-bool SmartMeter238::transmitSerialData(uint8_t *array, uint8_t size) {
-    SM_PRINT_I(F("* Message send: "));
-    SM_PRINT_MESSAGE(array, size);
+int SmartMeter238::readSerialByte() {
+    int byte = this->smSerial.read();
 
-    while (this->smSerial.available() > 0) {
-        this->smSerial.read();
-
-        delay(2);
+#ifdef SM_ENABLE_TRACE
+    if (this->smTrace != nullptr && byte >= 0) {
+        this->smTrace->record(SM_TRACE_RX, byte);
     }
+#endif
 
-    this->smSerial.write(array, size);
-
-    this->smSerial.flush();
-
-    SM_PRINT_I_LN(F("* Waiting confirmation:"));
+    return byte;
+}
 
-    if (this->receiveSerialData(array, size, array[1], array[4], SM_FRAME_3B_TYPE_SEND)) {
-        SM_PRINT_I_LN(F("* Successful Confirmation"));
+void SmartMeter238::writeSerialData(uint8_t *array, uint8_t size) {
+    this->smSerial.write(array, size);
 
-        return true;
+#ifdef SM_ENABLE_TRACE
+    if (this->smTrace != nullptr) {
+        for (uint8_t i = 0; i < size; i++) {
+            this->smTrace->record(SM_TRACE_TX, array[i]);
+        }
     }
-
-    SM_PRINT_I_LN(F("* Confirmation Failed"));
-
-    return false;
+#endif
 }
 
-bool SmartMeter238::preTransmitSerialData(smCommandTransmit cmd, uint8_t frameSize, uint8_t *array) {
-    uint8_t sendArr[frameSize];
-
-    sendArr[0] = SM_FRAME_1B_START;
-
-    sendArr[2] = SM_FRAME_3B_TYPE_SEND;
-    sendArr[3] = 0x01;
+bool SmartMeter238::transmitSerialData(uint8_t *array, uint8_t size) {
+    SM_PRINT_I(F("* Message send: "));
+    SM_PRINT_MESSAGE(array, size);
 
-    switch (cmd) {
-        case SM_CMD_GET_POWERCUT: {
-            sendArr[1] = SM_FRAME_2B_COMD_SEND_GETDATA;
-            sendArr[4] = SM_FRAME_5B_SUBCOMD_SEND_GETDATA_POWERCUT;
+    if (this->discardCount == 0) {
+        while (this->smSerial.available() > 0) {
+            this->readSerialByte();
 
-            break;
+            delay(2);
         }
-        case SM_CMD_GET_MEASUREMENTDATA: {
-            sendArr[1] = SM_FRAME_2B_COMD_SEND_GETDATA;
-            sendArr[4] = SM_FRAME_5B_SUBCOMD_SEND_GETDATA_MEASUREMENTDATA;
+    } else if (!this->smCodec->isEchoed()) {
+        // Half duplex bus, the aborted answer has to end before sending
+        this->discardSerialData();
+    }
 
-            break;
-        }
-        case SM_CMD_GET_LIMITANDPURCHASEDATA: {
-            sendArr[1] = SM_FRAME_2B_COMD_SEND_GETDATA;
-            sendArr[4] = SM_FRAME_5B_SUBCOMD_SEND_GETDATA_LIMITANDPURCHASEDATA;
+    this->writeSerialData(array, size);
 
-            break;
-        }
-        case SM_CMD_SET_LIMITDATA: {
-            sendArr[1] = SM_FRAME_2B_COMD_SEND_LIMITDATA;
-            sendArr[4] = SM_FRAME_5B_SUBCOMD_SEND_LIMITDATA;
+    this->smSerial.flush();
 
-            sendArr[5] = array[0];
-            sendArr[6] = array[1];
+    if (!this->smCodec->isEchoed()) {
+        return true;
+    }
 
-            sendArr[7] = array[2];
-            sendArr[8] = array[3];
+    SM_PRINT_I_LN(F("* Waiting confirmation:"));
 
-            sendArr[9] = array[4];
-            sendArr[10] = array[5];
+    uint8_t echoArr[size];
 
-            break;
-        }
-        case SM_CMD_SET_PURCHASEDATA: {
-            sendArr[1] = SM_FRAME_2B_COMD_SEND_PURCHASEDATA;
-            sendArr[4] = SM_FRAME_5B_SUBCOMD_SEND_PURCHASEDATA;
-
-            sendArr[5] = array[0];
-            sendArr[6] = array[1];
-            sendArr[7] = array[2];
-            sendArr[8] = array[3];
+    smErrorCode readErr = this->receiveSerialData(echoArr, size, true);
 
-            sendArr[9] = array[4];
-            sendArr[10] = array[5];
-            sendArr[11] = array[6];
-            sendArr[12] = array[7];
+    if (readErr == SM_ERR_NO_ERROR) {
+        readErr = this->smCodec->checkEcho(array, echoArr, size);
+    }
 
-            sendArr[13] = array[8];
+    if (this->checkSerialData(readErr)) {
+        SM_PRINT_I_LN(F("* Successful Confirmation"));
 
-            break;
-        }
-        case SM_CMD_SET_POWERCUT: {
-            sendArr[1] = SM_FRAME_2B_COMD_SEND_POWERCUT;
-            sendArr[4] = SM_FRAME_5B_SUBCOMD_SEND_POWERCUT;
+        return true;
+    }
 
-            sendArr[5] = array[0];
+    SM_PRINT_I_LN(F("* Confirmation Failed"));
 
-            break;
-        }
-        case SM_CMD_SET_DELAY: {
-            sendArr[1] = SM_FRAME_2B_COMD_SEND_DELAY;
-            sendArr[4] = SM_FRAME_5B_SUBCOMD_SEND_DELAY;
+    return false;
+}
 
-            sendArr[5] = array[0];
-            sendArr[6] = array[1];
+bool SmartMeter238::preTransmitSerialData(smCommandTransmit cmd, uint8_t *array) {
+    uint8_t sendArr[SM_MAX_BYTE_MSG_BUFFER];
 
-            sendArr[7] = array[2];
+    uint8_t frameSize = this->smCodec->encodeRequest(cmd, array, sendArr);
 
-            break;
-        }
-        case SM_CMD_SET_RESET: {
-            sendArr[1] = SM_FRAME_2B_COMD_SEND_RESET;
-            sendArr[4] = SM_FRAME_5B_SUBCOMD_SEND_RESET;
-
-            sendArr[5] = array[0];
-            sendArr[6] = array[1];
-            sendArr[7] = array[2];
-            sendArr[8] = array[3];
-            sendArr[9] = array[4];
-            sendArr[10] = array[5];
-            sendArr[11] = array[6];
-            sendArr[12] = array[7];
-            sendArr[13] = array[8];
-            sendArr[14] = array[9];
-            sendArr[15] = array[10];
-            sendArr[16] = array[11];
+    if (frameSize == 0) {
+        this->errType = SM_TYPE_INPUT_DATA_ERROR;
+        this->errCode = SM_ERR_NOT_SUPPORTED;
 
-            break;
-        }
+        return false;
     }
 
-    sendArr[frameSize - 1] = this->calculateCRC(sendArr, frameSize);
-
     return this->transmitSerialData(sendArr, frameSize);
 }
 
-bool SmartMeter238::receiveSerialData(uint8_t *array, uint8_t size, uint8_t command, uint8_t subCommand, uint8_t typeMessage) {
-    unsigned long resptime;
-    smErrorCode readErr = SM_ERR_NO_ERROR;
+SmartMeter238::smErrorCode SmartMeter238::receiveSerialData(uint8_t *array, uint8_t size, bool isEcho) {
+    this->discardSerialData();
 
-    resptime = millis() + SM_MAX_MILLIS_TO_RESPONSE;
+    unsigned long start = millis();
+    smErrorCode readErr = SM_ERR_NO_ERROR;
 
     while (this->smSerial.available() < size) {
-        if (resptime < millis()) {
+        if ((millis() - start) >= this->responseTimeout) {
             if (this->smSerial.available() > 0) {
                 readErr = SM_ERR_NOT_ENOUGHT_BYTES;
             } else {
@@ -200,133 +169,170 @@ bool SmartMeter238::receiveSerialData(uint8_t *array, uint8_t size, uint8_t comm
         yield();
     }
 
-    delay(2);
+    this->frameTimestamp = this->smClock->now();   // the last byte is in the buffer
+
+    // Bytes after an echo are the answer, a network bridge can deliver both at once
+    if (!isEcho) {
+        delay(2);
+    }
 
     if (readErr == SM_ERR_NO_ERROR) {
-        if (this->smSerial.available() == size) {
+        if (isEcho || this->smSerial.available() == size) {
             for (int n = 0; n < size; n++) {
-                array[n] = this->smSerial.read();
+                array[n] = this->readSerialByte();
             }
 
             SM_PRINT_I(F("* Message received: "));
             SM_PRINT_MESSAGE(array, size);
-
-            if (array[0] == SM_FRAME_1B_START && array[1] == command && array[2] == typeMessage && array[4] == subCommand) {
-                if (this->calculateCRC(array, size) != array[size - 1]) {
-                    readErr = SM_ERR_CRC_ERROR;
-                }
-            } else {
-                readErr = SM_ERR_WRONG_BYTES;
-            }
         } else {
             readErr = SM_ERR_EXCEEDS_BYTES;
         }
     }
 
+    return readErr;
+}
+
+bool SmartMeter238::countSerialData(smErrorCode readErr) {
     if (readErr != SM_ERR_NO_ERROR) {
         this->errType = SM_TYPE_COMMUNICATION_ERROR;
         this->errCode = readErr;
 
         this->readingErrCount++;
-    } else {
-        this->readingSuccessCount++;
+
+        return false;
     }
 
+    this->readingSuccessCount++;
+
+    return true;
+}
+
+void SmartMeter238::drainSerialData() {
     delay(2);
 
     while (this->smSerial.available() > 0) {
-        this->smSerial.read();
+        this->readSerialByte();
 
         delay(2);
     }
+}
+
+bool SmartMeter238::discardSerialData() {
+    unsigned long start = millis();
+
+    while (this->discardCount > 0) {
+        if (this->smSerial.available() > 0) {
+            this->readSerialByte();
+            this->discardCount--;
+        } else if ((millis() - start) >= this->responseTimeout) {
+            this->discardCount = 0;
+
+            return false;
+        } else {
+            yield();
+        }
+    }
+
+    return true;
+}
+
+bool SmartMeter238::checkSerialData(smErrorCode readErr) {
+    // Nothing is drained on success, after an echo the answer can be in the buffer already
+    if (!this->countSerialData(readErr)) {
+        this->drainSerialData();
+    }
 
     return (this->errCode == SM_ERR_NO_ERROR);
 }
 
-bool SmartMeter238::preReceiveSerialData(smCommandReceive cmd, uint8_t frameSize, smartMeterData *dataObject) {
-    uint8_t receiveArr[frameSize];
+bool SmartMeter238::preReceiveSerialData(smCommandReceive cmd, smartMeterData *dataObject) {
+    uint8_t frameSize = this->smCodec->getAnswerSize(cmd);
+    uint8_t receiveArr[SM_MAX_BYTE_MSG_BUFFER];
 
     SM_PRINT_I_LN(F("* Waiting answer:"));
 
-    switch (cmd) {
-        case SM_CMD_RESP_POWERCUT: {
-            if (this->receiveSerialData(receiveArr, frameSize, SM_FRAME_2B_COMD_RESPONSE_POWERCUT, SM_FRAME_5B_SUBCOMD_RESPONSE_POWERCUT, SM_FRAME_3B_TYPE_RESPONSE)) {
-                dataObject->powerCutData.time = millis();
+    if (frameSize == 0 || frameSize > SM_MAX_BYTE_MSG_BUFFER) {
+        this->errType = SM_TYPE_INPUT_DATA_ERROR;
+        this->errCode = SM_ERR_NOT_SUPPORTED;
 
-                dataObject->powerCutData.data.powerCut = !receiveArr[6];
-
-                if (dataObject->powerCutData.data.powerCut) {
-                    if (receiveArr[11] == 1) {
-                        dataObject->powerCutData.data.powerCutDetails = SM_STR_POWERCUT_DETAILS_OVER_VOLTAGE;
-                    } else if (receiveArr[11] == 2) {
-                        dataObject->powerCutData.data.powerCutDetails = SM_STR_POWERCUT_DETAILS_UNDER_VOLTAGE;
-                    } else if (receiveArr[15] == 1) {
-                        dataObject->powerCutData.data.powerCutDetails = SM_STR_POWERCUT_DETAILS_OVER_CURRENT;
-                    } else if (receiveArr[19] == 1) {
-                        dataObject->powerCutData.data.powerCutDetails = SM_STR_POWERCUT_DETAILS_END_PURCHASE;
-                    } else {
-                        dataObject->powerCutData.data.powerCutDetails = SM_STR_POWERCUT_DETAILS_UNKNOWN;
-                    }
-                } else {
-                    dataObject->powerCutData.data.powerCutDetails = SM_STR_POWERCUT_DETAILS_NO_POWER_CUT;
-                }
+        SM_PRINT_I_LN(F("* Failed answer"));
 
-                dataObject->powerCutData.data.delay = (receiveArr[16] << 8) | receiveArr[17];
-                dataObject->powerCutData.data.delaySetPowerCut = receiveArr[18];
+        return false;
+    }
 
-                SM_PRINT_I_LN(F("* Successful answer"));
+    smErrorCode readErr = this->receiveSerialData(receiveArr, frameSize, false);
 
-                return true;
-            }
+    if (readErr == SM_ERR_NOT_ENOUGHT_BYTES) {
+        // An error answer of the meter is shorter than the data
+        uint8_t size = 0;
 
-            break;
+        while (size < frameSize && this->smSerial.available() > 0) {
+            receiveArr[size++] = this->readSerialByte();
         }
-        case SM_CMD_RESP_MEASUREMENTDATA: {
-            if (this->receiveSerialData(receiveArr, frameSize, SM_FRAME_2B_COMD_RESPONSE_MEASUREMENTDATA, SM_FRAME_5B_SUBCOMD_RESPONSE_MEASUREMENTDATA, SM_FRAME_3B_TYPE_RESPONSE)) {
-                dataObject->measurementData.time = millis();
 
-                dataObject->measurementData.data.current = ((receiveArr[5] << 16) | (receiveArr[6] << 8) | receiveArr[7]) * 0.001;
-                dataObject->measurementData.data.voltage = ((receiveArr[14] << 8) | receiveArr[15]) * 0.1;
-                dataObject->measurementData.data.frequency = ((receiveArr[52] << 8) | receiveArr[53]) * 0.01;
+        readErr = this->smCodec->checkShortAnswer(cmd, receiveArr, size);
+    }
+
+    if (this->processSerialData(cmd, receiveArr, frameSize, readErr, dataObject)) {
+        return true;
+    }
 
-                dataObject->measurementData.data.reactivePower = receiveArr[20] + (((receiveArr[21] << 8) | receiveArr[22]) * 0.0001);
-                dataObject->measurementData.data.activePower = receiveArr[32] + (((receiveArr[33] << 8) | receiveArr[34]) * 0.0001);
-                dataObject->measurementData.data.powerFactor = ((receiveArr[44] << 8) | receiveArr[45]) * 0.001;
+    this->drainSerialData();
+
+    return false;
+}
 
-                dataObject->measurementData.data.lapseOfTimeTotalEnergy = (((receiveArr[54] << 24) | (receiveArr[55] << 16) | (receiveArr[56] << 8) | receiveArr[57]) * 0.01);
-                dataObject->measurementData.data.lapseOfTimeImportEnergy = (((receiveArr[58] << 24) | (receiveArr[59] << 16) | (receiveArr[60] << 8) | receiveArr[61]) * 0.01);
-                dataObject->measurementData.data.lapseOfTimeExportEnergy = (((receiveArr[62] << 24) | (receiveArr[63] << 16) | (receiveArr[64] << 8) | receiveArr[65]) * 0.01);
-                dataObject->measurementData.data.lapseOfTimePriceEnergy = dataObject->measurementData.data.lapseOfTimeTotalEnergy * dataObject->powerCompanyData.data.priceKWh;
+bool SmartMeter238::processSerialData(smCommandReceive cmd, uint8_t *array, uint8_t size, smErrorCode readErr, smartMeterData *dataObject) {
+    if (readErr == SM_ERR_NO_ERROR) {
+        readErr = this->smCodec->checkAnswer(cmd, array, size);
+    }
 
-                dataObject->measurementData.data.totalKWh = dataObject->measurementData.data.lapseOfTimeTotalEnergy + dataObject->powerCompanyData.data.startingKWh;
+    if (this->countSerialData(readErr)) {
+        if (cmd != SM_CMD_RESP_MEASUREMENTDATA || !this->decodeMeasurement(array, size, dataObject)) {
+            this->smCodec->decodeAnswer(cmd, array, dataObject);
+        }
 
-                SM_PRINT_I_LN(F("* Successful answer"));
+        switch (cmd) {
+            case SM_CMD_RESP_POWERCUT: {
+                dataObject->powerCutData.time = millis();
+                dataObject->powerCutData.timestamp = this->frameTimestamp;
 
-                return true;
+                break;
             }
+            case SM_CMD_RESP_MEASUREMENTDATA: {
+                dataObject->measurementData.time = millis();
+                dataObject->measurementData.timestamp = this->frameTimestamp;
 
-            break;
-        }
-        case SM_CMD_RESP_LIMITANDPURCHASEDATA: {
-            if (this->receiveSerialData(receiveArr, frameSize, SM_FRAME_2B_COMD_RESPONSE_LIMITANDPURCHASEDATA, SM_FRAME_5B_SUBCOMD_RESPONSE_LIMITANDPURCHASEDATA, SM_FRAME_3B_TYPE_RESPONSE)) {
-                dataObject->limitAndPurchaseData.time = millis();
+                if (this->smTariff != nullptr) {
+                    uint32_t epoch = this->smClock->hasEpoch() ? (this->smClock->toEpoch(this->frameTimestamp) / 1000000) : time(nullptr);
 
-                dataObject->limitAndPurchaseData.data.energyPurchase = (((receiveArr[11] << 24) | (receiveArr[12] << 16) | (receiveArr[13] << 8) | receiveArr[14]) * 0.01);
-                dataObject->limitAndPurchaseData.data.energyPurchaseBalance = (((receiveArr[15] << 24) | (receiveArr[16] << 16) | (receiveArr[17] << 8) | receiveArr[18]) * 0.01);
-                dataObject->limitAndPurchaseData.data.energyPurchaseAlarm = (((receiveArr[19] << 24) | (receiveArr[20] << 16) | (receiveArr[21] << 8) | receiveArr[22]) * 0.01);
-                dataObject->limitAndPurchaseData.data.energyPurchaseStatus = receiveArr[13];
+                    this->getMeasurementField(dataObject, SM_FIELD_TOTALENERGY);   // integrated by the tariff
+                    this->smTariff->accumulate(dataObject, epoch);
+                }
 
-                dataObject->limitAndPurchaseData.data.maxCurrentLimit = ((receiveArr[9] << 8) | receiveArr[10]) * 0.01;
-                dataObject->limitAndPurchaseData.data.maxVoltageLimit = (receiveArr[5] << 8) | receiveArr[6];
-                dataObject->limitAndPurchaseData.data.minVoltageLimit = (receiveArr[7] << 8) | receiveArr[8];
+                if (this->smTariff != nullptr || this->isMeasurementField(SM_FIELD_PRICEENERGY)) {
+                    this->deriveMeasurementField(dataObject, SM_FIELD_PRICEENERGY);
+                }
 
-                SM_PRINT_I_LN(F("* Successful answer"));
+                if (this->isMeasurementField(SM_FIELD_TOTALKWH)) {
+                    this->deriveMeasurementField(dataObject, SM_FIELD_TOTALKWH);
+                }
 
-                return true;
+                break;
             }
+            case SM_CMD_RESP_LIMITANDPURCHASEDATA: {
+                dataObject->limitAndPurchaseData.time = millis();
+                dataObject->limitAndPurchaseData.timestamp = this->frameTimestamp;
 
-            break;
+                break;
+            }
         }
+
+        this->notifyObservers(cmd, dataObject);
+
+        SM_PRINT_I_LN(F("* Successful answer"));
+
+        return true;
     }
 
     SM_PRINT_I_LN(F("* Failed answer"));
@@ -356,8 +362,8 @@ bool SmartMeter238::getPowerCutData(smartMeterData *dataObject, bool forceUpdate
     this->errType = SM_TYPE_NO_ERROR;
     this->errCode = SM_ERR_NO_ERROR;
 
-    if (this->preTransmitSerialData(SM_CMD_GET_POWERCUT, SM_FRAMESIZE_MSG_GET_POWERCUT, nullptr)) {
-        if (this->preReceiveSerialData(SM_CMD_RESP_POWERCUT, SM_FRAMESIZE_MSG_RESP_POWERCUT, dataObject)) {
+    if (this->preTransmitSerialData(SM_CMD_GET_POWERCUT, nullptr)) {
+        if (this->preReceiveSerialData(SM_CMD_RESP_POWERCUT, dataObject)) {
             SM_PRINT_I_LN(F("Out from SmartMeter238 Library (getPowerCutData)"));
 
             return true;
@@ -377,7 +383,7 @@ bool SmartMeter238::getMeasurementData(smartMeterData *dataObject, bool forceUpd
     SM_PRINT_V_LN(F("* No input Data"));
 
     if (!forceUpdate) {
-        if (!((millis() - dataObject->measurementData.time) >= this->minIntervalUpdate) && dataObject->measurementData.time > 0) {
+        if (!((millis() - dataObject->measurementData.time) >= this->measurementIntervalUpdate) && dataObject->measurementData.time > 0) {
             SM_PRINT_I_LN(F("* Not necessary to update the data:"));
 
             SM_PRINT_I_LN(F("Out from SmartMeter238 Library (getMeasurementData)"));
@@ -389,8 +395,8 @@ bool SmartMeter238::getMeasurementData(smartMeterData *dataObject, bool forceUpd
     this->errType = SM_TYPE_NO_ERROR;
     this->errCode = SM_ERR_NO_ERROR;
 
-    if (this->preTransmitSerialData(SM_CMD_GET_MEASUREMENTDATA, SM_FRAMESIZE_MSG_GET_MEASUREMENTDATA, nullptr)) {
-        if (this->preReceiveSerialData(SM_CMD_RESP_MEASUREMENTDATA, SM_FRAMESIZE_MSG_RESP_MEASUREMENTDATA, dataObject)) {
+    if (this->preTransmitSerialData(SM_CMD_GET_MEASUREMENTDATA, nullptr)) {
+        if (this->preReceiveSerialData(SM_CMD_RESP_MEASUREMENTDATA, dataObject)) {
             SM_PRINT_I_LN(F("Out from SmartMeter238 Library (getMeasurementData)"));
 
             return true;
@@ -410,7 +416,7 @@ bool SmartMeter238::getLimitAndPurchaseData(smartMeterData *dataObject, bool for
     SM_PRINT_V_LN(F("* No input Data"));
 
     if (!forceUpdate) {
-        if (!((millis() - dataObject->limitAndPurchaseData.time) >= this->minIntervalUpdate) && dataObject->limitAndPurchaseData.time > 0) {
+        if (!((millis() - dataObject->limitAndPurchaseData.time) >= this->limitAndPurchaseIntervalUpdate) && dataObject->limitAndPurchaseData.time > 0) {
             SM_PRINT_I_LN(F("* Not necessary to update the data:"));
 
             SM_PRINT_I_LN(F("Out from SmartMeter238 Library (getLimitAndPurchaseData)"));
@@ -422,8 +428,8 @@ bool SmartMeter238::getLimitAndPurchaseData(smartMeterData *dataObject, bool for
     this->errType = SM_TYPE_NO_ERROR;
     this->errCode = SM_ERR_NO_ERROR;
 
-    if (this->preTransmitSerialData(SM_CMD_GET_LIMITANDPURCHASEDATA, SM_FRAMESIZE_MSG_GET_LIMITANDPURCHASEDATA, nullptr)) {
-        if (this->preReceiveSerialData(SM_CMD_RESP_LIMITANDPURCHASEDATA, SM_FRAMESIZE_MSG_RESP_LIMITANDPURCHASEDATA, dataObject)) {
+    if (this->preTransmitSerialData(SM_CMD_GET_LIMITANDPURCHASEDATA, nullptr)) {
+        if (this->preReceiveSerialData(SM_CMD_RESP_LIMITANDPURCHASEDATA, dataObject)) {
             SM_PRINT_I_LN(F("Out from SmartMeter238 Library (getLimitAndPurchaseData)"));
 
             return true;
@@ -516,8 +522,8 @@ bool SmartMeter238::setLimitsData(float maxCurrentLimit, uint16_t maxVoltageLimi
         sendArr[4] = (minVoltageLimit >> 8);
         sendArr[5] = (minVoltageLimit & SM_GET_ONE_BYTE);
 
-        if (this->preTransmitSerialData(SM_CMD_SET_LIMITDATA, SM_FRAMESIZE_MSG_SET_LIMITDATA, sendArr)) {
-            if (this->preReceiveSerialData(SM_CMD_RESP_LIMITANDPURCHASEDATA, SM_FRAMESIZE_MSG_RESP_LIMITANDPURCHASEDATA, dataObject)) {
+        if (this->preTransmitSerialData(SM_CMD_SET_LIMITDATA, sendArr)) {
+            if (this->preReceiveSerialData(SM_CMD_RESP_LIMITANDPURCHASEDATA, dataObject)) {
                 SM_PRINT_I_LN(F("Out from SmartMeter238 Library (setLimitsData)"));
 
                 return true;
@@ -574,8 +580,8 @@ bool SmartMeter238::setPurchaseData(float energyPurchase, float energyPurchaseAl
 
         sendArr[8] = energyPurchaseStatus;
 
-        if (this->preTransmitSerialData(SM_CMD_SET_PURCHASEDATA, SM_FRAMESIZE_MSG_SET_PURCHASEDATA, sendArr)) {
-            if (this->preReceiveSerialData(SM_CMD_RESP_LIMITANDPURCHASEDATA, SM_FRAMESIZE_MSG_RESP_LIMITANDPURCHASEDATA, dataObject)) {
+        if (this->preTransmitSerialData(SM_CMD_SET_PURCHASEDATA, sendArr)) {
+            if (this->preReceiveSerialData(SM_CMD_RESP_LIMITANDPURCHASEDATA, dataObject)) {
                 SM_PRINT_I_LN(F("Out from SmartMeter238 Library (setPurchaseData)"));
 
                 return true;
@@ -606,8 +612,8 @@ bool SmartMeter238::setPowerCutData(bool powerCut, smartMeterData *dataObject) {
 
         sendArr[0] = !powerCut;
 
-        if (this->preTransmitSerialData(SM_CMD_SET_POWERCUT, SM_FRAMESIZE_MSG_SET_POWERCUT, sendArr)) {
-            if (this->preReceiveSerialData(SM_CMD_RESP_POWERCUT, SM_FRAMESIZE_MSG_RESP_POWERCUT, dataObject)) {
+        if (this->preTransmitSerialData(SM_CMD_SET_POWERCUT, sendArr)) {
+            if (this->preReceiveSerialData(SM_CMD_RESP_POWERCUT, dataObject)) {
                 SM_PRINT_I_LN(F("Out from SmartMeter238 Library (setPowerCutData)"));
 
                 return true;
@@ -647,8 +653,8 @@ bool SmartMeter238::setDelay(bool delaySetPowerCut, uint16_t delay, smartMeterDa
 
         sendArr[2] = delaySetPowerCut;
 
-        if (this->preTransmitSerialData(SM_CMD_SET_DELAY, SM_FRAMESIZE_MSG_SET_DELAY, sendArr)) {
-            if (this->preReceiveSerialData(SM_CMD_RESP_POWERCUT, SM_FRAMESIZE_MSG_RESP_POWERCUT, dataObject)) {
+        if (this->preTransmitSerialData(SM_CMD_SET_DELAY, sendArr)) {
+            if (this->preReceiveSerialData(SM_CMD_RESP_POWERCUT, dataObject)) {
                 SM_PRINT_I_LN(F("Out from SmartMeter238 Library (setDelay)"));
 
                 return true;
@@ -689,10 +695,10 @@ bool SmartMeter238::setReset(smartMeterData *dataObject) {
         sendArr[10] = 0x00;
         sendArr[11] = 0x00;
 
-        float tmpStartingKWh = dataObject->powerCompanyData.data.startingKWh + dataObject->measurementData.data.lapseOfTimeTotalEnergy;
+        float tmpStartingKWh = dataObject->powerCompanyData.data.startingKWh + this->getMeasurementField(dataObject, SM_FIELD_TOTALENERGY);
 
-        if (this->preTransmitSerialData(SM_CMD_SET_RESET, SM_FRAMESIZE_MSG_SET_RESET, sendArr)) {
-            if (this->preReceiveSerialData(SM_CMD_RESP_MEASUREMENTDATA, SM_FRAMESIZE_MSG_RESP_MEASUREMENTDATA, dataObject)) {
+        if (this->preTransmitSerialData(SM_CMD_SET_RESET, sendArr)) {
+            if (this->preReceiveSerialData(SM_CMD_RESP_MEASUREMENTDATA, dataObject)) {
                 dataObject->powerCompanyData.data.startingKWh = tmpStartingKWh;
                 dataObject->measurementData.data.totalKWh = tmpStartingKWh;
 
@@ -737,8 +743,8 @@ bool SmartMeter238::setPowerCompanyData(float startingKWh, float priceKWh, smart
         dataObject->powerCompanyData.data.priceKWh = priceKWh;
 
         // Update counters
-        dataObject->measurementData.data.lapseOfTimePriceEnergy = dataObject->measurementData.data.lapseOfTimeTotalEnergy * priceKWh;
-        dataObject->measurementData.data.totalKWh = dataObject->measurementData.data.lapseOfTimeTotalEnergy + startingKWh;
+        this->deriveMeasurementField(dataObject, SM_FIELD_PRICEENERGY);
+        this->deriveMeasurementField(dataObject, SM_FIELD_TOTALKWH);
 
         SM_PRINT_I_LN(F("Out from SmartMeter238 Library (setPowerCompanyData)"));
 
@@ -752,7 +758,353 @@ bool SmartMeter238::setPowerCompanyData(float startingKWh, float priceKWh, smart
     return false;
 }
 
+bool SmartMeter238::startRead(smCommandReceive cmd, smartMeterData *dataObject) {
+    SM_PRINT_I_LN(F("In to SmartMeter238 Library (startRead)"));
+
+    if (this->readPhase != SM_READ_IDLE) {
+        this->errType = SM_TYPE_INPUT_DATA_ERROR;
+        this->errCode = SM_ERR_QUEUE_FULL;
+
+        SM_PRINT_ERROR(true);
+
+        SM_PRINT_I_LN(F("Out from SmartMeter238 Library (startRead)"));
+
+        return false;
+    }
+
+    this->errType = SM_TYPE_NO_ERROR;
+    this->errCode = SM_ERR_NO_ERROR;
+
+    smCommandTransmit request = SM_CMD_GET_MEASUREMENTDATA;
+
+    switch (cmd) {
+        case SM_CMD_RESP_POWERCUT: {
+            request = SM_CMD_GET_POWERCUT;
+
+            break;
+        }
+        case SM_CMD_RESP_MEASUREMENTDATA: {
+            request = SM_CMD_GET_MEASUREMENTDATA;
+
+            break;
+        }
+        case SM_CMD_RESP_LIMITANDPURCHASEDATA: {
+            request = SM_CMD_GET_LIMITANDPURCHASEDATA;
+
+            break;
+        }
+    }
+
+    this->readRequestSize = this->smCodec->encodeRequest(request, nullptr, this->readRequest);
+    this->readExpected = this->smCodec->getAnswerSize(cmd);
+
+    if (this->readRequestSize == 0 || this->readExpected == 0 || this->readExpected > SM_MAX_BYTE_MSG_BUFFER) {
+        this->errType = SM_TYPE_INPUT_DATA_ERROR;
+        this->errCode = SM_ERR_NOT_SUPPORTED;
+
+        SM_PRINT_ERROR(true);
+
+        SM_PRINT_I_LN(F("Out from SmartMeter238 Library (startRead)"));
+
+        return false;
+    }
+
+    if (this->discardCount > 0 && !this->smCodec->isEchoed()) {
+        this->discardSerialData();
+    }
+
+    // Leftovers of a failed read, without waiting for more
+    while (this->smSerial.available() > 0) {
+        this->readSerialByte();
+
+        if (this->discardCount > 0) {
+            this->discardCount--;
+        }
+    }
+
+    SM_PRINT_I(F("* Message send: "));
+    SM_PRINT_MESSAGE(this->readRequest, this->readRequestSize);
+
+    this->writeSerialData(this->readRequest, this->readRequestSize);
+
+    this->smSerial.flush();
+
+    this->readCmd = cmd;
+    this->readDataObject = dataObject;
+    this->readStart = millis();
+    this->readSize = 0;
+
+    if (this->smCodec->isEchoed()) {
+        this->readPhase = SM_READ_ECHO;
+    } else {
+        this->readPhase = SM_READ_ANSWER;
+    }
+
+    SM_PRINT_I_LN(F("Out from SmartMeter238 Library (startRead)"));
+
+    return true;
+}
+
+SmartMeter238::smTransactionState SmartMeter238::pollRead() {
+    if (this->readPhase == SM_READ_IDLE) {
+        return SM_TRANSACTION_IDLE;
+    }
+
+    uint8_t expected = (this->readPhase == SM_READ_ECHO) ? this->readRequestSize : this->readExpected;
+
+    while (this->discardCount > 0 && this->smSerial.available() > 0) {
+        this->readSerialByte();
+        this->discardCount--;
+    }
+
+    while (this->discardCount == 0 && this->readSize < expected && this->smSerial.available() > 0) {
+        this->readBuffer[this->readSize++] = this->readSerialByte();
+    }
+
+    if (this->readSize < expected) {
+        smErrorCode readErr = (this->readSize > 0) ? SM_ERR_NOT_ENOUGHT_BYTES : SM_ERR_TIMEOUT;
+
+        // An error answer of the meter is shorter than the data, it ends the read without waiting
+        if (this->readPhase == SM_READ_ANSWER && this->readSize > 0) {
+            readErr = this->smCodec->checkShortAnswer(this->readCmd, this->readBuffer, this->readSize);
+        }
+
+        if ((readErr == SM_ERR_NOT_ENOUGHT_BYTES || readErr == SM_ERR_TIMEOUT) && (millis() - this->readStart) < this->responseTimeout) {
+            return SM_TRANSACTION_BUSY;
+        }
+
+        this->readPhase = SM_READ_IDLE;
+
+        this->countSerialData(readErr);
+
+        SM_PRINT_ERROR(true);
+
+        return SM_TRANSACTION_FAILED;
+    }
+
+    this->frameTimestamp = this->smClock->now();   // as close to the last byte as the polling allows
+
+    if (this->readPhase == SM_READ_ECHO) {
+        if (!this->countSerialData(this->smCodec->checkEcho(this->readRequest, this->readBuffer, this->readSize))) {
+            this->readPhase = SM_READ_IDLE;
+
+            SM_PRINT_ERROR(true);
+
+            return SM_TRANSACTION_FAILED;
+        }
+
+        this->readPhase = SM_READ_ANSWER;
+        this->readStart = millis();
+        this->readSize = 0;
+
+        // The answer may have come with the echo, a stream that buffers it would not wake an event loop again
+        return this->pollRead();
+    }
+
+    // Bytes after the answer are dropped by the next startRead()
+    this->readPhase = SM_READ_IDLE;
+
+    SM_PRINT_I(F("* Message received: "));
+    SM_PRINT_MESSAGE(this->readBuffer, this->readSize);
+
+    if (!this->processSerialData(this->readCmd, this->readBuffer, this->readSize, SM_ERR_NO_ERROR, this->readDataObject)) {
+        SM_PRINT_ERROR(true);
+
+        return SM_TRANSACTION_FAILED;
+    }
+
+    return SM_TRANSACTION_DONE;
+}
+
+bool SmartMeter238::isReadBusy() {
+    return this->readPhase != SM_READ_IDLE;
+}
+
+unsigned long SmartMeter238::getReadTimeLeft() {
+    if (this->readPhase == SM_READ_IDLE) {
+        return 0;
+    }
+
+    unsigned long elapsed = millis() - this->readStart;
+
+    return (elapsed < this->responseTimeout) ? this->responseTimeout - elapsed : 0;
+}
+
+uint8_t SmartMeter238::abortRead() {
+    if (this->readPhase == SM_READ_IDLE) {
+        return 0;
+    }
+
+    // The meter sends the rest anyway, it is skipped by count so the next frame does not wait for silence
+    uint16_t owed = this->readExpected - ((this->readPhase == SM_READ_ANSWER) ? this->readSize : 0);
+
+    if (this->readPhase == SM_READ_ECHO) {
+        owed += this->readRequestSize - this->readSize;
+    }
+
+    this->readPhase = SM_READ_IDLE;
+    this->discardCount = min((uint16_t)(this->discardCount + owed), (uint16_t)0xFF);
+
+    this->errType = SM_TYPE_COMMUNICATION_ERROR;
+    this->errCode = SM_ERR_ABORTED;
+
+    return owed;
+}
+
+void SmartMeter238::setCodec(SmartMeter238Codec *codec) {
+    this->smCodec = (codec != nullptr) ? codec : &smTuyaCodec;
+}
+
+SmartMeter238Codec *SmartMeter238::getCodec() {
+    return this->smCodec;
+}
+
+void SmartMeter238::setClock(SmartMeter238Clock *clock) {
+    this->smClock = (clock != nullptr) ? clock : &smDefaultClock;
+}
+
+SmartMeter238Clock *SmartMeter238::getClock() {
+    return this->smClock;
+}
+
+void SmartMeter238::setTariff(SmartMeter238Tariff *tariff) {
+    this->smTariff = tariff;
+}
+
+SmartMeter238Tariff *SmartMeter238::getTariff() {
+    return this->smTariff;
+}
+
+#ifdef SM_ENABLE_TRACE
+void SmartMeter238::setTrace(SmartMeter238Trace *trace) {
+    this->smTrace = trace;
+}
+#endif
+
+void SmartMeter238::setMeasurementInterval(unsigned long interval) {
+    this->measurementIntervalUpdate = interval;
+}
+
+unsigned long SmartMeter238::getMeasurementInterval() {
+    return this->measurementIntervalUpdate;
+}
+
+void SmartMeter238::setMeasurementFields(uint16_t fields) {
+#ifdef SM_ENABLE_LAZY_DECODE
+    this->measurementFields = fields;
+#else
+    (void)fields;
+#endif
+}
+
+uint16_t SmartMeter238::getMeasurementFields() {
+#ifdef SM_ENABLE_LAZY_DECODE
+    return this->measurementFields;
+#else
+    return SM_FIELDS_ALL;
+#endif
+}
+
+float SmartMeter238::getMeasurementField(smartMeterData *dataObject, smMeasurementField field) {
+    if (field >= SM_FIELD_COUNT) {
+        return 0;
+    }
+
+#ifdef SM_ENABLE_LAZY_DECODE
+    if (!(dataObject->measurementData.decoded & SM_FIELD_BIT(field)) && dataObject->measurementData.time > 0) {
+        if (field == SM_FIELD_PRICEENERGY || field == SM_FIELD_TOTALKWH) {
+            this->deriveMeasurementField(dataObject, field);
+        } else if (!this->decodeMeasurementField(dataObject, field)) {
+            // The codec only decodes the whole frame
+            this->smCodec->decodeAnswer(SM_CMD_RESP_MEASUREMENTDATA, dataObject->measurementData.frame, dataObject);
+
+            dataObject->measurementData.decoded |= SM_FIELDS_FRAME;
+        }
+    }
+#endif
+
+    return *SmartMeter238::getMeasurementValue(dataObject, field);
+}
+
+void SmartMeter238::decodeMeasurementFields(smartMeterData *dataObject, uint16_t fields) {
+#ifdef SM_ENABLE_LAZY_DECODE
+    for (uint8_t i = 0; i < SM_FIELD_COUNT; i++) {
+        if (fields & SM_FIELD_BIT(i)) {
+            this->getMeasurementField(dataObject, (smMeasurementField)i);
+        }
+    }
+#else
+    (void)dataObject;
+    (void)fields;
+#endif
+}
+
+void SmartMeter238::setLimitAndPurchaseInterval(unsigned long interval) {
+    this->limitAndPurchaseIntervalUpdate = interval;
+}
+
+unsigned long SmartMeter238::getLimitAndPurchaseInterval() {
+    return this->limitAndPurchaseIntervalUpdate;
+}
+
+void SmartMeter238::setResponseTimeout(unsigned long timeout) {
+    this->responseTimeout = timeout;
+}
+
+unsigned long SmartMeter238::getResponseTimeout() {
+    return this->responseTimeout;
+}
+
+bool SmartMeter238::addObserver(SmartMeter238Observer *observer) {
+    if (observer == nullptr || this->observerCount >= SM_MAX_OBSERVERS) {
+        return false;
+    }
+
+    for (uint8_t i = 0; i < this->observerCount; i++) {
+        if (this->smObservers[i] == observer) {
+            return true;
+        }
+    }
+
+    this->smObservers[this->observerCount] = observer;
+    this->observerCount++;
+
+    return true;
+}
+
+bool SmartMeter238::removeObserver(SmartMeter238Observer *observer) {
+    for (uint8_t i = 0; i < this->observerCount; i++) {
+        if (this->smObservers[i] == observer) {
+            this->observerCount--;
+
+            for (uint8_t n = i; n < this->observerCount; n++) {
+                this->smObservers[n] = this->smObservers[n + 1];
+            }
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void SmartMeter238::notifyObservers(smCommandReceive cmd, smartMeterData *dataObject) {
+    for (uint8_t i = 0; i < this->observerCount; i++) {
+        this->smObservers[i]->onDataUpdate(*this, cmd, dataObject);
+    }
+}
+
 #ifdef SM_ENABLE_RAW_TEST_MSG
+// Value of the characters '0' to 'f', -1 is not hex
+static const int8_t smHexDecodeTable[] PROGMEM = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15
+};
+
+static const char smHexEncodeTable[] PROGMEM = {"0123456789ABCDEF"};
+
 bool SmartMeter238::sendHexMessage(const char *msg) {
     SM_PRINT_I_LN(F("In to SmartMeter238 Library (sendHexMessage)"));
 
@@ -763,7 +1115,7 @@ bool SmartMeter238::sendHexMessage(const char *msg) {
     this->errType = SM_TYPE_NO_ERROR;
     this->errCode = SM_ERR_NO_ERROR;
 
-    uint8_t lengthMsg = strlen(msg);
+    size_t lengthMsg = strlen(msg);
 
     if (lengthMsg == 0 || lengthMsg > SM_MAX_HEX_MSG_LENGTH) {
         this->errType = SM_TYPE_INPUT_DATA_ERROR;
@@ -771,111 +1123,210 @@ bool SmartMeter238::sendHexMessage(const char *msg) {
     }
 
     if (this->errCode == SM_ERR_NO_ERROR) {
-        char tmpMsg[SM_MAX_HEX_MSG_LENGTH_PARSE];   // Max char without ":"
+        uint8_t sendArr[SM_MAX_BYTE_MSG_BUFFER];
 
-        uint8_t size = 0;
+        int16_t lengthArray = this->parseHexMessage(msg, lengthMsg, sendArr, nullptr);
 
-        uint8_t c = 0;
+        if (lengthArray <= 0) {
+            this->errType = SM_TYPE_INPUT_DATA_ERROR;
+            this->errCode = SM_ERR_WRONG_MSG;
+        }
 
-        for (uint8_t i = 0; i < lengthMsg; i++) {
-            if (msg[i] == ':') {
-                if (c == 2) {
-                    c = 0;
-                } else {
-                    this->errType = SM_TYPE_INPUT_DATA_ERROR;
-                    this->errCode = SM_ERR_WRONG_MSG;
+        if (this->errCode == SM_ERR_NO_ERROR) {
+            sendArr[lengthArray - 1] = this->calculateCRC(sendArr, lengthArray);
 
-                    break;
-                }
-            } else {
-                if (c == 2) {
-                    this->errType = SM_TYPE_INPUT_DATA_ERROR;
-                    this->errCode = SM_ERR_WRONG_MSG;
+            if (this->transmitSerialData(sendArr, lengthArray)) {
+                SM_PRINT_I_LN(F("* Waiting answer:"));
 
-                    break;
-                } else {
-                    tmpMsg[size] = msg[i];
-                    size++;
+                if (this->waitIncomingMessage(this->responseTimeout)) {
+                    if (this->processIncomingMessages()) {
+                        SM_PRINT_I_LN(F("* Successful answer"));
+
+                        SM_PRINT_I_LN(F("Out from SmartMeter238 Library (sendHexMessage)"));
 
-                    c++;
+                        return true;
+                    }
+                } else {
+                    this->errCode = SM_ERR_TIMEOUT;
                 }
+
+                SM_PRINT_I_LN(F("* Failed answer"));
             }
         }
+    }
 
-        if (this->errCode == SM_ERR_NO_ERROR) {
-            if ((size % 2) != 0) {
-                this->errType = SM_TYPE_INPUT_DATA_ERROR;
-                this->errCode = SM_ERR_WRONG_MSG;
+    SM_PRINT_ERROR(true);
+
+    SM_PRINT_I_LN(F("Out from SmartMeter238 Library (sendHexMessage)"));
+
+    return false;
+}
+
+bool SmartMeter238::runHexScript(const char *script, Print &output) {
+    SM_PRINT_I_LN(F("In to SmartMeter238 Library (runHexScript)"));
+
+    // One frame by line: "request [expected [timeout]]", hex bytes separated by ':', "??" matches any byte
+    // and a final "*" any tail, "-" skips the check. The last byte of the request is replaced by the CRC.
+    uint16_t frameCount = 0;
+    uint16_t passCount = 0;
+
+    char line[48];
+
+    const char *p = script;
+
+    while (*p != 0) {
+        const char *end = p;
+
+        while (*end != 0 && *end != '\n') {
+            end++;
+        }
+
+        // Tokens of the line
+        const char *token[3] = {nullptr, nullptr, nullptr};
+        uint8_t tokenLength[3] = {0, 0, 0};
+        uint8_t tokens = 0;
+
+        for (const char *c = p; c < end && *c != '#';) {
+            if (*c == ' ' || *c == '\t' || *c == '\r') {
+                c++;
+
+                continue;
             }
 
-            if (this->errCode == SM_ERR_NO_ERROR) {
-                uint8_t lengthArray = size / 2;
+            const char *start = c;
 
-                uint8_t sendArr[lengthArray];
+            while (c < end && *c != ' ' && *c != '\t' && *c != '\r') {
+                c++;
+            }
 
-                for (uint8_t i = 0; i < lengthArray; i++) {
-                    int a = this->char2int(tmpMsg[2 * i]);
-                    int b = this->char2int(tmpMsg[(2 * i) + 1]);
+            if (tokens < 3) {
+                token[tokens] = start;
+                tokenLength[tokens] = min((int)(c - start), 255);
+            }
 
-                    if (a == -1 || b == -1) {
-                        this->errType = SM_TYPE_INPUT_DATA_ERROR;
-                        this->errCode = SM_ERR_WRONG_MSG;
+            tokens++;
+        }
 
-                        break;
-                    }
+        p = (*end == 0) ? end : end + 1;
 
-                    sendArr[i] = (a << 4) | b;
-                }
+        if (tokens == 0) {
+            continue;   // empty line or comment
+        }
 
-                if (this->errCode == SM_ERR_NO_ERROR) {
-                    sendArr[lengthArray - 1] = this->calculateCRC(sendArr, lengthArray);
+        frameCount++;
 
-                    if (this->transmitSerialData(sendArr, lengthArray)) {
-                        SM_PRINT_I_LN(F("* Waiting answer:"));
+        uint8_t sendArr[SM_MAX_BYTE_MSG_BUFFER];
+        uint8_t expectedArr[SM_MAX_BYTE_MSG_BUFFER];
+        uint8_t expectedMask[SM_MAX_BYTE_MSG_BUFFER];
 
-                        unsigned long resptime = millis() + SM_MAX_MILLIS_TO_RESPONSE;
+        int16_t sendSize = this->parseHexMessage(token[0], tokenLength[0], sendArr, nullptr);
+        int16_t expectedSize = -1;   // no check
+        bool anyTail = false;
+        unsigned long timeout = this->responseTimeout;
 
-                        while (this->smSerial.available() == 0) {
-                            if (resptime < millis()) {
-                                this->errCode = SM_ERR_TIMEOUT;
+        bool badLine = (sendSize <= 0 || tokens > 3);
 
-                                break;
-                            }
+        if (tokens > 1 && !(tokenLength[1] == 1 && token[1][0] == '-')) {
+            uint8_t length = tokenLength[1];
 
-                            yield();
-                        }
+            if (token[1][length - 1] == '*') {
+                anyTail = true;
+                length = (length > 1) ? length - 2 : 0;   // "xx:*" or "*"
+            }
 
-                        if (this->errCode == SM_ERR_NO_ERROR) {
-                            if (this->processIncomingMessages()) {
-                                SM_PRINT_I_LN(F("* Successful answer"));
+            expectedSize = (length > 0) ? this->parseHexMessage(token[1], length, expectedArr, expectedMask) : 0;
 
-                                SM_PRINT_I_LN(F("Out from SmartMeter238 Library (sendHexMessage)"));
+            if (expectedSize < 0) {
+                badLine = true;
+            }
+        }
+
+        if (tokens > 2) {
+            timeout = strtoul(token[2], nullptr, 10);
+        }
 
-                                return true;
+        const char *status;
+        unsigned long elapsed = 0;
+
+        this->incomingHexMessage[0] = 0;
+
+        if (badLine) {
+            status = "BADLINE";
+        } else {
+            sendArr[sendSize - 1] = this->calculateCRC(sendArr, sendSize);
+
+            this->errType = SM_TYPE_NO_ERROR;
+            this->errCode = SM_ERR_NO_ERROR;
+
+            unsigned long start = millis();
+
+            if (!this->transmitSerialData(sendArr, sendSize)) {
+                status = "NOCONF";
+            } else if (!this->waitIncomingMessage(timeout)) {
+                status = "TIMEOUT";
+            } else {
+                uint8_t size = this->readIncomingMessage();
+
+                this->encodeHexMessage(this->incomingByteMessage, size, this->incomingHexMessage);
+
+                status = "PASS";
+
+                if (expectedSize >= 0) {
+                    if (size < expectedSize || (!anyTail && size != expectedSize)) {
+                        status = "FAIL";
+                    } else {
+                        for (int16_t i = 0; i < expectedSize; i++) {
+                            if ((this->incomingByteMessage[i] & expectedMask[i]) != expectedArr[i]) {
+                                status = "FAIL";
+
+                                break;
                             }
                         }
-
-                        SM_PRINT_I_LN(F("* Failed answer"));
                     }
                 }
             }
+
+            elapsed = millis() - start;
+        }
+
+        if (status[0] == 'P') {
+            passCount++;
         }
+
+        snprintf(line, sizeof(line), "%4u %-7s %6lu ", frameCount, status, elapsed);
+
+        output.print(line);
+        output.println(this->incomingHexMessage);
     }
 
-    SM_PRINT_ERROR(true);
+    snprintf(line, sizeof(line), "%u/%u passed", passCount, frameCount);
 
-    SM_PRINT_I_LN(F("Out from SmartMeter238 Library (sendHexMessage)"));
+    output.println(line);
 
-    return false;
+    SM_PRINT_I_LN(F("Out from SmartMeter238 Library (runHexScript)"));
+
+    return (passCount == frameCount);
 }
 
-bool SmartMeter238::processIncomingMessages() {
-    uint8_t index = 0;
+bool SmartMeter238::waitIncomingMessage(unsigned long timeout) {
+    unsigned long start = millis();
 
-    strlcpy(this->incomingHexMessage, "", SM_MAX_HEX_MSG_LENGTH);   // clean hex message buffer
+    while (this->smSerial.available() == 0) {
+        if ((millis() - start) >= timeout) {
+            return false;
+        }
+
+        yield();
+    }
+
+    return true;
+}
+
+uint8_t SmartMeter238::readIncomingMessage() {
+    uint8_t index = 0;
 
     while (this->smSerial.available() > 0) {
-        this->incomingByteMessage[index] = this->smSerial.read();
+        this->incomingByteMessage[index] = this->readSerialByte();
 
         delay(2);   // ESP is more quickly
 
@@ -886,6 +1337,14 @@ bool SmartMeter238::processIncomingMessages() {
         }
     }
 
+    return index;
+}
+
+bool SmartMeter238::processIncomingMessages() {
+    this->incomingHexMessage[0] = 0;   // clean hex message buffer
+
+    uint8_t index = this->readIncomingMessage();
+
     if (index == 0) {
         return true;   // 0 is not error
     } else {
@@ -901,21 +1360,7 @@ bool SmartMeter238::processIncomingMessages() {
             } else {
                 SM_PRINT_W_LN(F("* Valid message"));
 
-                char hexstr[index * 3];
-
-                uint8_t i;
-
-                for (i = 0; i < index; i++) {
-                    sprintf(hexstr + (i * 3), "%02x:", this->incomingByteMessage[i]);
-                }
-
-                hexstr[(index * 3) - 1] = 0;
-
-                for (i = 0; i < strlen(hexstr); i++) {
-                    hexstr[i] = toupper(hexstr[i]);
-                }
-
-                strlcpy(this->incomingHexMessage, hexstr, SM_MAX_HEX_MSG_LENGTH);
+                this->encodeHexMessage(this->incomingByteMessage, index, this->incomingHexMessage);
 
                 return true;
             }
@@ -933,16 +1378,68 @@ char *SmartMeter238::getIncomingHexMessage() {
     return this->incomingHexMessage;
 }
 
+int16_t SmartMeter238::parseHexMessage(const char *msg, uint16_t length, uint8_t *array, uint8_t *mask) {
+    // "XX:XX:XX", with a mask "??" is any byte. Two characters and a ':' by byte, none after the last one.
+    int16_t size = 0;
+
+    if ((length % 3) != 2) {
+        return -1;
+    }
+
+    for (uint16_t i = 0; i < length; i += 3) {
+        if ((i > 0 && msg[i - 1] != ':') || (i + 1) >= length || size == SM_MAX_BYTE_MSG_BUFFER) {
+            return -1;
+        }
+
+        if (mask != nullptr && msg[i] == '?' && msg[i + 1] == '?') {
+            array[size] = 0;
+            mask[size] = 0;
+        } else {
+            int a = this->char2int(msg[i]);
+            int b = this->char2int(msg[i + 1]);
+
+            if (a == -1 || b == -1) {
+                return -1;
+            }
+
+            array[size] = (a << 4) | b;
+
+            if (mask != nullptr) {
+                mask[size] = SM_GET_ONE_BYTE;
+            }
+        }
+
+        size++;
+    }
+
+    return size;
+}
+
+void SmartMeter238::encodeHexMessage(uint8_t *array, uint8_t size, char *hex) {
+    // Uppercase "XX:XX:XX", cut to fit SM_MAX_HEX_MSG_LENGTH
+    size = min(size, (uint8_t)(SM_MAX_HEX_MSG_LENGTH / 3));
+
+    char *c = hex;
+
+    for (uint8_t i = 0; i < size; i++) {
+        *c++ = pgm_read_byte(&smHexEncodeTable[array[i] >> 4]);
+        *c++ = pgm_read_byte(&smHexEncodeTable[array[i] & 0x0F]);
+        *c++ = ':';
+    }
+
+    if (size > 0) {
+        c--;
+    }
+
+    *c = 0;
+}
+
 int SmartMeter238::char2int(char input) {
-    if (input >= '0' && input <= '9') {
-        return input - 48;
-    } else if (input >= 'A' && input <= 'F') {
-        return input - 55;
-    } else if (input >= 'a' && input <= 'f') {
-        return input - 87;
+    if (input < '0' || input > 'f') {
+        return -1;
     }
 
-    return -1;
+    return (int8_t)pgm_read_byte(&smHexDecodeTable[input - '0']);
 }
 #endif
 
@@ -1010,19 +1507,104 @@ void SmartMeter238::clearSuccCount() {
 //
 //------------------------------------------------------------------------------
 
-uint8_t SmartMeter238::calculateCRC(uint8_t *array, uint8_t size) {
-    uint16_t tmpCRC = 0;
-    uint8_t crc;
+bool SmartMeter238::isMeasurementField(smMeasurementField field) {
+#ifdef SM_ENABLE_LAZY_DECODE
+    return this->measurementFields & SM_FIELD_BIT(field);
+#else
+    (void)field;
+
+    return true;
+#endif
+}
+
+bool SmartMeter238::decodeMeasurement(uint8_t *array, uint8_t size, smartMeterData *dataObject) {
+#ifdef SM_ENABLE_LAZY_DECODE
+    memcpy(dataObject->measurementData.frame, array, size);
 
-    uint8_t tmpSize = size - 1;   // we discard the last byte that corresponds to the CRC from the sum
+    dataObject->measurementData.decoded = 0;
 
-    for (uint8_t n = 0; n < tmpSize; n++) {
-        tmpCRC = tmpCRC + array[n];
+    if ((this->measurementFields & SM_FIELDS_FRAME) != SM_FIELDS_FRAME) {
+        for (uint8_t i = 0; i < SM_FIELD_COUNT; i++) {
+            if ((SM_FIELDS_FRAME & this->measurementFields & SM_FIELD_BIT(i)) && !this->decodeMeasurementField(dataObject, (smMeasurementField)i)) {
+                break;
+            }
+        }
+
+        if ((dataObject->measurementData.decoded & this->measurementFields & SM_FIELDS_FRAME) == (this->measurementFields & SM_FIELDS_FRAME)) {
+            return true;
+        }
     }
 
-    crc = tmpCRC & SM_GET_ONE_BYTE;
+    // Every field or a codec that only decodes the whole frame
+    dataObject->measurementData.decoded = SM_FIELDS_FRAME;
+#else
+    (void)array;
+    (void)size;
+    (void)dataObject;
+#endif
 
-    return crc;
+    return false;
+}
+
+bool SmartMeter238::decodeMeasurementField(smartMeterData *dataObject, smMeasurementField field) {
+#ifdef SM_ENABLE_LAZY_DECODE
+    if (this->smCodec->decodeField(field, dataObject->measurementData.frame, SmartMeter238::getMeasurementValue(dataObject, field))) {
+        dataObject->measurementData.decoded |= SM_FIELD_BIT(field);
+
+        return true;
+    }
+#else
+    (void)dataObject;
+    (void)field;
+#endif
+
+    return false;
+}
+
+void SmartMeter238::deriveMeasurementField(smartMeterData *dataObject, smMeasurementField field) {
+    float totalEnergy = this->getMeasurementField(dataObject, SM_FIELD_TOTALENERGY);
+
+    if (field == SM_FIELD_TOTALKWH) {
+        dataObject->measurementData.data.totalKWh = totalEnergy + dataObject->powerCompanyData.data.startingKWh;
+    } else if (this->smTariff == nullptr) {
+        // With a tariff the price is accumulated on every measurement
+        dataObject->measurementData.data.lapseOfTimePriceEnergy = totalEnergy * dataObject->powerCompanyData.data.priceKWh;
+    }
+
+#ifdef SM_ENABLE_LAZY_DECODE
+    dataObject->measurementData.decoded |= SM_FIELD_BIT(field);
+#endif
+}
+
+float *SmartMeter238::getMeasurementValue(smartMeterData *dataObject, smMeasurementField field) {
+    switch (field) {
+        case SM_FIELD_CURRENT:
+            return &dataObject->measurementData.data.current;
+        case SM_FIELD_VOLTAGE:
+            return &dataObject->measurementData.data.voltage;
+        case SM_FIELD_FREQUENCY:
+            return &dataObject->measurementData.data.frequency;
+        case SM_FIELD_REACTIVEPOWER:
+            return &dataObject->measurementData.data.reactivePower;
+        case SM_FIELD_ACTIVEPOWER:
+            return &dataObject->measurementData.data.activePower;
+        case SM_FIELD_POWERFACTOR:
+            return &dataObject->measurementData.data.powerFactor;
+        case SM_FIELD_TOTALENERGY:
+            return &dataObject->measurementData.data.lapseOfTimeTotalEnergy;
+        case SM_FIELD_IMPORTENERGY:
+            return &dataObject->measurementData.data.lapseOfTimeImportEnergy;
+        case SM_FIELD_EXPORTENERGY:
+            return &dataObject->measurementData.data.lapseOfTimeExportEnergy;
+        case SM_FIELD_PRICEENERGY:
+            return &dataObject->measurementData.data.lapseOfTimePriceEnergy;
+        default:
+            return &dataObject->measurementData.data.totalKWh;
+    }
+}
+
+uint8_t SmartMeter238::calculateCRC(uint8_t *array, uint8_t size) {
+    return SmartMeter238TuyaCodec::calculateCRC(array, size);
 }
 
 char *SmartMeter238::getTypeStr(bool clear) {
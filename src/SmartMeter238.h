@@ -36,6 +36,12 @@ SOFTWARE.
 #include <Arduino.h>
 #include <HardwareSerial.h>
 
+class SmartMeter238Tariff;
+class SmartMeter238Trace;
+class SmartMeter238Observer;
+class SmartMeter238Codec;
+class SmartMeter238Clock;
+
 #ifdef SM_ENABLE_DEBUG
 
 #define SM_PRINT_ERROR(x) this->printError(x);
@@ -115,6 +121,10 @@ SOFTWARE.
 
 #define SM_MIN_INTERVAL_TO_GET_DATA 500   // millis
 
+#ifndef SM_MAX_OBSERVERS
+#define SM_MAX_OBSERVERS 8   // max objects notified of every answer decoded
+#endif
+
 #ifndef SM_MAX_MILLIS_TO_CONFIRM
 #define SM_MAX_MILLIS_TO_CONFIRM 200   // default max time to wait for confirm from DDS2384W
 #endif
@@ -123,6 +133,15 @@ SOFTWARE.
 #define SM_MAX_MILLIS_TO_RESPONSE 1000   // default max time to wait for response from DDS2384W
 #endif
 
+// Measurement fields
+#define SM_FIELD_BIT(field) (1 << (field))
+#define SM_FIELDS_ALL 0x07FF     // every SM_FIELD_*
+#define SM_FIELDS_FRAME 0x01FF   // decoded from the frame, price and total kWh are derived
+
+#ifndef SM_MEASUREMENT_FIELDS
+#define SM_MEASUREMENT_FIELDS SM_FIELDS_ALL   // decoded on every measurement with SM_ENABLE_LAZY_DECODE
+#endif
+
 // Min Max data
 #define SM_MIN_VOLTAGE_LIMIT 80         // V
 #define SM_MAX_VOLTAGE_LIMIT 300        // V
@@ -139,6 +158,217 @@ SOFTWARE.
 #define SM_MIN_ENERGY_PRICE 0           //$
 #define SM_MAX_ENERGY_PRICE 1000        //$
 
+// Tariff
+#ifndef SM_TARIFF_MAX_BANDS
+#define SM_TARIFF_MAX_BANDS 4   // max time of use bands (peak, off-peak, ...), up to 16
+#endif
+
+#ifndef SM_TARIFF_MAX_TIERS
+#define SM_TARIFF_MAX_TIERS 4   // max tiered kWh blocks per billing period
+#endif
+
+#ifndef SM_TARIFF_SLOT_MINUTES
+#define SM_TARIFF_SLOT_MINUTES 30   // time resolution of the band table
+#endif
+
+#define SM_TARIFF_SLOTS_PER_DAY (1440 / SM_TARIFF_SLOT_MINUTES)
+#define SM_TARIFF_MIN_VALID_EPOCH 1577836800UL   // 2020-01-01, before this the clock is not set
+
+#if SM_TARIFF_MAX_BANDS > 16
+#error "SM_TARIFF_MAX_BANDS must be 16 or less"
+#endif
+
+// Trace
+#ifndef SM_TRACE_REPLAY_BUFFER
+#define SM_TRACE_REPLAY_BUFFER SM_MAX_BYTE_MSG_BUFFER   // bytes released by the replay before they are read
+#endif
+
+#ifndef SM_TRACE_FAST_GAP_MICROS
+#define SM_TRACE_FAST_GAP_MICROS 5000   // max gap between bursts on a fast replay, must be longer than the drain delays
+#endif
+
+// Worker
+#ifndef SM_WORKER_QUEUE_SIZE
+#define SM_WORKER_QUEUE_SIZE 16   // requests waiting for the worker, power of 2
+#endif
+
+#ifndef SM_WORKER_BATCH_SIZE
+#define SM_WORKER_BATCH_SIZE 8   // requests taken from the queue at once
+#endif
+
+#ifndef SM_WORKER_TASK_STACK
+#define SM_WORKER_TASK_STACK 4096   // RTOS task
+#endif
+
+#ifndef SM_WORKER_TASK_PRIORITY
+#define SM_WORKER_TASK_PRIORITY 2   // RTOS task
+#endif
+
+#if (SM_WORKER_QUEUE_SIZE & (SM_WORKER_QUEUE_SIZE - 1)) != 0
+#error "SM_WORKER_QUEUE_SIZE must be a power of 2"
+#endif
+
+// Power quality, defaults for 230 V 50 Hz
+#ifndef SM_PQ_MAX_EVENTS
+#define SM_PQ_MAX_EVENTS 16   // events kept, the oldest is lost when full
+#endif
+
+#define SM_PQ_DEFAULT_SAG_VOLTAGE 207        // V, 90 %
+#define SM_PQ_DEFAULT_SWELL_VOLTAGE 253      // V, 110 %
+#define SM_PQ_DEFAULT_VOLTAGE_HYSTERESIS 2   // V
+#define SM_PQ_DEFAULT_MIN_FREQUENCY 49.5     // Hz
+#define SM_PQ_DEFAULT_MAX_FREQUENCY 50.5     // Hz
+#define SM_PQ_DEFAULT_FREQUENCY_HYSTERESIS 0.05   // Hz
+#define SM_PQ_DEFAULT_MIN_DURATION 0         // millis, an event can be a single measurement
+#define SM_PQ_DEFAULT_FAST_INTERVAL 0        // millis, suggested measurement interval while an event is active
+
+// Load steps
+#ifndef SM_LOAD_MAX_SIGNATURES
+#define SM_LOAD_MAX_SIGNATURES 8   // appliances learned
+#endif
+
+#define SM_LOAD_DEFAULT_MIN_STEP 0.2      // kW
+#define SM_LOAD_DEFAULT_DEBOUNCE 2        // measurements at the new level to accept a step
+#define SM_LOAD_DEFAULT_TOLERANCE 0.15    // relative difference to match a signature
+#define SM_LOAD_MAX_LEARN_COUNT 16        // weight cap of a signature average, so it keeps adapting
+
+// Purchase forecast
+#define SM_FORECAST_DEFAULT_WARNING_HOURS 24       // hours before the cut
+#define SM_FORECAST_DAY_WEIGHT 0.3                 // weight of the last day in the rate of each hour
+#define SM_FORECAST_MIN_HOUR_COVERAGE 600          // seconds measured to learn the rate of an hour
+#define SM_FORECAST_READS_BEFORE_CUT 16            // balance reads scheduled in the time left
+#define SM_FORECAST_DEFAULT_MAX_INTERVAL 3600000   // millis, balance read interval far from the cut
+#define SM_FORECAST_REARM_FACTOR 1.5               // the warning fires again above warning hours * factor
+#define SM_FORECAST_MAX_DAYS 3650                  // balance that lasts longer is reported as no depletion
+
+// Cache
+#ifndef SM_CACHE_DEFAULT_TTL
+#define SM_CACHE_DEFAULT_TTL 1000   // millis, data younger than this is fresh
+#endif
+
+#ifndef SM_CACHE_DEFAULT_MAX_STALE
+#define SM_CACHE_DEFAULT_MAX_STALE 10000   // millis, stale data older than this is expired
+#endif
+
+#ifndef SM_CACHE_RETRY_INTERVAL
+#define SM_CACHE_RETRY_INTERVAL 1000   // millis, min time between a failed refresh and the next one
+#endif
+
+// Rollup
+#ifndef SM_ROLLUP_MINUTES
+#define SM_ROLLUP_MINUTES 60   // minute buckets kept
+#endif
+
+#ifndef SM_ROLLUP_HOURS
+#define SM_ROLLUP_HOURS 48   // hour buckets kept
+#endif
+
+#ifndef SM_ROLLUP_DAYS
+#define SM_ROLLUP_DAYS 62   // day buckets kept
+#endif
+
+#ifndef SM_ROLLUP_MONTHS
+#define SM_ROLLUP_MONTHS 24   // month buckets kept
+#endif
+
+#define SM_ROLLUP_FILE_VERSION 1
+
+// Archive
+#ifndef SM_ARCHIVE_TIME_RESOLUTION
+#define SM_ARCHIVE_TIME_RESOLUTION 1000   // micros, timestamps are kept to this resolution
+#endif
+
+#define SM_ARCHIVE_VERSION 1
+#define SM_ARCHIVE_FIELDS 9   // SM_FIELD_CURRENT to SM_FIELD_EXPORTENERGY, price and total kWh are derived
+#define SM_ARCHIVE_HEADER_SIZE (8 + 8 + (SM_ARCHIVE_FIELDS * 4))
+
+// Event server
+#ifndef SM_EVENT_MAX_CLIENTS
+#define SM_EVENT_MAX_CLIENTS 8   // connections served at the same time, more are refused
+#endif
+
+#ifndef SM_EVENT_BUFFER_SIZE
+#define SM_EVENT_BUFFER_SIZE 192   // request line and response header of each connection
+#endif
+
+#ifndef SM_EVENT_FRAME_SIZE
+#define SM_EVENT_FRAME_SIZE 384   // one serialized sample
+#endif
+
+#ifndef SM_EVENT_REQUEST_TIMEOUT
+#define SM_EVENT_REQUEST_TIMEOUT 2000   // millis to receive the request
+#endif
+
+#ifndef SM_EVENT_KEEPALIVE
+#define SM_EVENT_KEEPALIVE 15000   // millis, a comment is sent to idle event streams
+#endif
+
+#ifndef SM_EVENT_WRITE_CHUNK
+#define SM_EVENT_WRITE_CHUNK 512   // max bytes written to a connection per loop() without availableForWrite()
+#endif
+
+// Protection
+#ifndef SM_PROTECTION_MAX_RULES
+#define SM_PROTECTION_MAX_RULES 8   // rules evaluated on every measurement
+#endif
+
+#ifndef SM_PROTECTION_MAX_EVENTS
+#define SM_PROTECTION_MAX_EVENTS 8   // trips kept, the oldest is lost when full
+#endif
+
+// Fixed rate sampling
+#define SM_SAMPLER_LATENCY_SHIFT 3   // weight 1/8 of the last transaction in the latency estimate
+
+// Telemetry uplink
+#ifndef SM_UPLINK_QUEUE_SIZE
+#define SM_UPLINK_QUEUE_SIZE 32   // records kept in RAM
+#endif
+
+#ifndef SM_UPLINK_MAX_BATCH
+#define SM_UPLINK_MAX_BATCH 8   // records per packet, up to 255
+#endif
+
+#define SM_UPLINK_HIGH_WATERMARK (SM_UPLINK_QUEUE_SIZE * 3 / 4)   // records in RAM before spilling to flash
+#define SM_UPLINK_DEFAULT_MAX_DELAY 10000                       // millis a record waits for a full packet
+#define SM_UPLINK_PACKET_VERSION 1
+#define SM_UPLINK_PACKET_HEADER 8                               // bytes before the records
+
+#if SM_UPLINK_MAX_BATCH > 255 || SM_UPLINK_MAX_BATCH > SM_UPLINK_HIGH_WATERMARK
+#error "SM_UPLINK_MAX_BATCH must be 255 or less and fit under the high watermark"
+#endif
+
+// Poller
+#ifndef SM_POLLER_MAX_METERS
+#define SM_POLLER_MAX_METERS 16   // meters driven by one poller
+#endif
+
+#define SM_POLLER_SOCKET_BUFFER 512    // bytes of the JSON of one meter, host builds
+#define SM_POLLER_SOCKET_TIMEOUT 100   // millis a socket client has to take the answer
+
+#if SM_POLLER_MAX_METERS > 128
+#error "SM_POLLER_MAX_METERS must be 128 or less, addMeter() returns the index as int8_t"
+#endif
+
+// Network serial bridge
+#ifndef SM_NET_RX_BUFFER
+#define SM_NET_RX_BUFFER 128   // received bytes waiting to be read, power of 2
+#endif
+
+#define SM_NET_TX_BUFFER (SM_MAX_BYTE_MSG_BUFFER * 2)   // a frame with every byte escaped
+
+#if (SM_NET_RX_BUFFER & (SM_NET_RX_BUFFER - 1)) != 0
+#error "SM_NET_RX_BUFFER must be a power of 2"
+#endif
+
+// Coroutines
+#ifndef SM_CORO_FRAME_SIZE
+#define SM_CORO_FRAME_SIZE 512   // bytes of each coroutine frame
+#endif
+
+#ifndef SM_CORO_FRAME_COUNT
+#define SM_CORO_FRAME_COUNT 4   // coroutines running at once
+#endif
+
 //------------------------------------------------------------------------------
 //
 //------------------------------------------------------------------------------
@@ -173,6 +403,18 @@ SOFTWARE.
 #define SM_FRAMESIZE_MSG_SET_DELAY 0x09
 #define SM_FRAMESIZE_MSG_SET_RESET 0x12
 
+#include "SmartMeter238Model.h"
+
+//------------------------------------------------------------------------------
+
+// Modbus-RTU meters (DDS238-1 ZN, DDS238-2 ZN)
+#define SM_MODBUS_DEFAULT_ADDRESS 0x01
+#define SM_MODBUS_READ_HOLDING_REGISTERS 0x03
+#define SM_MODBUS_MEASUREMENT_REGISTER 0x0000   // first register of the measurement
+#define SM_MODBUS_MEASUREMENT_COUNT 0x12        // registers of the measurement
+#define SM_MODBUS_EXCEPTION 0x80                 // set in the function code of an exception answer
+#define SM_MODBUS_EXCEPTION_SIZE 5               // address, function, exception code, crc
+
 //------------------------------------------------------------------------------
 
 // Start Frame
@@ -247,6 +489,10 @@ const char smStrErrWrongMsg[] PROGMEM = {"No bytes received"};
 const char smStrErr1PInputDataOutOfRange[] PROGMEM = {"Data outside ranges, first parameter"};
 const char smStrErr2PInputDataOutOfRange[] PROGMEM = {"Data outside ranges, second parameter"};
 const char smStrErr3PInputDataOutOfRange[] PROGMEM = {"Data outside ranges, third parameter"};
+const char smStrErrQueueFull[] PROGMEM = {"Request queue full"};
+const char smStrErrNotSupported[] PROGMEM = {"Not supported by the meter protocol"};
+const char smStrErrAborted[] PROGMEM = {"Aborted by a higher priority request"};
+const char smStrErrMeterException[] PROGMEM = {"The meter answered with an exception"};
 
 const char *const smStrErrTable[] PROGMEM = {
     smStrErrNoError,
@@ -258,7 +504,11 @@ const char *const smStrErrTable[] PROGMEM = {
     smStrErrWrongMsg,
     smStrErr1PInputDataOutOfRange,
     smStrErr2PInputDataOutOfRange,
-    smStrErr3PInputDataOutOfRange
+    smStrErr3PInputDataOutOfRange,
+    smStrErrQueueFull,
+    smStrErrNotSupported,
+    smStrErrAborted,
+    smStrErrMeterException
 };
 
 class SmartMeter238 {
@@ -281,6 +531,32 @@ class SmartMeter238 {
         SM_CMD_RESP_LIMITANDPURCHASEDATA
     };
 
+    enum smTransactionState {
+        SM_TRANSACTION_IDLE,
+        SM_TRANSACTION_BUSY,
+        SM_TRANSACTION_DONE,
+        SM_TRANSACTION_FAILED
+    };
+
+    enum smMeasurementField {
+        SM_FIELD_CURRENT,
+        SM_FIELD_VOLTAGE,
+        SM_FIELD_FREQUENCY,
+
+        SM_FIELD_REACTIVEPOWER,
+        SM_FIELD_ACTIVEPOWER,
+        SM_FIELD_POWERFACTOR,
+
+        SM_FIELD_TOTALENERGY,
+        SM_FIELD_IMPORTENERGY,
+        SM_FIELD_EXPORTENERGY,
+        SM_FIELD_PRICEENERGY,
+
+        SM_FIELD_TOTALKWH,
+
+        SM_FIELD_COUNT
+    };
+
     enum smErrorType {
         SM_TYPE_NO_ERROR,
         SM_TYPE_COMMUNICATION_ERROR,
@@ -298,7 +574,11 @@ class SmartMeter238 {
         SM_ERR_WRONG_MSG,                    // message is not valid
         SM_ERR_1P_INPUT_DATA_OUT_OF_RANGE,   // out of range first parameter
         SM_ERR_2P_INPUT_DATA_OUT_OF_RANGE,   // out of range second parameter
-        SM_ERR_3P_INPUT_DATA_OUT_OF_RANGE    // out of range third parameter
+        SM_ERR_3P_INPUT_DATA_OUT_OF_RANGE,   // out of range third parameter
+        SM_ERR_QUEUE_FULL,                   // no room for the request
+        SM_ERR_NOT_SUPPORTED,                // command not supported by the meter protocol
+        SM_ERR_ABORTED,                      // read aborted for a higher priority request
+        SM_ERR_METER_EXCEPTION               // error answer from the meter (Modbus exception)
     };
 
     typedef struct {
@@ -308,11 +588,25 @@ class SmartMeter238 {
             struct {
                 float startingKWh = 0;
                 float priceKWh = 0;
+
+                // Tariff counters, only updated when a tariff is set
+                float bandKWh[SM_TARIFF_MAX_BANDS] = {};
+                float bandCost[SM_TARIFF_MAX_BANDS] = {};
+                float fixedCost = 0;
+                float periodKWh = 0;
+
+                uint8_t activeBand = 0;
+                uint8_t activeTier = 0;
+
+                float lastTotalEnergy = -1;   // no sample yet
+                uint32_t lastDay = 0;
+                uint32_t lastPeriod = 0;
             } data;
         } powerCompanyData;
 
         struct {
             unsigned long time = 0;
+            uint64_t timestamp = 0;   // micros of the last byte of the answer (SmartMeter238Clock)
 
             struct {
                 bool powerCut = false;
@@ -325,6 +619,7 @@ class SmartMeter238 {
 
         struct {
             unsigned long time = 0;
+            uint64_t timestamp = 0;   // micros of the last byte of the answer (SmartMeter238Clock)
 
             struct {
                 float current = 0;
@@ -341,11 +636,30 @@ class SmartMeter238 {
                 float lapseOfTimePriceEnergy = 0;
 
                 float totalKWh = 0;
+
+#if SM_METER_PHASES > 1
+                // With more than one phase current is the sum of the phases and voltage the average
+                struct {
+                    float current = 0;
+                    float voltage = 0;
+
+                    float reactivePower = 0;
+                    float activePower = 0;
+                    float powerFactor = 0;
+                } phase[SM_METER_PHASES];
+#endif
             } data;
+
+#ifdef SM_ENABLE_LAZY_DECODE
+            // Fields out of the mask are decoded from frame by getMeasurementField() on first access
+            uint16_t decoded = 0;   // SM_FIELD_* bits of data up to date
+            uint8_t frame[SM_MAX_BYTE_MSG_BUFFER];
+#endif
         } measurementData;
 
         struct {
             unsigned long time = 0;
+            uint64_t timestamp = 0;   // micros of the last byte of the answer (SmartMeter238Clock)
 
             struct {
                 float energyPurchase = 0;
@@ -363,11 +677,14 @@ class SmartMeter238 {
 #ifdef SM_ENABLE_DEBUG
 #ifdef SM_USE_REMOTE_DEBUG
     SmartMeter238(HardwareSerial &serial, RemoteDebug &debug);
+    SmartMeter238(Stream &stream, RemoteDebug &debug);
 #else
     SmartMeter238(HardwareSerial &serial, HardwareSerial &debug);
+    SmartMeter238(Stream &stream, HardwareSerial &debug);
 #endif   // SM_USE_REMOTE_DEBUG
 #else
     SmartMeter238(HardwareSerial &serial);
+    SmartMeter238(Stream &stream);
 #endif   // SM_ENABLE_DEBUG
 
     virtual ~SmartMeter238();
@@ -387,8 +704,51 @@ class SmartMeter238 {
 
     bool setPowerCompanyData(float startingKWh, float priceKWh, smartMeterData *dataObject);
 
+    // Non blocking reads: startRead() sends the request, pollRead() takes what has arrived and returns BUSY until
+    // the answer is decoded or fails. The blocking calls must not be used while a read is busy.
+    bool startRead(smCommandReceive cmd, smartMeterData *dataObject);
+    smTransactionState pollRead();
+    bool isReadBusy();
+    unsigned long getReadTimeLeft();   // millis until the busy read times out, 0 when idle
+    uint8_t abortRead();   // bytes the meter still owes, skipped by count before the next frame
+
+    void setCodec(SmartMeter238Codec *codec);   // nullptr restores the DDS238-4 protocol
+    SmartMeter238Codec *getCodec();
+
+    void setClock(SmartMeter238Clock *clock);   // nullptr restores the default clock
+    SmartMeter238Clock *getClock();
+
+    void setTariff(SmartMeter238Tariff *tariff);
+    SmartMeter238Tariff *getTariff();
+
+#ifdef SM_ENABLE_TRACE
+    void setTrace(SmartMeter238Trace *trace);
+#endif
+
+    void setMeasurementInterval(unsigned long interval);
+    unsigned long getMeasurementInterval();
+
+    // SM_FIELD_* bits decoded on every measurement, only with SM_ENABLE_LAZY_DECODE
+    void setMeasurementFields(uint16_t fields);
+    uint16_t getMeasurementFields();
+
+    float getMeasurementField(smartMeterData *dataObject, smMeasurementField field);
+
+    // Fields not decoded yet are decoded now, measurementData.data can then be read directly
+    void decodeMeasurementFields(smartMeterData *dataObject, uint16_t fields = SM_FIELDS_ALL);
+
+    void setLimitAndPurchaseInterval(unsigned long interval);
+    unsigned long getLimitAndPurchaseInterval();
+
+    void setResponseTimeout(unsigned long timeout);   // millis, more for meters behind a network bridge
+    unsigned long getResponseTimeout();
+
+    bool addObserver(SmartMeter238Observer *observer);
+    bool removeObserver(SmartMeter238Observer *observer);
+
 #ifdef SM_ENABLE_RAW_TEST_MSG
     bool sendHexMessage(const char *msg);
+    bool runHexScript(const char *script, Print &output);
     bool processIncomingMessages();
     char *getIncomingHexMessage();
 #endif
@@ -417,7 +777,8 @@ class SmartMeter238 {
     uint16_t readingErrCount = 0;
     uint32_t readingSuccessCount = 0;
 
-    HardwareSerial &smSerial;
+    Stream &smSerial;
+    HardwareSerial *smHardwareSerial = nullptr;
 
 #ifdef SM_ENABLE_DEBUG
 #ifdef SM_USE_REMOTE_DEBUG
@@ -427,19 +788,80 @@ class SmartMeter238 {
 #endif   // SM_USE_REMOTE_DEBUG
 #endif   // SM_ENABLE_DEBUG
 
+    SmartMeter238Codec *smCodec;
+    SmartMeter238Clock *smClock;
+
+    uint64_t frameTimestamp = 0;   // last byte of the last frame received
+
+    enum smReadPhase {
+        SM_READ_IDLE,
+        SM_READ_ECHO,
+        SM_READ_ANSWER
+    };
+
+    // Non blocking read in progress
+    smReadPhase readPhase = SM_READ_IDLE;
+    smCommandReceive readCmd = SM_CMD_RESP_MEASUREMENTDATA;
+    smartMeterData *readDataObject = nullptr;
+    unsigned long readStart = 0;
+    uint8_t readRequest[SM_MAX_BYTE_MSG_BUFFER];
+    uint8_t readRequestSize = 0;
+    uint8_t readBuffer[SM_MAX_BYTE_MSG_BUFFER];
+    uint8_t readSize = 0;
+    uint8_t readExpected = 0;
+    uint8_t discardCount = 0;   // bytes of an aborted read still to come
+
     const unsigned long minIntervalUpdate = SM_MIN_INTERVAL_TO_GET_DATA;
+    unsigned long measurementIntervalUpdate = SM_MIN_INTERVAL_TO_GET_DATA;
+    unsigned long limitAndPurchaseIntervalUpdate = SM_MIN_INTERVAL_TO_GET_DATA;
+    unsigned long responseTimeout = SM_MAX_MILLIS_TO_RESPONSE;
 
-    bool transmitSerialData(uint8_t *array, uint8_t size);
-    bool preTransmitSerialData(smCommandTransmit cmd, uint8_t frameSize, uint8_t *array = nullptr);
+#ifdef SM_ENABLE_LAZY_DECODE
+    uint16_t measurementFields = SM_MEASUREMENT_FIELDS;
+#endif
+
+    SmartMeter238Tariff *smTariff = nullptr;
+
+#ifdef SM_ENABLE_TRACE
+    SmartMeter238Trace *smTrace = nullptr;
+#endif
+
+    SmartMeter238Observer *smObservers[SM_MAX_OBSERVERS];
+    uint8_t observerCount = 0;
+
+    int readSerialByte();
+    void writeSerialData(uint8_t *array, uint8_t size);
 
-    bool receiveSerialData(uint8_t *array, uint8_t size, uint8_t command, uint8_t subCommand, uint8_t typeMessage);
-    bool preReceiveSerialData(smCommandReceive cmd, uint8_t frameSize, smartMeterData *dataObject);
+    void notifyObservers(smCommandReceive cmd, smartMeterData *dataObject);
+
+    bool transmitSerialData(uint8_t *array, uint8_t size);
+    bool preTransmitSerialData(smCommandTransmit cmd, uint8_t *array = nullptr);
+
+    smErrorCode receiveSerialData(uint8_t *array, uint8_t size, bool isEcho);
+    bool countSerialData(smErrorCode readErr);
+    void drainSerialData();
+    bool discardSerialData();
+    bool checkSerialData(smErrorCode readErr);
+    bool preReceiveSerialData(smCommandReceive cmd, smartMeterData *dataObject);
+    bool processSerialData(smCommandReceive cmd, uint8_t *array, uint8_t size, smErrorCode readErr, smartMeterData *dataObject);
+
+    bool isMeasurementField(smMeasurementField field);
+    bool decodeMeasurement(uint8_t *array, uint8_t size, smartMeterData *dataObject);
+    bool decodeMeasurementField(smartMeterData *dataObject, smMeasurementField field);
+    void deriveMeasurementField(smartMeterData *dataObject, smMeasurementField field);
+    static float *getMeasurementValue(smartMeterData *dataObject, smMeasurementField field);
 
     uint8_t calculateCRC(uint8_t *array, uint8_t size);
 
 #ifdef SM_ENABLE_RAW_TEST_MSG
     char incomingHexMessage[SM_MAX_HEX_MSG_LENGTH];
     uint8_t incomingByteMessage[SM_MAX_BYTE_MSG_BUFFER];
+
+    bool waitIncomingMessage(unsigned long timeout);
+    uint8_t readIncomingMessage();
+
+    int16_t parseHexMessage(const char *msg, uint16_t length, uint8_t *array, uint8_t *mask);
+    void encodeHexMessage(uint8_t *array, uint8_t size, char *hex);
     int char2int(char input);
 #endif
 
@@ -449,4 +871,12 @@ class SmartMeter238 {
     void printByte(uint8_t byte, bool prefix);
 #endif   // SM_ENABLE_DEBUG
 };
+
+// Receives every answer decoded by SmartMeter238, after dataObject has been updated
+class SmartMeter238Observer {
+   public:
+    virtual ~SmartMeter238Observer() {}
+
+    virtual void onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) = 0;
+};
 #endif   // SmartMeter238_h
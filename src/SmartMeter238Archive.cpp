@@ -0,0 +1,375 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Archive.h"
+//------------------------------------------------------------------------------
+
+#define SM_ARCHIVE_MAGIC_1 'S'
+#define SM_ARCHIVE_MAGIC_2 'A'
+
+// Units of the meter for every archived field
+static const double smArchiveScale[SM_ARCHIVE_FIELDS] = {1000, 10, 100, 10000, 10000, 1000, 100, 100, 100};
+
+static void smArchiveFields(SmartMeter238::smartMeterData *dataObject, float **fields) {
+    fields[SmartMeter238::SM_FIELD_CURRENT] = &dataObject->measurementData.data.current;
+    fields[SmartMeter238::SM_FIELD_VOLTAGE] = &dataObject->measurementData.data.voltage;
+    fields[SmartMeter238::SM_FIELD_FREQUENCY] = &dataObject->measurementData.data.frequency;
+    fields[SmartMeter238::SM_FIELD_REACTIVEPOWER] = &dataObject->measurementData.data.reactivePower;
+    fields[SmartMeter238::SM_FIELD_ACTIVEPOWER] = &dataObject->measurementData.data.activePower;
+    fields[SmartMeter238::SM_FIELD_POWERFACTOR] = &dataObject->measurementData.data.powerFactor;
+    fields[SmartMeter238::SM_FIELD_TOTALENERGY] = &dataObject->measurementData.data.lapseOfTimeTotalEnergy;
+    fields[SmartMeter238::SM_FIELD_IMPORTENERGY] = &dataObject->measurementData.data.lapseOfTimeImportEnergy;
+    fields[SmartMeter238::SM_FIELD_EXPORTENERGY] = &dataObject->measurementData.data.lapseOfTimeExportEnergy;
+}
+
+static void smArchivePut(uint8_t *array, uint64_t value, uint8_t size) {
+    for (uint8_t i = 0; i < size; i++) {
+        array[i] = (value >> (i * 8)) & SM_GET_ONE_BYTE;
+    }
+}
+
+static uint64_t smArchiveGet(const uint8_t *array, uint8_t size) {
+    uint64_t value = 0;
+
+    for (uint8_t i = 0; i < size; i++) {
+        value |= (uint64_t)array[i] << (i * 8);
+    }
+
+    return value;
+}
+
+//------------------------------------------------------------------------------
+//
+//------------------------------------------------------------------------------
+
+void SmartMeter238Archive::toSample(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject, smSample *sample) {
+    float *fields[SM_ARCHIVE_FIELDS];
+
+    sm.decodeMeasurementFields(dataObject, SM_FIELDS_FRAME);   // the archived fields
+    smArchiveFields(dataObject, fields);
+
+    sample->timestamp = dataObject->measurementData.timestamp;
+
+    for (uint8_t i = 0; i < SM_ARCHIVE_FIELDS; i++) {
+        sample->values[i] = (int32_t)llround(*fields[i] * smArchiveScale[i]);
+    }
+}
+
+void SmartMeter238Archive::toData(smSample *sample, SmartMeter238::smartMeterData *dataObject) {
+    float *fields[SM_ARCHIVE_FIELDS];
+
+    smArchiveFields(dataObject, fields);
+
+    dataObject->measurementData.timestamp = sample->timestamp;
+
+    for (uint8_t i = 0; i < SM_ARCHIVE_FIELDS; i++) {
+        *fields[i] = sample->values[i] / smArchiveScale[i];
+    }
+}
+
+bool SmartMeter238Archive::getBlockInfo(const uint8_t *block, size_t size, uint64_t *firstTime, uint16_t *count) {
+    if (size < SM_ARCHIVE_HEADER_SIZE || block[0] != SM_ARCHIVE_MAGIC_1 || block[1] != SM_ARCHIVE_MAGIC_2 || block[2] != SM_ARCHIVE_VERSION || block[3] != SM_ARCHIVE_FIELDS) {
+        return false;
+    }
+
+    *count = smArchiveGet(block + 4, 2);
+    *firstTime = smArchiveGet(block + 8, 8) * SM_ARCHIVE_TIME_RESOLUTION;
+
+    return smArchiveGet(block + 6, 2) <= size && *count > 0;
+}
+
+//------------------------------------------------------------------------------
+//
+//------------------------------------------------------------------------------
+
+SmartMeter238ArchiveEncoder::SmartMeter238ArchiveEncoder(uint8_t *buffer, size_t size) : buffer(buffer), size(min(size, (size_t)UINT16_MAX)) {
+}
+
+void SmartMeter238ArchiveEncoder::reset() {
+    this->count = 0;
+    this->bitPos = 0;
+    this->lastDelta = 0;
+}
+
+bool SmartMeter238ArchiveEncoder::append(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject) {
+    SmartMeter238Archive::smSample sample;
+
+    SmartMeter238Archive::toSample(sm, dataObject, &sample);
+
+    return this->append(&sample);
+}
+
+bool SmartMeter238ArchiveEncoder::append(SmartMeter238Archive::smSample *sample) {
+    uint64_t time = sample->timestamp / SM_ARCHIVE_TIME_RESOLUTION;
+
+    if (this->count == 0) {
+        if (this->size < SM_ARCHIVE_HEADER_SIZE) {
+            return false;
+        }
+
+        this->last = *sample;
+        this->last.timestamp = time;
+        this->count = 1;
+
+        this->writeHeader();
+
+        return true;
+    }
+
+    if (this->count == UINT16_MAX) {
+        return false;
+    }
+
+    size_t start = this->bitPos;
+    int64_t delta = (int64_t)(time - this->last.timestamp);
+
+    this->overflow = false;
+
+    this->writeValue(delta - this->lastDelta);
+
+    for (uint8_t i = 0; i < SM_ARCHIVE_FIELDS; i++) {
+        this->writeValue((int64_t)sample->values[i] - this->last.values[i]);
+    }
+
+    if (this->overflow) {
+        this->rollback(start);
+
+        return false;
+    }
+
+    this->last = *sample;
+    this->last.timestamp = time;
+    this->lastDelta = delta;
+    this->count++;
+
+    this->writeHeader();
+
+    return true;
+}
+
+uint16_t SmartMeter238ArchiveEncoder::getCount() {
+    return this->count;
+}
+
+size_t SmartMeter238ArchiveEncoder::getSize() {
+    return (this->count > 0) ? SM_ARCHIVE_HEADER_SIZE + ((this->bitPos + 7) / 8) : 0;
+}
+
+void SmartMeter238ArchiveEncoder::writeHeader() {
+    this->buffer[0] = SM_ARCHIVE_MAGIC_1;
+    this->buffer[1] = SM_ARCHIVE_MAGIC_2;
+    this->buffer[2] = SM_ARCHIVE_VERSION;
+    this->buffer[3] = SM_ARCHIVE_FIELDS;
+
+    smArchivePut(this->buffer + 4, this->count, 2);
+    smArchivePut(this->buffer + 6, this->getSize(), 2);
+
+    // The first sample, written once
+    if (this->count == 1) {
+        smArchivePut(this->buffer + 8, this->last.timestamp, 8);
+
+        for (uint8_t i = 0; i < SM_ARCHIVE_FIELDS; i++) {
+            smArchivePut(this->buffer + 16 + (i * 4), (uint32_t)this->last.values[i], 4);
+        }
+    }
+}
+
+void SmartMeter238ArchiveEncoder::rollback(size_t bitPos) {
+    this->bitPos = bitPos;
+
+    // Bits of the sample already ORed in the last partial byte, whole bytes are cleared when written again
+    if ((bitPos % 8) != 0) {
+        this->buffer[SM_ARCHIVE_HEADER_SIZE + (bitPos / 8)] &= (uint8_t)(0xFF << (8 - (bitPos % 8)));
+    }
+}
+
+void SmartMeter238ArchiveEncoder::writeBits(uint64_t value, uint8_t bits) {
+    while (bits > 0) {
+        size_t byte = SM_ARCHIVE_HEADER_SIZE + (this->bitPos / 8);
+
+        if (byte >= this->size) {
+            this->overflow = true;
+
+            return;
+        }
+
+        uint8_t free = 8 - (this->bitPos % 8);
+        uint8_t length = min(free, bits);
+        uint8_t chunk = (value >> (bits - length)) & ((1 << length) - 1);
+
+        if (free == 8) {
+            this->buffer[byte] = 0;
+        }
+
+        this->buffer[byte] |= chunk << (free - length);
+
+        this->bitPos += length;
+        bits -= length;
+    }
+}
+
+void SmartMeter238ArchiveEncoder::writeValue(int64_t value) {
+    uint64_t zigzag = ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+
+    if (zigzag == 0) {
+        this->writeBits(0x00, 1);
+    } else if (zigzag < (1ULL << 7)) {
+        this->writeBits((0x02ULL << 7) | zigzag, 9);
+    } else if (zigzag < (1ULL << 14)) {
+        this->writeBits((0x06ULL << 14) | zigzag, 17);
+    } else if (zigzag < (1ULL << 24)) {
+        this->writeBits((0x0EULL << 24) | zigzag, 28);
+    } else {
+        this->writeBits(0x0F, 4);
+        this->writeBits(zigzag, 64);
+    }
+}
+
+//------------------------------------------------------------------------------
+//
+//------------------------------------------------------------------------------
+
+SmartMeter238ArchiveDecoder::SmartMeter238ArchiveDecoder(const uint8_t *block, size_t size) : block(block), size(size) {
+    uint64_t firstTime;
+
+    if (SmartMeter238Archive::getBlockInfo(block, size, &firstTime, &this->count)) {
+        this->size = smArchiveGet(block + 6, 2);
+        this->valid = true;
+    }
+}
+
+bool SmartMeter238ArchiveDecoder::isValid() {
+    return this->valid;
+}
+
+uint16_t SmartMeter238ArchiveDecoder::getCount() {
+    return this->count;
+}
+
+void SmartMeter238ArchiveDecoder::rewind() {
+    this->index = 0;
+    this->bitPos = 0;
+    this->lastDelta = 0;
+}
+
+bool SmartMeter238ArchiveDecoder::next(SmartMeter238Archive::smSample *sample) {
+    if (!this->valid || this->index >= this->count) {
+        return false;
+    }
+
+    if (this->index == 0) {
+        this->last.timestamp = smArchiveGet(this->block + 8, 8);
+
+        for (uint8_t i = 0; i < SM_ARCHIVE_FIELDS; i++) {
+            this->last.values[i] = (int32_t)smArchiveGet(this->block + 16 + (i * 4), 4);
+        }
+    } else {
+        int64_t value;
+
+        if (!this->readValue(&value)) {
+            return false;
+        }
+
+        this->lastDelta += value;
+        this->last.timestamp += this->lastDelta;
+
+        for (uint8_t i = 0; i < SM_ARCHIVE_FIELDS; i++) {
+            if (!this->readValue(&value)) {
+                return false;
+            }
+
+            this->last.values[i] += (int32_t)value;
+        }
+    }
+
+    this->index++;
+
+    *sample = this->last;
+    sample->timestamp *= SM_ARCHIVE_TIME_RESOLUTION;
+
+    return true;
+}
+
+bool SmartMeter238ArchiveDecoder::readBits(uint8_t bits, uint64_t *value) {
+    *value = 0;
+
+    while (bits > 0) {
+        size_t byte = SM_ARCHIVE_HEADER_SIZE + (this->bitPos / 8);
+
+        if (byte >= this->size) {
+            return false;
+        }
+
+        uint8_t free = 8 - (this->bitPos % 8);
+        uint8_t length = min(free, bits);
+
+        *value = (*value << length) | ((this->block[byte] >> (free - length)) & ((1 << length) - 1));
+
+        this->bitPos += length;
+        bits -= length;
+    }
+
+    return true;
+}
+
+bool SmartMeter238ArchiveDecoder::readValue(int64_t *value) {
+    static const uint8_t lengths[4] = {7, 14, 24, 64};
+
+    uint64_t bit;
+    uint8_t prefix = 0;
+
+    // Count of leading ones, up to four
+    while (prefix < 4) {
+        if (!this->readBits(1, &bit)) {
+            return false;
+        }
+
+        if (bit == 0) {
+            break;
+        }
+
+        prefix++;
+    }
+
+    if (prefix == 0) {
+        *value = 0;
+
+        return true;
+    }
+
+    uint64_t zigzag;
+
+    if (!this->readBits(lengths[prefix - 1], &zigzag)) {
+        return false;
+    }
+
+    *value = (int64_t)(zigzag >> 1) ^ -(int64_t)(zigzag & 1);
+
+    return true;
+}
@@ -0,0 +1,112 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Archive_h
+#define SmartMeter238Archive_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+// Compressed blocks of measurements for long term archives. The fields are kept as the integers of the meter
+// (mA, dV, cHz, 0.1 W/var, 0.001 PF, 0.01 kWh), so nothing is lost. Timestamps are stored as delta of delta and
+// the fields as zig-zag deltas, each in a prefix coded bit field: '0' no change, '10' 7 bits, '110' 14 bits,
+// '1110' 24 bits, '1111' 64 bits. A steady sample costs a few bytes instead of the whole measurement struct.
+//
+// Every block starts with its own header ('S' 'A' version fields, uint16 count, uint16 size, first timestamp
+// and first sample, little endian), so each block is decoded alone and blocks can be indexed by their first
+// timestamp for random access.
+class SmartMeter238Archive {
+   public:
+    typedef struct {
+        uint64_t timestamp;   // micros
+        int32_t values[SM_ARCHIVE_FIELDS];   // smMeasurementField order
+    } smSample;
+
+    static void toSample(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject, smSample *sample);
+    static void toData(smSample *sample, SmartMeter238::smartMeterData *dataObject);   // price and total kWh are not set
+
+    // First timestamp and count of a block, false if it is not a block
+    static bool getBlockInfo(const uint8_t *block, size_t size, uint64_t *firstTime, uint16_t *count);
+};
+
+class SmartMeter238ArchiveEncoder {
+   public:
+    SmartMeter238ArchiveEncoder(uint8_t *buffer, size_t size);
+
+    void reset();   // starts a new block in the buffer
+
+    bool append(SmartMeter238Archive::smSample *sample);   // false when the block is full, the sample is not added
+    bool append(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject);
+
+    uint16_t getCount();
+    size_t getSize();   // bytes of the block
+
+   private:
+    uint8_t *buffer;
+    size_t size;
+
+    uint16_t count = 0;
+    size_t bitPos = 0;
+    bool overflow = false;
+
+    SmartMeter238Archive::smSample last;
+    int64_t lastDelta = 0;   // of the timestamp, in SM_ARCHIVE_TIME_RESOLUTION units
+
+    void rollback(size_t bitPos);
+    void writeBits(uint64_t value, uint8_t bits);
+    void writeValue(int64_t value);
+    void writeHeader();
+};
+
+class SmartMeter238ArchiveDecoder {
+   public:
+    SmartMeter238ArchiveDecoder(const uint8_t *block, size_t size);
+
+    bool isValid();
+    uint16_t getCount();
+
+    bool next(SmartMeter238Archive::smSample *sample);   // false after the last sample
+    void rewind();
+
+   private:
+    const uint8_t *block;
+    size_t size;
+
+    bool valid = false;
+    uint16_t count = 0;
+    uint16_t index = 0;
+    size_t bitPos = 0;
+
+    SmartMeter238Archive::smSample last;
+    int64_t lastDelta = 0;
+
+    bool readBits(uint8_t bits, uint64_t *value);
+    bool readValue(int64_t *value);
+};
+#endif   // SmartMeter238Archive_h
@@ -0,0 +1,198 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Cache.h"
+//------------------------------------------------------------------------------
+
+SmartMeter238Cache::SmartMeter238Cache(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject) : sm(sm), dataObject(dataObject), pending(0), inFlight(-1), refreshCount(0), coalescedCount(0), failedCount(0) {
+    for (uint8_t i = 0; i < datasetCount; i++) {
+        this->datasets[i].ttl = SM_CACHE_DEFAULT_TTL;
+        this->datasets[i].maxStale = SM_CACHE_DEFAULT_MAX_STALE;
+        this->datasets[i].revalidate = true;
+        this->datasets[i].failTime = 0;
+        this->datasets[i].time = 0;
+    }
+}
+
+void SmartMeter238Cache::setPolicy(SmartMeter238::smCommandReceive cmd, unsigned long ttl, unsigned long maxStale, bool revalidate) {
+    if (cmd < datasetCount) {
+        this->datasets[cmd].ttl = ttl;
+        this->datasets[cmd].maxStale = max(ttl, maxStale);
+        this->datasets[cmd].revalidate = revalidate;
+    }
+}
+
+SmartMeter238Cache::smCacheStatus SmartMeter238Cache::get(SmartMeter238::smCommandReceive cmd, unsigned long *age) {
+    if (cmd >= datasetCount) {
+        return SM_CACHE_EMPTY;
+    }
+
+    smDataset *dataset = &this->datasets[cmd];
+    unsigned long time = dataset->time.load();
+    unsigned long dataAge = millis() - time;
+
+    if (age != nullptr) {
+        *age = (time > 0) ? dataAge : 0;
+    }
+
+    if (time > 0 && dataAge < dataset->ttl) {
+        return SM_CACHE_FRESH;
+    }
+
+    // After a failure the meter is not asked again until the retry interval
+    unsigned long failTime = dataset->failTime.load();
+
+    if (failTime == 0 || (millis() - failTime) >= SM_CACHE_RETRY_INTERVAL) {
+        if (time == 0 || dataAge >= dataset->maxStale || dataset->revalidate) {
+            this->request(cmd);
+        }
+    }
+
+    if (time == 0) {
+        return SM_CACHE_EMPTY;
+    }
+
+    return (dataAge < dataset->maxStale) ? SM_CACHE_STALE : SM_CACHE_EXPIRED;
+}
+
+void SmartMeter238Cache::refresh(SmartMeter238::smCommandReceive cmd) {
+    if (cmd < datasetCount) {
+        this->request(cmd);
+    }
+}
+
+bool SmartMeter238Cache::isRefreshing(SmartMeter238::smCommandReceive cmd) {
+    return (this->pending.load() & (1 << cmd)) || this->inFlight.load() == cmd;
+}
+
+uint32_t SmartMeter238Cache::read(SmartMeter238::smartMeterData *dataObject) {
+    return this->snapshot.read(dataObject);
+}
+
+SmartMeter238::smartMeterData *SmartMeter238Cache::getData() {
+    return this->dataObject;
+}
+
+uint32_t SmartMeter238Cache::getRefreshCount() {
+    return this->refreshCount.load();
+}
+
+uint32_t SmartMeter238Cache::getCoalescedCount() {
+    return this->coalescedCount.load();
+}
+
+uint32_t SmartMeter238Cache::getFailedCount() {
+    return this->failedCount.load();
+}
+
+void SmartMeter238Cache::clearCounters() {
+    this->refreshCount = 0;
+    this->coalescedCount = 0;
+    this->failedCount = 0;
+}
+
+void SmartMeter238Cache::request(SmartMeter238::smCommandReceive cmd) {
+    uint8_t bit = 1 << cmd;
+
+    // inFlight is set before the pending bit is cleared, one of them is always seen
+    if (this->inFlight.load() == cmd || (this->pending.fetch_or(bit) & bit)) {
+        this->coalescedCount++;
+    }
+}
+
+unsigned long SmartMeter238Cache::getDataTime(SmartMeter238::smCommandReceive cmd) {
+    switch (cmd) {
+        case SmartMeter238::SM_CMD_RESP_POWERCUT:
+            return this->dataObject->powerCutData.time;
+        case SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA:
+            return this->dataObject->measurementData.time;
+        default:
+            return this->dataObject->limitAndPurchaseData.time;
+    }
+}
+
+bool SmartMeter238Cache::loop() {
+    int8_t current = this->inFlight.load();
+
+    if (current >= 0) {
+        SmartMeter238::smTransactionState state = this->sm.pollRead();
+
+        if (state == SmartMeter238::SM_TRANSACTION_BUSY) {
+            return false;
+        }
+
+        if (state == SmartMeter238::SM_TRANSACTION_DONE) {
+            // Other tasks only see complete answers, decoded and copied before the time says they are there
+            if (current == SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA) {
+                this->sm.decodeMeasurementFields(this->dataObject);
+            }
+
+            this->snapshot.publish(this->dataObject);
+
+            this->datasets[current].failTime = 0;
+            this->datasets[current].time = this->getDataTime((SmartMeter238::smCommandReceive)current);
+            this->refreshCount++;
+        } else {
+            this->datasets[current].failTime = max(millis(), 1UL);
+            this->failedCount++;
+        }
+
+        this->inFlight = -1;
+
+        return state == SmartMeter238::SM_TRANSACTION_DONE;
+    }
+
+    uint8_t requests = this->pending.load();
+
+    if (requests == 0 || this->sm.isReadBusy()) {
+        return false;
+    }
+
+    // Round robin, a dataset refreshed all the time does not starve the others
+    for (uint8_t i = 0; i < datasetCount; i++) {
+        uint8_t cmd = (this->nextDataset + i) % datasetCount;
+
+        if (requests & (1 << cmd)) {
+            this->nextDataset = (cmd + 1) % datasetCount;
+
+            this->inFlight = cmd;
+            this->pending &= ~(1 << cmd);
+
+            if (!this->sm.startRead((SmartMeter238::smCommandReceive)cmd, this->dataObject)) {
+                this->datasets[cmd].failTime = max(millis(), 1UL);
+                this->failedCount++;
+                this->inFlight = -1;
+            }
+
+            break;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,102 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Cache_h
+#define SmartMeter238Cache_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+#include "SmartMeter238Snapshot.h"
+
+#include <atomic>
+
+// Cached access to the data of a meter that never blocks. get() returns at once with the status and age of the
+// data in the data object and asks for a refresh when it is stale (stale while revalidate); the refresh runs in
+// loop() as a non blocking read. Every get() of a dataset with a refresh pending or in flight is coalesced in
+// that one transaction. get() and read() may be called from other tasks than loop(): the data object is
+// written by loop() while a refresh is in flight, so other tasks take a copy with read(), which goes through a
+// snapshot published after every refresh. getData() is the live object, for the task of loop() only.
+class SmartMeter238Cache {
+   public:
+    enum smCacheStatus {
+        SM_CACHE_EMPTY,     // never read
+        SM_CACHE_FRESH,     // younger than the TTL
+        SM_CACHE_STALE,     // older than the TTL, still good to show
+        SM_CACHE_EXPIRED    // older than max stale
+    };
+
+    SmartMeter238Cache(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject);
+
+    // Stale data is refreshed by get() only with revalidate, expired and empty data always
+    void setPolicy(SmartMeter238::smCommandReceive cmd, unsigned long ttl, unsigned long maxStale, bool revalidate = true);
+
+    smCacheStatus get(SmartMeter238::smCommandReceive cmd, unsigned long *age = nullptr);
+    void refresh(SmartMeter238::smCommandReceive cmd);
+    bool isRefreshing(SmartMeter238::smCommandReceive cmd);
+
+    uint32_t read(SmartMeter238::smartMeterData *dataObject);   // copy of the last refresh, 0 before the first
+    SmartMeter238::smartMeterData *getData();                    // live data, only from the task of loop()
+
+    uint32_t getRefreshCount();
+    uint32_t getCoalescedCount();   // get() and refresh() served by a refresh already pending or in flight
+    uint32_t getFailedCount();
+    void clearCounters();
+
+    bool loop();   // true when a refresh has been completed in this call
+
+   private:
+    static const uint8_t datasetCount = SmartMeter238::SM_CMD_RESP_LIMITANDPURCHASEDATA + 1;
+
+    typedef struct {
+        unsigned long ttl;
+        unsigned long maxStale;
+        bool revalidate;
+
+        std::atomic<unsigned long> failTime;   // millis of the last failed refresh, 0 none
+        std::atomic<unsigned long> time;   // millis of the data of the last refresh, 0 none
+    } smDataset;
+
+    SmartMeter238 &sm;
+    SmartMeter238::smartMeterData *dataObject;
+
+    smDataset datasets[datasetCount];
+    SmartMeter238Snapshot snapshot;
+
+    std::atomic<uint8_t> pending;   // bit per dataset
+    std::atomic<int8_t> inFlight;   // dataset being read, -1 none
+    uint8_t nextDataset = 0;
+
+    std::atomic<uint32_t> refreshCount;
+    std::atomic<uint32_t> coalescedCount;
+    std::atomic<uint32_t> failedCount;
+
+    unsigned long getDataTime(SmartMeter238::smCommandReceive cmd);
+    void request(SmartMeter238::smCommandReceive cmd);
+};
+#endif   // SmartMeter238Cache_h
@@ -0,0 +1,78 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Clock.h"
+
+#if defined(ESP32)
+#include <esp_timer.h>
+#endif
+//------------------------------------------------------------------------------
+
+uint64_t SmartMeter238Clock::now() {
+#if defined(ESP8266)
+    return micros64();
+#elif defined(ESP32)
+    return esp_timer_get_time();
+#else
+    uint32_t current = micros();
+
+    if (current < this->lastMicros) {
+        this->wrapCount++;
+    }
+
+    this->lastMicros = current;
+
+    return ((uint64_t)this->wrapCount << 32) | current;
+#endif
+}
+
+void SmartMeter238Clock::setEpoch(uint64_t epochMicros) {
+    this->epochOffset = (int64_t)(epochMicros - this->now());
+    this->epochSet = true;
+}
+
+void SmartMeter238Clock::clearEpoch() {
+    this->epochSet = false;
+}
+
+bool SmartMeter238Clock::hasEpoch() {
+    return this->epochSet;
+}
+
+uint64_t SmartMeter238Clock::toEpoch(uint64_t timestamp) {
+    if (!this->epochSet) {
+        return 0;
+    }
+
+    return timestamp + this->epochOffset;
+}
+
+uint64_t SmartMeter238Clock::nowEpoch() {
+    return this->toEpoch(this->now());
+}
@@ -0,0 +1,59 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Clock_h
+#define SmartMeter238Clock_h
+//------------------------------------------------------------------------------
+
+#include <Arduino.h>
+
+// Time source of the samples: microseconds since boot in 64 bits, so it never wraps, plus an optional offset to
+// the wall clock. ESP8266 and ESP32 have a 64 bit timer; on other targets micros() is extended counting its
+// wraps, which needs now() to be called at least once every 71 minutes (every measurement does).
+class SmartMeter238Clock {
+   public:
+    virtual ~SmartMeter238Clock() {}
+
+    virtual uint64_t now();
+
+    void setEpoch(uint64_t epochMicros);   // wall clock at this moment
+    void clearEpoch();
+    bool hasEpoch();
+
+    uint64_t toEpoch(uint64_t timestamp);  // wall clock micros of a timestamp, 0 without epoch
+    uint64_t nowEpoch();
+
+   private:
+    int64_t epochOffset = 0;
+    bool epochSet = false;
+
+    uint32_t lastMicros = 0;
+    uint32_t wrapCount = 0;
+};
+#endif   // SmartMeter238Clock_h
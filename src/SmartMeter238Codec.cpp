@@ -0,0 +1,357 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Codec.h"
+//------------------------------------------------------------------------------
+
+// Measurement field at offset of a Tuya answer, the same scale on every phase
+static float smTuyaValue(SmartMeter238::smMeasurementField field, uint8_t *frame, uint8_t offset) {
+    switch (field) {
+        case SmartMeter238::SM_FIELD_CURRENT:
+            return ((frame[offset] << 16) | (frame[offset + 1] << 8) | frame[offset + 2]) * 0.001;
+        case SmartMeter238::SM_FIELD_VOLTAGE:
+            return ((frame[offset] << 8) | frame[offset + 1]) * 0.1;
+        case SmartMeter238::SM_FIELD_FREQUENCY:
+            return ((frame[offset] << 8) | frame[offset + 1]) * 0.01;
+        case SmartMeter238::SM_FIELD_REACTIVEPOWER:
+        case SmartMeter238::SM_FIELD_ACTIVEPOWER:
+            return frame[offset] + (((frame[offset + 1] << 8) | frame[offset + 2]) * 0.0001);
+        case SmartMeter238::SM_FIELD_POWERFACTOR:
+            return ((frame[offset] << 8) | frame[offset + 1]) * 0.001;
+        default:   // energies
+            return (((frame[offset] << 24) | (frame[offset + 1] << 16) | (frame[offset + 2] << 8) | frame[offset + 3]) * 0.01);
+    }
+}
+
+uint8_t SmartMeter238TuyaCodec::encodeRequest(SmartMeter238::smCommandTransmit cmd, uint8_t *payload, uint8_t *frame) {
+    uint8_t frameSize = 0;
+
+    frame[0] = SM_FRAME_1B_START;
+
+    frame[2] = SM_FRAME_3B_TYPE_SEND;
+    frame[3] = 0x01;
+
+    switch (cmd) {
+        case SmartMeter238::SM_CMD_GET_POWERCUT: {
+            frameSize = SM_FRAMESIZE_MSG_GET_POWERCUT;
+
+            frame[1] = SM_FRAME_2B_COMD_SEND_GETDATA;
+            frame[4] = SM_FRAME_5B_SUBCOMD_SEND_GETDATA_POWERCUT;
+
+            break;
+        }
+        case SmartMeter238::SM_CMD_GET_MEASUREMENTDATA: {
+            frameSize = SM_FRAMESIZE_MSG_GET_MEASUREMENTDATA;
+
+            frame[1] = SM_FRAME_2B_COMD_SEND_GETDATA;
+            frame[4] = SM_FRAME_5B_SUBCOMD_SEND_GETDATA_MEASUREMENTDATA;
+
+            break;
+        }
+        case SmartMeter238::SM_CMD_GET_LIMITANDPURCHASEDATA: {
+            frameSize = SM_FRAMESIZE_MSG_GET_LIMITANDPURCHASEDATA;
+
+            frame[1] = SM_FRAME_2B_COMD_SEND_GETDATA;
+            frame[4] = SM_FRAME_5B_SUBCOMD_SEND_GETDATA_LIMITANDPURCHASEDATA;
+
+            break;
+        }
+        case SmartMeter238::SM_CMD_SET_LIMITDATA: {
+            frameSize = SM_FRAMESIZE_MSG_SET_LIMITDATA;
+
+            frame[1] = SM_FRAME_2B_COMD_SEND_LIMITDATA;
+            frame[4] = SM_FRAME_5B_SUBCOMD_SEND_LIMITDATA;
+
+            frame[5] = payload[0];
+            frame[6] = payload[1];
+
+            frame[7] = payload[2];
+            frame[8] = payload[3];
+
+            frame[9] = payload[4];
+            frame[10] = payload[5];
+
+            break;
+        }
+        case SmartMeter238::SM_CMD_SET_PURCHASEDATA: {
+            frameSize = SM_FRAMESIZE_MSG_SET_PURCHASEDATA;
+
+            frame[1] = SM_FRAME_2B_COMD_SEND_PURCHASEDATA;
+            frame[4] = SM_FRAME_5B_SUBCOMD_SEND_PURCHASEDATA;
+
+            frame[5] = payload[0];
+            frame[6] = payload[1];
+            frame[7] = payload[2];
+            frame[8] = payload[3];
+
+            frame[9] = payload[4];
+            frame[10] = payload[5];
+            frame[11] = payload[6];
+            frame[12] = payload[7];
+
+            frame[13] = payload[8];
+
+            break;
+        }
+        case SmartMeter238::SM_CMD_SET_POWERCUT: {
+            frameSize = SM_FRAMESIZE_MSG_SET_POWERCUT;
+
+            frame[1] = SM_FRAME_2B_COMD_SEND_POWERCUT;
+            frame[4] = SM_FRAME_5B_SUBCOMD_SEND_POWERCUT;
+
+            frame[5] = payload[0];
+
+            break;
+        }
+        case SmartMeter238::SM_CMD_SET_DELAY: {
+            frameSize = SM_FRAMESIZE_MSG_SET_DELAY;
+
+            frame[1] = SM_FRAME_2B_COMD_SEND_DELAY;
+            frame[4] = SM_FRAME_5B_SUBCOMD_SEND_DELAY;
+
+            frame[5] = payload[0];
+            frame[6] = payload[1];
+
+            frame[7] = payload[2];
+
+            break;
+        }
+        case SmartMeter238::SM_CMD_SET_RESET: {
+            frameSize = SM_FRAMESIZE_MSG_SET_RESET;
+
+            frame[1] = SM_FRAME_2B_COMD_SEND_RESET;
+            frame[4] = SM_FRAME_5B_SUBCOMD_SEND_RESET;
+
+            frame[5] = payload[0];
+            frame[6] = payload[1];
+            frame[7] = payload[2];
+            frame[8] = payload[3];
+            frame[9] = payload[4];
+            frame[10] = payload[5];
+            frame[11] = payload[6];
+            frame[12] = payload[7];
+            frame[13] = payload[8];
+            frame[14] = payload[9];
+            frame[15] = payload[10];
+            frame[16] = payload[11];
+
+            break;
+        }
+    }
+
+    frame[frameSize - 1] = SmartMeter238TuyaCodec::calculateCRC(frame, frameSize);
+
+    return frameSize;
+}
+
+bool SmartMeter238TuyaCodec::isEchoed() {
+    return true;
+}
+
+SmartMeter238::smErrorCode SmartMeter238TuyaCodec::checkEcho(uint8_t *request, uint8_t *frame, uint8_t size) {
+    return this->checkFrame(frame, size, request[1], request[4], SM_FRAME_3B_TYPE_SEND);
+}
+
+uint8_t SmartMeter238TuyaCodec::getAnswerSize(SmartMeter238::smCommandReceive cmd) {
+    switch (cmd) {
+        case SmartMeter238::SM_CMD_RESP_POWERCUT: {
+            return SM_FRAMESIZE_MSG_RESP_POWERCUT;
+        }
+        case SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA: {
+            return SmartMeter238MeterModel::measurementFrameSize;
+        }
+        case SmartMeter238::SM_CMD_RESP_LIMITANDPURCHASEDATA: {
+            return SM_FRAMESIZE_MSG_RESP_LIMITANDPURCHASEDATA;
+        }
+    }
+
+    return 0;
+}
+
+SmartMeter238::smErrorCode SmartMeter238TuyaCodec::checkAnswer(SmartMeter238::smCommandReceive cmd, uint8_t *frame, uint8_t size) {
+    switch (cmd) {
+        case SmartMeter238::SM_CMD_RESP_POWERCUT: {
+            return this->checkFrame(frame, size, SM_FRAME_2B_COMD_RESPONSE_POWERCUT, SM_FRAME_5B_SUBCOMD_RESPONSE_POWERCUT, SM_FRAME_3B_TYPE_RESPONSE);
+        }
+        case SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA: {
+            return this->checkFrame(frame, size, SM_FRAME_2B_COMD_RESPONSE_MEASUREMENTDATA, SM_FRAME_5B_SUBCOMD_RESPONSE_MEASUREMENTDATA, SM_FRAME_3B_TYPE_RESPONSE);
+        }
+        case SmartMeter238::SM_CMD_RESP_LIMITANDPURCHASEDATA: {
+            return this->checkFrame(frame, size, SM_FRAME_2B_COMD_RESPONSE_LIMITANDPURCHASEDATA, SM_FRAME_5B_SUBCOMD_RESPONSE_LIMITANDPURCHASEDATA, SM_FRAME_3B_TYPE_RESPONSE);
+        }
+    }
+
+    return SmartMeter238::SM_ERR_WRONG_BYTES;
+}
+
+SmartMeter238::smErrorCode SmartMeter238TuyaCodec::checkFrame(uint8_t *frame, uint8_t size, uint8_t command, uint8_t subCommand, uint8_t typeMessage) {
+    if (frame[0] == SM_FRAME_1B_START && frame[1] == command && frame[2] == typeMessage && frame[4] == subCommand) {
+        if (SmartMeter238TuyaCodec::calculateCRC(frame, size) != frame[size - 1]) {
+            return SmartMeter238::SM_ERR_CRC_ERROR;
+        }
+
+        return SmartMeter238::SM_ERR_NO_ERROR;
+    }
+
+    return SmartMeter238::SM_ERR_WRONG_BYTES;
+}
+
+void SmartMeter238TuyaCodec::decodeAnswer(SmartMeter238::smCommandReceive cmd, uint8_t *frame, SmartMeter238::smartMeterData *dataObject) {
+    switch (cmd) {
+        case SmartMeter238::SM_CMD_RESP_POWERCUT: {
+            dataObject->powerCutData.data.powerCut = !frame[6];
+
+            if (dataObject->powerCutData.data.powerCut) {
+                if (frame[11] == 1) {
+                    dataObject->powerCutData.data.powerCutDetails = SM_STR_POWERCUT_DETAILS_OVER_VOLTAGE;
+                } else if (frame[11] == 2) {
+                    dataObject->powerCutData.data.powerCutDetails = SM_STR_POWERCUT_DETAILS_UNDER_VOLTAGE;
+                } else if (frame[15] == 1) {
+                    dataObject->powerCutData.data.powerCutDetails = SM_STR_POWERCUT_DETAILS_OVER_CURRENT;
+                } else if (frame[19] == 1) {
+                    dataObject->powerCutData.data.powerCutDetails = SM_STR_POWERCUT_DETAILS_END_PURCHASE;
+                } else {
+                    dataObject->powerCutData.data.powerCutDetails = SM_STR_POWERCUT_DETAILS_UNKNOWN;
+                }
+            } else {
+                dataObject->powerCutData.data.powerCutDetails = SM_STR_POWERCUT_DETAILS_NO_POWER_CUT;
+            }
+
+            dataObject->powerCutData.data.delay = (frame[16] << 8) | frame[17];
+            dataObject->powerCutData.data.delaySetPowerCut = frame[18];
+
+            break;
+        }
+        case SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA: {
+            this->decodeField(SmartMeter238::SM_FIELD_CURRENT, frame, &dataObject->measurementData.data.current);
+            this->decodeField(SmartMeter238::SM_FIELD_VOLTAGE, frame, &dataObject->measurementData.data.voltage);
+            this->decodeField(SmartMeter238::SM_FIELD_FREQUENCY, frame, &dataObject->measurementData.data.frequency);
+
+            this->decodeField(SmartMeter238::SM_FIELD_REACTIVEPOWER, frame, &dataObject->measurementData.data.reactivePower);
+            this->decodeField(SmartMeter238::SM_FIELD_ACTIVEPOWER, frame, &dataObject->measurementData.data.activePower);
+            this->decodeField(SmartMeter238::SM_FIELD_POWERFACTOR, frame, &dataObject->measurementData.data.powerFactor);
+
+#if SM_METER_PHASES > 1
+            typedef SmartMeter238MeterModel smModel;
+
+            dataObject->measurementData.data.current = 0;
+            dataObject->measurementData.data.voltage = 0;
+
+            for (uint8_t i = 0; i < SM_METER_PHASES; i++) {
+                dataObject->measurementData.data.phase[i].current = smTuyaValue(SmartMeter238::SM_FIELD_CURRENT, frame, smModel::currentOffset + i * 3);
+                dataObject->measurementData.data.phase[i].voltage = smTuyaValue(SmartMeter238::SM_FIELD_VOLTAGE, frame, smModel::voltageOffset + i * 2);
+
+                dataObject->measurementData.data.phase[i].reactivePower = smTuyaValue(SmartMeter238::SM_FIELD_REACTIVEPOWER, frame, smModel::reactivePowerOffset + (i + 1) * 3);
+                dataObject->measurementData.data.phase[i].activePower = smTuyaValue(SmartMeter238::SM_FIELD_ACTIVEPOWER, frame, smModel::activePowerOffset + (i + 1) * 3);
+                dataObject->measurementData.data.phase[i].powerFactor = smTuyaValue(SmartMeter238::SM_FIELD_POWERFACTOR, frame, smModel::powerFactorOffset + (i + 1) * 2);
+
+                dataObject->measurementData.data.current += dataObject->measurementData.data.phase[i].current;
+                dataObject->measurementData.data.voltage += dataObject->measurementData.data.phase[i].voltage / SM_METER_PHASES;
+            }
+#endif
+
+            this->decodeField(SmartMeter238::SM_FIELD_TOTALENERGY, frame, &dataObject->measurementData.data.lapseOfTimeTotalEnergy);
+            this->decodeField(SmartMeter238::SM_FIELD_IMPORTENERGY, frame, &dataObject->measurementData.data.lapseOfTimeImportEnergy);
+            this->decodeField(SmartMeter238::SM_FIELD_EXPORTENERGY, frame, &dataObject->measurementData.data.lapseOfTimeExportEnergy);
+
+            break;
+        }
+        case SmartMeter238::SM_CMD_RESP_LIMITANDPURCHASEDATA: {
+            dataObject->limitAndPurchaseData.data.energyPurchase = (((frame[11] << 24) | (frame[12] << 16) | (frame[13] << 8) | frame[14]) * 0.01);
+            dataObject->limitAndPurchaseData.data.energyPurchaseBalance = (((frame[15] << 24) | (frame[16] << 16) | (frame[17] << 8) | frame[18]) * 0.01);
+            dataObject->limitAndPurchaseData.data.energyPurchaseAlarm = (((frame[19] << 24) | (frame[20] << 16) | (frame[21] << 8) | frame[22]) * 0.01);
+            dataObject->limitAndPurchaseData.data.energyPurchaseStatus = frame[23];
+
+            dataObject->limitAndPurchaseData.data.maxCurrentLimit = ((frame[9] << 8) | frame[10]) * 0.01;
+            dataObject->limitAndPurchaseData.data.maxVoltageLimit = (frame[5] << 8) | frame[6];
+            dataObject->limitAndPurchaseData.data.minVoltageLimit = (frame[7] << 8) | frame[8];
+
+            break;
+        }
+    }
+}
+
+bool SmartMeter238TuyaCodec::decodeField(SmartMeter238::smMeasurementField field, uint8_t *frame, float *value) {
+    typedef SmartMeter238MeterModel smModel;
+
+    uint8_t offset;
+
+    switch (field) {
+#if SM_METER_PHASES == 1   // otherwise the sum of the phases
+        case SmartMeter238::SM_FIELD_CURRENT:
+            offset = smModel::currentOffset;
+            break;
+        case SmartMeter238::SM_FIELD_VOLTAGE:
+            offset = smModel::voltageOffset;
+            break;
+#endif
+        case SmartMeter238::SM_FIELD_FREQUENCY:
+            offset = smModel::frequencyOffset;
+            break;
+        case SmartMeter238::SM_FIELD_REACTIVEPOWER:
+            offset = smModel::reactivePowerOffset;
+            break;
+        case SmartMeter238::SM_FIELD_ACTIVEPOWER:
+            offset = smModel::activePowerOffset;
+            break;
+        case SmartMeter238::SM_FIELD_POWERFACTOR:
+            offset = smModel::powerFactorOffset;
+            break;
+        case SmartMeter238::SM_FIELD_TOTALENERGY:
+            offset = smModel::totalEnergyOffset;
+            break;
+        case SmartMeter238::SM_FIELD_IMPORTENERGY:
+            offset = smModel::importEnergyOffset;
+            break;
+        case SmartMeter238::SM_FIELD_EXPORTENERGY:
+            offset = smModel::exportEnergyOffset;
+            break;
+        default:
+            return false;
+    }
+
+    *value = smTuyaValue(field, frame, offset);
+
+    return true;
+}
+
+uint8_t SmartMeter238TuyaCodec::calculateCRC(uint8_t *array, uint8_t size) {
+    uint16_t tmpCRC = 0;
+    uint8_t crc;
+
+    uint8_t tmpSize = size - 1;   // we discard the last byte that corresponds to the CRC from the sum
+
+    for (uint8_t n = 0; n < tmpSize; n++) {
+        tmpCRC = tmpCRC + array[n];
+    }
+
+    crc = tmpCRC & SM_GET_ONE_BYTE;
+
+    return crc;
+}
@@ -0,0 +1,95 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Codec_h
+#define SmartMeter238Codec_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+// Frame format of the meter. SmartMeter238 sends the request, waits for the echo when the protocol has one,
+// reads getAnswerSize() bytes and hands them to the codec; timing, counters, tariff and observers stay in
+// SmartMeter238, the codec only knows bytes.
+class SmartMeter238Codec {
+   public:
+    virtual ~SmartMeter238Codec() {}
+
+    // Request frame of cmd in frame (SM_MAX_BYTE_MSG_BUFFER bytes), returns its size or 0 if not supported
+    virtual uint8_t encodeRequest(SmartMeter238::smCommandTransmit cmd, uint8_t *payload, uint8_t *frame) = 0;
+
+    // The meter confirms the request sending it back
+    virtual bool isEchoed() = 0;
+    virtual SmartMeter238::smErrorCode checkEcho(uint8_t *request, uint8_t *frame, uint8_t size) = 0;
+
+    // Size of the answer, 0 if not supported
+    virtual uint8_t getAnswerSize(SmartMeter238::smCommandReceive cmd) = 0;
+    virtual SmartMeter238::smErrorCode checkAnswer(SmartMeter238::smCommandReceive cmd, uint8_t *frame, uint8_t size) = 0;
+
+    // Bytes received so far when fewer than getAnswerSize(), an error answer of the meter ends the read without
+    // waiting for the timeout
+    virtual SmartMeter238::smErrorCode checkShortAnswer(SmartMeter238::smCommandReceive cmd, uint8_t *frame, uint8_t size) {
+        (void)cmd;
+        (void)frame;
+        (void)size;
+
+        return SmartMeter238::SM_ERR_NOT_ENOUGHT_BYTES;
+    }
+
+    virtual void decodeAnswer(SmartMeter238::smCommandReceive cmd, uint8_t *frame, SmartMeter238::smartMeterData *dataObject) = 0;
+
+    // One field of a measurement answer (SM_ENABLE_LAZY_DECODE), false if only the whole frame is decoded
+    virtual bool decodeField(SmartMeter238::smMeasurementField field, uint8_t *frame, float *value) {
+        (void)field;
+        (void)frame;
+        (void)value;
+
+        return false;
+    }
+};
+
+// DDS238-4 W / DTS238-7 W Tuya module protocol: 0x48 start byte, length, type, 0x01, subcommand, data and
+// an additive checksum. Every request is echoed.
+class SmartMeter238TuyaCodec : public SmartMeter238Codec {
+   public:
+    uint8_t encodeRequest(SmartMeter238::smCommandTransmit cmd, uint8_t *payload, uint8_t *frame) override;
+
+    bool isEchoed() override;
+    SmartMeter238::smErrorCode checkEcho(uint8_t *request, uint8_t *frame, uint8_t size) override;
+
+    uint8_t getAnswerSize(SmartMeter238::smCommandReceive cmd) override;
+    SmartMeter238::smErrorCode checkAnswer(SmartMeter238::smCommandReceive cmd, uint8_t *frame, uint8_t size) override;
+    void decodeAnswer(SmartMeter238::smCommandReceive cmd, uint8_t *frame, SmartMeter238::smartMeterData *dataObject) override;
+    bool decodeField(SmartMeter238::smMeasurementField field, uint8_t *frame, float *value) override;
+
+    static uint8_t calculateCRC(uint8_t *array, uint8_t size);
+
+   private:
+    SmartMeter238::smErrorCode checkFrame(uint8_t *frame, uint8_t size, uint8_t command, uint8_t subCommand, uint8_t typeMessage);
+};
+#endif   // SmartMeter238Codec_h
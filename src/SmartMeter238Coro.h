@@ -0,0 +1,246 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Coro_h
+#define SmartMeter238Coro_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238Worker.h"
+
+#if !defined(__cpp_impl_coroutine)
+#error "SmartMeter238Coro needs C++20 coroutines (-std=gnu++20, and -fcoroutines on GCC 10)"
+#endif
+
+#include <coroutine>
+#include <exception>
+
+// Coroutine frames come from a fixed pool, there is no heap use per call
+class SmartMeter238CoroPool {
+   public:
+    static void *allocate(size_t size) {
+        if (size <= SM_CORO_FRAME_SIZE) {
+            for (uint8_t i = 0; i < SM_CORO_FRAME_COUNT; i++) {
+                if (!used[i].exchange(true, std::memory_order_acquire)) {
+                    return blocks[i];
+                }
+            }
+        }
+
+        failCount.fetch_add(1, std::memory_order_relaxed);
+
+        return nullptr;
+    }
+
+    static void release(void *ptr) {
+        for (uint8_t i = 0; i < SM_CORO_FRAME_COUNT; i++) {
+            if (ptr == blocks[i]) {
+                used[i].store(false, std::memory_order_release);
+
+                return;
+            }
+        }
+    }
+
+    static uint32_t getFailCount() {
+        return failCount.load(std::memory_order_relaxed);
+    }
+
+   private:
+    alignas(8) static inline uint8_t blocks[SM_CORO_FRAME_COUNT][SM_CORO_FRAME_SIZE];
+    static inline std::atomic<bool> used[SM_CORO_FRAME_COUNT];
+    static inline std::atomic<uint32_t> failCount{0};
+};
+
+// Coroutine that starts when called and frees its frame when it ends. If there is no free frame
+// the coroutine does not run and isRunning() is false.
+class SmartMeter238Task {
+   public:
+    struct promise_type {
+        SmartMeter238Task get_return_object() {
+            return SmartMeter238Task(true);
+        }
+
+        static SmartMeter238Task get_return_object_on_allocation_failure() {
+            return SmartMeter238Task(false);
+        }
+
+        std::suspend_never initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() {}
+
+        // Nobody awaits a task, an exception would be lost with the coroutine left suspended in its frame.
+        // Stop like an uncaught exception in a thread (with -fno-exceptions this is never called)
+        void unhandled_exception() {
+            std::terminate();
+        }
+
+        static void *operator new(size_t size) noexcept {
+            return SmartMeter238CoroPool::allocate(size);
+        }
+
+        static void operator delete(void *ptr) {
+            SmartMeter238CoroPool::release(ptr);
+        }
+    };
+
+    bool isRunning() {
+        return this->started;
+    }
+
+   private:
+    explicit SmartMeter238Task(bool started) : started(started) {}
+
+    bool started;
+};
+
+// Awaitable versions of the SmartMeter238 operations, the coroutine is resumed by the worker
+// when the answer has been decoded
+class SmartMeter238Async {
+   public:
+    class smAwaiter {
+       public:
+        smAwaiter(SmartMeter238Worker &worker, SmartMeter238Worker::smRequestType type) : worker(worker) {
+            this->request.type = type;
+        }
+
+        bool await_ready() {
+            return false;
+        }
+
+        bool await_suspend(std::coroutine_handle<> handle) {
+            this->handle = handle;
+
+            this->request.callback = smAwaiter::resume;
+            this->request.context = this;
+
+            if (!this->worker.submit(this->request)) {
+                this->result.type = this->request.type;
+                this->result.success = false;
+                this->result.errCode = SmartMeter238::SM_ERR_QUEUE_FULL;
+                this->result.latency = 0;
+
+                return false;   // go on without suspending
+            }
+
+            return true;
+        }
+
+        SmartMeter238Worker::smResult await_resume() {
+            return this->result;
+        }
+
+        SmartMeter238Worker::smRequest request;
+
+       private:
+        SmartMeter238Worker &worker;
+        SmartMeter238Worker::smResult result;
+        std::coroutine_handle<> handle;
+
+        static void resume(const SmartMeter238Worker::smResult &result, void *context) {
+            smAwaiter *awaiter = static_cast<smAwaiter *>(context);
+
+            awaiter->result = result;
+            awaiter->handle.resume();
+        }
+    };
+
+    SmartMeter238Async(SmartMeter238Worker &worker) : worker(worker) {}
+
+    smAwaiter powerCut() {
+        return smAwaiter(this->worker, SmartMeter238Worker::SM_REQ_GET_POWERCUT);
+    }
+
+    smAwaiter measurement() {
+        return smAwaiter(this->worker, SmartMeter238Worker::SM_REQ_GET_MEASUREMENTDATA);
+    }
+
+    smAwaiter limitAndPurchase() {
+        return smAwaiter(this->worker, SmartMeter238Worker::SM_REQ_GET_LIMITANDPURCHASEDATA);
+    }
+
+    smAwaiter setLimits(float maxCurrentLimit, uint16_t maxVoltageLimit, uint16_t minVoltageLimit) {
+        smAwaiter awaiter(this->worker, SmartMeter238Worker::SM_REQ_SET_LIMITDATA);
+
+        awaiter.request.value1 = maxCurrentLimit;
+        awaiter.request.value2 = maxVoltageLimit;
+        awaiter.request.value3 = minVoltageLimit;
+
+        return awaiter;
+    }
+
+    smAwaiter setPurchase(float energyPurchase, float energyPurchaseAlarm, bool energyPurchaseStatus) {
+        smAwaiter awaiter(this->worker, SmartMeter238Worker::SM_REQ_SET_PURCHASEDATA);
+
+        awaiter.request.value1 = energyPurchase;
+        awaiter.request.value2 = energyPurchaseAlarm;
+        awaiter.request.flag = energyPurchaseStatus;
+
+        return awaiter;
+    }
+
+    smAwaiter setPowerCut(bool powerCut) {
+        smAwaiter awaiter(this->worker, SmartMeter238Worker::SM_REQ_SET_POWERCUT);
+
+        awaiter.request.flag = powerCut;
+
+        return awaiter;
+    }
+
+    smAwaiter setDelay(bool delaySetPowerCut, uint16_t delay) {
+        smAwaiter awaiter(this->worker, SmartMeter238Worker::SM_REQ_SET_DELAY);
+
+        awaiter.request.flag = delaySetPowerCut;
+        awaiter.request.value1 = delay;
+
+        return awaiter;
+    }
+
+    smAwaiter reset() {
+        return smAwaiter(this->worker, SmartMeter238Worker::SM_REQ_SET_RESET);
+    }
+
+    smAwaiter setPowerCompany(float startingKWh, float priceKWh) {
+        smAwaiter awaiter(this->worker, SmartMeter238Worker::SM_REQ_SET_POWERCOMPANYDATA);
+
+        awaiter.request.value1 = startingKWh;
+        awaiter.request.value2 = priceKWh;
+
+        return awaiter;
+    }
+
+   private:
+    SmartMeter238Worker &worker;
+};
+#endif   // SmartMeter238Coro_h
@@ -0,0 +1,367 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238EventServer.h"
+
+#if defined(ESP8266) || defined(ESP32)
+#include "SmartMeter238Clock.h"
+//------------------------------------------------------------------------------
+
+#define SM_EVENT_HEADER_STREAM "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\nConnection: keep-alive\r\nAccess-Control-Allow-Origin: *\r\n\r\n"
+#define SM_EVENT_HEADER_DATA "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %u\r\nCache-Control: no-cache\r\nConnection: close\r\nAccess-Control-Allow-Origin: *\r\n\r\n"
+#define SM_EVENT_HEADER_NO_DATA "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+#define SM_EVENT_HEADER_NOT_FOUND "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+#define SM_EVENT_KEEPALIVE_COMMENT ":\n\n"
+
+static bool smEventPath(const char *request, const char *path) {
+    size_t length = strlen(path);
+
+    return strncmp(request, path, length) == 0 && (request[length] == ' ' || request[length] == '?' || request[length] == '\0');
+}
+
+SmartMeter238EventServer::SmartMeter238EventServer(WiFiServer &server) : server(server) {
+    for (uint8_t i = 0; i < SM_EVENT_MAX_CLIENTS; i++) {
+        this->connections[i].state = SM_CONNECTION_FREE;
+        this->connections[i].frame = -1;
+    }
+
+    this->frames[0].version = 0;
+    this->frames[1].version = 0;
+}
+
+void SmartMeter238EventServer::begin() {
+    this->server.begin();
+}
+
+void SmartMeter238EventServer::publish(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject) {
+    int8_t index = (this->current < 0) ? 0 : 1 - this->current;
+
+    // Still writing the older frame, the one to be written now
+    for (uint8_t i = 0; i < SM_EVENT_MAX_CLIENTS; i++) {
+        if (this->connections[i].state != SM_CONNECTION_FREE && this->connections[i].frame == index) {
+            this->droppedCount++;
+            this->close(&this->connections[i]);
+        }
+    }
+
+    smFrame *frame = &this->frames[index];
+    SmartMeter238Clock *clock = sm.getClock();
+
+    uint64_t timestamp = dataObject->measurementData.timestamp;
+    uint64_t time = clock->hasEpoch() ? (clock->toEpoch(timestamp) / 1000) : 0;
+
+    int offset = snprintf(frame->data, SM_EVENT_FRAME_SIZE, "id: %lu\ndata: ", (unsigned long)(this->version + 1));
+    int json = snprintf(frame->data + offset, SM_EVENT_FRAME_SIZE - offset,
+                        "{\"time\":%llu,\"timestamp\":%llu,\"current\":%.3f,\"voltage\":%.1f,\"frequency\":%.2f,\"reactivePower\":%.4f,\"activePower\":%.4f,"
+                        "\"powerFactor\":%.3f,\"totalEnergy\":%.2f,\"importEnergy\":%.2f,\"exportEnergy\":%.2f,\"priceEnergy\":%.2f,\"totalKWh\":%.2f}",
+                        (unsigned long long)time, (unsigned long long)timestamp,
+                        sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_CURRENT),
+                        sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_VOLTAGE),
+                        sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_FREQUENCY),
+                        sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_REACTIVEPOWER),
+                        sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_ACTIVEPOWER),
+                        sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_POWERFACTOR),
+                        sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_TOTALENERGY),
+                        sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_IMPORTENERGY),
+                        sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_EXPORTENERGY),
+                        sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_PRICEENERGY),
+                        sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_TOTALKWH));
+
+    if (offset < 0 || json < 0 || (offset + json + 3) > SM_EVENT_FRAME_SIZE) {
+        return;   // SM_EVENT_FRAME_SIZE too small
+    }
+
+    frame->data[offset + json] = '\n';
+    frame->data[offset + json + 1] = '\n';
+
+    frame->length = offset + json + 2;
+    frame->jsonOffset = offset;
+    frame->jsonLength = json;
+    frame->version = ++this->version;
+
+    this->current = index;
+}
+
+uint8_t SmartMeter238EventServer::getClientCount() {
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < SM_EVENT_MAX_CLIENTS; i++) {
+        count += (this->connections[i].state != SM_CONNECTION_FREE);
+    }
+
+    return count;
+}
+
+uint8_t SmartMeter238EventServer::getStreamCount() {
+    uint8_t count = 0;
+
+    for (uint8_t i = 0; i < SM_EVENT_MAX_CLIENTS; i++) {
+        count += (this->connections[i].state == SM_CONNECTION_STREAM);
+    }
+
+    return count;
+}
+
+uint32_t SmartMeter238EventServer::getFrameCount() {
+    return this->version;
+}
+
+uint32_t SmartMeter238EventServer::getSkippedCount() {
+    return this->skippedCount;
+}
+
+uint32_t SmartMeter238EventServer::getDroppedCount() {
+    return this->droppedCount;
+}
+
+uint32_t SmartMeter238EventServer::getRefusedCount() {
+    return this->refusedCount;
+}
+
+void SmartMeter238EventServer::clearCounters() {
+    this->skippedCount = 0;
+    this->droppedCount = 0;
+    this->refusedCount = 0;
+}
+
+void SmartMeter238EventServer::loop() {
+    this->accept();
+
+    for (uint8_t i = 0; i < SM_EVENT_MAX_CLIENTS; i++) {
+        smConnection *connection = &this->connections[i];
+
+        if (connection->state == SM_CONNECTION_FREE) {
+            continue;
+        }
+
+        if (!connection->client.connected()) {
+            this->close(connection);
+
+            continue;
+        }
+
+        switch (connection->state) {
+            case SM_CONNECTION_REQUEST: {
+                this->receive(connection);
+
+                if (connection->state == SM_CONNECTION_REQUEST && (millis() - connection->time) >= SM_EVENT_REQUEST_TIMEOUT) {
+                    this->close(connection);
+                }
+
+                break;
+            }
+            case SM_CONNECTION_HEADER: {
+                if (this->send(connection, connection->buffer, connection->length)) {
+                    connection->pos = 0;
+                    connection->time = millis();
+
+                    if (connection->events) {
+                        connection->state = SM_CONNECTION_STREAM;
+                    } else if (connection->frame >= 0) {
+                        connection->state = SM_CONNECTION_BODY;
+                    } else {
+                        this->close(connection);
+                    }
+                }
+
+                break;
+            }
+            case SM_CONNECTION_BODY: {
+                smFrame *frame = &this->frames[connection->frame];
+
+                if (this->send(connection, frame->data + frame->jsonOffset, frame->jsonLength)) {
+                    this->close(connection);
+                }
+
+                break;
+            }
+            case SM_CONNECTION_STREAM: {
+                // Between events a stream goes straight to the latest frame
+                if (connection->frame < 0 && this->current >= 0 && this->frames[this->current].version != connection->version) {
+                    if (connection->version > 0) {
+                        this->skippedCount += this->frames[this->current].version - connection->version - 1;
+                    }
+
+                    connection->frame = this->current;
+                    connection->version = this->frames[this->current].version;
+                    connection->pos = 0;
+                }
+
+                if (connection->frame >= 0) {
+                    smFrame *frame = &this->frames[connection->frame];
+
+                    if (this->send(connection, frame->data, frame->length)) {
+                        connection->frame = -1;
+                        connection->pos = 0;
+                        connection->time = millis();
+                    }
+                } else if ((millis() - connection->time) >= SM_EVENT_KEEPALIVE && this->getSpace(connection) >= strlen(SM_EVENT_KEEPALIVE_COMMENT)) {
+                    connection->client.write((const uint8_t *)SM_EVENT_KEEPALIVE_COMMENT, strlen(SM_EVENT_KEEPALIVE_COMMENT));
+                    connection->time = millis();
+                }
+
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+void SmartMeter238EventServer::accept() {
+    for (uint8_t n = 0; n < SM_EVENT_MAX_CLIENTS; n++) {
+        WiFiClient client = this->server.available();
+
+        if (!client) {
+            return;
+        }
+
+        smConnection *connection = nullptr;
+
+        for (uint8_t i = 0; i < SM_EVENT_MAX_CLIENTS; i++) {
+            if (this->connections[i].state == SM_CONNECTION_FREE) {
+                connection = &this->connections[i];
+
+                break;
+            }
+        }
+
+        if (connection == nullptr) {
+            this->refusedCount++;
+
+            client.stop();
+
+            return;
+        }
+
+        client.setNoDelay(true);
+
+        connection->client = client;
+        connection->state = SM_CONNECTION_REQUEST;
+        connection->length = 0;
+        connection->pos = 0;
+        connection->lineEmpty = false;
+        connection->events = false;
+        connection->frame = -1;
+        connection->version = 0;
+        connection->time = millis();
+    }
+}
+
+void SmartMeter238EventServer::receive(smConnection *connection) {
+    while (connection->client.available() > 0) {
+        int data = connection->client.read();
+
+        if (data < 0) {
+            return;
+        }
+
+        if (connection->pos == 0) {
+            // Request line, what does not fit is cut
+            if (data == '\n') {
+                connection->buffer[connection->length] = '\0';
+                connection->pos = 1;
+                connection->lineEmpty = true;
+            } else if (data != '\r' && connection->length < (SM_EVENT_BUFFER_SIZE - 1)) {
+                connection->buffer[connection->length++] = data;
+            }
+        } else if (data == '\n') {
+            // The headers are skipped, only the empty line after them matters
+            if (connection->lineEmpty) {
+                this->answer(connection);
+
+                return;
+            }
+
+            connection->lineEmpty = true;
+        } else if (data != '\r') {
+            connection->lineEmpty = false;
+        }
+    }
+}
+
+void SmartMeter238EventServer::answer(smConnection *connection) {
+    const char *path = (strncmp(connection->buffer, "GET ", 4) == 0) ? connection->buffer + 4 : nullptr;
+    int length;
+
+    connection->frame = -1;
+    connection->events = false;
+
+    if (path != nullptr && smEventPath(path, "/events")) {
+        connection->events = true;
+
+        length = snprintf(connection->buffer, SM_EVENT_BUFFER_SIZE, SM_EVENT_HEADER_STREAM);
+    } else if (path != nullptr && (smEventPath(path, "/") || smEventPath(path, "/data"))) {
+        if (this->current >= 0) {
+            connection->frame = this->current;
+
+            length = snprintf(connection->buffer, SM_EVENT_BUFFER_SIZE, SM_EVENT_HEADER_DATA, this->frames[this->current].jsonLength);
+        } else {
+            length = snprintf(connection->buffer, SM_EVENT_BUFFER_SIZE, SM_EVENT_HEADER_NO_DATA);
+        }
+    } else {
+        length = snprintf(connection->buffer, SM_EVENT_BUFFER_SIZE, SM_EVENT_HEADER_NOT_FOUND);
+    }
+
+    connection->length = constrain(length, 0, SM_EVENT_BUFFER_SIZE - 1);
+    connection->pos = 0;
+    connection->state = SM_CONNECTION_HEADER;
+}
+
+bool SmartMeter238EventServer::send(smConnection *connection, const char *data, uint16_t length) {
+    size_t size = min(this->getSpace(connection), (size_t)(length - connection->pos));
+
+    if (size > 0) {
+        connection->pos += connection->client.write((const uint8_t *)data + connection->pos, size);
+    }
+
+    return connection->pos >= length;
+}
+
+size_t SmartMeter238EventServer::getSpace(smConnection *connection) {
+#if defined(ESP32)
+    // availableForWrite() is not implemented by the client, the socket takes a chunk
+    return SM_EVENT_WRITE_CHUNK;
+#else
+    return connection->client.availableForWrite();
+#endif
+}
+
+void SmartMeter238EventServer::close(smConnection *connection) {
+    connection->client.stop();
+    connection->state = SM_CONNECTION_FREE;
+    connection->frame = -1;
+}
+
+void SmartMeter238EventServer::onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) {
+    if (cmd == SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA) {
+        this->publish(sm, dataObject);
+    }
+}
+#endif
@@ -0,0 +1,118 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238EventServer_h
+#define SmartMeter238EventServer_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+#if defined(ESP8266) || defined(ESP32)
+#include <WiFiClient.h>
+#include <WiFiServer.h>
+
+// Small HTTP server of the live readings. GET / (or /data) answers the last measurement as JSON, GET /events
+// is a Server-Sent Events stream with one event per measurement. Each measurement is serialized once in a
+// shared frame and every connection writes from it, there is no copy or heap per client; each connection only
+// has its own buffer for the request and the response header. Two frames are kept: a client still writing the
+// older one when a new measurement comes is too slow and is closed, an idle client skips to the latest frame.
+// Nothing here blocks, call loop() as often as possible.
+class SmartMeter238EventServer : public SmartMeter238Observer {
+   public:
+    SmartMeter238EventServer(WiFiServer &server);
+
+    void begin();
+
+    void publish(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject);
+
+    uint8_t getClientCount();     // open connections
+    uint8_t getStreamCount();     // of them, event streams
+    uint32_t getFrameCount();     // measurements published
+    uint32_t getSkippedCount();   // events not sent to a stream because a newer one was ready
+    uint32_t getDroppedCount();   // connections closed for being too slow
+    uint32_t getRefusedCount();   // connections refused, all slots busy
+    void clearCounters();
+
+    void loop();
+
+    void onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) override;
+
+   private:
+    enum smConnectionState {
+        SM_CONNECTION_FREE,
+        SM_CONNECTION_REQUEST,
+        SM_CONNECTION_HEADER,
+        SM_CONNECTION_STREAM,
+        SM_CONNECTION_BODY
+    };
+
+    typedef struct {
+        WiFiClient client;
+        smConnectionState state;
+
+        char buffer[SM_EVENT_BUFFER_SIZE];   // request line, then the response header
+        uint16_t length;
+        uint16_t pos;
+        bool lineEmpty;   // parsing the headers of the request
+        bool events;
+
+        int8_t frame;       // frame being written, -1 none
+        uint32_t version;   // version of the last frame written
+        unsigned long time;   // millis of the connection or of the last write
+    } smConnection;
+
+    typedef struct {
+        char data[SM_EVENT_FRAME_SIZE];   // "id: n\ndata: {json}\n\n"
+        uint16_t length;
+        uint16_t jsonOffset;
+        uint16_t jsonLength;
+        uint32_t version;
+    } smFrame;
+
+    WiFiServer &server;
+
+    smConnection connections[SM_EVENT_MAX_CLIENTS];
+
+    smFrame frames[2];
+    int8_t current = -1;
+    uint32_t version = 0;
+
+    uint32_t skippedCount = 0;
+    uint32_t droppedCount = 0;
+    uint32_t refusedCount = 0;
+
+    void accept();
+    void receive(smConnection *connection);
+    void answer(smConnection *connection);
+    bool send(smConnection *connection, const char *data, uint16_t length);
+    void close(smConnection *connection);
+    size_t getSpace(smConnection *connection);
+};
+#endif
+#endif   // SmartMeter238EventServer_h
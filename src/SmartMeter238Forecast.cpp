@@ -0,0 +1,258 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Forecast.h"
+#include "SmartMeter238Clock.h"
+//------------------------------------------------------------------------------
+
+SmartMeter238Forecast::SmartMeter238Forecast() {
+    for (uint8_t i = 0; i < 24; i++) {
+        this->hourRate[i] = -1;
+    }
+}
+
+void SmartMeter238Forecast::setWarning(float hours, smForecastCallback callback, void *context) {
+    this->warningHours = hours;
+    this->callback = callback;
+    this->context = context;
+    this->warning = false;
+}
+
+void SmartMeter238Forecast::setBalanceInterval(unsigned long minInterval, unsigned long maxInterval) {
+    this->minInterval = minInterval;
+    this->maxInterval = max(minInterval, maxInterval);
+    this->balanceInterval = this->maxInterval;
+}
+
+void SmartMeter238Forecast::setUtcOffset(int32_t seconds) {
+    this->utcOffset = seconds;
+}
+
+float SmartMeter238Forecast::getBalance() {
+    if (this->balance < 0) {
+        return -1;
+    }
+
+    return max(0.0f, this->balance - this->consumedSinceRead);
+}
+
+float SmartMeter238Forecast::getRate() {
+    uint8_t hour;
+    uint32_t secondOfHour;
+
+    this->getClock((this->clock != nullptr) ? this->clock->now() : this->lastTimestamp, &hour, &secondOfHour);
+
+    return this->getHourRate(hour);
+}
+
+float SmartMeter238Forecast::getHoursToDepletion() {
+    return this->hoursToDepletion;
+}
+
+bool SmartMeter238Forecast::isWarning() {
+    return this->warning;
+}
+
+unsigned long SmartMeter238Forecast::getBalanceInterval() {
+    return this->balanceInterval;
+}
+
+bool SmartMeter238Forecast::isBalanceReadDue() {
+    return this->balance < 0 || (millis() - this->balanceTime) >= this->balanceInterval;
+}
+
+void SmartMeter238Forecast::getClock(uint64_t timestamp, uint8_t *hour, uint32_t *secondOfHour) {
+    uint64_t seconds;
+
+    // Without a wall clock the hours are counted from boot, still useful for the daily pattern once it is learned
+    if (this->clock != nullptr && this->clock->hasEpoch()) {
+        seconds = (this->clock->toEpoch(timestamp) / 1000000) + this->utcOffset;
+    } else {
+        seconds = timestamp / 1000000;
+    }
+
+    *hour = (seconds / 3600) % 24;
+    *secondOfHour = seconds % 3600;
+}
+
+float SmartMeter238Forecast::getHourRate(uint8_t hour) {
+    return (this->hourRate[hour] >= 0) ? this->hourRate[hour] : this->globalRate;
+}
+
+void SmartMeter238Forecast::learnHour(uint8_t hour, float rate) {
+    float old = this->hourRate[hour];
+
+    if (old < 0) {
+        this->hourRate[hour] = rate;
+        this->knownRateSum += rate;
+        this->knownRateCount++;
+    } else {
+        this->hourRate[hour] = old + (rate - old) * SM_FORECAST_DAY_WEIGHT;
+        this->knownRateSum += this->hourRate[hour] - old;
+    }
+}
+
+void SmartMeter238Forecast::updateMeasurement(SmartMeter238::smartMeterData *dataObject) {
+    float power = dataObject->measurementData.data.activePower;
+    uint64_t timestamp = dataObject->measurementData.timestamp;
+
+    if (!this->measured) {
+        this->lastTimestamp = timestamp;
+        this->globalRate = power;
+        this->measured = true;
+
+        return;
+    }
+
+    float seconds = (timestamp - this->lastTimestamp) / 1000000.0f;
+    float energy = power * seconds / 3600.0f;
+
+    this->lastTimestamp = timestamp;
+
+    this->consumedSinceRead += energy;
+    this->globalRate += (power - this->globalRate) * seconds / (seconds + 3600.0f);
+
+    uint8_t hour;
+    uint32_t secondOfHour;
+
+    this->getClock(timestamp, &hour, &secondOfHour);
+
+    if (hour != this->currentHour) {
+        if (this->currentHour >= 0 && this->hourSeconds >= SM_FORECAST_MIN_HOUR_COVERAGE) {
+            this->learnHour(this->currentHour, this->hourEnergy * 3600.0f / this->hourSeconds);
+        }
+
+        this->currentHour = hour;
+        this->hourEnergy = 0;
+        this->hourSeconds = 0;
+    }
+
+    this->hourEnergy += energy;
+    this->hourSeconds += seconds;
+}
+
+void SmartMeter238Forecast::updateForecast(uint64_t timestamp) {
+    float energy = this->getBalance();
+    float dailyEnergy = this->knownRateSum + (24 - this->knownRateCount) * this->globalRate;
+
+    if (!this->purchaseEnabled || energy < 0) {
+        this->hoursToDepletion = -1;
+    } else if (energy == 0) {
+        this->hoursToDepletion = 0;
+    } else if (dailyEnergy <= 0 || energy / dailyEnergy > SM_FORECAST_MAX_DAYS) {
+        this->hoursToDepletion = -1;   // no consumption, the balance lasts forever
+    } else {
+        uint8_t hour;
+        uint32_t secondOfHour;
+
+        this->getClock(timestamp, &hour, &secondOfHour);
+
+        // Rest of the current hour, whole days, then hour by hour: at most 26 steps
+        float span = (3600 - secondOfHour) / 3600.0f;
+        float rate = this->getHourRate(hour);
+        float hours;
+
+        if (energy <= rate * span) {
+            hours = energy / rate;
+        } else {
+            energy -= rate * span;
+            hours = span;
+            hour = (hour + 1) % 24;
+
+            uint32_t days = energy / dailyEnergy;
+
+            energy -= days * dailyEnergy;
+            hours += days * 24.0f;
+
+            for (uint8_t i = 0; i < 24; i++) {
+                rate = this->getHourRate(hour);
+
+                if (energy <= rate) {
+                    hours += (rate > 0) ? energy / rate : 0;
+
+                    break;
+                }
+
+                energy -= rate;
+                hours += 1;
+                hour = (hour + 1) % 24;
+            }
+        }
+
+        this->hoursToDepletion = hours;
+    }
+
+    // Read the balance more often as the cut gets closer
+    this->balanceInterval = this->maxInterval;
+
+    if (this->hoursToDepletion >= 0) {
+        float proposed = this->hoursToDepletion * 3600000.0f / SM_FORECAST_READS_BEFORE_CUT;
+
+        this->balanceInterval = (proposed < this->maxInterval) ? max(this->minInterval, (unsigned long)proposed) : this->maxInterval;
+    }
+
+    if (!this->warning && this->hoursToDepletion >= 0 && this->hoursToDepletion <= this->warningHours) {
+        this->warning = true;
+
+        if (this->callback != nullptr) {
+            this->callback(this->hoursToDepletion, this->getBalance(), this->context);
+        }
+    } else if (this->warning && (this->hoursToDepletion < 0 || this->hoursToDepletion > this->warningHours * SM_FORECAST_REARM_FACTOR)) {
+        this->warning = false;   // new purchase or lower consumption
+    }
+}
+
+void SmartMeter238Forecast::update(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) {
+    uint64_t timestamp;
+
+    this->clock = sm.getClock();
+
+    if (cmd == SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA) {
+        sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_ACTIVEPOWER);   // decoded now if out of the field mask
+
+        this->updateMeasurement(dataObject);
+
+        timestamp = dataObject->measurementData.timestamp;
+    } else if (cmd == SmartMeter238::SM_CMD_RESP_LIMITANDPURCHASEDATA) {
+        this->purchaseEnabled = dataObject->limitAndPurchaseData.data.energyPurchaseStatus;
+        this->balance = dataObject->limitAndPurchaseData.data.energyPurchaseBalance;
+        this->balanceTime = dataObject->limitAndPurchaseData.time;
+        this->consumedSinceRead = 0;
+
+        timestamp = dataObject->limitAndPurchaseData.timestamp;
+    } else {
+        return;
+    }
+
+    this->updateForecast(timestamp);
+}
+
+void SmartMeter238Forecast::onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) {
+    this->update(sm, cmd, dataObject);
+}
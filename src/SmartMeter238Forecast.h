@@ -0,0 +1,105 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Forecast_h
+#define SmartMeter238Forecast_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+// Forecast of the purchase balance depletion. The consumption rate is learned for every hour of the day from the
+// measurements (moving average over days), the balance is read from limitAndPurchaseData and discounted with the
+// energy measured since the read. The time to depletion is kept on every answer with fixed work, a callback fires
+// once when it goes below the warning hours, and the proposed balance read interval gets shorter as the cut gets
+// closer. Nothing is read by the forecast, the caller schedules getLimitAndPurchaseData() with isBalanceReadDue().
+class SmartMeter238Forecast : public SmartMeter238Observer {
+   public:
+    typedef void (*smForecastCallback)(float hoursToDepletion, float balance, void *context);
+
+    SmartMeter238Forecast();
+
+    void setWarning(float hours, smForecastCallback callback, void *context = nullptr);
+    void setBalanceInterval(unsigned long minInterval, unsigned long maxInterval);
+    void setUtcOffset(int32_t seconds);
+
+    float getBalance();             // kWh estimated now, -1 before the first read
+    float getRate();                // kW expected for the current hour
+    float getHoursToDepletion();    // -1 when unknown, no consumption or beyond SM_FORECAST_MAX_DAYS
+    bool isWarning();
+
+    unsigned long getBalanceInterval();   // millis proposed between balance reads
+    bool isBalanceReadDue();              // no balance read yet or the interval has passed since the last one
+
+    void update(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject);
+
+    void onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) override;
+
+   private:
+    float warningHours = SM_FORECAST_DEFAULT_WARNING_HOURS;
+    smForecastCallback callback = nullptr;
+    void *context = nullptr;
+    bool warning = false;
+
+    unsigned long minInterval = SM_MIN_INTERVAL_TO_GET_DATA;
+    unsigned long maxInterval = SM_FORECAST_DEFAULT_MAX_INTERVAL;
+    unsigned long balanceInterval = SM_FORECAST_DEFAULT_MAX_INTERVAL;
+    unsigned long balanceTime = 0;   // millis of the last balance read
+
+    int32_t utcOffset = 0;
+    SmartMeter238Clock *clock = nullptr;   // of the meter of the last update
+
+    // kW of every hour of the day, < 0 until the hour is learned
+    float hourRate[24];
+    float knownRateSum = 0;
+    uint8_t knownRateCount = 0;
+    float globalRate = 0;
+
+    // Hour being measured
+    int8_t currentHour = -1;
+    float hourEnergy = 0;    // kWh
+    float hourSeconds = 0;
+
+    uint64_t lastTimestamp = 0;
+    bool measured = false;
+
+    // Balance
+    bool purchaseEnabled = false;
+    float balance = -1;
+    float consumedSinceRead = 0;   // kWh
+
+    float hoursToDepletion = -1;
+
+    void getClock(uint64_t timestamp, uint8_t *hour, uint32_t *secondOfHour);
+    float getHourRate(uint8_t hour);
+    void learnHour(uint8_t hour, float rate);
+
+    void updateMeasurement(SmartMeter238::smartMeterData *dataObject);
+    void updateForecast(uint64_t timestamp);
+};
+#endif   // SmartMeter238Forecast_h
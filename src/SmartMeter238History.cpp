@@ -0,0 +1,552 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238History.h"
+
+#include <new>
+
+// SM_HISTORY_NO_SIMD keeps the portable kernels on x86, the host tests compare both
+#if defined(__AVX__) && !defined(SM_HISTORY_NO_SIMD)
+#define SM_HISTORY_AVX
+#include <immintrin.h>
+#elif defined(__SSE2__) && !defined(SM_HISTORY_NO_SIMD)
+#define SM_HISTORY_SSE2
+#include <emmintrin.h>
+#endif
+//------------------------------------------------------------------------------
+
+static double smSumKernel(const float *data, uint32_t length) {
+    double total = 0;
+    uint32_t i = 0;
+
+#if defined(SM_HISTORY_AVX)
+    __m256d acc0 = _mm256_setzero_pd();
+    __m256d acc1 = _mm256_setzero_pd();
+
+    for (; (i + 8) <= length; i += 8) {
+        __m256 values = _mm256_loadu_ps(data + i);
+
+        acc0 = _mm256_add_pd(acc0, _mm256_cvtps_pd(_mm256_castps256_ps128(values)));
+        acc1 = _mm256_add_pd(acc1, _mm256_cvtps_pd(_mm256_extractf128_ps(values, 1)));
+    }
+
+    double lanes[4];
+
+    _mm256_storeu_pd(lanes, _mm256_add_pd(acc0, acc1));
+
+    total = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+#elif defined(SM_HISTORY_SSE2)
+    __m128d acc0 = _mm_setzero_pd();
+    __m128d acc1 = _mm_setzero_pd();
+
+    for (; (i + 4) <= length; i += 4) {
+        __m128 values = _mm_loadu_ps(data + i);
+
+        acc0 = _mm_add_pd(acc0, _mm_cvtps_pd(values));
+        acc1 = _mm_add_pd(acc1, _mm_cvtps_pd(_mm_movehl_ps(values, values)));
+    }
+
+    double lanes[2];
+
+    _mm_storeu_pd(lanes, _mm_add_pd(acc0, acc1));
+
+    total = lanes[0] + lanes[1];
+#else
+    // Independent accumulators so the additions do not wait for each other
+    double acc[4] = {0, 0, 0, 0};
+
+    for (; (i + 4) <= length; i += 4) {
+        acc[0] += data[i];
+        acc[1] += data[i + 1];
+        acc[2] += data[i + 2];
+        acc[3] += data[i + 3];
+    }
+
+    total = acc[0] + acc[1] + acc[2] + acc[3];
+#endif
+
+    for (; i < length; i++) {
+        total += data[i];
+    }
+
+    return total;
+}
+
+static void smMinMaxKernel(const float *data, uint32_t length, float *min, float *max) {
+    float tmpMin = *min;
+    float tmpMax = *max;
+    uint32_t i = 0;
+
+#if defined(SM_HISTORY_AVX)
+    if (length >= 8) {
+        __m256 vMin = _mm256_set1_ps(tmpMin);
+        __m256 vMax = _mm256_set1_ps(tmpMax);
+
+        for (; (i + 8) <= length; i += 8) {
+            __m256 values = _mm256_loadu_ps(data + i);
+
+            vMin = _mm256_min_ps(vMin, values);
+            vMax = _mm256_max_ps(vMax, values);
+        }
+
+        float lanesMin[8];
+        float lanesMax[8];
+
+        _mm256_storeu_ps(lanesMin, vMin);
+        _mm256_storeu_ps(lanesMax, vMax);
+
+        for (uint8_t n = 0; n < 8; n++) {
+            tmpMin = lanesMin[n] < tmpMin ? lanesMin[n] : tmpMin;
+            tmpMax = lanesMax[n] > tmpMax ? lanesMax[n] : tmpMax;
+        }
+    }
+#elif defined(SM_HISTORY_SSE2)
+    if (length >= 4) {
+        __m128 vMin = _mm_set1_ps(tmpMin);
+        __m128 vMax = _mm_set1_ps(tmpMax);
+
+        for (; (i + 4) <= length; i += 4) {
+            __m128 values = _mm_loadu_ps(data + i);
+
+            vMin = _mm_min_ps(vMin, values);
+            vMax = _mm_max_ps(vMax, values);
+        }
+
+        float lanesMin[4];
+        float lanesMax[4];
+
+        _mm_storeu_ps(lanesMin, vMin);
+        _mm_storeu_ps(lanesMax, vMax);
+
+        for (uint8_t n = 0; n < 4; n++) {
+            tmpMin = lanesMin[n] < tmpMin ? lanesMin[n] : tmpMin;
+            tmpMax = lanesMax[n] > tmpMax ? lanesMax[n] : tmpMax;
+        }
+    }
+#endif
+
+    for (; i < length; i++) {
+        tmpMin = data[i] < tmpMin ? data[i] : tmpMin;
+        tmpMax = data[i] > tmpMax ? data[i] : tmpMax;
+    }
+
+    *min = tmpMin;
+    *max = tmpMax;
+}
+
+static uint32_t smCountKernel(const float *data, uint32_t length, float threshold, bool above) {
+    uint32_t total = 0;
+    uint32_t i = 0;
+
+#if defined(SM_HISTORY_AVX)
+    __m256 vThreshold = _mm256_set1_ps(threshold);
+
+    for (; (i + 8) <= length; i += 8) {
+        __m256 values = _mm256_loadu_ps(data + i);
+        __m256 mask = above ? _mm256_cmp_ps(values, vThreshold, _CMP_GT_OQ) : _mm256_cmp_ps(values, vThreshold, _CMP_LT_OQ);
+
+        total += __builtin_popcount(_mm256_movemask_ps(mask));
+    }
+#elif defined(SM_HISTORY_SSE2)
+    __m128 vThreshold = _mm_set1_ps(threshold);
+
+    for (; (i + 4) <= length; i += 4) {
+        __m128 values = _mm_loadu_ps(data + i);
+        __m128 mask = above ? _mm_cmpgt_ps(values, vThreshold) : _mm_cmplt_ps(values, vThreshold);
+
+        total += __builtin_popcount(_mm_movemask_ps(mask));
+    }
+#endif
+
+    for (; i < length; i++) {
+        if (above ? (data[i] > threshold) : (data[i] < threshold)) {
+            total++;
+        }
+    }
+
+    return total;
+}
+
+//------------------------------------------------------------------------------
+//
+//------------------------------------------------------------------------------
+
+SmartMeter238History::SmartMeter238History(uint32_t capacity) : capacity(capacity) {
+    // One block for all the columns
+    float *block = new (std::nothrow) float[(size_t)capacity * SmartMeter238::SM_FIELD_COUNT];
+
+    for (uint8_t i = 0; i < SmartMeter238::SM_FIELD_COUNT; i++) {
+        this->columns[i] = (block != nullptr) ? block + ((size_t)i * capacity) : nullptr;
+    }
+
+    this->timeColumn = new (std::nothrow) uint64_t[capacity];
+}
+
+SmartMeter238History::~SmartMeter238History() {
+    delete[] this->columns[0];
+    delete[] this->timeColumn;
+}
+
+bool SmartMeter238History::isReady() {
+    return this->columns[0] != nullptr && this->timeColumn != nullptr && this->capacity > 0;
+}
+
+void SmartMeter238History::clear() {
+    this->head = 0;
+    this->count = 0;
+}
+
+void SmartMeter238History::append(SmartMeter238::smartMeterData *dataObject) {
+    if (!this->isReady()) {
+        return;
+    }
+
+    uint32_t pos = this->head;
+
+    this->timeColumn[pos] = dataObject->measurementData.timestamp;
+
+    this->columns[SmartMeter238::SM_FIELD_CURRENT][pos] = dataObject->measurementData.data.current;
+    this->columns[SmartMeter238::SM_FIELD_VOLTAGE][pos] = dataObject->measurementData.data.voltage;
+    this->columns[SmartMeter238::SM_FIELD_FREQUENCY][pos] = dataObject->measurementData.data.frequency;
+
+    this->columns[SmartMeter238::SM_FIELD_REACTIVEPOWER][pos] = dataObject->measurementData.data.reactivePower;
+    this->columns[SmartMeter238::SM_FIELD_ACTIVEPOWER][pos] = dataObject->measurementData.data.activePower;
+    this->columns[SmartMeter238::SM_FIELD_POWERFACTOR][pos] = dataObject->measurementData.data.powerFactor;
+
+    this->columns[SmartMeter238::SM_FIELD_TOTALENERGY][pos] = dataObject->measurementData.data.lapseOfTimeTotalEnergy;
+    this->columns[SmartMeter238::SM_FIELD_IMPORTENERGY][pos] = dataObject->measurementData.data.lapseOfTimeImportEnergy;
+    this->columns[SmartMeter238::SM_FIELD_EXPORTENERGY][pos] = dataObject->measurementData.data.lapseOfTimeExportEnergy;
+    this->columns[SmartMeter238::SM_FIELD_PRICEENERGY][pos] = dataObject->measurementData.data.lapseOfTimePriceEnergy;
+
+    this->columns[SmartMeter238::SM_FIELD_TOTALKWH][pos] = dataObject->measurementData.data.totalKWh;
+
+    this->head = (this->head + 1) % this->capacity;
+
+    if (this->count < this->capacity) {
+        this->count++;
+    }
+}
+
+uint32_t SmartMeter238History::getCount() {
+    return this->count;
+}
+
+uint32_t SmartMeter238History::getCapacity() {
+    return this->capacity;
+}
+
+uint32_t SmartMeter238History::physical(uint32_t index) {
+    return (this->head + this->capacity - this->count + index) % this->capacity;
+}
+
+uint8_t SmartMeter238History::segments(uint32_t from, uint32_t count, uint32_t *start, uint32_t *length) {
+    if (from >= this->count || count == 0) {
+        return 0;
+    }
+
+    if (count > this->count - from) {
+        count = this->count - from;
+    }
+
+    start[0] = this->physical(from);
+
+    if (start[0] + count <= this->capacity) {
+        length[0] = count;
+
+        return 1;
+    }
+
+    // The range goes around the end of the buffer
+    length[0] = this->capacity - start[0];
+    start[1] = 0;
+    length[1] = count - length[0];
+
+    return 2;
+}
+
+uint64_t SmartMeter238History::getTime(uint32_t index) {
+    return (index < this->count) ? this->timeColumn[this->physical(index)] : 0;
+}
+
+float SmartMeter238History::getValue(SmartMeter238::smMeasurementField field, uint32_t index) {
+    return (index < this->count && field < SmartMeter238::SM_FIELD_COUNT) ? this->columns[field][this->physical(index)] : 0;
+}
+
+bool SmartMeter238History::getRange(uint64_t fromTime, uint64_t toTime, uint32_t *from, uint32_t *count) {
+    // Binary search, the time column is in order
+    uint32_t low = 0;
+    uint32_t high = this->count;
+
+    while (low < high) {
+        uint32_t middle = low + ((high - low) / 2);
+
+        if (this->getTime(middle) < fromTime) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    *from = low;
+
+    high = this->count;
+
+    while (low < high) {
+        uint32_t middle = low + ((high - low) / 2);
+
+        if (this->getTime(middle) <= toTime) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    *count = low - *from;
+
+    return *count > 0;
+}
+
+double SmartMeter238History::sum(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count) {
+    uint32_t start[2];
+    uint32_t length[2];
+
+    uint8_t parts = this->segments(from, count, start, length);
+
+    double total = 0;
+
+    for (uint8_t i = 0; i < parts; i++) {
+        total += smSumKernel(this->columns[field] + start[i], length[i]);
+    }
+
+    return total;
+}
+
+float SmartMeter238History::mean(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count) {
+    uint32_t start[2];
+    uint32_t length[2];
+
+    uint8_t parts = this->segments(from, count, start, length);
+
+    if (parts == 0) {
+        return 0;
+    }
+
+    return this->sum(field, from, count) / (length[0] + (parts > 1 ? length[1] : 0));
+}
+
+bool SmartMeter238History::minMax(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count, float *min, float *max) {
+    uint32_t start[2];
+    uint32_t length[2];
+
+    uint8_t parts = this->segments(from, count, start, length);
+
+    if (parts == 0) {
+        return false;
+    }
+
+    *min = this->columns[field][start[0]];
+    *max = *min;
+
+    for (uint8_t i = 0; i < parts; i++) {
+        smMinMaxKernel(this->columns[field] + start[i], length[i], min, max);
+    }
+
+    return true;
+}
+
+uint32_t SmartMeter238History::countAbove(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count, float threshold) {
+    uint32_t start[2];
+    uint32_t length[2];
+
+    uint8_t parts = this->segments(from, count, start, length);
+    uint32_t total = 0;
+
+    for (uint8_t i = 0; i < parts; i++) {
+        total += smCountKernel(this->columns[field] + start[i], length[i], threshold, true);
+    }
+
+    return total;
+}
+
+uint32_t SmartMeter238History::countBelow(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count, float threshold) {
+    uint32_t start[2];
+    uint32_t length[2];
+
+    uint8_t parts = this->segments(from, count, start, length);
+    uint32_t total = 0;
+
+    for (uint8_t i = 0; i < parts; i++) {
+        total += smCountKernel(this->columns[field] + start[i], length[i], threshold, false);
+    }
+
+    return total;
+}
+
+double SmartMeter238History::energy(uint32_t from, uint32_t count) {
+    // kWh from the active power (kW) with the trapezoidal rule
+    if (from >= this->count || count < 2) {
+        return 0;
+    }
+
+    if (count > this->count - from) {
+        count = this->count - from;
+    }
+
+    double total = 0;
+
+    uint32_t pos = this->physical(from);
+    uint32_t next = (pos + 1) % this->capacity;
+
+    for (uint32_t i = 1; i < count; i++) {
+        uint64_t elapsed = this->timeColumn[next] - this->timeColumn[pos];
+
+        total += (this->columns[SmartMeter238::SM_FIELD_ACTIVEPOWER][pos] + this->columns[SmartMeter238::SM_FIELD_ACTIVEPOWER][next]) * 0.5 * elapsed;
+
+        pos = next;
+        next = (next + 1) % this->capacity;
+    }
+
+    return total / 3600000000.0;   // micros to hours
+}
+
+uint32_t SmartMeter238History::downsample(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count, smPoint *points, uint32_t maxPoints) {
+    if (from >= this->count || maxPoints == 0) {
+        return 0;
+    }
+
+    if (count > this->count - from) {
+        count = this->count - from;
+    }
+
+    float *column = this->columns[field];
+
+    if (count <= maxPoints || maxPoints < 3) {
+        count = min(count, maxPoints);
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t pos = this->physical(from + i);
+
+            points[i].time = this->timeColumn[pos];
+            points[i].value = column[pos];
+        }
+
+        return count;
+    }
+
+    // First and last points are kept, the others are split in maxPoints - 2 buckets. Of every bucket the point
+    // with the largest triangle with the point taken before and the average of the next bucket is taken.
+    double every = (double)(count - 2) / (maxPoints - 2);
+    uint64_t origin = this->timeColumn[this->physical(from)];
+
+    uint32_t selected = 0;
+    uint32_t pos = this->physical(from);
+
+    points[0].time = this->timeColumn[pos];
+    points[0].value = column[pos];
+
+    for (uint32_t i = 0; i < maxPoints - 2; i++) {
+        uint32_t start = (uint32_t)(i * every) + 1;
+        uint32_t end = (uint32_t)((i + 1) * every) + 1;
+
+        // Average of the next bucket, the last point for the last bucket
+        uint32_t nextStart = end;
+        uint32_t nextEnd = min((uint32_t)((i + 2) * every) + 1, count);
+
+        if (i == maxPoints - 3) {
+            nextStart = count - 1;
+            nextEnd = count;
+        }
+
+        double avgValue = this->sum(field, from + nextStart, nextEnd - nextStart) / (nextEnd - nextStart);
+        double avgTime = ((double)(this->timeColumn[this->physical(from + nextStart)] - origin) + (double)(this->timeColumn[this->physical(from + nextEnd - 1)] - origin)) * 0.5;
+
+        pos = this->physical(from + selected);
+
+        double aTime = (double)(this->timeColumn[pos] - origin);
+        double aValue = column[pos];
+
+        double maxArea = -1;
+
+        pos = this->physical(from + start);
+
+        for (uint32_t j = start; j < end; j++) {
+            double area = fabs(((aTime - avgTime) * (column[pos] - aValue)) - ((aTime - (double)(this->timeColumn[pos] - origin)) * (avgValue - aValue)));
+
+            if (area > maxArea) {
+                maxArea = area;
+                selected = j;
+            }
+
+            pos = (pos + 1 == this->capacity) ? 0 : pos + 1;
+        }
+
+        pos = this->physical(from + selected);
+
+        points[i + 1].time = this->timeColumn[pos];
+        points[i + 1].value = column[pos];
+    }
+
+    pos = this->physical(from + count - 1);
+
+    points[maxPoints - 1].time = this->timeColumn[pos];
+    points[maxPoints - 1].value = column[pos];
+
+    return maxPoints;
+}
+
+uint32_t SmartMeter238History::envelope(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count, smEnvelope *buckets, uint32_t maxBuckets) {
+    if (from >= this->count || maxBuckets == 0) {
+        return 0;
+    }
+
+    if (count > this->count - from) {
+        count = this->count - from;
+    }
+
+    uint32_t total = min(count, maxBuckets);
+
+    for (uint32_t i = 0; i < total; i++) {
+        uint32_t start = (uint32_t)(((uint64_t)i * count) / total);
+        uint32_t end = (uint32_t)(((uint64_t)(i + 1) * count) / total);
+
+        buckets[i].time = this->timeColumn[this->physical(from + start)];
+
+        this->minMax(field, from + start, end - start, &buckets[i].min, &buckets[i].max);
+    }
+
+    return total;
+}
+
+void SmartMeter238History::onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) {
+    if (cmd == SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA) {
+        sm.decodeMeasurementFields(dataObject);   // every column
+
+        this->append(dataObject);
+    }
+}
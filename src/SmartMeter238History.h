@@ -0,0 +1,94 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238History_h
+#define SmartMeter238History_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+// History of measurements stored by column (one array per field plus the time), so a scan of one field
+// only reads that field. It is a ring buffer, index 0 is the oldest sample. The kernels use SSE/AVX when
+// the target has them.
+class SmartMeter238History : public SmartMeter238Observer {
+   public:
+    typedef struct {
+        uint64_t time;
+        float value;
+    } smPoint;
+
+    typedef struct {
+        uint64_t time;   // first sample of the bucket
+        float min;
+        float max;
+    } smEnvelope;
+
+    SmartMeter238History(uint32_t capacity);
+    virtual ~SmartMeter238History();
+
+    bool isReady();
+    void clear();
+
+    void append(SmartMeter238::smartMeterData *dataObject);
+
+    uint32_t getCount();
+    uint32_t getCapacity();
+
+    uint64_t getTime(uint32_t index);   // timestamp, micros
+    float getValue(SmartMeter238::smMeasurementField field, uint32_t index);
+
+    bool getRange(uint64_t fromTime, uint64_t toTime, uint32_t *from, uint32_t *count);
+
+    double sum(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count);
+    float mean(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count);
+    bool minMax(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count, float *min, float *max);
+    uint32_t countAbove(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count, float threshold);
+    uint32_t countBelow(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count, float threshold);
+    double energy(uint32_t from, uint32_t count);
+
+    // Range reduced to a number of points for charts, written straight to the caller buffer. downsample() keeps
+    // the shape (largest triangle three buckets), envelope() the min and max of equal buckets. Both return the
+    // points written, the whole range when it fits.
+    uint32_t downsample(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count, smPoint *points, uint32_t maxPoints);
+    uint32_t envelope(SmartMeter238::smMeasurementField field, uint32_t from, uint32_t count, smEnvelope *buckets, uint32_t maxBuckets);
+
+    void onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) override;
+
+   private:
+    uint32_t capacity;
+    uint32_t head = 0;   // next position to write
+    uint32_t count = 0;
+
+    float *columns[SmartMeter238::SM_FIELD_COUNT];
+    uint64_t *timeColumn = nullptr;
+
+    uint32_t physical(uint32_t index);
+    uint8_t segments(uint32_t from, uint32_t count, uint32_t *start, uint32_t *length);
+};
+#endif   // SmartMeter238History_h
@@ -0,0 +1,268 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238LoadSteps.h"
+//------------------------------------------------------------------------------
+
+#define SM_LOAD_ACTIVE_POWER 0
+#define SM_LOAD_REACTIVE_POWER 1
+#define SM_LOAD_CURRENT 2
+
+#define SM_LOAD_BASELINE_SHIFT 3   // 1/8 of the difference, slow drift of the stable level
+
+SmartMeter238LoadSteps::SmartMeter238LoadSteps() {
+    this->clearSignatures();
+}
+
+void SmartMeter238LoadSteps::setMinStep(float activePower) {
+    this->minStep = fabsf(activePower);
+}
+
+void SmartMeter238LoadSteps::setDebounce(uint8_t count) {
+    this->debounce = max((uint8_t)1, count);
+}
+
+void SmartMeter238LoadSteps::setTolerance(float tolerance) {
+    this->tolerance = fabsf(tolerance);
+}
+
+void SmartMeter238LoadSteps::setCallback(smLoadCallback callback, void *context) {
+    this->callback = callback;
+    this->context = context;
+}
+
+uint8_t SmartMeter238LoadSteps::getSignatureCount() {
+    return this->signatureCount;
+}
+
+bool SmartMeter238LoadSteps::getSignature(uint8_t index, smSignature *signature) {
+    if (index >= this->signatureCount) {
+        return false;
+    }
+
+    *signature = this->signatures[index];
+
+    return true;
+}
+
+void SmartMeter238LoadSteps::clearSignatures() {
+    for (uint8_t i = 0; i < SM_LOAD_MAX_SIGNATURES; i++) {
+        this->signatures[i] = {};
+    }
+
+    this->signatureCount = 0;
+}
+
+int8_t SmartMeter238LoadSteps::match(float *delta, bool onlyRunning) {
+    int8_t best = -1;
+    float bestDistance = 0;
+
+    for (uint8_t i = 0; i < this->signatureCount; i++) {
+        smSignature &signature = this->signatures[i];
+
+        if (onlyRunning && !signature.on) {
+            continue;
+        }
+
+        float distance = fabsf(delta[SM_LOAD_ACTIVE_POWER] - signature.activePower) + fabsf(delta[SM_LOAD_REACTIVE_POWER] - signature.reactivePower);
+        float limit = this->tolerance * max(signature.activePower, this->minStep);
+
+        if (distance <= limit && (best < 0 || distance < bestDistance)) {
+            best = i;
+            bestDistance = distance;
+        }
+    }
+
+    return best;
+}
+
+int8_t SmartMeter238LoadSteps::learn(float *delta) {
+    int8_t index = this->match(delta, false);
+
+    if (index < 0) {
+        if (this->signatureCount < SM_LOAD_MAX_SIGNATURES) {
+            index = this->signatureCount++;
+        } else {
+            // Table full, replace the least seen signature that is not running
+            for (uint8_t i = 0; i < SM_LOAD_MAX_SIGNATURES; i++) {
+                if (!this->signatures[i].on && (index < 0 || this->signatures[i].runCount < this->signatures[index].runCount)) {
+                    index = i;
+                }
+            }
+
+            if (index < 0) {
+                return -1;   // every load is running, none can be forgotten
+            }
+        }
+
+        this->signatures[index] = {};
+    }
+
+    smSignature &signature = this->signatures[index];
+
+    if (signature.learnCount < SM_LOAD_MAX_LEARN_COUNT) {
+        signature.learnCount++;
+    }
+
+    float weight = 1.0f / signature.learnCount;
+
+    signature.activePower += (delta[SM_LOAD_ACTIVE_POWER] - signature.activePower) * weight;
+    signature.reactivePower += (delta[SM_LOAD_REACTIVE_POWER] - signature.reactivePower) * weight;
+    signature.current += (delta[SM_LOAD_CURRENT] - signature.current) * weight;
+
+    return index;
+}
+
+void SmartMeter238LoadSteps::step(float *delta, uint64_t time) {
+    smLoadEvent event;
+
+    event.deltaActivePower = delta[SM_LOAD_ACTIVE_POWER];
+    event.deltaReactivePower = delta[SM_LOAD_REACTIVE_POWER];
+    event.deltaCurrent = delta[SM_LOAD_CURRENT];
+    event.time = time;
+    event.duration = 0;
+    event.energy = 0;
+
+    if (delta[SM_LOAD_ACTIVE_POWER] > 0) {
+        int8_t index = this->learn(delta);
+
+        if (index < 0) {
+            return;   // no room to learn it, the step is dropped
+        }
+
+        smSignature &signature = this->signatures[index];
+
+        signature.on = true;
+        signature.onTime = time;
+
+        event.type = SM_LOAD_ON;
+        event.signature = index;
+    } else {
+        float rise[3] = {-delta[SM_LOAD_ACTIVE_POWER], -delta[SM_LOAD_REACTIVE_POWER], -delta[SM_LOAD_CURRENT]};
+
+        // A load that is running explains the drop better than any other
+        int8_t index = this->match(rise, true);
+
+        if (index < 0) {
+            index = this->match(rise, false);
+        }
+
+        if (index < 0) {
+            return;   // unknown load, it was running before the detector started
+        }
+
+        smSignature &signature = this->signatures[index];
+
+        event.type = SM_LOAD_OFF;
+        event.signature = index;
+
+        if (signature.on) {
+            event.duration = time - signature.onTime;
+            event.energy = signature.activePower * (event.duration / 3600000000.0);   // micros to hours
+
+            signature.on = false;
+            signature.runCount++;
+            signature.totalEnergy += event.energy;
+        }
+    }
+
+    if (this->callback != nullptr) {
+        this->callback(event, this->context);
+    }
+}
+
+void SmartMeter238LoadSteps::update(SmartMeter238::smartMeterData *dataObject) {
+    float sample[3] = {dataObject->measurementData.data.activePower, dataObject->measurementData.data.reactivePower, dataObject->measurementData.data.current};
+    uint64_t time = dataObject->measurementData.timestamp;
+
+    if (!this->started) {
+        for (uint8_t i = 0; i < 3; i++) {
+            this->baseline[i] = sample[i];
+        }
+
+        this->started = true;
+
+        return;
+    }
+
+    bool away = fabsf(sample[SM_LOAD_ACTIVE_POWER] - this->baseline[SM_LOAD_ACTIVE_POWER]) > this->minStep;
+
+    if (!this->changing) {
+        if (!away) {
+            for (uint8_t i = 0; i < 3; i++) {
+                this->baseline[i] += (sample[i] - this->baseline[i]) / (1 << SM_LOAD_BASELINE_SHIFT);
+            }
+
+            return;
+        }
+
+        this->changing = true;
+        this->candidateCount = 0;
+    } else if (!away) {
+        this->changing = false;   // spike, back to the stable level
+
+        return;
+    } else if (fabsf(sample[SM_LOAD_ACTIVE_POWER] - this->candidate[SM_LOAD_ACTIVE_POWER]) > this->tolerance * max(fabsf(this->candidate[SM_LOAD_ACTIVE_POWER] - this->baseline[SM_LOAD_ACTIVE_POWER]), this->minStep)) {
+        this->candidateCount = 0;   // still moving, restart on the new level
+    }
+
+    // Average of the new level while it is being confirmed
+    this->candidateCount++;
+
+    for (uint8_t i = 0; i < 3; i++) {
+        if (this->candidateCount == 1) {
+            this->candidate[i] = sample[i];
+        } else {
+            this->candidate[i] += (sample[i] - this->candidate[i]) / this->candidateCount;
+        }
+    }
+
+    if (this->candidateCount < this->debounce) {
+        return;
+    }
+
+    float delta[3];
+
+    for (uint8_t i = 0; i < 3; i++) {
+        delta[i] = this->candidate[i] - this->baseline[i];
+        this->baseline[i] = this->candidate[i];
+    }
+
+    this->changing = false;
+
+    this->step(delta, time);
+}
+
+void SmartMeter238LoadSteps::onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) {
+    if (cmd == SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA) {
+        sm.decodeMeasurementFields(dataObject, SM_FIELD_BIT(SmartMeter238::SM_FIELD_ACTIVEPOWER) | SM_FIELD_BIT(SmartMeter238::SM_FIELD_REACTIVEPOWER) | SM_FIELD_BIT(SmartMeter238::SM_FIELD_CURRENT));
+
+        this->update(dataObject);
+    }
+}
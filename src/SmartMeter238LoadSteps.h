@@ -0,0 +1,112 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238LoadSteps_h
+#define SmartMeter238LoadSteps_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+// Detection of loads switching on and off from steps in activePower, reactivePower and current. A step is
+// accepted when the new level holds for the debounce count. Steps are matched with a small table of appliance
+// signatures that is learned on the fly, every on/off is reported with the energy of the run.
+// Memory is fixed and the work per measurement is bounded by SM_LOAD_MAX_SIGNATURES.
+class SmartMeter238LoadSteps : public SmartMeter238Observer {
+   public:
+    enum smLoadEventType {
+        SM_LOAD_ON,
+        SM_LOAD_OFF
+    };
+
+    typedef struct {
+        smLoadEventType type;
+        uint8_t signature;
+
+        float deltaActivePower;
+        float deltaReactivePower;
+        float deltaCurrent;
+
+        uint64_t time;       // timestamp of the measurement that confirmed the step, micros
+        uint64_t duration;   // micros, off only
+        float energy;             // kWh, off only
+    } smLoadEvent;
+
+    typedef struct {
+        float activePower;
+        float reactivePower;
+        float current;
+
+        uint16_t learnCount;
+        uint32_t runCount;
+        float totalEnergy;   // kWh
+
+        bool on;
+        uint64_t onTime;
+    } smSignature;
+
+    typedef void (*smLoadCallback)(const smLoadEvent &event, void *context);
+
+    SmartMeter238LoadSteps();
+
+    void setMinStep(float activePower);
+    void setDebounce(uint8_t count);
+    void setTolerance(float tolerance);
+    void setCallback(smLoadCallback callback, void *context = nullptr);
+
+    uint8_t getSignatureCount();
+    bool getSignature(uint8_t index, smSignature *signature);
+    void clearSignatures();
+
+    void update(SmartMeter238::smartMeterData *dataObject);
+
+    void onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) override;
+
+   private:
+    float minStep = SM_LOAD_DEFAULT_MIN_STEP;
+    uint8_t debounce = SM_LOAD_DEFAULT_DEBOUNCE;
+    float tolerance = SM_LOAD_DEFAULT_TOLERANCE;
+
+    smLoadCallback callback = nullptr;
+    void *context = nullptr;
+
+    bool started = false;
+    bool changing = false;
+    uint8_t candidateCount = 0;
+
+    float baseline[3];    // activePower, reactivePower, current
+    float candidate[3];
+
+    smSignature signatures[SM_LOAD_MAX_SIGNATURES];
+    uint8_t signatureCount = 0;
+
+    void step(float *delta, uint64_t time);
+    int8_t match(float *delta, bool onlyRunning);
+    int8_t learn(float *delta);
+};
+#endif   // SmartMeter238LoadSteps_h
@@ -0,0 +1,255 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Modbus.h"
+//------------------------------------------------------------------------------
+
+// Registers of the measurement read, 16 bits big endian
+#define SM_MODBUS_REG_TOTALENERGY 0x00    // 32 bits, 0.01 kWh
+#define SM_MODBUS_REG_EXPORTENERGY 0x08   // 32 bits, 0.01 kWh
+#define SM_MODBUS_REG_IMPORTENERGY 0x0A   // 32 bits, 0.01 kWh
+#define SM_MODBUS_REG_VOLTAGE 0x0C        // 0.1 V
+#define SM_MODBUS_REG_CURRENT 0x0D        // 0.01 A
+#define SM_MODBUS_REG_ACTIVEPOWER 0x0E    // signed, W
+#define SM_MODBUS_REG_REACTIVEPOWER 0x0F  // signed, var
+#define SM_MODBUS_REG_POWERFACTOR 0x10    // 0.001
+#define SM_MODBUS_REG_FREQUENCY 0x11      // 0.01 Hz
+
+// CRC-16/MODBUS (polynomial 0xA001 reflected), one lookup per byte
+static const uint16_t smModbusCRCTable[256] PROGMEM = {
+    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
+    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
+    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
+    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
+    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
+    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
+    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
+    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
+    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
+    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
+    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
+    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
+    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
+    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
+    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
+    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
+    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
+    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
+    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
+    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
+    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
+    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
+    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
+    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
+    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
+    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
+    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
+    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
+    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
+    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
+    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
+    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040
+};
+
+SmartMeter238ModbusCodec::SmartMeter238ModbusCodec(uint8_t address) : address(address) {}
+
+void SmartMeter238ModbusCodec::setAddress(uint8_t address) {
+    this->address = address;
+}
+
+uint8_t SmartMeter238ModbusCodec::getAddress() {
+    return this->address;
+}
+
+uint8_t SmartMeter238ModbusCodec::getExceptionCode() {
+    return this->exceptionCode;
+}
+
+uint8_t SmartMeter238ModbusCodec::encodeRequest(SmartMeter238::smCommandTransmit cmd, uint8_t *payload, uint8_t *frame) {
+    (void)payload;   // no set command
+
+    if (cmd != SmartMeter238::SM_CMD_GET_MEASUREMENTDATA) {
+        return 0;
+    }
+
+    // Every field in one request
+    frame[0] = this->address;
+    frame[1] = SM_MODBUS_READ_HOLDING_REGISTERS;
+    frame[2] = (SM_MODBUS_MEASUREMENT_REGISTER >> 8);
+    frame[3] = (SM_MODBUS_MEASUREMENT_REGISTER & SM_GET_ONE_BYTE);
+    frame[4] = (SM_MODBUS_MEASUREMENT_COUNT >> 8);
+    frame[5] = (SM_MODBUS_MEASUREMENT_COUNT & SM_GET_ONE_BYTE);
+
+    uint16_t crc = SmartMeter238ModbusCodec::calculateCRC(frame, 6);
+
+    frame[6] = (crc & SM_GET_ONE_BYTE);   // low byte first
+    frame[7] = (crc >> 8);
+
+    return 8;
+}
+
+bool SmartMeter238ModbusCodec::isEchoed() {
+    return false;
+}
+
+SmartMeter238::smErrorCode SmartMeter238ModbusCodec::checkEcho(uint8_t *request, uint8_t *frame, uint8_t size) {
+    (void)request;
+    (void)frame;
+    (void)size;
+
+    return SmartMeter238::SM_ERR_NO_ERROR;
+}
+
+uint8_t SmartMeter238ModbusCodec::getAnswerSize(SmartMeter238::smCommandReceive cmd) {
+    if (cmd != SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA) {
+        return 0;
+    }
+
+    return 3 + (SM_MODBUS_MEASUREMENT_COUNT * 2) + 2;   // address, function, byte count, registers, crc
+}
+
+SmartMeter238::smErrorCode SmartMeter238ModbusCodec::checkAnswer(SmartMeter238::smCommandReceive cmd, uint8_t *frame, uint8_t size) {
+    (void)cmd;   // only the measurement is read
+
+    if (this->isException(frame, SM_MODBUS_EXCEPTION_SIZE)) {
+        return SmartMeter238::SM_ERR_METER_EXCEPTION;
+    }
+
+    if (frame[0] != this->address || frame[1] != SM_MODBUS_READ_HOLDING_REGISTERS || frame[2] != (size - 5)) {
+        return SmartMeter238::SM_ERR_WRONG_BYTES;
+    }
+
+    uint16_t crc = SmartMeter238ModbusCodec::calculateCRC(frame, size - 2);
+
+    if (frame[size - 2] != (crc & SM_GET_ONE_BYTE) || frame[size - 1] != (crc >> 8)) {
+        return SmartMeter238::SM_ERR_CRC_ERROR;
+    }
+
+    return SmartMeter238::SM_ERR_NO_ERROR;
+}
+
+SmartMeter238::smErrorCode SmartMeter238ModbusCodec::checkShortAnswer(SmartMeter238::smCommandReceive cmd, uint8_t *frame, uint8_t size) {
+    (void)cmd;
+
+    if (size == SM_MODBUS_EXCEPTION_SIZE && this->isException(frame, size)) {
+        return SmartMeter238::SM_ERR_METER_EXCEPTION;
+    }
+
+    return SmartMeter238::SM_ERR_NOT_ENOUGHT_BYTES;
+}
+
+bool SmartMeter238ModbusCodec::isException(uint8_t *frame, uint8_t size) {
+    if (frame[0] != this->address || frame[1] != (SM_MODBUS_READ_HOLDING_REGISTERS | SM_MODBUS_EXCEPTION)) {
+        return false;
+    }
+
+    uint16_t crc = SmartMeter238ModbusCodec::calculateCRC(frame, size - 2);
+
+    if (frame[size - 2] != (crc & SM_GET_ONE_BYTE) || frame[size - 1] != (crc >> 8)) {
+        return false;
+    }
+
+    this->exceptionCode = frame[2];
+
+    return true;
+}
+
+void SmartMeter238ModbusCodec::decodeAnswer(SmartMeter238::smCommandReceive cmd, uint8_t *frame, SmartMeter238::smartMeterData *dataObject) {
+    if (cmd != SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA) {
+        return;
+    }
+
+    this->decodeField(SmartMeter238::SM_FIELD_CURRENT, frame, &dataObject->measurementData.data.current);
+    this->decodeField(SmartMeter238::SM_FIELD_VOLTAGE, frame, &dataObject->measurementData.data.voltage);
+    this->decodeField(SmartMeter238::SM_FIELD_FREQUENCY, frame, &dataObject->measurementData.data.frequency);
+
+    this->decodeField(SmartMeter238::SM_FIELD_REACTIVEPOWER, frame, &dataObject->measurementData.data.reactivePower);
+    this->decodeField(SmartMeter238::SM_FIELD_ACTIVEPOWER, frame, &dataObject->measurementData.data.activePower);
+    this->decodeField(SmartMeter238::SM_FIELD_POWERFACTOR, frame, &dataObject->measurementData.data.powerFactor);
+
+    this->decodeField(SmartMeter238::SM_FIELD_TOTALENERGY, frame, &dataObject->measurementData.data.lapseOfTimeTotalEnergy);
+    this->decodeField(SmartMeter238::SM_FIELD_IMPORTENERGY, frame, &dataObject->measurementData.data.lapseOfTimeImportEnergy);
+    this->decodeField(SmartMeter238::SM_FIELD_EXPORTENERGY, frame, &dataObject->measurementData.data.lapseOfTimeExportEnergy);
+}
+
+bool SmartMeter238ModbusCodec::decodeField(SmartMeter238::smMeasurementField field, uint8_t *frame, float *value) {
+    uint8_t *reg = frame + 3;
+
+#define SM_MODBUS_U16(r) ((uint16_t)((reg[(r) * 2] << 8) | reg[((r) * 2) + 1]))
+#define SM_MODBUS_U32(r) (((uint32_t)SM_MODBUS_U16(r) << 16) | SM_MODBUS_U16((r) + 1))
+
+    bool decoded = true;
+
+    switch (field) {
+        case SmartMeter238::SM_FIELD_CURRENT:
+            *value = SM_MODBUS_U16(SM_MODBUS_REG_CURRENT) * 0.01;
+            break;
+        case SmartMeter238::SM_FIELD_VOLTAGE:
+            *value = SM_MODBUS_U16(SM_MODBUS_REG_VOLTAGE) * 0.1;
+            break;
+        case SmartMeter238::SM_FIELD_FREQUENCY:
+            *value = SM_MODBUS_U16(SM_MODBUS_REG_FREQUENCY) * 0.01;
+            break;
+        case SmartMeter238::SM_FIELD_REACTIVEPOWER:
+            *value = (int16_t)SM_MODBUS_U16(SM_MODBUS_REG_REACTIVEPOWER) * 0.001;   // kvar
+            break;
+        case SmartMeter238::SM_FIELD_ACTIVEPOWER:
+            *value = (int16_t)SM_MODBUS_U16(SM_MODBUS_REG_ACTIVEPOWER) * 0.001;   // kW
+            break;
+        case SmartMeter238::SM_FIELD_POWERFACTOR:
+            *value = SM_MODBUS_U16(SM_MODBUS_REG_POWERFACTOR) * 0.001;
+            break;
+        case SmartMeter238::SM_FIELD_TOTALENERGY:
+            *value = SM_MODBUS_U32(SM_MODBUS_REG_TOTALENERGY) * 0.01;
+            break;
+        case SmartMeter238::SM_FIELD_IMPORTENERGY:
+            *value = SM_MODBUS_U32(SM_MODBUS_REG_IMPORTENERGY) * 0.01;
+            break;
+        case SmartMeter238::SM_FIELD_EXPORTENERGY:
+            *value = SM_MODBUS_U32(SM_MODBUS_REG_EXPORTENERGY) * 0.01;
+            break;
+        default:
+            decoded = false;
+    }
+
+#undef SM_MODBUS_U16
+#undef SM_MODBUS_U32
+
+    return decoded;
+}
+
+uint16_t SmartMeter238ModbusCodec::calculateCRC(uint8_t *array, uint8_t size) {
+    uint16_t crc = 0xFFFF;
+
+    for (uint8_t n = 0; n < size; n++) {
+        crc = (crc >> 8) ^ pgm_read_word(&smModbusCRCTable[(crc ^ array[n]) & SM_GET_ONE_BYTE]);
+    }
+
+    return crc;
+}
@@ -0,0 +1,68 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Modbus_h
+#define SmartMeter238Modbus_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238Codec.h"
+
+// Modbus-RTU protocol of DDS238-1 ZN and DDS238-2 ZN meters. The measurement is one read of the holding registers
+// 0x0000 to 0x0011, the answer fills the same measurementData as the DDS238-4. The meter has no relay or prepaid
+// energy, those commands fail with SM_ERR_NOT_SUPPORTED. An exception answer fails with SM_ERR_METER_EXCEPTION,
+// its code is kept in getExceptionCode().
+class SmartMeter238ModbusCodec : public SmartMeter238Codec {
+   public:
+    SmartMeter238ModbusCodec(uint8_t address = SM_MODBUS_DEFAULT_ADDRESS);
+
+    void setAddress(uint8_t address);
+    uint8_t getAddress();
+
+    uint8_t getExceptionCode();   // of the last exception answer, 0 if none
+
+    uint8_t encodeRequest(SmartMeter238::smCommandTransmit cmd, uint8_t *payload, uint8_t *frame) override;
+
+    bool isEchoed() override;
+    SmartMeter238::smErrorCode checkEcho(uint8_t *request, uint8_t *frame, uint8_t size) override;
+
+    uint8_t getAnswerSize(SmartMeter238::smCommandReceive cmd) override;
+    SmartMeter238::smErrorCode checkAnswer(SmartMeter238::smCommandReceive cmd, uint8_t *frame, uint8_t size) override;
+    SmartMeter238::smErrorCode checkShortAnswer(SmartMeter238::smCommandReceive cmd, uint8_t *frame, uint8_t size) override;
+    void decodeAnswer(SmartMeter238::smCommandReceive cmd, uint8_t *frame, SmartMeter238::smartMeterData *dataObject) override;
+    bool decodeField(SmartMeter238::smMeasurementField field, uint8_t *frame, float *value) override;
+
+    static uint16_t calculateCRC(uint8_t *array, uint8_t size);
+
+   private:
+    uint8_t address;
+    uint8_t exceptionCode = 0;
+
+    bool isException(uint8_t *frame, uint8_t size);
+};
+#endif   // SmartMeter238Modbus_h
@@ -0,0 +1,85 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Model_h
+#define SmartMeter238Model_h
+//------------------------------------------------------------------------------
+
+// Meter model traits, included by SmartMeter238.h. The model is chosen at compile time with SM_METER_MODEL, the
+// decoder only reads constants from the traits so each build contains the layout of one model.
+//
+// The measurement frame has room for three phases: current and voltage of phases A, B, C, then total, A, B, C
+// for reactive power, active power and power factor. DDS238-4 only fills phase A and the totals.
+
+// Measurement frame, offsets of the first byte
+struct SmartMeter238ModelDDS238_4 {
+    static constexpr uint8_t phases = 1;
+
+    static constexpr uint8_t measurementFrameSize = SM_FRAMESIZE_MSG_RESP_MEASUREMENTDATA;
+
+    static constexpr uint8_t currentOffset = 5;    // 3 bytes by phase, 0.001 A
+    static constexpr uint8_t voltageOffset = 14;   // 2 bytes by phase, 0.1 V
+
+    static constexpr uint8_t reactivePowerOffset = 20;   // 3 bytes, total then by phase, kW + 0.0001
+    static constexpr uint8_t activePowerOffset = 32;     // 3 bytes, total then by phase, kW + 0.0001
+    static constexpr uint8_t powerFactorOffset = 44;     // 2 bytes, total then by phase, 0.001
+
+    static constexpr uint8_t frequencyOffset = 52;       // 2 bytes, 0.01 Hz
+    static constexpr uint8_t totalEnergyOffset = 54;     // 4 bytes, 0.01 kWh
+    static constexpr uint8_t importEnergyOffset = 58;
+    static constexpr uint8_t exportEnergyOffset = 62;
+};
+
+// Same frame with the three phases filled. Unverified: no frame of a real meter has been captured, the layout
+// comes from the empty phase slots of DDS238-4
+struct SmartMeter238ModelDTS238_7 : SmartMeter238ModelDDS238_4 {
+    static constexpr uint8_t phases = 3;
+};
+
+#define SM_METER_MODEL_DDS238_4 1
+#define SM_METER_MODEL_DTS238_7 2
+
+#ifndef SM_METER_MODEL
+#define SM_METER_MODEL SM_METER_MODEL_DDS238_4
+#endif
+
+#if SM_METER_MODEL == SM_METER_MODEL_DTS238_7
+#define SM_METER_PHASES 3
+typedef SmartMeter238ModelDTS238_7 SmartMeter238MeterModel;
+#elif SM_METER_MODEL == SM_METER_MODEL_DDS238_4
+#define SM_METER_PHASES 1
+typedef SmartMeter238ModelDDS238_4 SmartMeter238MeterModel;
+#else
+#error "Unknown SM_METER_MODEL"
+#endif
+
+static_assert(SmartMeter238MeterModel::phases == SM_METER_PHASES, "SM_METER_PHASES does not match the meter model");
+static_assert(SmartMeter238MeterModel::exportEnergyOffset + 4 < SmartMeter238MeterModel::measurementFrameSize, "Measurement frame too short for the meter model");
+
+#endif   // SmartMeter238Model_h
@@ -0,0 +1,283 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238NetSerial.h"
+//------------------------------------------------------------------------------
+
+// Telnet (RFC854) and COM-PORT-OPTION (RFC2217)
+#define SM_TELNET_SE 240
+#define SM_TELNET_SB 250
+#define SM_TELNET_WILL 251
+#define SM_TELNET_WONT 252
+#define SM_TELNET_DO 253
+#define SM_TELNET_DONT 254
+#define SM_TELNET_IAC 255
+
+#define SM_TELNET_OPTION_BINARY 0
+#define SM_TELNET_OPTION_SGA 3
+#define SM_TELNET_OPTION_COM_PORT 44
+
+#define SM_COM_PORT_SET_BAUDRATE 1
+#define SM_COM_PORT_SET_DATASIZE 2
+#define SM_COM_PORT_SET_PARITY 3
+#define SM_COM_PORT_SET_STOPSIZE 4
+
+#define SM_COM_PORT_PARITY_NONE 1
+#define SM_COM_PORT_STOPSIZE_1 1
+
+SmartMeter238NetSerial::SmartMeter238NetSerial(Client &client, smNetMode mode, uint32_t baud) : client(client), mode(mode), baud(baud) {
+}
+
+#if defined(ESP8266) || defined(ESP32)
+SmartMeter238NetSerial::SmartMeter238NetSerial(WiFiClient &client, smNetMode mode, uint32_t baud) : SmartMeter238NetSerial((Client &)client, mode, baud) {
+    this->wifiClient = &client;
+}
+#endif
+
+bool SmartMeter238NetSerial::isConnected() {
+    return this->client.connected();
+}
+
+int SmartMeter238NetSerial::available() {
+    this->poll();
+
+    return (this->rxHead - this->rxTail) & (SM_NET_RX_BUFFER - 1);
+}
+
+int SmartMeter238NetSerial::read() {
+    this->poll();
+
+    if (this->rxHead == this->rxTail) {
+        return -1;
+    }
+
+    uint8_t data = this->rxBuffer[this->rxTail];
+
+    this->rxTail = (this->rxTail + 1) & (SM_NET_RX_BUFFER - 1);
+
+    return data;
+}
+
+int SmartMeter238NetSerial::peek() {
+    this->poll();
+
+    return (this->rxHead == this->rxTail) ? -1 : this->rxBuffer[this->rxTail];
+}
+
+void SmartMeter238NetSerial::flush() {
+    // The frame goes out in one segment. Client::flush() is not called, on some cores it drops the input
+    if (this->txSize > 0 && this->client.connected()) {
+        this->client.write(this->txBuffer, this->txSize);
+    }
+
+    this->txSize = 0;
+}
+
+size_t SmartMeter238NetSerial::write(uint8_t data) {
+    return this->write(&data, 1);
+}
+
+size_t SmartMeter238NetSerial::write(const uint8_t *buffer, size_t size) {
+    this->poll();
+
+    if (!this->connected) {
+        return 0;
+    }
+
+    for (size_t n = 0; n < size; n++) {
+        this->queue(buffer[n]);
+    }
+
+    return size;
+}
+
+void SmartMeter238NetSerial::poll() {
+    bool connected = this->client.connected();
+
+    if (connected != this->connected) {
+        // New connection or lost one, nothing pending is valid anymore
+        this->connected = connected;
+
+        this->rxHead = 0;
+        this->rxTail = 0;
+        this->txSize = 0;
+        this->telnetState = SM_TELNET_STATE_DATA;
+
+        if (connected) {
+#if defined(ESP8266) || defined(ESP32)
+            if (this->wifiClient != nullptr) {
+                this->wifiClient->setNoDelay(true);
+            }
+#endif
+
+            if (this->mode == SM_NET_TELNET) {
+                this->negotiate();
+            }
+        }
+    }
+
+    if (!connected) {
+        return;
+    }
+
+    int count = this->client.available();
+
+    // Never more than the free space, a telnet command only makes the data shorter
+    int space = (SM_NET_RX_BUFFER - 1) - ((this->rxHead - this->rxTail) & (SM_NET_RX_BUFFER - 1));
+
+    while (count > 0 && space > 0) {
+        uint8_t chunk[32];
+        int size = this->client.read(chunk, min(min(count, space), (int)sizeof(chunk)));
+
+        if (size <= 0) {
+            break;
+        }
+
+        for (int n = 0; n < size; n++) {
+            this->decode(chunk[n]);
+        }
+
+        count -= size;
+        space -= size;
+    }
+}
+
+void SmartMeter238NetSerial::decode(uint8_t data) {
+    if (this->mode == SM_NET_RAW) {
+        this->store(data);
+
+        return;
+    }
+
+    switch (this->telnetState) {
+        case SM_TELNET_STATE_DATA:
+            if (data == SM_TELNET_IAC) {
+                this->telnetState = SM_TELNET_STATE_IAC;
+            } else {
+                this->store(data);
+            }
+            break;
+
+        case SM_TELNET_STATE_IAC:
+            if (data == SM_TELNET_IAC) {
+                this->store(data);
+                this->telnetState = SM_TELNET_STATE_DATA;
+            } else if (data >= SM_TELNET_WILL) {
+                this->telnetCommand = data;
+                this->telnetState = SM_TELNET_STATE_OPTION;
+            } else if (data == SM_TELNET_SB) {
+                this->telnetState = SM_TELNET_STATE_SUBNEGOTIATION;
+            } else {
+                this->telnetState = SM_TELNET_STATE_DATA;
+            }
+            break;
+
+        case SM_TELNET_STATE_OPTION:
+            // Only binary, suppress go ahead and the port options are accepted, they were asked for
+            if (this->telnetCommand == SM_TELNET_DO && data != SM_TELNET_OPTION_BINARY && data != SM_TELNET_OPTION_SGA && data != SM_TELNET_OPTION_COM_PORT) {
+                this->sendOption(SM_TELNET_WONT, data);
+            } else if (this->telnetCommand == SM_TELNET_WILL && data != SM_TELNET_OPTION_BINARY && data != SM_TELNET_OPTION_SGA) {
+                this->sendOption(SM_TELNET_DONT, data);
+            }
+
+            this->telnetState = SM_TELNET_STATE_DATA;
+            break;
+
+        case SM_TELNET_STATE_SUBNEGOTIATION:
+            // Answers and notifications of the port server are not used
+            if (data == SM_TELNET_IAC) {
+                this->telnetState = SM_TELNET_STATE_SUBNEGOTIATION_IAC;
+            }
+            break;
+
+        case SM_TELNET_STATE_SUBNEGOTIATION_IAC:
+            this->telnetState = (data == SM_TELNET_SE) ? SM_TELNET_STATE_DATA : SM_TELNET_STATE_SUBNEGOTIATION;
+            break;
+    }
+}
+
+void SmartMeter238NetSerial::negotiate() {
+    this->sendOption(SM_TELNET_WILL, SM_TELNET_OPTION_BINARY);
+    this->sendOption(SM_TELNET_DO, SM_TELNET_OPTION_BINARY);
+    this->sendOption(SM_TELNET_DO, SM_TELNET_OPTION_SGA);
+    this->sendOption(SM_TELNET_WILL, SM_TELNET_OPTION_COM_PORT);
+
+    uint8_t baud[4] = {(uint8_t)(this->baud >> 24), (uint8_t)(this->baud >> 16), (uint8_t)(this->baud >> 8), (uint8_t)this->baud};
+    uint8_t dataSize = 8;
+    uint8_t parity = SM_COM_PORT_PARITY_NONE;
+    uint8_t stopSize = SM_COM_PORT_STOPSIZE_1;
+
+    this->sendPortSetting(SM_COM_PORT_SET_BAUDRATE, baud, sizeof(baud));
+    this->sendPortSetting(SM_COM_PORT_SET_DATASIZE, &dataSize, 1);
+    this->sendPortSetting(SM_COM_PORT_SET_PARITY, &parity, 1);
+    this->sendPortSetting(SM_COM_PORT_SET_STOPSIZE, &stopSize, 1);
+
+    this->flush();
+}
+
+void SmartMeter238NetSerial::sendOption(uint8_t command, uint8_t option) {
+    uint8_t message[3] = {SM_TELNET_IAC, command, option};
+
+    this->client.write(message, sizeof(message));
+}
+
+void SmartMeter238NetSerial::sendPortSetting(uint8_t setting, const uint8_t *value, uint8_t size) {
+    this->txBuffer[this->txSize++] = SM_TELNET_IAC;
+    this->txBuffer[this->txSize++] = SM_TELNET_SB;
+    this->txBuffer[this->txSize++] = SM_TELNET_OPTION_COM_PORT;
+    this->txBuffer[this->txSize++] = setting;
+
+    for (uint8_t n = 0; n < size; n++) {
+        this->queue(value[n]);
+    }
+
+    this->txBuffer[this->txSize++] = SM_TELNET_IAC;
+    this->txBuffer[this->txSize++] = SM_TELNET_SE;
+}
+
+void SmartMeter238NetSerial::queue(uint8_t data) {
+    if (this->txSize + 2 > SM_NET_TX_BUFFER) {
+        this->flush();
+    }
+
+    if (this->mode == SM_NET_TELNET && data == SM_TELNET_IAC) {
+        this->txBuffer[this->txSize++] = SM_TELNET_IAC;
+    }
+
+    this->txBuffer[this->txSize++] = data;
+}
+
+void SmartMeter238NetSerial::store(uint8_t data) {
+    uint16_t next = (this->rxHead + 1) & (SM_NET_RX_BUFFER - 1);
+
+    if (next != this->rxTail) {
+        this->rxBuffer[this->rxHead] = data;
+        this->rxHead = next;
+    }
+}
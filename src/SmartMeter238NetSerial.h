@@ -0,0 +1,108 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238NetSerial_h
+#define SmartMeter238NetSerial_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+#include <Client.h>
+
+#if defined(ESP8266) || defined(ESP32)
+#include <WiFiClient.h>
+#endif
+
+// Transport to a meter wired to a serial server (ser2net, ESP-Link, RFC2217 port servers) over a TCP Client,
+// used like the UART: SmartMeter238 sm(netSerial). Received bytes are taken from the socket without waiting,
+// written bytes are held until the frame is complete (flush) and go out in one segment, so with Nagle disabled
+// a transaction costs one round trip. Raw mode passes the bytes as they are; telnet mode escapes IAC, skips
+// the telnet commands of the server and sets the remote port to 8N1 at the baudrate given (RFC2217).
+// Connecting and reconnecting the client is left to the sketch, the settings are sent again on every new
+// connection. Raise the response timeout of SmartMeter238 by the round trip of the network.
+class SmartMeter238NetSerial : public Stream {
+   public:
+    enum smNetMode {
+        SM_NET_RAW,
+        SM_NET_TELNET
+    };
+
+    SmartMeter238NetSerial(Client &client, smNetMode mode = SM_NET_RAW, uint32_t baud = SM_UART_BAUD);
+#if defined(ESP8266) || defined(ESP32)
+    SmartMeter238NetSerial(WiFiClient &client, smNetMode mode = SM_NET_RAW, uint32_t baud = SM_UART_BAUD);   // disables Nagle
+#endif
+
+    bool isConnected();
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    void flush() override;
+
+    size_t write(uint8_t data) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+
+   private:
+    enum smTelnetState {
+        SM_TELNET_STATE_DATA,
+        SM_TELNET_STATE_IAC,
+        SM_TELNET_STATE_OPTION,
+        SM_TELNET_STATE_SUBNEGOTIATION,
+        SM_TELNET_STATE_SUBNEGOTIATION_IAC
+    };
+
+    Client &client;
+#if defined(ESP8266) || defined(ESP32)
+    WiFiClient *wifiClient = nullptr;
+#endif
+    smNetMode mode;
+    uint32_t baud;
+
+    bool connected = false;
+
+    smTelnetState telnetState = SM_TELNET_STATE_DATA;
+    uint8_t telnetCommand = 0;
+
+    uint8_t rxBuffer[SM_NET_RX_BUFFER];
+    uint16_t rxHead = 0;
+    uint16_t rxTail = 0;
+
+    uint8_t txBuffer[SM_NET_TX_BUFFER];
+    uint16_t txSize = 0;
+
+    void poll();
+    void decode(uint8_t data);
+    void negotiate();
+    void sendOption(uint8_t command, uint8_t option);
+    void sendPortSetting(uint8_t setting, const uint8_t *value, uint8_t size);
+    void queue(uint8_t data);
+    void store(uint8_t data);
+};
+#endif   // SmartMeter238NetSerial_h
@@ -0,0 +1,170 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Poller.h"
+//------------------------------------------------------------------------------
+
+SmartMeter238Poller::SmartMeter238Poller() {
+}
+
+int8_t SmartMeter238Poller::addMeter(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject, unsigned long interval) {
+    if (this->meterCount >= SM_POLLER_MAX_METERS) {
+        return -1;
+    }
+
+    smPolledMeter *meter = &this->meters[this->meterCount];
+
+    meter->sm = &sm;
+    meter->dataObject = dataObject;
+    meter->cmd = SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA;
+    meter->interval = interval;
+    meter->nextRead = millis();
+    meter->requestMicros = 0;
+    meter->state = SmartMeter238::SM_TRANSACTION_IDLE;
+    meter->stats = {};
+
+    return this->meterCount++;
+}
+
+void SmartMeter238Poller::setInterval(uint8_t meter, unsigned long interval) {
+    if (meter < this->meterCount) {
+        this->meters[meter].interval = interval;
+    }
+}
+
+void SmartMeter238Poller::setCommand(uint8_t meter, SmartMeter238::smCommandReceive cmd) {
+    if (meter < this->meterCount) {
+        this->meters[meter].cmd = cmd;
+    }
+}
+
+SmartMeter238::smCommandReceive SmartMeter238Poller::getCommand(uint8_t meter) {
+    return (meter < this->meterCount) ? this->meters[meter].cmd : SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA;
+}
+
+uint8_t SmartMeter238Poller::getMeterCount() {
+    return this->meterCount;
+}
+
+SmartMeter238 *SmartMeter238Poller::getMeter(uint8_t meter) {
+    return (meter < this->meterCount) ? this->meters[meter].sm : nullptr;
+}
+
+SmartMeter238::smartMeterData *SmartMeter238Poller::getData(uint8_t meter) {
+    return (meter < this->meterCount) ? this->meters[meter].dataObject : nullptr;
+}
+
+SmartMeter238::smTransactionState SmartMeter238Poller::getState(uint8_t meter) {
+    return (meter < this->meterCount) ? this->meters[meter].state : SmartMeter238::SM_TRANSACTION_IDLE;
+}
+
+bool SmartMeter238Poller::getStats(uint8_t meter, smMeterStats *stats) {
+    if (meter >= this->meterCount) {
+        return false;
+    }
+
+    *stats = this->meters[meter].stats;
+
+    return true;
+}
+
+void SmartMeter238Poller::clearStats() {
+    for (uint8_t i = 0; i < this->meterCount; i++) {
+        this->meters[i].stats = {};
+    }
+}
+
+uint8_t SmartMeter238Poller::loop() {
+    uint8_t completed = 0;
+
+    for (uint8_t i = 0; i < this->meterCount; i++) {
+        smPolledMeter *meter = &this->meters[i];
+
+        unsigned long start = micros();
+
+        if (meter->sm->isReadBusy()) {
+            SmartMeter238::smTransactionState state = meter->sm->pollRead();
+
+            if (state != SmartMeter238::SM_TRANSACTION_BUSY) {
+                meter->state = state;
+
+                if (state == SmartMeter238::SM_TRANSACTION_DONE) {
+                    meter->stats.readCount++;
+                    meter->stats.latency = micros() - meter->requestMicros;
+
+                    completed++;
+                } else {
+                    meter->stats.failedCount++;
+                }
+            }
+        } else if ((long)(millis() - meter->nextRead) >= 0) {
+            unsigned long now = millis();
+
+            // Intervals gone while the last read was busy are skipped
+            if ((now - meter->nextRead) >= meter->interval && meter->interval > 0) {
+                meter->stats.missedCount += (now - meter->nextRead) / meter->interval;
+                meter->nextRead = now;
+            }
+
+            meter->nextRead += meter->interval;
+            meter->requestMicros = micros();
+
+            if (meter->sm->startRead(meter->cmd, meter->dataObject)) {
+                meter->state = SmartMeter238::SM_TRANSACTION_BUSY;
+            } else {
+                meter->state = SmartMeter238::SM_TRANSACTION_FAILED;
+                meter->stats.failedCount++;
+            }
+        }
+
+        meter->stats.busyMicros += micros() - start;
+    }
+
+    return completed;
+}
+
+unsigned long SmartMeter238Poller::getNextDue() {
+    unsigned long now = millis();
+    unsigned long due = ~0UL;   // no meter
+
+    for (uint8_t i = 0; i < this->meterCount; i++) {
+        smPolledMeter *meter = &this->meters[i];
+        unsigned long left;
+
+        if (meter->sm->isReadBusy()) {
+            left = meter->sm->getReadTimeLeft();
+        } else {
+            left = ((long)(now - meter->nextRead) >= 0) ? 0 : meter->nextRead - now;
+        }
+
+        due = min(due, left);
+    }
+
+    return due;
+}
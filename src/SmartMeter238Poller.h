@@ -0,0 +1,88 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Poller_h
+#define SmartMeter238Poller_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+// Many meters read from one loop, each one on its own stream (UARTs, network bridges) with its own interval.
+// Reads are non blocking (startRead/pollRead), so the transactions of all meters run at the same time and a
+// slow or dead meter does not delay the others. The latest data of each meter is in its data object and the
+// observers of its SmartMeter238 are notified as usual. Call loop() as often as possible.
+class SmartMeter238Poller {
+   public:
+    typedef struct {
+        uint32_t readCount;
+        uint32_t failedCount;
+        uint32_t missedCount;   // intervals passed while a read was busy
+        uint32_t latency;       // micros from request to decoded answer, last read
+        uint64_t busyMicros;    // time spent in loop() for this meter
+    } smMeterStats;
+
+    SmartMeter238Poller();
+
+    int8_t addMeter(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject, unsigned long interval);   // index, -1 when full
+    void setInterval(uint8_t meter, unsigned long interval);   // millis
+    void setCommand(uint8_t meter, SmartMeter238::smCommandReceive cmd);   // default measurement
+    SmartMeter238::smCommandReceive getCommand(uint8_t meter);
+
+    uint8_t getMeterCount();
+    SmartMeter238 *getMeter(uint8_t meter);
+    SmartMeter238::smartMeterData *getData(uint8_t meter);
+    SmartMeter238::smTransactionState getState(uint8_t meter);   // result of the last read, or busy
+
+    bool getStats(uint8_t meter, smMeterStats *stats);
+    void clearStats();
+
+    uint8_t loop();   // reads completed in this call
+
+    // Millis until loop() has something to do without new bytes: a read to start or a busy read that times out.
+    // An event loop sleeps this long in epoll/poll on the meter streams, 0 is now.
+    unsigned long getNextDue();
+
+   private:
+    typedef struct {
+        SmartMeter238 *sm;
+        SmartMeter238::smartMeterData *dataObject;
+        SmartMeter238::smCommandReceive cmd;
+
+        unsigned long interval;
+        unsigned long nextRead;
+        unsigned long requestMicros;
+
+        SmartMeter238::smTransactionState state;
+        smMeterStats stats;
+    } smPolledMeter;
+
+    smPolledMeter meters[SM_POLLER_MAX_METERS];
+    uint8_t meterCount = 0;
+};
+#endif   // SmartMeter238Poller_h
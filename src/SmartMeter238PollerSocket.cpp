@@ -0,0 +1,219 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238PollerSocket.h"
+#include "SmartMeter238Clock.h"
+//------------------------------------------------------------------------------
+
+#if !defined(ARDUINO)
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static const char *const smStateNames[] = {"idle", "busy", "done", "failed"};
+
+SmartMeter238PollerSocket::SmartMeter238PollerSocket(SmartMeter238Poller &poller) : poller(poller) {
+    this->path[0] = 0;
+}
+
+SmartMeter238PollerSocket::~SmartMeter238PollerSocket() {
+    this->end();
+}
+
+bool SmartMeter238PollerSocket::begin(const char *path) {
+    sockaddr_un address = {};
+
+    this->end();
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        return false;
+    }
+
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, path);
+
+    this->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+    if (this->fd < 0) {
+        return false;
+    }
+
+    unlink(path);
+
+    if (bind(this->fd, (sockaddr *)&address, sizeof(address)) != 0 || listen(this->fd, 16) != 0) {
+        ::close(this->fd);
+        this->fd = -1;
+
+        return false;
+    }
+
+    strcpy(this->path, path);
+
+    return true;
+}
+
+void SmartMeter238PollerSocket::end() {
+    if (this->fd >= 0) {
+        ::close(this->fd);
+        this->fd = -1;
+
+        unlink(this->path);
+    }
+
+    this->path[0] = 0;
+}
+
+int SmartMeter238PollerSocket::getFd() {
+    return this->fd;
+}
+
+uint16_t SmartMeter238PollerSocket::loop() {
+    uint16_t answered = 0;
+
+    if (this->fd < 0) {
+        return 0;
+    }
+
+    int client;
+
+    while ((client = accept4(this->fd, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+        // Blocking with a short timeout, a client that does not read loses its answer and the loop goes on
+        timeval timeout = {0, SM_POLLER_SOCKET_TIMEOUT * 1000};
+
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+        char buffer[SM_POLLER_SOCKET_BUFFER];
+        bool ok = (send(client, "[", 1, MSG_NOSIGNAL) == 1);
+
+        for (uint8_t i = 0; ok && i < this->poller.getMeterCount(); i++) {
+            int length = this->format(i, buffer, sizeof(buffer));
+
+            ok = (length > 0 && length < (int)sizeof(buffer) && send(client, buffer, length, MSG_NOSIGNAL) == length);
+        }
+
+        if (ok) {
+            send(client, "]\n", 2, MSG_NOSIGNAL);
+        }
+
+        ::close(client);
+
+        answered++;
+    }
+
+    return answered;
+}
+
+int SmartMeter238PollerSocket::format(uint8_t meter, char *buffer, size_t size) {
+    SmartMeter238 *sm = this->poller.getMeter(meter);
+    SmartMeter238::smartMeterData *dataObject = this->poller.getData(meter);
+    SmartMeter238Poller::smMeterStats stats;
+
+    this->poller.getStats(meter, &stats);
+
+    int length = snprintf(buffer, size, "%s{\"meter\":%u,\"state\":\"%s\",\"reads\":%lu,\"failed\":%lu,\"missed\":%lu,\"latency\":%lu,\"data\":",
+                          (meter > 0) ? "," : "", meter, smStateNames[this->poller.getState(meter)], (unsigned long)stats.readCount,
+                          (unsigned long)stats.failedCount, (unsigned long)stats.missedCount, (unsigned long)stats.latency);
+
+    if (length < 0 || length >= (int)size) {
+        return -1;
+    }
+
+    buffer += length;
+    size -= length;
+
+    int data;
+
+    switch (this->poller.getCommand(meter)) {
+        case SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA: {
+            uint64_t timestamp = dataObject->measurementData.timestamp;
+
+            if (timestamp == 0) {
+                data = snprintf(buffer, size, "null}");
+
+                break;
+            }
+
+            data = snprintf(buffer, size,
+                            "{\"timestamp\":%llu,\"current\":%.3f,\"voltage\":%.1f,\"frequency\":%.2f,\"reactivePower\":%.4f,\"activePower\":%.4f,"
+                            "\"powerFactor\":%.3f,\"totalEnergy\":%.2f,\"importEnergy\":%.2f,\"exportEnergy\":%.2f}}",
+                            (unsigned long long)(sm->getClock()->hasEpoch() ? sm->getClock()->toEpoch(timestamp) : timestamp),
+                            sm->getMeasurementField(dataObject, SmartMeter238::SM_FIELD_CURRENT),
+                            sm->getMeasurementField(dataObject, SmartMeter238::SM_FIELD_VOLTAGE),
+                            sm->getMeasurementField(dataObject, SmartMeter238::SM_FIELD_FREQUENCY),
+                            sm->getMeasurementField(dataObject, SmartMeter238::SM_FIELD_REACTIVEPOWER),
+                            sm->getMeasurementField(dataObject, SmartMeter238::SM_FIELD_ACTIVEPOWER),
+                            sm->getMeasurementField(dataObject, SmartMeter238::SM_FIELD_POWERFACTOR),
+                            sm->getMeasurementField(dataObject, SmartMeter238::SM_FIELD_TOTALENERGY),
+                            sm->getMeasurementField(dataObject, SmartMeter238::SM_FIELD_IMPORTENERGY),
+                            sm->getMeasurementField(dataObject, SmartMeter238::SM_FIELD_EXPORTENERGY));
+
+            break;
+        }
+        case SmartMeter238::SM_CMD_RESP_LIMITANDPURCHASEDATA: {
+            uint64_t timestamp = dataObject->limitAndPurchaseData.timestamp;
+
+            if (timestamp == 0) {
+                data = snprintf(buffer, size, "null}");
+
+                break;
+            }
+
+            data = snprintf(buffer, size,
+                            "{\"timestamp\":%llu,\"energyPurchase\":%.2f,\"energyPurchaseBalance\":%.2f,\"energyPurchaseAlarm\":%.2f,\"energyPurchaseStatus\":%s,"
+                            "\"maxCurrentLimit\":%.2f,\"maxVoltageLimit\":%u,\"minVoltageLimit\":%u}}",
+                            (unsigned long long)(sm->getClock()->hasEpoch() ? sm->getClock()->toEpoch(timestamp) : timestamp),
+                            dataObject->limitAndPurchaseData.data.energyPurchase, dataObject->limitAndPurchaseData.data.energyPurchaseBalance,
+                            dataObject->limitAndPurchaseData.data.energyPurchaseAlarm, dataObject->limitAndPurchaseData.data.energyPurchaseStatus ? "true" : "false",
+                            dataObject->limitAndPurchaseData.data.maxCurrentLimit, dataObject->limitAndPurchaseData.data.maxVoltageLimit,
+                            dataObject->limitAndPurchaseData.data.minVoltageLimit);
+
+            break;
+        }
+        default: {
+            uint64_t timestamp = dataObject->powerCutData.timestamp;
+
+            if (timestamp == 0) {
+                data = snprintf(buffer, size, "null}");
+
+                break;
+            }
+
+            data = snprintf(buffer, size, "{\"timestamp\":%llu,\"powerCut\":%s,\"powerCutDetails\":\"%s\",\"delay\":%u,\"delaySetPowerCut\":%s}}",
+                            (unsigned long long)(sm->getClock()->hasEpoch() ? sm->getClock()->toEpoch(timestamp) : timestamp),
+                            dataObject->powerCutData.data.powerCut ? "true" : "false", dataObject->powerCutData.data.powerCutDetails,
+                            dataObject->powerCutData.data.delay, dataObject->powerCutData.data.delaySetPowerCut ? "true" : "false");
+
+            break;
+        }
+    }
+
+    return (data < 0) ? -1 : length + data;
+}
+#endif
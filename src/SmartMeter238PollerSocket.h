@@ -0,0 +1,61 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238PollerSocket_h
+#define SmartMeter238PollerSocket_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+#include "SmartMeter238Poller.h"
+
+#if !defined(ARDUINO)
+// Latest data of every meter of a poller on a local (unix) socket, for the other processes of a Linux gateway.
+// Every connection gets a JSON array with one element by meter and is closed. getFd() goes in epoll/poll with
+// the meter streams, loop() answers the connections that are waiting.
+class SmartMeter238PollerSocket {
+   public:
+    SmartMeter238PollerSocket(SmartMeter238Poller &poller);
+    virtual ~SmartMeter238PollerSocket();
+
+    bool begin(const char *path);   // a socket file left by an old run is replaced
+    void end();
+    int getFd();
+
+    uint16_t loop();   // connections answered
+
+   private:
+    SmartMeter238Poller &poller;
+
+    int fd = -1;
+    char path[108];   // sun_path
+
+    int format(uint8_t meter, char *buffer, size_t size);
+};
+#endif
+#endif   // SmartMeter238PollerSocket_h
@@ -0,0 +1,221 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238PowerQuality.h"
+//------------------------------------------------------------------------------
+
+SmartMeter238PowerQuality::SmartMeter238PowerQuality() {
+    for (uint8_t i = 0; i < SM_PQ_EVENT_TYPES; i++) {
+        this->channels[i].state = SM_PQ_IDLE;
+        this->channels[i].start = 0;
+        this->channels[i].extremum = 0;
+    }
+
+    this->setThreshold(SM_PQ_SAG, SM_PQ_DEFAULT_SAG_VOLTAGE, SM_PQ_DEFAULT_VOLTAGE_HYSTERESIS, SM_PQ_DEFAULT_MIN_DURATION);
+    this->setThreshold(SM_PQ_SWELL, SM_PQ_DEFAULT_SWELL_VOLTAGE, SM_PQ_DEFAULT_VOLTAGE_HYSTERESIS, SM_PQ_DEFAULT_MIN_DURATION);
+    this->setThreshold(SM_PQ_FREQUENCY_LOW, SM_PQ_DEFAULT_MIN_FREQUENCY, SM_PQ_DEFAULT_FREQUENCY_HYSTERESIS, SM_PQ_DEFAULT_MIN_DURATION);
+    this->setThreshold(SM_PQ_FREQUENCY_HIGH, SM_PQ_DEFAULT_MAX_FREQUENCY, SM_PQ_DEFAULT_FREQUENCY_HYSTERESIS, SM_PQ_DEFAULT_MIN_DURATION);
+}
+
+bool SmartMeter238PowerQuality::setThreshold(smEventType type, float threshold, float hysteresis, unsigned long minDuration) {
+    if (type >= SM_PQ_EVENT_TYPES || hysteresis < 0) {
+        return false;
+    }
+
+    this->channels[type].enabled = true;
+    this->channels[type].threshold = threshold;
+    this->channels[type].hysteresis = hysteresis;
+    this->channels[type].minDuration = minDuration;
+    this->channels[type].state = SM_PQ_IDLE;
+
+    return true;
+}
+
+bool SmartMeter238PowerQuality::disable(smEventType type) {
+    if (type >= SM_PQ_EVENT_TYPES) {
+        return false;
+    }
+
+    this->channels[type].enabled = false;
+    this->channels[type].state = SM_PQ_IDLE;
+
+    return true;
+}
+
+void SmartMeter238PowerQuality::setFastInterval(unsigned long interval) {
+    this->fastInterval = interval;
+}
+
+void SmartMeter238PowerQuality::setNormalInterval(unsigned long interval) {
+    this->normalInterval = interval;
+}
+
+void SmartMeter238PowerQuality::setRateCallback(smRateCallback callback, void *context) {
+    this->callback = callback;
+    this->context = context;
+}
+
+unsigned long SmartMeter238PowerQuality::getSuggestedInterval() {
+    return this->fastPolling ? this->fastInterval : this->normalInterval;
+}
+
+bool SmartMeter238PowerQuality::isEventActive() {
+    for (uint8_t i = 0; i < SM_PQ_EVENT_TYPES; i++) {
+        if (this->channels[i].state != SM_PQ_IDLE) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint8_t SmartMeter238PowerQuality::getEventCount() {
+    return this->eventCount;
+}
+
+bool SmartMeter238PowerQuality::getEvent(uint8_t index, smEvent *event) {
+    // Index 0 is the oldest event
+    if (index >= this->eventCount) {
+        return false;
+    }
+
+    *event = this->events[(this->eventHead + SM_PQ_MAX_EVENTS - this->eventCount + index) % SM_PQ_MAX_EVENTS];
+
+    return true;
+}
+
+void SmartMeter238PowerQuality::clearEvents() {
+    this->eventHead = 0;
+    this->eventCount = 0;
+    this->lostEventCount = 0;
+}
+
+uint32_t SmartMeter238PowerQuality::getLostEventCount() {
+    return this->lostEventCount;
+}
+
+void SmartMeter238PowerQuality::recordEvent(smEventType type, smChannel &channel, uint64_t timestamp) {
+    smEvent &event = this->events[this->eventHead];
+
+    event.type = type;
+    event.start = channel.start;
+    event.end = timestamp;
+    event.duration = (unsigned long)((timestamp - channel.start) / 1000);
+    event.extremum = channel.extremum;
+
+    this->eventHead = (this->eventHead + 1) % SM_PQ_MAX_EVENTS;
+
+    if (this->eventCount < SM_PQ_MAX_EVENTS) {
+        this->eventCount++;
+    } else {
+        this->lostEventCount++;
+    }
+}
+
+void SmartMeter238PowerQuality::updateChannel(smEventType type, float value, uint64_t timestamp) {
+    smChannel &channel = this->channels[type];
+
+    if (!channel.enabled) {
+        return;
+    }
+
+    bool low = (type == SM_PQ_SAG || type == SM_PQ_FREQUENCY_LOW);
+
+    bool outside = low ? (value < channel.threshold) : (value > channel.threshold);
+    bool recovered = low ? (value >= channel.threshold + channel.hysteresis) : (value <= channel.threshold - channel.hysteresis);
+
+    switch (channel.state) {
+        case SM_PQ_IDLE: {
+            if (outside) {
+                channel.start = timestamp;
+                channel.extremum = value;
+                channel.state = (channel.minDuration == 0) ? SM_PQ_ACTIVE : SM_PQ_PENDING;
+            }
+
+            break;
+        }
+        case SM_PQ_PENDING: {
+            if (recovered) {
+                channel.state = SM_PQ_IDLE;   // too short to be an event
+
+                break;
+            }
+
+            channel.extremum = low ? min(channel.extremum, value) : max(channel.extremum, value);
+
+            if ((timestamp - channel.start) >= (uint64_t)channel.minDuration * 1000) {
+                channel.state = SM_PQ_ACTIVE;
+            }
+
+            break;
+        }
+        case SM_PQ_ACTIVE: {
+            if (recovered) {
+                this->recordEvent(type, channel, timestamp);
+
+                channel.state = SM_PQ_IDLE;
+
+                break;
+            }
+
+            channel.extremum = low ? min(channel.extremum, value) : max(channel.extremum, value);
+
+            break;
+        }
+    }
+}
+
+void SmartMeter238PowerQuality::update(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject) {
+    uint64_t timestamp = dataObject->measurementData.timestamp;
+
+    float voltage = sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_VOLTAGE);
+    float frequency = sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_FREQUENCY);
+
+    this->updateChannel(SM_PQ_SAG, voltage, timestamp);
+    this->updateChannel(SM_PQ_SWELL, voltage, timestamp);
+    this->updateChannel(SM_PQ_FREQUENCY_LOW, frequency, timestamp);
+    this->updateChannel(SM_PQ_FREQUENCY_HIGH, frequency, timestamp);
+
+    // Suggest measuring as fast as possible during an excursion, the rate itself belongs to whoever polls
+    bool active = this->isEventActive();
+
+    if (active != this->fastPolling) {
+        this->fastPolling = active;
+
+        if (this->callback != nullptr) {
+            this->callback(this->getSuggestedInterval(), this->context);
+        }
+    }
+}
+
+void SmartMeter238PowerQuality::onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) {
+    if (cmd == SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA) {
+        this->update(sm, dataObject);
+    }
+}
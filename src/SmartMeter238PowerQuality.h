@@ -0,0 +1,121 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238PowerQuality_h
+#define SmartMeter238PowerQuality_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+// Voltage sag/swell and frequency excursion detector, runs on every measurement. An excursion becomes an event
+// when it lasts minDuration, and ends when the value is back inside the threshold plus the hysteresis. Times come
+// from the answer timestamp (SmartMeter238Clock). While an excursion is active the suggested interval is the fast
+// one, the rate callback tells the owner of the polling (sampler, poller or loop) when it changes.
+class SmartMeter238PowerQuality : public SmartMeter238Observer {
+   public:
+    enum smEventType {
+        SM_PQ_SAG,
+        SM_PQ_SWELL,
+        SM_PQ_FREQUENCY_LOW,
+        SM_PQ_FREQUENCY_HIGH,
+
+        SM_PQ_EVENT_TYPES
+    };
+
+    typedef struct {
+        smEventType type;
+
+        uint64_t start;            // timestamp, micros
+        uint64_t end;              // timestamp, micros
+        unsigned long duration;    // millis
+
+        float extremum;
+    } smEvent;
+
+    typedef void (*smRateCallback)(unsigned long interval, void *context);
+
+    SmartMeter238PowerQuality();
+
+    bool setThreshold(smEventType type, float threshold, float hysteresis, unsigned long minDuration);
+    bool disable(smEventType type);
+
+    void setFastInterval(unsigned long interval);
+    void setNormalInterval(unsigned long interval);
+    void setRateCallback(smRateCallback callback, void *context = nullptr);
+
+    unsigned long getSuggestedInterval();   // millis, the fast interval while an excursion is active
+
+    bool isEventActive();
+
+    uint8_t getEventCount();
+    bool getEvent(uint8_t index, smEvent *event);
+    void clearEvents();
+    uint32_t getLostEventCount();
+
+    void update(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject);
+
+    void onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) override;
+
+   private:
+    enum smChannelState {
+        SM_PQ_IDLE,
+        SM_PQ_PENDING,
+        SM_PQ_ACTIVE
+    };
+
+    typedef struct {
+        bool enabled;
+
+        float threshold;
+        float hysteresis;
+        unsigned long minDuration;
+
+        smChannelState state;
+        uint64_t start;
+        float extremum;
+    } smChannel;
+
+    smChannel channels[SM_PQ_EVENT_TYPES];
+
+    smEvent events[SM_PQ_MAX_EVENTS];
+    uint8_t eventHead = 0;
+    uint8_t eventCount = 0;
+    uint32_t lostEventCount = 0;
+
+    unsigned long fastInterval = SM_PQ_DEFAULT_FAST_INTERVAL;
+    unsigned long normalInterval = SM_MIN_INTERVAL_TO_GET_DATA;
+    bool fastPolling = false;
+
+    smRateCallback callback = nullptr;
+    void *context = nullptr;
+
+    void updateChannel(smEventType type, float value, uint64_t timestamp);
+    void recordEvent(smEventType type, smChannel &channel, uint64_t timestamp);
+};
+#endif   // SmartMeter238PowerQuality_h
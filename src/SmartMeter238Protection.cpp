@@ -0,0 +1,278 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Protection.h"
+#include "SmartMeter238Clock.h"
+//------------------------------------------------------------------------------
+
+SmartMeter238Protection::SmartMeter238Protection() {
+}
+
+int8_t SmartMeter238Protection::addRule(SmartMeter238::smMeasurementField field, smRuleCondition condition, float threshold, float hysteresis, unsigned long duration) {
+    if (this->ruleCount >= SM_PROTECTION_MAX_RULES || field >= SmartMeter238::SM_FIELD_COUNT || hysteresis < 0) {
+        return -1;
+    }
+
+    smRule &rule = this->rules[this->ruleCount];
+
+    rule.field = field;
+    rule.absolute = (condition == SM_RULE_ABS_ABOVE || condition == SM_RULE_ABS_BELOW);
+    rule.sign = (condition == SM_RULE_ABOVE || condition == SM_RULE_ABS_ABOVE) ? 1 : -1;
+    rule.fireLevel = rule.sign * threshold;
+    rule.clearLevel = rule.fireLevel - hysteresis;
+    rule.duration = (uint64_t)duration * 1000;
+    rule.minCurrent = 0;
+
+    rule.enabled = true;
+    rule.pending = false;
+    rule.fired = false;
+    rule.onset = 0;
+
+    return this->ruleCount++;
+}
+
+bool SmartMeter238Protection::setGuard(uint8_t rule, float minCurrent) {
+    if (rule >= this->ruleCount) {
+        return false;
+    }
+
+    this->rules[rule].minCurrent = minCurrent;
+
+    return true;
+}
+
+bool SmartMeter238Protection::enableRule(uint8_t rule, bool enable) {
+    if (rule >= this->ruleCount) {
+        return false;
+    }
+
+    this->rules[rule].enabled = enable;
+    this->rules[rule].pending = false;
+    this->rules[rule].fired = false;
+
+    return true;
+}
+
+void SmartMeter238Protection::clearRules() {
+    this->ruleCount = 0;
+}
+
+void SmartMeter238Protection::setWorker(SmartMeter238Worker *worker) {
+    this->worker = worker;
+}
+
+void SmartMeter238Protection::setTripCallback(smTripCallback callback, void *context) {
+    this->callback = callback;
+    this->context = context;
+}
+
+bool SmartMeter238Protection::isTripped() {
+    return this->tripped;
+}
+
+void SmartMeter238Protection::rearm() {
+    this->tripped = false;
+    this->tripHeld = false;   // a cut not sent yet is dropped, its event stays without trip
+
+    for (uint8_t i = 0; i < this->ruleCount; i++) {
+        this->rules[i].pending = false;
+        this->rules[i].fired = false;
+    }
+}
+
+uint8_t SmartMeter238Protection::getEventCount() {
+    return this->eventCount;
+}
+
+bool SmartMeter238Protection::getEvent(uint8_t index, smTripEvent *event) {
+    if (index >= this->eventCount) {
+        return false;
+    }
+
+    *event = this->events[(this->eventHead + SM_PROTECTION_MAX_EVENTS - this->eventCount + index) % SM_PROTECTION_MAX_EVENTS];
+
+    return true;
+}
+
+void SmartMeter238Protection::clearEvents() {
+    this->eventHead = 0;
+    this->eventCount = 0;
+}
+
+uint32_t SmartMeter238Protection::getLastTripLatency() {
+    return this->lastTripLatency;
+}
+
+uint32_t SmartMeter238Protection::getMaxTripLatency(bool clear) {
+    uint32_t tmp = this->maxTripLatency;
+
+    if (clear) {
+        this->maxTripLatency = 0;
+    }
+
+    return tmp;
+}
+
+void SmartMeter238Protection::update(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject) {
+    uint64_t time = dataObject->measurementData.timestamp;
+
+    for (uint8_t i = 0; i < this->ruleCount; i++) {
+        smRule &rule = this->rules[i];
+
+        if (!rule.enabled) {
+            continue;
+        }
+
+        float value = sm.getMeasurementField(dataObject, rule.field);
+        float level = rule.sign * (rule.absolute ? fabsf(value) : value);
+
+        bool guarded = (rule.minCurrent > 0 && sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_CURRENT) < rule.minCurrent);
+
+        if (rule.fired) {
+            if (guarded || level < rule.clearLevel) {
+                rule.fired = false;
+            }
+
+            continue;
+        }
+
+        if (guarded || level <= rule.fireLevel) {
+            rule.pending = false;
+
+            continue;
+        }
+
+        if (!rule.pending) {
+            rule.pending = true;
+            rule.onset = time;
+        }
+
+        if ((time - rule.onset) >= rule.duration) {
+            rule.pending = false;
+            rule.fired = true;
+
+            if (!this->tripped) {
+                this->trip(sm, dataObject, i, value);
+            }
+        }
+    }
+}
+
+void SmartMeter238Protection::trip(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject, uint8_t rule, float value) {
+    smTripEvent *event = &this->events[this->eventHead];
+
+    this->eventHead = (this->eventHead + 1) % SM_PROTECTION_MAX_EVENTS;
+
+    if (this->eventCount < SM_PROTECTION_MAX_EVENTS) {
+        this->eventCount++;
+    }
+
+    event->rule = rule;
+    event->value = value;
+    event->onset = this->rules[rule].onset;
+    event->detection = dataObject->measurementData.timestamp;
+    event->trip = 0;
+    event->success = false;
+
+    this->tripped = true;
+
+    if (this->worker != nullptr) {
+        SmartMeter238Worker::smRequest request;
+
+        request.type = SmartMeter238Worker::SM_REQ_SET_POWERCUT;
+        request.flag = true;
+        request.callback = SmartMeter238Protection::onWorkerResult;
+        request.context = this;
+
+        this->tripMeter = &sm;
+
+        if (this->worker->submit(request)) {
+            return;
+        }
+
+        this->completeTrip(event, false, 0);
+
+        return;
+    }
+
+    // The measurement answer is still being dispatched, a request from here would re-enter the serial processing
+    this->tripMeter = &sm;
+    this->tripData = dataObject;
+    this->tripHeld = true;
+}
+
+bool SmartMeter238Protection::loop() {
+    if (!this->tripHeld || this->tripMeter->isReadBusy()) {
+        return false;
+    }
+
+    this->tripHeld = false;
+
+    // The last event is the held trip
+    smTripEvent *event = &this->events[(this->eventHead + SM_PROTECTION_MAX_EVENTS - 1) % SM_PROTECTION_MAX_EVENTS];
+
+    bool success = this->tripMeter->setPowerCutData(true, this->tripData);
+
+    this->completeTrip(event, success, success ? this->tripData->powerCutData.timestamp : 0);
+
+    return true;
+}
+
+void SmartMeter238Protection::onWorkerResult(const SmartMeter238Worker::smResult &result, void *context) {
+    SmartMeter238Protection *protection = static_cast<SmartMeter238Protection *>(context);
+
+    // The last event is the trip in progress
+    smTripEvent *event = &protection->events[(protection->eventHead + SM_PROTECTION_MAX_EVENTS - 1) % SM_PROTECTION_MAX_EVENTS];
+
+    protection->completeTrip(event, result.success, result.success ? protection->tripMeter->getClock()->now() : 0);
+}
+
+void SmartMeter238Protection::completeTrip(smTripEvent *event, bool success, uint64_t time) {
+    event->success = success;
+    event->trip = time;
+
+    if (success) {
+        this->lastTripLatency = (uint32_t)(time - event->detection);
+        this->maxTripLatency = max(this->maxTripLatency, this->lastTripLatency);
+    } else {
+        // Another try on the next measurement past the threshold
+        this->tripped = false;
+        this->rules[event->rule].fired = false;
+    }
+
+    if (this->callback != nullptr) {
+        this->callback(*event, this->context);
+    }
+}
+
+void SmartMeter238Protection::onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) {
+    if (cmd == SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA) {
+        this->update(sm, dataObject);
+    }
+}
@@ -0,0 +1,135 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Protection_h
+#define SmartMeter238Protection_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+#include "SmartMeter238Worker.h"
+
+// Local protection on top of the meter limits: threshold rules on any measurement field with duration and
+// hysteresis, evaluated on every decoded measurement. A rule fires when its condition holds for the duration and
+// clears past the hysteresis. On a fire the power is cut at once: from the observer, in the task that owns the
+// link, or through the control queue of the worker when one is set. Every trip records the timestamps of the
+// onset, the fire and the confirmation of the meter. After a trip no more cuts are sent until rearm().
+// Without a worker the observer does not touch the link: the measurement answer is still being dispatched, so the
+// cut is held and loop() sends it with a blocking setPowerCutData() once the meter has no read in flight. Call
+// loop() from the task that owns the link, before the Poller or Cache loop() when they drive it.
+class SmartMeter238Protection : public SmartMeter238Observer {
+   public:
+    enum smRuleCondition {
+        SM_RULE_ABOVE,
+        SM_RULE_BELOW,
+        SM_RULE_ABS_ABOVE,   // on the absolute value (export, capacitive)
+        SM_RULE_ABS_BELOW
+    };
+
+    typedef struct {
+        uint8_t rule;
+        float value;          // value that fired the rule
+
+        uint64_t onset;       // answer timestamp of the first frame past the threshold
+        uint64_t detection;   // answer timestamp of the frame that fired the rule
+        uint64_t trip;        // meter confirmed the power cut, 0 when it failed
+
+        bool success;
+    } smTripEvent;
+
+    typedef void (*smTripCallback)(const smTripEvent &event, void *context);
+
+    SmartMeter238Protection();
+
+    int8_t addRule(SmartMeter238::smMeasurementField field, smRuleCondition condition, float threshold, float hysteresis, unsigned long duration);   // index, -1 when full
+    bool setGuard(uint8_t rule, float minCurrent);   // the rule only runs above this current, 0 always
+    bool enableRule(uint8_t rule, bool enable);
+    void clearRules();
+
+    void setWorker(SmartMeter238Worker *worker);   // nullptr cuts from loop()
+    void setTripCallback(smTripCallback callback, void *context = nullptr);
+
+    bool isTripped();
+    void rearm();
+
+    uint8_t getEventCount();
+    bool getEvent(uint8_t index, smTripEvent *event);   // 0 is the oldest
+    void clearEvents();
+
+    uint32_t getLastTripLatency();   // micros from detection to confirmation
+    uint32_t getMaxTripLatency(bool clear = false);
+
+    bool loop();   // true when a held cut has been sent in this call, nothing to do with a worker
+
+    void update(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject);
+
+    void onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) override;
+
+   private:
+    // Conditions are compiled to a signed comparison: fire above fireLevel, clear below clearLevel
+    typedef struct {
+        SmartMeter238::smMeasurementField field;
+        bool absolute;
+        float sign;
+        float fireLevel;
+        float clearLevel;
+        uint64_t duration;   // micros
+        float minCurrent;
+
+        bool enabled;
+        bool pending;
+        bool fired;
+        uint64_t onset;
+    } smRule;
+
+    smRule rules[SM_PROTECTION_MAX_RULES];
+    uint8_t ruleCount = 0;
+
+    SmartMeter238Worker *worker = nullptr;
+    SmartMeter238 *tripMeter = nullptr;   // meter of the trip in the worker or held for loop()
+    SmartMeter238::smartMeterData *tripData = nullptr;
+    bool tripHeld = false;
+
+    smTripCallback callback = nullptr;
+    void *context = nullptr;
+
+    bool tripped = false;
+
+    smTripEvent events[SM_PROTECTION_MAX_EVENTS];
+    uint8_t eventHead = 0;
+    uint8_t eventCount = 0;
+
+    uint32_t lastTripLatency = 0;
+    uint32_t maxTripLatency = 0;
+
+    void trip(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject, uint8_t rule, float value);
+    void completeTrip(smTripEvent *event, bool success, uint64_t time);
+
+    static void onWorkerResult(const SmartMeter238Worker::smResult &result, void *context);
+};
+#endif   // SmartMeter238Protection_h
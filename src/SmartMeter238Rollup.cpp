@@ -0,0 +1,376 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Rollup.h"
+#include "SmartMeter238Clock.h"
+//------------------------------------------------------------------------------
+
+#define SM_ROLLUP_MAGIC_1 'S'
+#define SM_ROLLUP_MAGIC_2 'R'
+
+SmartMeter238Rollup::SmartMeter238Rollup() {
+    this->levels[SM_ROLLUP_MINUTE] = this->minutes;
+    this->levels[SM_ROLLUP_HOUR] = this->hours;
+    this->levels[SM_ROLLUP_DAY] = this->days;
+    this->levels[SM_ROLLUP_MONTH] = this->months;
+
+    this->capacity[SM_ROLLUP_MINUTE] = SM_ROLLUP_MINUTES;
+    this->capacity[SM_ROLLUP_HOUR] = SM_ROLLUP_HOURS;
+    this->capacity[SM_ROLLUP_DAY] = SM_ROLLUP_DAYS;
+    this->capacity[SM_ROLLUP_MONTH] = SM_ROLLUP_MONTHS;
+
+    this->clear();
+}
+
+void SmartMeter238Rollup::setUtcOffset(int32_t seconds) {
+    this->utcOffset = seconds;
+}
+
+void SmartMeter238Rollup::clear() {
+    for (uint8_t level = 0; level < SM_ROLLUP_LEVELS; level++) {
+        memset(this->levels[level], 0, this->capacity[level] * sizeof(smRollupBucket));
+    }
+
+    this->lastImport = -1;
+    this->lastExport = -1;
+    this->lastCost = -1;
+
+    this->importTotal = 0;
+    this->exportTotal = 0;
+    this->costTotal = 0;
+
+    this->firstEpoch = 0;
+    this->lastEpoch = 0;
+}
+
+float SmartMeter238Rollup::getDelta(float value, float *last) {
+    float delta = value - *last;
+
+    if (*last < 0) {
+        delta = 0;   // first sample, the energy before it is not attributed to any bucket
+    } else if (delta < 0) {
+        delta = value;   // the meter counters were reset
+    }
+
+    *last = value;
+
+    return delta;
+}
+
+void SmartMeter238Rollup::update(SmartMeter238::smartMeterData *dataObject, uint32_t epoch) {
+    if (epoch < SM_TARIFF_MIN_VALID_EPOCH) {
+        return;
+    }
+
+    // A clock stepped back must not overwrite newer buckets
+    epoch = max(epoch, this->lastEpoch);
+
+    float importDelta = getDelta(dataObject->measurementData.data.lapseOfTimeImportEnergy, &this->lastImport);
+    float exportDelta = getDelta(dataObject->measurementData.data.lapseOfTimeExportEnergy, &this->lastExport);
+    float costDelta = getDelta(dataObject->measurementData.data.lapseOfTimePriceEnergy, &this->lastCost);
+    float power = dataObject->measurementData.data.activePower;
+
+    for (uint8_t level = 0; level < SM_ROLLUP_LEVELS; level++) {
+        uint32_t key;
+        uint32_t start = this->getStart((smRollupLevel)level, epoch, &key);
+
+        smRollupBucket *bucket = &this->levels[level][key % this->capacity[level]];
+
+        if (bucket->start != start) {
+            memset(bucket, 0, sizeof(smRollupBucket));
+
+            bucket->start = start;
+            bucket->peakPower = power;
+
+            bucket->importStart = this->importTotal;
+            bucket->exportStart = this->exportTotal;
+            bucket->costStart = this->costTotal;
+        }
+
+        bucket->importEnergy += importDelta;
+        bucket->exportEnergy += exportDelta;
+        bucket->totalEnergy += importDelta + exportDelta;
+        bucket->cost += costDelta;
+        bucket->peakPower = max(bucket->peakPower, power);
+    }
+
+    this->importTotal += importDelta;
+    this->exportTotal += exportDelta;
+    this->costTotal += costDelta;
+
+    if (this->firstEpoch == 0) {
+        this->firstEpoch = epoch;
+    }
+
+    this->lastEpoch = epoch;
+}
+
+uint16_t SmartMeter238Rollup::getCapacity(smRollupLevel level) {
+    return (level < SM_ROLLUP_LEVELS) ? this->capacity[level] : 0;
+}
+
+bool SmartMeter238Rollup::getBucket(smRollupLevel level, uint32_t epoch, smRollupBucket *bucket) {
+    if (level >= SM_ROLLUP_LEVELS || epoch < SM_TARIFF_MIN_VALID_EPOCH) {
+        return false;
+    }
+
+    uint32_t key;
+    uint32_t start = this->getStart(level, epoch, &key);
+    smRollupBucket *stored = &this->levels[level][key % this->capacity[level]];
+
+    if (stored->start != start) {
+        return false;
+    }
+
+    *bucket = *stored;
+
+    return true;
+}
+
+bool SmartMeter238Rollup::getRecent(smRollupLevel level, uint16_t age, smRollupBucket *bucket) {
+    if (level >= SM_ROLLUP_LEVELS || this->lastEpoch == 0) {
+        return false;
+    }
+
+    uint32_t key;
+    this->getStart(level, this->lastEpoch, &key);
+
+    if (age > key) {
+        return false;
+    }
+
+    return this->getBucket(level, this->getKeyStart(level, key - age), bucket);
+}
+
+bool SmartMeter238Rollup::getEnergy(uint32_t from, uint32_t to, smRollupTotals *totals) {
+    smRollupTotals first;
+    smRollupTotals last;
+
+    if (from > to || !this->getTotalsAt(from, &first) || !this->getTotalsAt(to, &last)) {
+        return false;
+    }
+
+    totals->importEnergy = last.importEnergy - first.importEnergy;
+    totals->exportEnergy = last.exportEnergy - first.exportEnergy;
+    totals->totalEnergy = totals->importEnergy + totals->exportEnergy;
+    totals->cost = last.cost - first.cost;
+
+    return true;
+}
+
+bool SmartMeter238Rollup::getTotalsAt(uint32_t epoch, smRollupTotals *totals) {
+    if (this->lastEpoch == 0) {
+        return false;
+    }
+
+    if (epoch <= this->firstEpoch || epoch > this->lastEpoch) {
+        bool before = (epoch <= this->firstEpoch);
+
+        totals->importEnergy = before ? 0 : this->importTotal;
+        totals->exportEnergy = before ? 0 : this->exportTotal;
+        totals->cost = before ? 0 : this->costTotal;
+
+        return true;
+    }
+
+    // The finest level that still has the bucket, at most one read per level
+    for (uint8_t level = 0; level < SM_ROLLUP_LEVELS; level++) {
+        uint32_t key;
+        uint32_t start = this->getStart((smRollupLevel)level, epoch, &key);
+        smRollupBucket *bucket = &this->levels[level][key % this->capacity[level]];
+
+        if (bucket->start == start) {
+            totals->importEnergy = bucket->importStart;
+            totals->exportEnergy = bucket->exportStart;
+            totals->cost = bucket->costStart;
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+uint32_t SmartMeter238Rollup::getStart(smRollupLevel level, uint32_t epoch, uint32_t *key) {
+    uint32_t local = epoch + this->utcOffset;
+
+    switch (level) {
+        case SM_ROLLUP_MINUTE:
+            *key = local / 60;
+            break;
+        case SM_ROLLUP_HOUR:
+            *key = local / 3600;
+            break;
+        case SM_ROLLUP_DAY:
+            *key = local / 86400;
+            break;
+        default: {
+            // Civil date from days since epoch, months are counted from march
+            uint32_t z = (local / 86400) + 719468;
+            uint32_t era = z / 146097;
+            uint32_t doe = z - (era * 146097);
+            uint32_t yoe = (doe - (doe / 1460) + (doe / 36524) - (doe / 146096)) / 365;
+            uint32_t doy = doe - ((365 * yoe) + (yoe / 4) - (yoe / 100));
+            uint32_t mp = ((5 * doy) + 2) / 153;
+
+            uint32_t month = (mp < 10) ? (mp + 2) : (mp - 10);   // 0 = january
+            uint32_t year = yoe + (era * 400) + (month <= 1);
+
+            *key = ((year - 1970) * 12) + month;
+            break;
+        }
+    }
+
+    return this->getKeyStart(level, *key);
+}
+
+uint32_t SmartMeter238Rollup::getKeyStart(smRollupLevel level, uint32_t key) {
+    switch (level) {
+        case SM_ROLLUP_MINUTE:
+            return (key * 60) - this->utcOffset;
+        case SM_ROLLUP_HOUR:
+            return (key * 3600) - this->utcOffset;
+        case SM_ROLLUP_DAY:
+            return (key * 86400) - this->utcOffset;
+        default: {
+            // Days since epoch of the first day of the month
+            uint32_t month = key % 12;
+            uint32_t year = 1970 + (key / 12) - (month <= 1);
+            uint32_t era = year / 400;
+            uint32_t yoe = year - (era * 400);
+            uint32_t doy = ((153 * ((month <= 1) ? (month + 10) : (month - 2))) + 2) / 5;
+            uint32_t doe = (yoe * 365) + (yoe / 4) - (yoe / 100) + doy;
+
+            return (((era * 146097) + doe - 719468) * 86400) - this->utcOffset;
+        }
+    }
+}
+
+size_t SmartMeter238Rollup::save(Print &output) {
+    uint8_t header[4] = {SM_ROLLUP_MAGIC_1, SM_ROLLUP_MAGIC_2, SM_ROLLUP_FILE_VERSION, SM_ROLLUP_LEVELS};
+    size_t size = output.write(header, sizeof(header));
+
+    size += output.write((const uint8_t *)&this->lastImport, sizeof(this->lastImport));
+    size += output.write((const uint8_t *)&this->lastExport, sizeof(this->lastExport));
+    size += output.write((const uint8_t *)&this->lastCost, sizeof(this->lastCost));
+    size += output.write((const uint8_t *)&this->importTotal, sizeof(this->importTotal));
+    size += output.write((const uint8_t *)&this->exportTotal, sizeof(this->exportTotal));
+    size += output.write((const uint8_t *)&this->costTotal, sizeof(this->costTotal));
+    size += output.write((const uint8_t *)&this->firstEpoch, sizeof(this->firstEpoch));
+    size += output.write((const uint8_t *)&this->lastEpoch, sizeof(this->lastEpoch));
+
+    size_t expected = sizeof(header) + (3 * sizeof(float)) + (3 * sizeof(double)) + (2 * sizeof(uint32_t));
+
+    for (uint8_t level = 0; level < SM_ROLLUP_LEVELS; level++) {
+        uint16_t used = 0;
+
+        for (uint16_t i = 0; i < this->capacity[level]; i++) {
+            used += (this->levels[level][i].start != 0);
+        }
+
+        size += output.write((const uint8_t *)&used, sizeof(used));
+
+        for (uint16_t i = 0; i < this->capacity[level]; i++) {
+            if (this->levels[level][i].start != 0) {
+                size += output.write((const uint8_t *)&this->levels[level][i], sizeof(smRollupBucket));
+            }
+        }
+
+        expected += sizeof(used) + (used * sizeof(smRollupBucket));
+    }
+
+    return (size == expected) ? size : 0;
+}
+
+bool SmartMeter238Rollup::load(Stream &input) {
+    uint8_t header[4];
+
+    if (input.readBytes(header, sizeof(header)) != sizeof(header) || header[0] != SM_ROLLUP_MAGIC_1 || header[1] != SM_ROLLUP_MAGIC_2 || header[2] != SM_ROLLUP_FILE_VERSION || header[3] != SM_ROLLUP_LEVELS) {
+        return false;
+    }
+
+    this->clear();
+
+    bool ok = true;
+
+    ok = ok && input.readBytes((uint8_t *)&this->lastImport, sizeof(this->lastImport)) == sizeof(this->lastImport);
+    ok = ok && input.readBytes((uint8_t *)&this->lastExport, sizeof(this->lastExport)) == sizeof(this->lastExport);
+    ok = ok && input.readBytes((uint8_t *)&this->lastCost, sizeof(this->lastCost)) == sizeof(this->lastCost);
+    ok = ok && input.readBytes((uint8_t *)&this->importTotal, sizeof(this->importTotal)) == sizeof(this->importTotal);
+    ok = ok && input.readBytes((uint8_t *)&this->exportTotal, sizeof(this->exportTotal)) == sizeof(this->exportTotal);
+    ok = ok && input.readBytes((uint8_t *)&this->costTotal, sizeof(this->costTotal)) == sizeof(this->costTotal);
+    ok = ok && input.readBytes((uint8_t *)&this->firstEpoch, sizeof(this->firstEpoch)) == sizeof(this->firstEpoch);
+    ok = ok && input.readBytes((uint8_t *)&this->lastEpoch, sizeof(this->lastEpoch)) == sizeof(this->lastEpoch);
+
+    for (uint8_t level = 0; ok && level < SM_ROLLUP_LEVELS; level++) {
+        uint16_t used;
+
+        ok = input.readBytes((uint8_t *)&used, sizeof(used)) == sizeof(used);
+
+        for (uint16_t i = 0; ok && i < used; i++) {
+            smRollupBucket bucket;
+
+            ok = input.readBytes((uint8_t *)&bucket, sizeof(bucket)) == sizeof(bucket);
+
+            // Placed again by time, the file is still good after a change of capacity
+            uint32_t key;
+
+            if (ok && this->getStart((smRollupLevel)level, bucket.start, &key) == bucket.start) {
+                smRollupBucket *stored = &this->levels[level][key % this->capacity[level]];
+
+                if (bucket.start > stored->start) {
+                    *stored = bucket;
+                }
+            }
+        }
+    }
+
+    if (!ok) {
+        this->clear();
+    }
+
+    return ok;
+}
+
+void SmartMeter238Rollup::onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) {
+    if (cmd != SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA) {
+        return;
+    }
+
+    SmartMeter238Clock *clock = sm.getClock();
+    uint32_t epoch = clock->hasEpoch() ? (clock->toEpoch(dataObject->measurementData.timestamp) / 1000000) : time(nullptr);
+
+    // Decoded now if out of the field mask
+    sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_IMPORTENERGY);
+    sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_EXPORTENERGY);
+    sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_PRICEENERGY);
+    sm.getMeasurementField(dataObject, SmartMeter238::SM_FIELD_ACTIVEPOWER);
+
+    this->update(dataObject, epoch);
+}
@@ -0,0 +1,126 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Rollup_h
+#define SmartMeter238Rollup_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+// Import, export and total energy, cost and peak active power of every minute, hour, day and month (local
+// time), from the deltas of the meter counters. Each level is a circular array indexed by the bucket time, so
+// any bucket is one read. Every bucket also keeps the running totals at its start, the energy between two
+// times is the difference of two buckets whatever the length of the range. A counter going back (setReset)
+// starts a new count, nothing is lost.
+//
+// save()/load() use a compact binary form ('S' 'R' version, state, then the used buckets of each level, native
+// byte order) on any Print/Stream, e.g. a file.
+class SmartMeter238Rollup : public SmartMeter238Observer {
+   public:
+    enum smRollupLevel {
+        SM_ROLLUP_MINUTE,
+        SM_ROLLUP_HOUR,
+        SM_ROLLUP_DAY,
+        SM_ROLLUP_MONTH,
+
+        SM_ROLLUP_LEVELS
+    };
+
+    typedef struct {
+        uint32_t start;   // epoch seconds, 0 unused
+
+        float importEnergy;   // kWh in the bucket
+        float exportEnergy;
+        float totalEnergy;
+        float cost;
+        float peakPower;   // kW, max active power of the samples
+
+        float importStart;   // running totals at the start of the bucket
+        float exportStart;
+        float costStart;
+    } smRollupBucket;
+
+    typedef struct {
+        float importEnergy;
+        float exportEnergy;
+        float totalEnergy;
+        float cost;
+    } smRollupTotals;
+
+    SmartMeter238Rollup();
+
+    void setUtcOffset(int32_t seconds);
+    void clear();
+
+    void update(SmartMeter238::smartMeterData *dataObject, uint32_t epoch);
+
+    uint16_t getCapacity(smRollupLevel level);
+    bool getBucket(smRollupLevel level, uint32_t epoch, smRollupBucket *bucket);   // bucket holding epoch
+    bool getRecent(smRollupLevel level, uint16_t age, smRollupBucket *bucket);     // 0 the current bucket
+
+    // Ends are rounded down to the start of the finest bucket still kept, an end after the last sample is the last sample
+    bool getEnergy(uint32_t from, uint32_t to, smRollupTotals *totals);
+
+    size_t save(Print &output);
+    bool load(Stream &input);
+
+    void onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) override;
+
+   private:
+    smRollupBucket minutes[SM_ROLLUP_MINUTES];
+    smRollupBucket hours[SM_ROLLUP_HOURS];
+    smRollupBucket days[SM_ROLLUP_DAYS];
+    smRollupBucket months[SM_ROLLUP_MONTHS];
+
+    smRollupBucket *levels[SM_ROLLUP_LEVELS];
+    uint16_t capacity[SM_ROLLUP_LEVELS];
+
+    int32_t utcOffset = 0;
+
+    // Last counters of the meter, negative before the first sample
+    float lastImport = -1;
+    float lastExport = -1;
+    float lastCost = -1;
+
+    // Running totals since clear()
+    double importTotal = 0;
+    double exportTotal = 0;
+    double costTotal = 0;
+
+    uint32_t firstEpoch = 0;
+    uint32_t lastEpoch = 0;
+
+    // Key: minutes, hours, days or months since epoch (local time), the array index is key % capacity
+    uint32_t getStart(smRollupLevel level, uint32_t epoch, uint32_t *key);
+    uint32_t getKeyStart(smRollupLevel level, uint32_t key);
+    bool getTotalsAt(uint32_t epoch, smRollupTotals *totals);
+
+    static float getDelta(float value, float *last);
+};
+#endif   // SmartMeter238Rollup_h
@@ -0,0 +1,144 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Sampler.h"
+#include "SmartMeter238Clock.h"
+//------------------------------------------------------------------------------
+
+SmartMeter238Sampler::SmartMeter238Sampler(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject, unsigned long period) : sm(sm), dataObject(dataObject) {
+    this->setPeriod(period);
+}
+
+void SmartMeter238Sampler::setPeriod(unsigned long period) {
+    this->period = (uint64_t)max(period, 1UL) * 1000;
+    this->started = false;
+}
+
+unsigned long SmartMeter238Sampler::getPeriod() {
+    return this->period / 1000;
+}
+
+void SmartMeter238Sampler::begin() {
+    this->nextSlot = this->sm.getClock()->now() + this->period;
+    this->started = true;
+}
+
+bool SmartMeter238Sampler::loop() {
+    if (!this->started) {
+        this->begin();
+    }
+
+    uint64_t now = this->sm.getClock()->now();
+
+    if (now + this->latency < this->nextSlot) {
+        return false;
+    }
+
+    // Slots already gone, take the current one
+    if (now > this->nextSlot + this->period) {
+        uint64_t missed = (now - this->nextSlot) / this->period;
+
+        this->missedCount += missed;
+        this->nextSlot += missed * this->period;
+    }
+
+    uint64_t slot = this->nextSlot;
+
+    this->nextSlot += this->period;
+
+    if (!this->sm.getMeasurementData(this->dataObject, true)) {
+        this->failedCount++;
+
+        return false;
+    }
+
+    uint64_t timestamp = this->dataObject->measurementData.timestamp;
+
+    // Latency from request to answer, the next request goes out that much earlier
+    int64_t measured = (int64_t)(timestamp - now);
+
+    if (measured > 0) {
+        int32_t sample = (int32_t)min(measured, (int64_t)this->period);
+
+        if (this->sampleCount == 0) {
+            this->latency = sample;
+        } else {
+            this->latency += (sample - (int32_t)this->latency) / (1 << SM_SAMPLER_LATENCY_SHIFT);
+        }
+    }
+
+    this->jitter = (int32_t)((int64_t)timestamp - (int64_t)slot);
+
+    uint32_t absJitter = (this->jitter < 0) ? -this->jitter : this->jitter;
+
+    this->maxJitter = max(this->maxJitter, absJitter);
+    this->jitterSum += absJitter;
+
+    this->sampleCount++;
+
+    return true;
+}
+
+int32_t SmartMeter238Sampler::getJitter() {
+    return this->jitter;
+}
+
+uint32_t SmartMeter238Sampler::getMaxJitter() {
+    return this->maxJitter;
+}
+
+float SmartMeter238Sampler::getMeanJitter() {
+    return (this->sampleCount > 0) ? (float)this->jitterSum / this->sampleCount : 0;
+}
+
+uint32_t SmartMeter238Sampler::getLatency() {
+    return this->latency;
+}
+
+uint32_t SmartMeter238Sampler::getSampleCount() {
+    return this->sampleCount;
+}
+
+uint32_t SmartMeter238Sampler::getMissedCount() {
+    return this->missedCount;
+}
+
+uint32_t SmartMeter238Sampler::getFailedCount() {
+    return this->failedCount;
+}
+
+void SmartMeter238Sampler::clearStats() {
+    this->jitter = 0;
+    this->maxJitter = 0;
+    this->jitterSum = 0;
+
+    this->sampleCount = 0;
+    this->missedCount = 0;
+    this->failedCount = 0;
+}
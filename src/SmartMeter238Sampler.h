@@ -0,0 +1,79 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Sampler_h
+#define SmartMeter238Sampler_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+// Measurements on a fixed time grid. The slots are absolute (start + n * period) so the time a transaction
+// takes does not accumulate, and each request is sent ahead of its slot by the estimated latency so the
+// timestamp of the answer falls on the slot. Slots that pass while the link is busy are skipped and counted.
+// Call loop() as often as possible.
+class SmartMeter238Sampler {
+   public:
+    SmartMeter238Sampler(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject, unsigned long period);
+
+    void setPeriod(unsigned long period);   // millis
+    unsigned long getPeriod();
+
+    void begin();
+    bool loop();   // true when a measurement was taken
+
+    int32_t getJitter();       // micros from the slot to the answer timestamp of the last sample
+    uint32_t getMaxJitter();   // max absolute jitter
+    float getMeanJitter();     // mean absolute jitter
+    uint32_t getLatency();     // estimated micros from request to answer
+
+    uint32_t getSampleCount();
+    uint32_t getMissedCount();  // slots skipped
+    uint32_t getFailedCount();  // requests without answer
+
+    void clearStats();
+
+   private:
+    SmartMeter238 &sm;
+    SmartMeter238::smartMeterData *dataObject;
+
+    uint64_t period;
+    uint64_t nextSlot = 0;
+    bool started = false;
+
+    uint32_t latency = 0;
+
+    int32_t jitter = 0;
+    uint32_t maxJitter = 0;
+    uint64_t jitterSum = 0;
+
+    uint32_t sampleCount = 0;
+    uint32_t missedCount = 0;
+    uint32_t failedCount = 0;
+};
+#endif   // SmartMeter238Sampler_h
@@ -0,0 +1,104 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Snapshot.h"
+//------------------------------------------------------------------------------
+
+SmartMeter238Snapshot::SmartMeter238Snapshot() {
+    this->sequence[0].store(0);
+    this->sequence[1].store(0);
+    this->version.store(0);
+    this->retryCount.store(0);
+}
+
+void SmartMeter238Snapshot::publish(SmartMeter238::smartMeterData *dataObject) {
+    // Write the buffer that readers are not using, the sequence is odd while it is written
+    uint32_t next = this->version.load(std::memory_order_relaxed) + 1;
+    uint8_t index = next & 1;
+
+    uint32_t seq = this->sequence[index].load(std::memory_order_relaxed);
+
+    this->sequence[index].store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    this->buffer[index] = *dataObject;
+    this->bufferVersion[index] = next;
+
+    this->sequence[index].store(seq + 2, std::memory_order_release);
+    this->version.store(next, std::memory_order_release);
+}
+
+uint32_t SmartMeter238Snapshot::read(SmartMeter238::smartMeterData *dataObject) {
+    while (true) {
+        uint32_t current = this->version.load(std::memory_order_acquire);
+
+        if (current == 0) {
+            return 0;   // nothing published yet
+        }
+
+        uint8_t index = current & 1;
+
+        uint32_t seqStart = this->sequence[index].load(std::memory_order_acquire);
+
+        if (!(seqStart & 1)) {
+            *dataObject = this->buffer[index];
+            uint32_t readVersion = this->bufferVersion[index];
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (this->sequence[index].load(std::memory_order_relaxed) == seqStart) {
+                return readVersion;
+            }
+        }
+
+        // The poller published twice while reading, try again with the newest buffer
+        this->retryCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+uint32_t SmartMeter238Snapshot::getVersion() {
+    return this->version.load(std::memory_order_acquire);
+}
+
+uint32_t SmartMeter238Snapshot::getRetryCount(bool clear) {
+    if (clear) {
+        return this->retryCount.exchange(0, std::memory_order_relaxed);
+    }
+
+    return this->retryCount.load(std::memory_order_relaxed);
+}
+
+void SmartMeter238Snapshot::onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) {
+    // Readers of the copy have no access to the frame decoder
+    if (cmd == SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA) {
+        sm.decodeMeasurementFields(dataObject);
+    }
+
+    this->publish(dataObject);
+}
@@ -0,0 +1,61 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Snapshot_h
+#define SmartMeter238Snapshot_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+#include <atomic>
+
+// Latest data for readers in other tasks/threads. The poller publishes into one of two buffers, each guarded
+// by a sequence counter, so a reader never blocks the poller and never gets fields from different answers.
+// Only one task may publish.
+class SmartMeter238Snapshot : public SmartMeter238Observer {
+   public:
+    SmartMeter238Snapshot();
+
+    void publish(SmartMeter238::smartMeterData *dataObject);
+    uint32_t read(SmartMeter238::smartMeterData *dataObject);
+
+    uint32_t getVersion();
+    uint32_t getRetryCount(bool clear = false);
+
+    void onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) override;
+
+   private:
+    SmartMeter238::smartMeterData buffer[2];
+    uint32_t bufferVersion[2] = {0, 0};
+
+    std::atomic<uint32_t> sequence[2];
+    std::atomic<uint32_t> version;
+    std::atomic<uint32_t> retryCount;
+};
+#endif   // SmartMeter238Snapshot_h
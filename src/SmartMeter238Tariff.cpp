@@ -0,0 +1,275 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Tariff.h"
+//------------------------------------------------------------------------------
+
+SmartMeter238Tariff::SmartMeter238Tariff() {
+    this->clear();
+}
+
+void SmartMeter238Tariff::clear() {
+    memset(this->slotTable, 0, sizeof(this->slotTable));
+
+    for (uint8_t i = 0; i < SM_TARIFF_MAX_BANDS; i++) {
+        this->bandPrice[i] = 0;
+    }
+
+    for (uint8_t i = 0; i < SM_TARIFF_MAX_TIERS; i++) {
+        this->tierLimit[i] = 0;
+        this->tierPrice[i] = 0;
+    }
+
+    this->tierCount = 0;
+    this->dailyCharge = 0;
+    this->billingDay = 1;
+    this->utcOffset = 0;
+}
+
+bool SmartMeter238Tariff::setBandPrice(uint8_t band, float priceKWh) {
+    if (band >= SM_TARIFF_MAX_BANDS || priceKWh < SM_MIN_ENERGY_PRICE || priceKWh > SM_MAX_ENERGY_PRICE) {
+        return false;
+    }
+
+    this->bandPrice[band] = priceKWh;
+
+    return true;
+}
+
+bool SmartMeter238Tariff::setBand(uint8_t band, uint8_t weekdayMask, uint16_t startMinute, uint16_t endMinute) {
+    if (band >= SM_TARIFF_MAX_BANDS || startMinute > 1440 || endMinute > 1440) {
+        return false;
+    }
+
+    // The table has no finer resolution than a slot, and an empty band would be taken as the whole day
+    if ((startMinute % SM_TARIFF_SLOT_MINUTES) != 0 || (endMinute % SM_TARIFF_SLOT_MINUTES) != 0) {
+        return false;
+    }
+
+    if (startMinute == endMinute) {
+        return false;
+    }
+
+    uint16_t startSlot = startMinute / SM_TARIFF_SLOT_MINUTES;
+    uint16_t endSlot = endMinute / SM_TARIFF_SLOT_MINUTES;
+
+    for (uint8_t weekday = 0; weekday < 7; weekday++) {
+        if (!(weekdayMask & (1 << weekday))) {
+            continue;
+        }
+
+        for (uint16_t slot = 0; slot < SM_TARIFF_SLOTS_PER_DAY; slot++) {
+            bool inBand;
+
+            if (startSlot < endSlot) {
+                inBand = (slot >= startSlot && slot < endSlot);
+            } else {
+                inBand = (slot >= startSlot || slot < endSlot);   // wraps midnight
+            }
+
+            if (inBand) {
+                uint16_t index = (weekday * SM_TARIFF_SLOTS_PER_DAY) + slot;
+
+                if (index & 1) {
+                    this->slotTable[index >> 1] = (this->slotTable[index >> 1] & 0x0F) | (band << 4);
+                } else {
+                    this->slotTable[index >> 1] = (this->slotTable[index >> 1] & 0xF0) | band;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool SmartMeter238Tariff::setTier(uint8_t tier, float upToKWh, float priceKWh) {
+    // Tiers are set in order and the limits must grow, the last tier has no upper limit
+    if (tier >= SM_TARIFF_MAX_TIERS || tier > this->tierCount) {
+        return false;
+    }
+
+    if (tier > 0 && upToKWh <= this->tierLimit[tier - 1]) {
+        return false;
+    }
+
+    if (priceKWh < -SM_MAX_ENERGY_PRICE || priceKWh > SM_MAX_ENERGY_PRICE) {
+        return false;
+    }
+
+    this->tierLimit[tier] = upToKWh;
+    this->tierPrice[tier] = priceKWh;
+
+    if (tier == this->tierCount) {
+        this->tierCount++;
+    }
+
+    return true;
+}
+
+void SmartMeter238Tariff::setDailyCharge(float charge) {
+    this->dailyCharge = charge;
+}
+
+bool SmartMeter238Tariff::setBillingDay(uint8_t day) {
+    if (day < 1 || day > 28) {
+        return false;
+    }
+
+    this->billingDay = day;
+
+    return true;
+}
+
+void SmartMeter238Tariff::setUtcOffset(int32_t seconds) {
+    this->utcOffset = seconds;
+}
+
+uint8_t SmartMeter238Tariff::getBand(uint32_t epoch) {
+    if (epoch < SM_TARIFF_MIN_VALID_EPOCH) {
+        return 0;
+    }
+
+    uint32_t local = epoch + this->utcOffset;
+    uint32_t day = local / 86400;
+
+    uint16_t index = (((day + 4) % 7) * SM_TARIFF_SLOTS_PER_DAY) + ((local % 86400) / (SM_TARIFF_SLOT_MINUTES * 60));   // 1970-01-01 was thursday
+
+    if (index & 1) {
+        return this->slotTable[index >> 1] >> 4;
+    }
+
+    return this->slotTable[index >> 1] & 0x0F;
+}
+
+uint8_t SmartMeter238Tariff::getTier(float periodKWh) {
+    for (uint8_t i = 0; (i + 1) < this->tierCount; i++) {
+        if (periodKWh < this->tierLimit[i]) {
+            return i;
+        }
+    }
+
+    return this->tierCount > 0 ? this->tierCount - 1 : 0;
+}
+
+uint32_t SmartMeter238Tariff::getPeriod(uint32_t day) {
+    // Civil date from days since epoch, months are counted from march
+    uint32_t z = day + 719468;
+    uint32_t era = z / 146097;
+    uint32_t doe = z - (era * 146097);
+    uint32_t yoe = (doe - (doe / 1460) + (doe / 36524) - (doe / 146096)) / 365;
+    uint32_t doy = doe - ((365 * yoe) + (yoe / 4) - (yoe / 100));
+    uint32_t mp = ((5 * doy) + 2) / 153;
+    uint32_t dayOfMonth = doy - (((153 * mp) + 2) / 5) + 1;
+
+    uint32_t period = ((yoe + (era * 400)) * 12) + mp;
+
+    if (dayOfMonth < this->billingDay) {
+        period--;
+    }
+
+    return period;
+}
+
+void SmartMeter238Tariff::accumulate(SmartMeter238::smartMeterData *dataObject, uint32_t epoch) {
+    float totalEnergy = dataObject->measurementData.data.lapseOfTimeTotalEnergy;
+    float delta = totalEnergy - dataObject->powerCompanyData.data.lastTotalEnergy;
+
+    if (dataObject->powerCompanyData.data.lastTotalEnergy < 0) {
+        delta = 0;   // first sample, the energy before it is not attributed to any band
+    } else if (delta < 0) {
+        delta = totalEnergy;   // the meter counters were reset
+    }
+
+    dataObject->powerCompanyData.data.lastTotalEnergy = totalEnergy;
+
+    uint8_t band = this->getBand(epoch);
+
+    if (epoch >= SM_TARIFF_MIN_VALID_EPOCH) {
+        uint32_t day = (epoch + this->utcOffset) / 86400;
+
+        if (day > dataObject->powerCompanyData.data.lastDay) {
+            if (dataObject->powerCompanyData.data.lastDay == 0) {
+                dataObject->powerCompanyData.data.fixedCost += this->dailyCharge;
+            } else {
+                dataObject->powerCompanyData.data.fixedCost += this->dailyCharge * (day - dataObject->powerCompanyData.data.lastDay);
+            }
+
+            uint32_t period = this->getPeriod(day);
+
+            if (period != dataObject->powerCompanyData.data.lastPeriod) {
+                dataObject->powerCompanyData.data.periodKWh = 0;
+                dataObject->powerCompanyData.data.lastPeriod = period;
+            }
+
+            dataObject->powerCompanyData.data.lastDay = day;
+        }
+    }
+
+    // A delta can cross a tier limit, every tier gets its own part
+    float cost = 0;
+    float remaining = delta;
+
+    for (uint8_t n = 0; n <= this->tierCount && remaining > 0; n++) {
+        uint8_t tier = this->getTier(dataObject->powerCompanyData.data.periodKWh);
+        float chunk = remaining;
+
+        if ((tier + 1) < this->tierCount && n < this->tierCount) {
+            float room = this->tierLimit[tier] - dataObject->powerCompanyData.data.periodKWh;
+
+            if (room < chunk) {
+                chunk = room;
+            }
+        }
+
+        float price = this->bandPrice[band];
+
+        if (this->tierCount > 0) {
+            price += this->tierPrice[tier];
+        }
+
+        cost += chunk * price;
+
+        dataObject->powerCompanyData.data.periodKWh += chunk;
+        remaining -= chunk;
+    }
+
+    dataObject->powerCompanyData.data.bandKWh[band] += delta;
+    dataObject->powerCompanyData.data.bandCost[band] += cost;
+
+    dataObject->powerCompanyData.data.activeBand = band;
+    dataObject->powerCompanyData.data.activeTier = this->getTier(dataObject->powerCompanyData.data.periodKWh);
+
+    float totalCost = dataObject->powerCompanyData.data.fixedCost;
+
+    for (uint8_t i = 0; i < SM_TARIFF_MAX_BANDS; i++) {
+        totalCost += dataObject->powerCompanyData.data.bandCost[i];
+    }
+
+    dataObject->measurementData.data.lapseOfTimePriceEnergy = totalCost;
+}
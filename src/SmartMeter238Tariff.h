@@ -0,0 +1,80 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Tariff_h
+#define SmartMeter238Tariff_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+#define SM_TARIFF_ALL_DAYS 0x7F   // weekday mask, bit 0 = sunday ... bit 6 = saturday
+#define SM_TARIFF_WORKDAYS 0x3E
+#define SM_TARIFF_WEEKEND 0x41
+
+// Time of use tariff: the week is divided in slots of SM_TARIFF_SLOT_MINUTES and each slot
+// points to a band with its own price. Tiers add a price per kWh depending on the energy
+// consumed in the billing period, and a fixed charge is added once per day.
+class SmartMeter238Tariff {
+   public:
+    SmartMeter238Tariff();
+
+    void clear();
+
+    bool setBandPrice(uint8_t band, float priceKWh);
+    // Minutes of the day on slot boundaries, end excluded; a band from 22:00 to 6:00 wraps midnight, 0 to 1440 is
+    // the whole day. The limit of the last tier set is not used, it takes all the energy above the previous one.
+    bool setBand(uint8_t band, uint8_t weekdayMask, uint16_t startMinute, uint16_t endMinute);
+    bool setTier(uint8_t tier, float upToKWh, float priceKWh);
+
+    void setDailyCharge(float charge);
+    bool setBillingDay(uint8_t day);
+    void setUtcOffset(int32_t seconds);
+
+    uint8_t getBand(uint32_t epoch);
+    uint8_t getTier(float periodKWh);
+
+    void accumulate(SmartMeter238::smartMeterData *dataObject, uint32_t epoch);
+
+   private:
+    // Two slots per byte, low nibble first
+    uint8_t slotTable[(7 * SM_TARIFF_SLOTS_PER_DAY + 1) / 2];
+
+    float bandPrice[SM_TARIFF_MAX_BANDS];
+
+    float tierLimit[SM_TARIFF_MAX_TIERS];
+    float tierPrice[SM_TARIFF_MAX_TIERS];
+    uint8_t tierCount = 0;
+
+    float dailyCharge = 0;
+    uint8_t billingDay = 1;
+    int32_t utcOffset = 0;
+
+    uint32_t getPeriod(uint32_t day);
+};
+#endif   // SmartMeter238Tariff_h
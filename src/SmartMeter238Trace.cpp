@@ -0,0 +1,420 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Trace.h"
+//------------------------------------------------------------------------------
+
+SmartMeter238Trace::SmartMeter238Trace() {}
+
+void SmartMeter238Trace::begin(Print &out) {
+    this->out = &out;
+
+    this->out->write(SM_TRACE_MAGIC_0);
+    this->out->write(SM_TRACE_MAGIC_1);
+    this->out->write(SM_TRACE_MAGIC_2);
+    this->out->write(SM_TRACE_MAGIC_3);
+
+    this->lastMicros = micros();
+
+    this->byteCount = 0;
+    this->lostCount = 0;
+}
+
+void SmartMeter238Trace::end() {
+    if (this->out != nullptr) {
+        this->out->flush();
+    }
+
+    this->out = nullptr;
+}
+
+void SmartMeter238Trace::record(uint8_t direction, uint8_t byte) {
+    if (this->out == nullptr) {
+        return;
+    }
+
+    unsigned long now = micros();
+    uint32_t delta = now - this->lastMicros;
+
+    this->lastMicros = now;
+
+    if (delta > SM_TRACE_MAX_DELTA) {
+        delta = SM_TRACE_MAX_DELTA;
+    }
+
+    uint32_t value = (delta << 1) | (direction & 1);
+
+    uint8_t recordArr[6];
+    uint8_t size = 0;
+
+    while (value >= 0x80) {
+        recordArr[size] = (value & 0x7F) | 0x80;
+        size++;
+
+        value >>= 7;
+    }
+
+    recordArr[size] = value;
+    size++;
+
+    recordArr[size] = byte;
+    size++;
+
+    if (this->out->write(recordArr, size) == size) {
+        this->byteCount++;
+    } else {
+        this->lostCount++;
+    }
+}
+
+uint32_t SmartMeter238Trace::getByteCount() {
+    return this->byteCount;
+}
+
+uint32_t SmartMeter238Trace::getLostCount() {
+    return this->lostCount;
+}
+
+//------------------------------------------------------------------------------
+//
+//------------------------------------------------------------------------------
+
+SmartMeter238TraceBuffer::SmartMeter238TraceBuffer(uint8_t *buffer, size_t size) : buffer(buffer), size(size) {}
+
+void SmartMeter238TraceBuffer::clear() {
+    this->length = 0;
+    this->position = 0;
+}
+
+void SmartMeter238TraceBuffer::rewind() {
+    this->position = 0;
+}
+
+size_t SmartMeter238TraceBuffer::getLength() {
+    return this->length;
+}
+
+uint8_t *SmartMeter238TraceBuffer::getBuffer() {
+    return this->buffer;
+}
+
+size_t SmartMeter238TraceBuffer::write(uint8_t byte) {
+    if (this->length >= this->size) {
+        return 0;
+    }
+
+    this->buffer[this->length] = byte;
+    this->length++;
+
+    return 1;
+}
+
+int SmartMeter238TraceBuffer::available() {
+    return this->length - this->position;
+}
+
+int SmartMeter238TraceBuffer::read() {
+    if (this->position >= this->length) {
+        return -1;
+    }
+
+    return this->buffer[this->position++];
+}
+
+int SmartMeter238TraceBuffer::peek() {
+    if (this->position >= this->length) {
+        return -1;
+    }
+
+    return this->buffer[this->position];
+}
+
+//------------------------------------------------------------------------------
+//
+//------------------------------------------------------------------------------
+
+#if !defined(ARDUINO)
+SmartMeter238TraceFile::SmartMeter238TraceFile() {}
+
+SmartMeter238TraceFile::~SmartMeter238TraceFile() {
+    this->close();
+}
+
+bool SmartMeter238TraceFile::open(const char *path, bool writing) {
+    this->close();
+
+    this->file = fopen(path, writing ? "wb" : "rb");
+
+    if (this->file == nullptr) {
+        return false;
+    }
+
+    this->position = 0;
+    this->size = 0;
+
+    if (!writing) {
+        fseek(this->file, 0, SEEK_END);
+        this->size = ftell(this->file);
+        fseek(this->file, 0, SEEK_SET);
+    }
+
+    return true;
+}
+
+void SmartMeter238TraceFile::close() {
+    if (this->file != nullptr) {
+        fclose(this->file);
+        this->file = nullptr;
+    }
+}
+
+bool SmartMeter238TraceFile::isOpen() {
+    return this->file != nullptr;
+}
+
+size_t SmartMeter238TraceFile::write(uint8_t byte) {
+    return this->write(&byte, 1);
+}
+
+size_t SmartMeter238TraceFile::write(const uint8_t *buffer, size_t size) {
+    if (this->file == nullptr) {
+        return 0;
+    }
+
+    return fwrite(buffer, 1, size, this->file);
+}
+
+void SmartMeter238TraceFile::flush() {
+    if (this->file != nullptr) {
+        fflush(this->file);
+    }
+}
+
+int SmartMeter238TraceFile::available() {
+    return (this->file != nullptr) ? this->size - this->position : 0;
+}
+
+int SmartMeter238TraceFile::read() {
+    int byte = (this->file != nullptr) ? fgetc(this->file) : EOF;
+
+    if (byte == EOF) {
+        return -1;
+    }
+
+    this->position++;
+
+    return byte;
+}
+
+int SmartMeter238TraceFile::peek() {
+    int byte = (this->file != nullptr) ? fgetc(this->file) : EOF;
+
+    if (byte == EOF) {
+        return -1;
+    }
+
+    ungetc(byte, this->file);
+
+    return byte;
+}
+#endif
+
+//------------------------------------------------------------------------------
+//
+//------------------------------------------------------------------------------
+
+SmartMeter238Replay::SmartMeter238Replay(Stream &trace, bool realTime) : trace(trace), realTime(realTime) {}
+
+bool SmartMeter238Replay::begin() {
+    this->pendingValid = false;
+    this->traceEnd = false;
+
+    this->rxHead = 0;
+    this->rxBufferCount = 0;
+
+    this->rxTotal = 0;
+    this->txCount = 0;
+    this->txMismatchCount = 0;
+    this->droppedCount = 0;
+
+    this->dueMicros = micros();
+
+    if (this->trace.read() != SM_TRACE_MAGIC_0 || this->trace.read() != SM_TRACE_MAGIC_1 || this->trace.read() != SM_TRACE_MAGIC_2 || this->trace.read() != SM_TRACE_MAGIC_3) {
+        this->traceEnd = true;
+
+        return false;
+    }
+
+    return true;
+}
+
+bool SmartMeter238Replay::finished() {
+    return !this->fetchRecord() && this->rxBufferCount == 0;
+}
+
+bool SmartMeter238Replay::fetchRecord() {
+    if (this->pendingValid) {
+        return true;
+    }
+
+    if (this->traceEnd) {
+        return false;
+    }
+
+    uint32_t value = 0;
+    uint8_t shift = 0;
+
+    while (true) {
+        int c = this->trace.read();
+
+        if (c < 0 || shift > 28) {
+            this->traceEnd = true;   // end of trace or corrupted record
+
+            return false;
+        }
+
+        value |= (uint32_t)(c & 0x7F) << shift;
+        shift += 7;
+
+        if (!(c & 0x80)) {
+            break;
+        }
+    }
+
+    int byte = this->trace.read();
+
+    if (byte < 0) {
+        this->traceEnd = true;
+
+        return false;
+    }
+
+    this->pendingDirection = value & 1;
+    this->pendingDelta = value >> 1;
+    this->pendingByte = byte;
+    this->pendingValid = true;
+
+    if (!this->realTime && this->pendingDelta > SM_TRACE_FAST_GAP_MICROS) {
+        this->dueMicros += SM_TRACE_FAST_GAP_MICROS;
+    } else {
+        this->dueMicros += this->pendingDelta;
+    }
+
+    return true;
+}
+
+void SmartMeter238Replay::fillBuffer() {
+    while (this->rxBufferCount < SM_TRACE_REPLAY_BUFFER) {
+        if (!this->fetchRecord() || this->pendingDirection != SM_TRACE_RX) {
+            return;   // wait for the frame that is sent next
+        }
+
+        if ((long)(micros() - this->dueMicros) < 0) {
+            return;   // not yet received
+        }
+
+        this->rxBuffer[(this->rxHead + this->rxBufferCount) % SM_TRACE_REPLAY_BUFFER] = this->pendingByte;
+        this->rxBufferCount++;
+        this->rxTotal++;
+
+        this->pendingValid = false;
+    }
+}
+
+size_t SmartMeter238Replay::write(uint8_t byte) {
+    this->txCount++;
+
+    // Received bytes that were not released before this frame are lost, as with the meter
+    while (this->fetchRecord() && this->pendingDirection == SM_TRACE_RX) {
+        this->pendingValid = false;
+        this->droppedCount++;
+    }
+
+    if (this->pendingValid) {
+        if (this->pendingByte != byte) {
+            this->txMismatchCount++;
+        }
+
+        this->pendingValid = false;
+    } else {
+        this->txMismatchCount++;   // the trace has ended
+    }
+
+    // The answer is timed from the frame sent
+    this->dueMicros = micros();
+
+    return 1;
+}
+
+int SmartMeter238Replay::available() {
+    this->fillBuffer();
+
+    return this->rxBufferCount;
+}
+
+int SmartMeter238Replay::read() {
+    this->fillBuffer();
+
+    if (this->rxBufferCount == 0) {
+        return -1;
+    }
+
+    uint8_t byte = this->rxBuffer[this->rxHead];
+
+    this->rxHead = (this->rxHead + 1) % SM_TRACE_REPLAY_BUFFER;
+    this->rxBufferCount--;
+
+    return byte;
+}
+
+int SmartMeter238Replay::peek() {
+    this->fillBuffer();
+
+    if (this->rxBufferCount == 0) {
+        return -1;
+    }
+
+    return this->rxBuffer[this->rxHead];
+}
+
+uint32_t SmartMeter238Replay::getRxCount() {
+    return this->rxTotal;
+}
+
+uint32_t SmartMeter238Replay::getTxCount() {
+    return this->txCount;
+}
+
+uint32_t SmartMeter238Replay::getTxMismatchCount() {
+    return this->txMismatchCount;
+}
+
+uint32_t SmartMeter238Replay::getDroppedCount() {
+    return this->droppedCount;
+}
@@ -0,0 +1,174 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Trace_h
+#define SmartMeter238Trace_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+#if SM_TRACE_REPLAY_BUFFER > 255
+#error "SM_TRACE_REPLAY_BUFFER must be 255 or less"
+#endif
+
+#define SM_TRACE_RX 0
+#define SM_TRACE_TX 1
+
+// File header, followed by one record per byte:
+// varint((micros since previous record << 1) | direction) + byte
+#define SM_TRACE_MAGIC_0 'S'
+#define SM_TRACE_MAGIC_1 'M'
+#define SM_TRACE_MAGIC_2 'T'
+#define SM_TRACE_MAGIC_3 '1'
+
+#define SM_TRACE_MAX_DELTA 0x7FFFFFFFUL
+
+// Capture of every byte sent and received by SmartMeter238, the output can be a File or a SmartMeter238TraceBuffer
+class SmartMeter238Trace {
+   public:
+    SmartMeter238Trace();
+
+    void begin(Print &out);
+    void end();
+
+    void record(uint8_t direction, uint8_t byte);
+
+    uint32_t getByteCount();
+    uint32_t getLostCount();
+
+   private:
+    Print *out = nullptr;
+
+    unsigned long lastMicros = 0;
+
+    uint32_t byteCount = 0;
+    uint32_t lostCount = 0;
+};
+
+// Trace in a memory buffer given by the user, what is written can be read back
+class SmartMeter238TraceBuffer : public Stream {
+   public:
+    SmartMeter238TraceBuffer(uint8_t *buffer, size_t size);
+
+    void clear();
+    void rewind();
+
+    size_t getLength();
+    uint8_t *getBuffer();
+
+    size_t write(uint8_t byte) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    int peek() override;
+
+   private:
+    uint8_t *buffer;
+    size_t size;
+
+    size_t length = 0;
+    size_t position = 0;
+};
+
+#if !defined(ARDUINO)
+// Trace in a file on disk for host builds (tests, tools), which have no FS. Opened to write a capture or to read
+// it back for a replay
+class SmartMeter238TraceFile : public Stream {
+   public:
+    SmartMeter238TraceFile();
+    virtual ~SmartMeter238TraceFile();
+
+    bool open(const char *path, bool writing);
+    void close();
+    bool isOpen();
+
+    size_t write(uint8_t byte) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+    void flush() override;
+
+    int available() override;
+    int read() override;
+    int peek() override;
+
+   private:
+    FILE *file = nullptr;
+
+    long size = 0;
+    long position = 0;
+};
+#endif
+
+// Transport that plays a trace back to SmartMeter238 in place of the meter. The received bytes are released
+// after each sent frame with the recorded timing (realTime) or with the gaps shortened to SM_TRACE_FAST_GAP_MICROS
+class SmartMeter238Replay : public Stream {
+   public:
+    SmartMeter238Replay(Stream &trace, bool realTime = false);
+
+    bool begin();
+    bool finished();
+
+    size_t write(uint8_t byte) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    int peek() override;
+
+    uint32_t getRxCount();
+    uint32_t getTxCount();
+    uint32_t getTxMismatchCount();
+    uint32_t getDroppedCount();
+
+   private:
+    Stream &trace;
+    bool realTime;
+
+    bool pendingValid = false;
+    bool traceEnd = false;
+    uint8_t pendingDirection = SM_TRACE_RX;
+    uint8_t pendingByte = 0;
+    uint32_t pendingDelta = 0;
+
+    unsigned long dueMicros = 0;
+
+    uint8_t rxBuffer[SM_TRACE_REPLAY_BUFFER];
+    uint8_t rxHead = 0;
+    uint8_t rxBufferCount = 0;
+
+    uint32_t rxTotal = 0;
+    uint32_t txCount = 0;
+    uint32_t txMismatchCount = 0;
+    uint32_t droppedCount = 0;
+
+    bool fetchRecord();
+    void fillBuffer();
+};
+#endif   // SmartMeter238Trace_h
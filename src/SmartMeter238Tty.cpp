@@ -0,0 +1,151 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Tty.h"
+//------------------------------------------------------------------------------
+
+#if !defined(ARDUINO)
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+static speed_t smTtySpeed(uint32_t baud) {
+    switch (baud) {
+        case 1200:
+            return B1200;
+        case 2400:
+            return B2400;
+        case 4800:
+            return B4800;
+        case 19200:
+            return B19200;
+        case 38400:
+            return B38400;
+        case 57600:
+            return B57600;
+        case 115200:
+            return B115200;
+        default:
+            return B9600;
+    }
+}
+
+SmartMeter238Tty::SmartMeter238Tty() {}
+
+SmartMeter238Tty::~SmartMeter238Tty() {
+    this->close();
+}
+
+bool SmartMeter238Tty::open(const char *path, uint32_t baud) {
+    this->close();
+
+    this->fd = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+
+    if (this->fd < 0) {
+        return false;
+    }
+
+    struct termios settings;
+
+    // A pty takes the settings too, they are ignored
+    if (tcgetattr(this->fd, &settings) == 0) {
+        cfmakeraw(&settings);
+        cfsetispeed(&settings, smTtySpeed(baud));
+        cfsetospeed(&settings, smTtySpeed(baud));
+
+        settings.c_cflag |= CLOCAL | CREAD;
+        settings.c_cflag &= ~(CSTOPB | CRTSCTS);
+
+        tcsetattr(this->fd, TCSANOW, &settings);
+        tcflush(this->fd, TCIOFLUSH);
+    }
+
+    this->bufferStart = 0;
+    this->bufferEnd = 0;
+
+    return true;
+}
+
+void SmartMeter238Tty::close() {
+    if (this->fd >= 0) {
+        ::close(this->fd);
+        this->fd = -1;
+    }
+}
+
+bool SmartMeter238Tty::isOpen() {
+    return this->fd >= 0;
+}
+
+int SmartMeter238Tty::getFd() {
+    return this->fd;
+}
+
+size_t SmartMeter238Tty::write(uint8_t byte) {
+    return this->write(&byte, 1);
+}
+
+size_t SmartMeter238Tty::write(const uint8_t *buffer, size_t size) {
+    if (this->fd < 0) {
+        return 0;
+    }
+
+    ssize_t n = ::write(this->fd, buffer, size);
+
+    return (n < 0) ? 0 : n;
+}
+
+int SmartMeter238Tty::available() {
+    // One read() for all the bytes that have arrived, not one by byte
+    if (this->bufferStart == this->bufferEnd && this->fd >= 0) {
+        ssize_t n = ::read(this->fd, this->buffer, sizeof(this->buffer));
+
+        this->bufferStart = 0;
+        this->bufferEnd = (n > 0) ? n : 0;
+    }
+
+    return this->bufferEnd - this->bufferStart;
+}
+
+int SmartMeter238Tty::read() {
+    if (this->available() == 0) {
+        return -1;
+    }
+
+    return this->buffer[this->bufferStart++];
+}
+
+int SmartMeter238Tty::peek() {
+    if (this->available() == 0) {
+        return -1;
+    }
+
+    return this->buffer[this->bufferStart];
+}
+#endif
@@ -0,0 +1,66 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Tty_h
+#define SmartMeter238Tty_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+#if !defined(ARDUINO)
+// Serial port of a Linux host (USB-RS485/UART adapter or pty) as the stream of a meter, for a gateway that reads
+// many meters with SmartMeter238Poller. Raw 8N1 and non blocking, getFd() goes in epoll/poll to wait for answers.
+// flush() does not wait for the bytes to leave, so one meter does not hold the loop of the others.
+class SmartMeter238Tty : public Stream {
+   public:
+    SmartMeter238Tty();
+    virtual ~SmartMeter238Tty();
+
+    bool open(const char *path, uint32_t baud = SM_UART_BAUD);
+    void close();
+    bool isOpen();
+    int getFd();
+
+    size_t write(uint8_t byte) override;
+    size_t write(const uint8_t *buffer, size_t size) override;
+    using Print::write;
+
+    int available() override;
+    int read() override;
+    int peek() override;
+
+   private:
+    int fd = -1;
+
+    uint8_t buffer[SM_MAX_BYTE_MSG_BUFFER];   // bytes read from the port and not taken yet
+    uint8_t bufferStart = 0;
+    uint8_t bufferEnd = 0;
+};
+#endif
+#endif   // SmartMeter238Tty_h
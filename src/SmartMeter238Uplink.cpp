@@ -0,0 +1,459 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Uplink.h"
+#include "SmartMeter238Clock.h"
+//------------------------------------------------------------------------------
+
+SmartMeter238ClientSink::SmartMeter238ClientSink(Client &client) : client(client) {
+}
+
+bool SmartMeter238ClientSink::isReady() {
+    if (!this->client.connected()) {
+        // A packet cut by the disconnection goes again from the start
+        this->offset = 0;
+
+        return false;
+    }
+
+    return true;
+}
+
+bool SmartMeter238ClientSink::send(const uint8_t *packet, size_t size) {
+    if (!this->isReady()) {
+        return false;
+    }
+
+    this->offset += this->client.write(packet + this->offset, size - this->offset);
+
+    if (this->offset < size) {
+        return false;
+    }
+
+    this->offset = 0;
+
+    return true;
+}
+
+void SmartMeter238ClientSink::reset() {
+    if (this->offset > 0) {
+        this->client.stop();
+    }
+
+    this->offset = 0;
+}
+
+#if defined(ESP8266) || defined(ESP32)
+SmartMeter238FileSpill::SmartMeter238FileSpill(fs::FS &fs, const char *path, uint32_t maxSize) : fs(fs), path(path), maxSize(maxSize) {
+}
+
+bool SmartMeter238FileSpill::begin() {
+    this->readPos = sizeof(uint32_t);
+    this->count = 0;
+    this->headLength = 0;
+    this->damaged = false;
+
+    if (!this->fs.exists(this->path)) {
+        return true;
+    }
+
+    File file = this->fs.open(this->path, "r");
+
+    if (!file) {
+        return false;
+    }
+
+    uint32_t size = file.size();
+    uint32_t pos = 0;
+
+    if (file.read((uint8_t *)&pos, sizeof(pos)) != sizeof(pos) || pos < sizeof(pos) || pos > size) {
+        file.close();
+        this->clear();
+
+        return true;
+    }
+
+    this->readPos = pos;
+
+    // Count the packets left, one cut by a reset ends the file
+    while (pos + sizeof(uint16_t) <= size) {
+        uint16_t length = 0;
+
+        file.seek(pos);
+        file.read((uint8_t *)&length, sizeof(length));
+
+        if (pos + sizeof(length) + length > size) {
+            break;
+        }
+
+        pos += sizeof(length) + length;
+        this->count++;
+    }
+
+    file.close();
+
+    if (this->count == 0) {
+        this->clear();
+    } else if (pos < size) {
+        this->damaged = true;
+    }
+
+    return true;
+}
+
+void SmartMeter238FileSpill::clear() {
+    if (this->fs.exists(this->path)) {
+        this->fs.remove(this->path);
+    }
+
+    this->readPos = sizeof(uint32_t);
+    this->count = 0;
+    this->headLength = 0;
+    this->damaged = false;
+}
+
+bool SmartMeter238FileSpill::push(const uint8_t *packet, size_t size) {
+    if (this->damaged || size == 0 || size > 0xFFFF) {
+        return false;
+    }
+
+    bool created = !this->fs.exists(this->path);
+
+    File file = this->fs.open(this->path, created ? "w" : "a");
+
+    if (!file) {
+        return false;
+    }
+
+    if (created) {
+        this->readPos = sizeof(uint32_t);
+
+        file.write((const uint8_t *)&this->readPos, sizeof(this->readPos));
+    }
+
+    if (file.size() + sizeof(uint16_t) + size > this->maxSize) {
+        file.close();
+
+        return false;
+    }
+
+    uint16_t length = size;
+
+    bool written = (file.write((const uint8_t *)&length, sizeof(length)) == sizeof(length)) && (file.write(packet, size) == size);
+
+    file.close();
+
+    if (!written) {
+        this->damaged = true;
+
+        return false;
+    }
+
+    this->count++;
+
+    return true;
+}
+
+size_t SmartMeter238FileSpill::peek(uint8_t *packet, size_t maxSize) {
+    if (this->count == 0) {
+        return 0;
+    }
+
+    File file = this->fs.open(this->path, "r");
+
+    if (!file) {
+        return 0;
+    }
+
+    uint16_t length = 0;
+    size_t size = 0;
+
+    file.seek(this->readPos);
+
+    if (file.read((uint8_t *)&length, sizeof(length)) == sizeof(length)) {
+        this->headLength = length;
+
+        if (length <= maxSize && file.read(packet, length) == length) {
+            size = length;
+        }
+    }
+
+    file.close();
+
+    return size;
+}
+
+void SmartMeter238FileSpill::pop() {
+    if (this->count == 0) {
+        return;
+    }
+
+    if (--this->count == 0) {
+        this->clear();
+
+        return;
+    }
+
+    File file;
+
+    if (this->headLength == 0) {
+        file = this->fs.open(this->path, "r");
+
+        if (file) {
+            file.seek(this->readPos);
+            file.read((uint8_t *)&this->headLength, sizeof(this->headLength));
+            file.close();
+        }
+    }
+
+    this->readPos += sizeof(this->headLength) + this->headLength;
+    this->headLength = 0;
+
+    file = this->fs.open(this->path, "r+");
+
+    if (file) {
+        file.write((const uint8_t *)&this->readPos, sizeof(this->readPos));
+        file.close();
+    }
+}
+
+uint32_t SmartMeter238FileSpill::getCount() {
+    return this->count;
+}
+#endif
+
+SmartMeter238Uplink::SmartMeter238Uplink(SmartMeter238UplinkSink *sink, SmartMeter238UplinkSpill *spill) : sink(sink), spill(spill) {
+}
+
+void SmartMeter238Uplink::setMaxBatch(uint8_t records) {
+    this->maxBatch = constrain(records, 1, SM_UPLINK_MAX_BATCH);
+}
+
+void SmartMeter238Uplink::setMaxDelay(unsigned long maxDelay) {
+    this->maxDelay = maxDelay;
+}
+
+void SmartMeter238Uplink::setPressureCallback(smPressureCallback callback, void *context) {
+    this->callback = callback;
+    this->context = context;
+}
+
+SmartMeter238Uplink::smUplinkPressure SmartMeter238Uplink::getPressure() {
+    return this->pressure;
+}
+
+uint32_t SmartMeter238Uplink::getQueuedCount() {
+    return this->count;
+}
+
+uint32_t SmartMeter238Uplink::getSpilledCount() {
+    return (this->spill != nullptr) ? this->spill->getCount() : 0;
+}
+
+uint32_t SmartMeter238Uplink::getDroppedCount() {
+    return this->droppedCount;
+}
+
+uint32_t SmartMeter238Uplink::getSentCount() {
+    return this->sentCount;
+}
+
+void SmartMeter238Uplink::push(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject) {
+    if (this->count == SM_UPLINK_QUEUE_SIZE && !this->spillPacket()) {
+        // No room anywhere, the oldest record is lost
+        if (this->packetSize > 0 && !this->packetFromSpill) {
+            this->resetPacket();
+        }
+
+        this->head = (this->head + 1) % SM_UPLINK_QUEUE_SIZE;
+        this->count--;
+        this->droppedCount++;
+    }
+
+    smUplinkRecord *record = &this->queue[(this->head + this->count) % SM_UPLINK_QUEUE_SIZE];
+
+    sm.decodeMeasurementFields(dataObject);   // every field goes in the record
+
+    uint64_t timestamp = dataObject->measurementData.timestamp;
+
+    record->timestamp = sm.getClock()->hasEpoch() ? sm.getClock()->toEpoch(timestamp) : timestamp;
+    record->queued = millis();
+
+    record->value[SmartMeter238::SM_FIELD_CURRENT] = dataObject->measurementData.data.current;
+    record->value[SmartMeter238::SM_FIELD_VOLTAGE] = dataObject->measurementData.data.voltage;
+    record->value[SmartMeter238::SM_FIELD_FREQUENCY] = dataObject->measurementData.data.frequency;
+
+    record->value[SmartMeter238::SM_FIELD_REACTIVEPOWER] = dataObject->measurementData.data.reactivePower;
+    record->value[SmartMeter238::SM_FIELD_ACTIVEPOWER] = dataObject->measurementData.data.activePower;
+    record->value[SmartMeter238::SM_FIELD_POWERFACTOR] = dataObject->measurementData.data.powerFactor;
+
+    record->value[SmartMeter238::SM_FIELD_TOTALENERGY] = dataObject->measurementData.data.lapseOfTimeTotalEnergy;
+    record->value[SmartMeter238::SM_FIELD_IMPORTENERGY] = dataObject->measurementData.data.lapseOfTimeImportEnergy;
+    record->value[SmartMeter238::SM_FIELD_EXPORTENERGY] = dataObject->measurementData.data.lapseOfTimeExportEnergy;
+    record->value[SmartMeter238::SM_FIELD_PRICEENERGY] = dataObject->measurementData.data.lapseOfTimePriceEnergy;
+
+    record->value[SmartMeter238::SM_FIELD_TOTALKWH] = dataObject->measurementData.data.totalKWh;
+
+    this->count++;
+
+    this->updatePressure();
+}
+
+bool SmartMeter238Uplink::loop() {
+    bool ready = (this->sink != nullptr) && this->sink->isReady();
+    bool sent = false;
+
+    if (ready && this->packetSize == 0) {
+        if (this->spill != nullptr && this->spill->getCount() > 0) {
+            // The spill is older than anything in RAM, it goes first
+            this->packetSize = this->spill->peek(this->packet, sizeof(this->packet));
+            this->packetFromSpill = true;
+
+            if (this->packetSize == 0) {
+                // Unreadable, skip it
+                this->spill->pop();
+            }
+        } else if (this->count >= this->maxBatch || (this->count > 0 && (millis() - this->queue[this->head].queued) >= this->maxDelay)) {
+            this->buildPacket();
+        }
+    }
+
+    if (ready && this->packetSize > 0 && this->sink->send(this->packet, this->packetSize)) {
+        if (this->packetFromSpill) {
+            this->spill->pop();
+            this->spillFull = false;
+        } else {
+            this->commitPacket();
+        }
+
+        this->packetSize = 0;
+        this->sentCount++;
+
+        sent = true;
+    }
+
+    // Link down or slow, keep room in RAM for the new records
+    if (this->count >= SM_UPLINK_HIGH_WATERMARK) {
+        this->spillPacket();
+    }
+
+    this->updatePressure();
+
+    return sent;
+}
+
+void SmartMeter238Uplink::buildPacket() {
+    uint8_t records = min((uint16_t)this->maxBatch, this->count);
+
+    this->packet[0] = 'S';
+    this->packet[1] = 'U';
+    this->packet[2] = SM_UPLINK_PACKET_VERSION;
+    this->packet[3] = records;
+
+    memcpy(&this->packet[4], &this->sequence, sizeof(this->sequence));
+
+    uint8_t *pos = &this->packet[SM_UPLINK_PACKET_HEADER];
+
+    for (uint8_t i = 0; i < records; i++) {
+        smUplinkRecord *record = &this->queue[(this->head + i) % SM_UPLINK_QUEUE_SIZE];
+
+        memcpy(pos, &record->timestamp, sizeof(record->timestamp));
+        pos += sizeof(record->timestamp);
+
+        memcpy(pos, record->value, sizeof(record->value));
+        pos += sizeof(record->value);
+    }
+
+    this->packetSize = pos - this->packet;
+    this->packetRecords = records;
+    this->packetFromSpill = false;
+}
+
+void SmartMeter238Uplink::commitPacket() {
+    // The records of the packet leave the queue, a packet rebuilt before this keeps its sequence
+    this->head = (this->head + this->packetRecords) % SM_UPLINK_QUEUE_SIZE;
+    this->count -= this->packetRecords;
+    this->sequence++;
+}
+
+void SmartMeter238Uplink::resetPacket() {
+    // The sink may have written part of it
+    if (this->packetSize > 0 && this->sink != nullptr) {
+        this->sink->reset();
+    }
+
+    this->packetSize = 0;
+}
+
+bool SmartMeter238Uplink::spillPacket() {
+    if (this->spill == nullptr || this->spillFull || this->count == 0) {
+        return false;
+    }
+
+    // The packet in progress is given up, its records are sent again whole from the spill. A copy of the spill
+    // head is dropped, the oldest records in RAM go behind it
+    this->resetPacket();
+    this->buildPacket();
+
+    bool spilled = this->spill->push(this->packet, this->packetSize);
+
+    if (spilled) {
+        this->commitPacket();
+    } else {
+        this->spillFull = true;
+    }
+
+    this->packetSize = 0;
+
+    return spilled;
+}
+
+void SmartMeter238Uplink::updatePressure() {
+    smUplinkPressure pressure = SM_UPLINK_NORMAL;
+
+    if (this->count == SM_UPLINK_QUEUE_SIZE && (this->spill == nullptr || this->spillFull)) {
+        pressure = SM_UPLINK_FULL;
+    } else if (this->count >= SM_UPLINK_HIGH_WATERMARK || this->getSpilledCount() > 0) {
+        pressure = SM_UPLINK_BACKLOG;
+    }
+
+    if (pressure != this->pressure) {
+        this->pressure = pressure;
+
+        if (this->callback != nullptr) {
+            this->callback(pressure, this->context);
+        }
+    }
+}
+
+void SmartMeter238Uplink::onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) {
+    if (cmd == SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA) {
+        this->push(sm, dataObject);
+    }
+}
@@ -0,0 +1,183 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Uplink_h
+#define SmartMeter238Uplink_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+#include <Client.h>
+
+#if defined(ESP8266) || defined(ESP32)
+#include <FS.h>
+#endif
+
+// Destination of the packets (broker connection, socket, ...). send() must not block: it returns false when the
+// packet can not be taken now and the uplink retries the same packet later, so a sink may keep a partial write.
+// reset() is called when the uplink gives up the packet in progress (spilled or dropped), the next send() is a
+// new packet.
+class SmartMeter238UplinkSink {
+   public:
+    virtual ~SmartMeter238UplinkSink() {}
+
+    virtual bool isReady() = 0;
+    virtual bool send(const uint8_t *packet, size_t size) = 0;
+    virtual void reset() = 0;
+};
+
+// Storage for packets the sink could not take in time, read back in the same order they were written.
+class SmartMeter238UplinkSpill {
+   public:
+    virtual ~SmartMeter238UplinkSpill() {}
+
+    virtual bool push(const uint8_t *packet, size_t size) = 0;   // false when full
+    virtual size_t peek(uint8_t *packet, size_t maxSize) = 0;    // oldest packet, 0 when empty
+    virtual void pop() = 0;
+    virtual uint32_t getCount() = 0;
+};
+
+// Sink over an Arduino Client (WiFiClient, EthernetClient, ...). Packets are self delimited so they go to the
+// stream as they are. Connecting and reconnecting the client is left to the sketch; reset() of a packet already
+// partly written stops the client, the receiver drops the cut packet with the connection.
+class SmartMeter238ClientSink : public SmartMeter238UplinkSink {
+   public:
+    SmartMeter238ClientSink(Client &client);
+
+    bool isReady() override;
+    bool send(const uint8_t *packet, size_t size) override;
+    void reset() override;
+
+   private:
+    Client &client;
+    size_t offset = 0;   // bytes of the current packet already written
+};
+
+#if defined(ESP8266) || defined(ESP32)
+// Spill to a file (LittleFS, SPIFFS, SD). The read position is kept in the file header, so packets left by a
+// previous run are replayed after a reboot. Space is given back when the file is emptied.
+class SmartMeter238FileSpill : public SmartMeter238UplinkSpill {
+   public:
+    SmartMeter238FileSpill(fs::FS &fs, const char *path, uint32_t maxSize);
+
+    bool begin();   // counts the packets left in the file
+    void clear();
+
+    bool push(const uint8_t *packet, size_t size) override;
+    size_t peek(uint8_t *packet, size_t maxSize) override;
+    void pop() override;
+    uint32_t getCount() override;
+
+   private:
+    fs::FS &fs;
+    const char *path;
+    uint32_t maxSize;
+
+    uint32_t readPos = sizeof(uint32_t);
+    uint32_t count = 0;
+    uint16_t headLength = 0;   // size of the oldest packet, 0 when not read yet
+    bool damaged = false;      // a write failed, no more packets until the file is emptied
+};
+#endif
+
+// Store and forward of the measurements towards a sink. Records are queued in RAM and sent in packets of up to
+// maxBatch records or when the oldest one has waited maxDelay. While the sink is down or slow the queue grows;
+// over the high watermark the oldest records go to the spill and are replayed in order before any new packet.
+// Without room anywhere the oldest record is dropped. Nothing here blocks, call loop() as often as possible.
+//
+// Packet, little endian: 'S' 'U' version count, uint32 sequence, then count records of uint64 timestamp and
+// SM_FIELD_COUNT floats in smMeasurementField order. The timestamp is wall clock micros when the clock has an
+// epoch, micros since boot otherwise. The sequence starts at 0 with the uplink.
+class SmartMeter238Uplink : public SmartMeter238Observer {
+   public:
+    enum smUplinkPressure {
+        SM_UPLINK_NORMAL,    // data flows to the sink
+        SM_UPLINK_BACKLOG,   // queue over the high watermark or packets waiting in the spill
+        SM_UPLINK_FULL       // queue full with no spill room, records are being dropped
+    };
+
+    typedef void (*smPressureCallback)(smUplinkPressure pressure, void *context);
+
+    SmartMeter238Uplink(SmartMeter238UplinkSink *sink, SmartMeter238UplinkSpill *spill = nullptr);
+
+    void setMaxBatch(uint8_t records);
+    void setMaxDelay(unsigned long maxDelay);   // millis
+    void setPressureCallback(smPressureCallback callback, void *context = nullptr);
+
+    smUplinkPressure getPressure();
+
+    uint32_t getQueuedCount();    // records in RAM
+    uint32_t getSpilledCount();   // packets in the spill
+    uint32_t getDroppedCount();
+    uint32_t getSentCount();      // packets
+
+    void push(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject);
+    bool loop();   // true when a packet was sent
+
+    void onDataUpdate(SmartMeter238 &sm, SmartMeter238::smCommandReceive cmd, SmartMeter238::smartMeterData *dataObject) override;
+
+   private:
+    typedef struct {
+        uint64_t timestamp;
+        float value[SmartMeter238::SM_FIELD_COUNT];
+        unsigned long queued;   // millis
+    } smUplinkRecord;
+
+    SmartMeter238UplinkSink *sink;
+    SmartMeter238UplinkSpill *spill;
+
+    uint8_t maxBatch = SM_UPLINK_MAX_BATCH;
+    unsigned long maxDelay = SM_UPLINK_DEFAULT_MAX_DELAY;
+
+    smPressureCallback callback = nullptr;
+    void *context = nullptr;
+    smUplinkPressure pressure = SM_UPLINK_NORMAL;
+
+    smUplinkRecord queue[SM_UPLINK_QUEUE_SIZE];
+    uint16_t head = 0;   // oldest record
+    uint16_t count = 0;
+
+    // Packet being sent, taken from the queue or a copy of the oldest one in the spill
+    uint8_t packet[SM_UPLINK_PACKET_HEADER + (SM_UPLINK_MAX_BATCH * (sizeof(uint64_t) + (SmartMeter238::SM_FIELD_COUNT * sizeof(float))))];
+    size_t packetSize = 0;
+    uint8_t packetRecords = 0;
+    bool packetFromSpill = false;
+    bool spillFull = false;
+
+    uint32_t sequence = 0;
+    uint32_t droppedCount = 0;
+    uint32_t sentCount = 0;
+
+    void buildPacket();
+    void commitPacket();
+    void resetPacket();
+    bool spillPacket();
+    void updatePressure();
+};
+#endif   // SmartMeter238Uplink_h
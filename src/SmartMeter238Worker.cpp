@@ -0,0 +1,463 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#include "SmartMeter238Worker.h"
+//------------------------------------------------------------------------------
+
+SmartMeter238Worker::SmartMeter238Worker(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject) : sm(sm), dataObject(dataObject) {
+    for (uint8_t queue = 0; queue < SM_QUEUE_COUNT; queue++) {
+        for (uint32_t i = 0; i < SM_WORKER_QUEUE_SIZE; i++) {
+            this->cells[queue][i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        this->enqueuePos[queue].store(0, std::memory_order_relaxed);
+    }
+
+    this->rejectedCount.store(0, std::memory_order_relaxed);
+    this->completedCount.store(0, std::memory_order_relaxed);
+    this->transactionCount.store(0, std::memory_order_relaxed);
+
+    this->maxLatency.store(0, std::memory_order_relaxed);
+    this->latencySum.store(0, std::memory_order_relaxed);
+    this->latencyCount.store(0, std::memory_order_relaxed);
+
+    this->maxControlLatency.store(0, std::memory_order_relaxed);
+    this->controlLatencySum.store(0, std::memory_order_relaxed);
+    this->controlLatencyCount.store(0, std::memory_order_relaxed);
+    this->abortedCount.store(0, std::memory_order_relaxed);
+}
+
+SmartMeter238Worker::~SmartMeter238Worker() {
+#ifdef SM_WORKER_USE_RTOS
+    if (this->taskHandle != nullptr) {
+        vTaskDelete(this->taskHandle);
+    }
+#endif
+
+#ifdef SM_WORKER_USE_THREAD
+    if (this->thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->stopping = true;
+        }
+
+        this->workCondition.notify_one();
+        this->thread.join();
+    }
+#endif
+}
+
+bool SmartMeter238Worker::begin() {
+#ifdef SM_WORKER_USE_RTOS
+    if (this->taskHandle == nullptr) {
+        return xTaskCreate(SmartMeter238Worker::task, "SmartMeter238", SM_WORKER_TASK_STACK, this, SM_WORKER_TASK_PRIORITY, &this->taskHandle) == pdPASS;
+    }
+#endif
+
+#ifdef SM_WORKER_USE_THREAD
+    if (!this->thread.joinable()) {
+        this->thread = std::thread(&SmartMeter238Worker::run, this);
+    }
+#endif
+
+    return true;
+}
+
+#ifdef SM_WORKER_USE_RTOS
+void SmartMeter238Worker::task(void *parameter) {
+    SmartMeter238Worker *worker = static_cast<SmartMeter238Worker *>(parameter);
+
+    while (true) {
+        if (!worker->loop()) {
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);   // sleep until the next submit
+        }
+    }
+}
+#endif
+
+#ifdef SM_WORKER_USE_THREAD
+void SmartMeter238Worker::run() {
+    while (true) {
+        if (this->loop()) {
+            continue;
+        }
+
+        // The queues are checked under the lock that submit() takes before notifying, no wake up is lost
+        std::unique_lock<std::mutex> lock(this->mutex);
+
+        this->workCondition.wait(lock, [this]() { return this->stopping || this->isPending(SM_QUEUE_CONTROL) || this->isPending(SM_QUEUE_ROUTINE); });
+
+        if (this->stopping) {
+            return;
+        }
+    }
+}
+#endif
+
+// Max kept by the worker while other tasks may clear it
+static void smStoreMax(std::atomic<uint32_t> &max, uint32_t value) {
+    uint32_t current = max.load(std::memory_order_relaxed);
+
+    while (value > current && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+bool SmartMeter238Worker::submit(smRequest &request) {
+    if (request.completion != nullptr) {
+        request.completion->done.store(false, std::memory_order_relaxed);
+    }
+
+    request.submitMicros = micros();
+
+    smQueue queue = isControl(request.type) ? SM_QUEUE_CONTROL : SM_QUEUE_ROUTINE;
+
+    // Bounded MPSC queue, every cell has a sequence that tells if it is free for the position
+    uint32_t pos = this->enqueuePos[queue].load(std::memory_order_relaxed);
+    smCell *cell;
+
+    while (true) {
+        cell = &this->cells[queue][pos & (SM_WORKER_QUEUE_SIZE - 1)];
+
+        int32_t diff = (int32_t)(cell->sequence.load(std::memory_order_acquire) - pos);
+
+        if (diff == 0) {
+            if (this->enqueuePos[queue].compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            this->rejectedCount.fetch_add(1, std::memory_order_relaxed);
+
+            if (request.completion != nullptr) {
+                request.completion->result.type = request.type;
+                request.completion->result.success = false;
+                request.completion->result.errCode = SmartMeter238::SM_ERR_QUEUE_FULL;
+                request.completion->result.latency = 0;
+
+                request.completion->done.store(true, std::memory_order_release);
+            }
+
+            return false;   // queue full
+        } else {
+            pos = this->enqueuePos[queue].load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->request = request;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+
+#ifdef SM_WORKER_USE_RTOS
+    if (this->taskHandle != nullptr) {
+        xTaskNotifyGive(this->taskHandle);
+    }
+#endif
+
+#ifdef SM_WORKER_USE_THREAD
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+    }
+
+    this->workCondition.notify_one();
+#endif
+
+    return true;
+}
+
+bool SmartMeter238Worker::submit(smRequestType type, smCompletion *completion) {
+    smRequest request;
+
+    request.type = type;
+    request.completion = completion;
+
+    return this->submit(request);
+}
+
+bool SmartMeter238Worker::isPending(smQueue queue) {
+    smCell *cell = &this->cells[queue][this->dequeuePos[queue] & (SM_WORKER_QUEUE_SIZE - 1)];
+
+    return (int32_t)(cell->sequence.load(std::memory_order_acquire) - (this->dequeuePos[queue] + 1)) >= 0;
+}
+
+bool SmartMeter238Worker::pop(smQueue queue, smRequest *request) {
+    if (!this->isPending(queue)) {
+        return false;   // empty
+    }
+
+    smCell *cell = &this->cells[queue][this->dequeuePos[queue] & (SM_WORKER_QUEUE_SIZE - 1)];
+
+    *request = cell->request;
+    cell->sequence.store(this->dequeuePos[queue] + SM_WORKER_QUEUE_SIZE, std::memory_order_release);
+
+    this->dequeuePos[queue]++;
+
+    return true;
+}
+
+bool SmartMeter238Worker::runControl() {
+    smRequest request;
+    bool done = false;
+
+    while (this->pop(SM_QUEUE_CONTROL, &request)) {
+        bool success = this->execute(request);
+
+        this->complete(request, success, this->sm.getErrCode());
+
+        done = true;
+    }
+
+    return done;
+}
+
+bool SmartMeter238Worker::loop() {
+    bool worked = this->runControl();
+
+    smRequest batch[SM_WORKER_BATCH_SIZE];
+    uint8_t size = 0;
+
+    while (size < SM_WORKER_BATCH_SIZE && this->pop(SM_QUEUE_ROUTINE, &batch[size])) {
+        size++;
+    }
+
+    if (size == 0) {
+        return worked;
+    }
+
+    // Back to back reads of the same data are answered by a single transaction, a request that does not
+    // match ends the run so a read is never answered with data from before a write queued ahead of it
+    uint8_t i = 0;
+
+    while (i < size) {
+        this->runControl();
+
+        bool success = this->execute(batch[i]);
+        SmartMeter238::smErrorCode errCode = this->sm.getErrCode();
+
+        this->complete(batch[i], success, errCode);
+
+        uint8_t n = i + 1;
+
+        // An aborted read leaves its duplicates for a new transaction after the control requests
+        if (success || errCode != SmartMeter238::SM_ERR_ABORTED) {
+            while (n < size && this->sameTransaction(batch[i], batch[n])) {
+                this->complete(batch[n], success, errCode);
+
+                n++;
+            }
+        }
+
+        i = n;
+    }
+
+    return true;
+}
+
+bool SmartMeter238Worker::sameTransaction(smRequest &a, smRequest &b) {
+    if (a.type != b.type) {
+        return false;
+    }
+
+    switch (a.type) {
+        case SM_REQ_GET_POWERCUT:
+        case SM_REQ_GET_MEASUREMENTDATA:
+        case SM_REQ_GET_LIMITANDPURCHASEDATA:
+            return true;
+        default:
+            return false;   // sets are always sent
+    }
+}
+
+bool SmartMeter238Worker::isControl(smRequestType type) {
+    switch (type) {
+        case SM_REQ_SET_POWERCUT:
+        case SM_REQ_SET_DELAY:
+        case SM_REQ_SET_RESET:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool SmartMeter238Worker::read(SmartMeter238::smCommandReceive cmd) {
+    if (!this->sm.startRead(cmd, this->dataObject)) {
+        return false;
+    }
+
+    SmartMeter238::smTransactionState state;
+
+    while ((state = this->sm.pollRead()) == SmartMeter238::SM_TRANSACTION_BUSY) {
+        // A control request does not wait for the rest of the read
+        if (this->isPending(SM_QUEUE_CONTROL)) {
+            this->sm.abortRead();
+            this->abortedCount.fetch_add(1, std::memory_order_relaxed);
+
+            return false;
+        }
+
+        yield();
+    }
+
+    return state == SmartMeter238::SM_TRANSACTION_DONE;
+}
+
+bool SmartMeter238Worker::execute(smRequest &request) {
+    this->transactionCount.fetch_add(1, std::memory_order_relaxed);
+
+    switch (request.type) {
+        case SM_REQ_GET_POWERCUT:
+            return this->read(SmartMeter238::SM_CMD_RESP_POWERCUT);
+        case SM_REQ_GET_MEASUREMENTDATA:
+            return this->read(SmartMeter238::SM_CMD_RESP_MEASUREMENTDATA);
+        case SM_REQ_GET_LIMITANDPURCHASEDATA:
+            return this->read(SmartMeter238::SM_CMD_RESP_LIMITANDPURCHASEDATA);
+        case SM_REQ_SET_LIMITDATA:
+            return this->sm.setLimitsData(request.value1, request.value2, request.value3, this->dataObject);
+        case SM_REQ_SET_PURCHASEDATA:
+            return this->sm.setPurchaseData(request.value1, request.value2, request.flag, this->dataObject);
+        case SM_REQ_SET_POWERCUT:
+            return this->sm.setPowerCutData(request.flag, this->dataObject);
+        case SM_REQ_SET_DELAY:
+            return this->sm.setDelay(request.flag, request.value1, this->dataObject);
+        case SM_REQ_SET_RESET:
+            return this->sm.setReset(this->dataObject);
+        case SM_REQ_SET_POWERCOMPANYDATA:
+            return this->sm.setPowerCompanyData(request.value1, request.value2, this->dataObject);
+    }
+
+    return false;
+}
+
+void SmartMeter238Worker::complete(smRequest &request, bool success, SmartMeter238::smErrorCode errCode) {
+    smResult result;
+
+    result.type = request.type;
+    result.success = success;
+    result.errCode = errCode;
+    result.latency = micros() - request.submitMicros;
+
+    this->completedCount.fetch_add(1, std::memory_order_relaxed);
+
+    smStoreMax(this->maxLatency, result.latency);
+
+    this->latencySum.fetch_add(result.latency, std::memory_order_relaxed);
+    this->latencyCount.fetch_add(1, std::memory_order_relaxed);
+
+    if (isControl(request.type)) {
+        smStoreMax(this->maxControlLatency, result.latency);
+
+        this->controlLatencySum.fetch_add(result.latency, std::memory_order_relaxed);
+        this->controlLatencyCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (request.callback != nullptr) {
+        request.callback(result, request.context);
+    }
+
+    if (request.completion != nullptr) {
+        request.completion->result = result;
+        request.completion->done.store(true, std::memory_order_release);
+
+#ifdef SM_WORKER_USE_THREAD
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+        }
+
+        this->doneCondition.notify_all();
+#endif
+    }
+}
+
+bool SmartMeter238Worker::wait(smCompletion *completion, unsigned long timeout) {
+#ifdef SM_WORKER_USE_THREAD
+    // Only the worker thread (or the one task calling loop()) consumes the queue, the caller just sleeps
+    std::unique_lock<std::mutex> lock(this->mutex);
+
+    return this->doneCondition.wait_for(lock, std::chrono::milliseconds(timeout), [completion]() { return completion->done.load(std::memory_order_acquire); });
+#else
+    unsigned long start = millis();
+
+    while (!completion->done.load(std::memory_order_acquire)) {
+        if ((millis() - start) >= timeout) {
+            return false;
+        }
+
+#ifdef SM_WORKER_USE_RTOS
+        vTaskDelay(1);
+#else
+        this->loop();   // single task, nobody else does the work
+#endif
+    }
+
+    return true;
+#endif
+}
+
+uint32_t SmartMeter238Worker::getCompletedCount() {
+    return this->completedCount.load(std::memory_order_relaxed);
+}
+
+uint32_t SmartMeter238Worker::getRejectedCount() {
+    return this->rejectedCount.load(std::memory_order_relaxed);
+}
+
+uint32_t SmartMeter238Worker::getTransactionCount() {
+    return this->transactionCount.load(std::memory_order_relaxed);
+}
+
+uint32_t SmartMeter238Worker::getMaxLatency(bool clear) {
+    if (clear) {
+        return this->maxLatency.exchange(0, std::memory_order_relaxed);
+    }
+
+    return this->maxLatency.load(std::memory_order_relaxed);
+}
+
+uint32_t SmartMeter238Worker::getAverageLatency(bool clear) {
+    uint32_t count = clear ? this->latencyCount.exchange(0, std::memory_order_relaxed) : this->latencyCount.load(std::memory_order_relaxed);
+    uint64_t sum = clear ? this->latencySum.exchange(0, std::memory_order_relaxed) : this->latencySum.load(std::memory_order_relaxed);
+
+    return count > 0 ? sum / count : 0;
+}
+
+uint32_t SmartMeter238Worker::getMaxControlLatency(bool clear) {
+    if (clear) {
+        return this->maxControlLatency.exchange(0, std::memory_order_relaxed);
+    }
+
+    return this->maxControlLatency.load(std::memory_order_relaxed);
+}
+
+uint32_t SmartMeter238Worker::getAverageControlLatency(bool clear) {
+    uint32_t count = clear ? this->controlLatencyCount.exchange(0, std::memory_order_relaxed) : this->controlLatencyCount.load(std::memory_order_relaxed);
+    uint64_t sum = clear ? this->controlLatencySum.exchange(0, std::memory_order_relaxed) : this->controlLatencySum.load(std::memory_order_relaxed);
+
+    return count > 0 ? sum / count : 0;
+}
+
+uint32_t SmartMeter238Worker::getAbortedCount() {
+    return this->abortedCount.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,185 @@
+/*
+Library for reading DDS238-4 W Wifi Smart meter (SM).
+Reading via Hardware Serial
+2020 (development with PlatformIO IDE for VSCode & esp8266 core)
+
+MIT License
+
+Copyright (c) 2020 Rodrigo González
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+//------------------------------------------------------------------------------
+#ifndef SmartMeter238Worker_h
+#define SmartMeter238Worker_h
+//------------------------------------------------------------------------------
+
+#include "SmartMeter238.h"
+
+#include <atomic>
+
+#if defined(ESP32)
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#define SM_WORKER_USE_RTOS
+#elif !defined(ARDUINO)
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#define SM_WORKER_USE_THREAD
+#endif
+
+// A single worker owns the serial link, other tasks submit requests to a bounded lock-free queue and get the
+// result in a callback (called from the worker) or in a completion. On ESP32 begin() starts a FreeRTOS task and
+// on host builds (no ARDUINO) a std::thread, loop() must not be called then; on other targets loop() has to be
+// called from the sketch loop. The statistics can be read from any task.
+// Control requests (power cut, delay, reset) have their own queue and go before any other request; a read in
+// progress is aborted at the next frame boundary when one arrives and completes with SM_ERR_ABORTED.
+class SmartMeter238Worker {
+   public:
+    enum smRequestType {
+        SM_REQ_GET_POWERCUT,
+        SM_REQ_GET_MEASUREMENTDATA,
+        SM_REQ_GET_LIMITANDPURCHASEDATA,
+
+        SM_REQ_SET_LIMITDATA,           // value1 = maxCurrentLimit, value2 = maxVoltageLimit, value3 = minVoltageLimit
+        SM_REQ_SET_PURCHASEDATA,        // value1 = energyPurchase, value2 = energyPurchaseAlarm, flag = energyPurchaseStatus
+        SM_REQ_SET_POWERCUT,            // flag = powerCut
+        SM_REQ_SET_DELAY,               // flag = delaySetPowerCut, value1 = delay
+        SM_REQ_SET_RESET,
+        SM_REQ_SET_POWERCOMPANYDATA     // value1 = startingKWh, value2 = priceKWh
+    };
+
+    typedef struct {
+        smRequestType type;
+
+        bool success;
+        SmartMeter238::smErrorCode errCode;
+
+        uint32_t latency;   // micros from submit to complete
+    } smResult;
+
+    typedef struct {
+        std::atomic<bool> done;
+        smResult result;
+    } smCompletion;
+
+    typedef void (*smCallback)(const smResult &result, void *context);
+
+    typedef struct {
+        smRequestType type = SM_REQ_GET_MEASUREMENTDATA;
+
+        float value1 = 0;
+        float value2 = 0;
+        float value3 = 0;
+        bool flag = false;
+
+        smCallback callback = nullptr;
+        void *context = nullptr;
+        smCompletion *completion = nullptr;
+
+        unsigned long submitMicros = 0;
+    } smRequest;
+
+    SmartMeter238Worker(SmartMeter238 &sm, SmartMeter238::smartMeterData *dataObject);
+    virtual ~SmartMeter238Worker();
+
+    bool begin();
+    bool loop();
+
+    bool submit(smRequest &request);
+    bool submit(smRequestType type, smCompletion *completion);
+
+    bool wait(smCompletion *completion, unsigned long timeout);
+
+    uint32_t getCompletedCount();
+    uint32_t getRejectedCount();
+    uint32_t getTransactionCount();
+    uint32_t getMaxLatency(bool clear = false);
+    uint32_t getAverageLatency(bool clear = false);
+
+    // Control requests only, micros from submit to the meter confirming the relay state
+    uint32_t getMaxControlLatency(bool clear = false);
+    uint32_t getAverageControlLatency(bool clear = false);
+    uint32_t getAbortedCount();
+
+    static bool isControl(smRequestType type);
+
+   private:
+    typedef struct {
+        std::atomic<uint32_t> sequence;
+        smRequest request;
+    } smCell;
+
+    SmartMeter238 &sm;
+    SmartMeter238::smartMeterData *dataObject;
+
+    enum smQueue {
+        SM_QUEUE_CONTROL,
+        SM_QUEUE_ROUTINE,
+
+        SM_QUEUE_COUNT
+    };
+
+    smCell cells[SM_QUEUE_COUNT][SM_WORKER_QUEUE_SIZE];
+
+    std::atomic<uint32_t> enqueuePos[SM_QUEUE_COUNT];
+    uint32_t dequeuePos[SM_QUEUE_COUNT] = {};
+
+    std::atomic<uint32_t> rejectedCount;
+    std::atomic<uint32_t> completedCount;
+    std::atomic<uint32_t> transactionCount;
+
+    std::atomic<uint32_t> maxLatency;
+    std::atomic<uint64_t> latencySum;
+    std::atomic<uint32_t> latencyCount;
+
+    std::atomic<uint32_t> maxControlLatency;
+    std::atomic<uint64_t> controlLatencySum;
+    std::atomic<uint32_t> controlLatencyCount;
+    std::atomic<uint32_t> abortedCount;
+
+#ifdef SM_WORKER_USE_RTOS
+    TaskHandle_t taskHandle = nullptr;
+
+    static void task(void *parameter);
+#endif
+
+#ifdef SM_WORKER_USE_THREAD
+    std::thread thread;
+    bool stopping = false;
+
+    // Wakes the thread on submit and the waiters on complete, the queue itself takes no lock
+    std::mutex mutex;
+    std::condition_variable workCondition;
+    std::condition_variable doneCondition;
+
+    void run();
+#endif
+
+    bool pop(smQueue queue, smRequest *request);
+    bool isPending(smQueue queue);
+    bool runControl();
+    bool read(SmartMeter238::smCommandReceive cmd);
+    bool execute(smRequest &request);
+    void complete(smRequest &request, bool success, SmartMeter238::smErrorCode errCode);
+    bool sameTransaction(smRequest &a, smRequest &b);
+};
+#endif   // SmartMeter238Worker_h